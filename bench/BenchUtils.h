@@ -0,0 +1,14 @@
+#ifndef BENCH_UTILS_H_
+#define BENCH_UTILS_H_
+
+#include <chrono>
+
+/// Wall clock time aFunction takes to run, in milliseconds
+template<typename Function>
+double time_ms(Function aFunction){
+    auto start = std::chrono::steady_clock::now();
+    aFunction();
+    return(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+#endif
@@ -0,0 +1,51 @@
+// Culls a scene of 100k objects against the view frustum with the vectorized kernel and the scalar reference, and
+// reports how long each takes per frame and how many objects stay visible.
+// Usage: culling_bench [object count]   (defaults to 100000)
+
+#include "utils/Culling.h"
+#include "BenchUtils.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    size_t objectCount = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    // Boxes of random size and rotation scattered through a cube of 1000 units, with the camera at its center
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f), size(0.5f, 8.0f), angle(0.0f, 6.2831853f);
+    BoundsBatch batch;
+    for(size_t i = 0; i < objectCount; ++i){
+        glm::vec3 extent(size(random), size(random), size(random));
+        Bounds local = make_bounds(-extent, extent, glm::length(extent));
+        glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random))),
+                                      angle(random), glm::normalize(glm::vec3(position(random), position(random), position(random))));
+        batch.push_back(transform_bounds(local, model));
+    }
+    printf("%zu objects, %zu bytes of bounds\n", objectCount, objectCount * 7 * sizeof(float));
+
+    const glm::mat4 projection = glm::perspective(60.0f * 3.14159265f / 180.0f, 16.0f / 9.0f, 0.1f, 400.0f);
+    const int frameCount = 200;
+    std::vector<uint32_t> visible;
+    visible.reserve(objectCount);
+
+    // Each frame looks a different way, so the branchy scalar path can't learn the outcome of every object
+    for(int kernel = 0; kernel < 2; ++kernel){
+        size_t keptCount = 0;
+        double ms = time_ms([&](){
+            for(int frame = 0; frame < frameCount; ++frame){
+                float yaw = 6.2831853f * frame / frameCount;
+                glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::cos(yaw), 0.3f, std::sin(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+                Frustum frustum = extract_frustum(projection * view);
+                visible.clear();
+                keptCount += kernel == 0 ? cull_bounds(visible, batch, frustum) : cull_bounds_scalar(visible, batch, frustum);
+            }
+        }) / frameCount;
+        printf("%-10s %7.3f ms per frame, %5.2f ns per object, %4.1f%% visible\n", kernel == 0 ? "Vectorized" : "Scalar",
+               ms, ms * 1e6 / objectCount, 100.0 * keptCount / (double(frameCount) * objectCount));
+    }
+    return(0);
+}
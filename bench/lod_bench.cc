@@ -0,0 +1,82 @@
+// Builds the level of detail chain of a model and reports how many triangles a large field of instances of it
+// submits with and without per-instance LOD selection.
+// Usage: lod_bench [model.glb] [field size]   (defaults to suzanne in ASSET_DIR and a 316 x 316 field)
+
+#include "utils/common.h"
+#include "utils/ModelContainer.h"
+#include "utils/MeshSimplifier.h"
+#include "BenchUtils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static size_t lod_triangles(const ModelContainer& aModel, const CookedMesh::Lod& aLod){
+    size_t indexCount = 0;
+    for(uint32_t i = aLod.firstChunk; i < aLod.firstChunk + aLod.chunkCount; ++i) indexCount += aModel.chunks[i].indexCount;
+    return(indexCount / 3);
+}
+
+int main(int argc, char** argv){
+    std::string path = argc > 1 ? argv[1] : STRIFY(ASSET_DIR) "suzanne.glb";
+    const size_t fieldSize = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 316;
+
+    ModelContainer model(path, /* optimize = */ true, /* useCache = */ false);
+    std::vector<size_t> triangles;
+    printf("%s: %zu levels of detail\n", path.c_str(), model.lods.size());
+    for(size_t i = 0; i < model.lods.size(); ++i){
+        triangles.push_back(lod_triangles(model, model.lods[i]));
+        printf("  LOD %zu: %6zu triangles, error %.5f\n", i, triangles.back(), model.lods[i].error);
+    }
+
+    // Simplification speed, halving the full detail level like the LOD chain does
+    const CookedMesh::Lod& full = model.lods[0];
+    std::vector<uint32_t> fullIndices(model.indices.begin() + model.chunks[full.firstChunk].firstIndex,
+                                      model.indices.begin() + model.chunks[full.firstChunk].firstIndex + triangles[0] * 3);
+    std::vector<uint32_t> simplified;
+    const int repeats = 20;
+    double ms = time_ms([&](){
+        for(int i = 0; i < repeats; ++i){
+            simplify_mesh(simplified, fullIndices, model.positionData(), model.verts.size(), sizeof(SimpleVertex),
+                          fullIndices.size() / 6 * 3, FLT_MAX, model.normalData(), sizeof(SimpleVertex));
+        }
+    }) / repeats;
+    printf("Simplifying %zu -> %zu triangles: %.3f ms (%.2f M input triangles/s)\n\n",
+           triangles[0], simplified.size() / 3, ms, triangles[0] / ms / 1000.0);
+
+    // Instances on a grid in the xz plane, seen from just above one corner with a 60 degree vertical field of view
+    // at 1080p. The GPU side can't be measured without a device, so triangle counts stand in for throughput.
+    const float spacing = 3.0f;
+    const float pixelsPerUnit = 1080.0f * 0.5f / std::tan(0.5f * 60.0f * 3.14159265f / 180.0f);
+    const glm::vec3 camera(-spacing, 2.0f, -spacing);
+    const glm::vec3 center = (model.min + model.max) * 0.5f;
+    const float radius = glm::length(model.max - model.min) * 0.5f;
+    std::vector<float> distances;
+    distances.reserve(fieldSize * fieldSize);
+    for(size_t z = 0; z < fieldSize; ++z){
+        for(size_t x = 0; x < fieldSize; ++x){
+            glm::vec3 position = center + glm::vec3(x * spacing, 0.0f, z * spacing);
+            distances.push_back(glm::length(position - camera) - radius);
+        }
+    }
+    printf("Field of %zu instances, %.1f units apart\n", distances.size(), spacing);
+    printf("  full detail:        %12zu triangles\n", distances.size() * triangles[0]);
+
+    for(float maxPixelError : {0.5f, 1.0f, 2.0f, 4.0f}){
+        std::vector<size_t> histogram(model.lods.size(), 0);
+        size_t submitted = 0;
+        ms = time_ms([&](){
+            for(float distance : distances){
+                size_t lod = select_lod(model.lods, distance, pixelsPerUnit, maxPixelError);
+                ++histogram[lod];
+                submitted += triangles[lod];
+            }
+        });
+        printf("  %.1f pixel error:    %12zu triangles (%5.1f%%), selected in %.3f ms (%.1f ns per instance)   instances per LOD:",
+               maxPixelError, submitted, 100.0 * submitted / (distances.size() * triangles[0]), ms, ms * 1e6 / distances.size());
+        for(size_t count : histogram) printf(" %zu", count);
+        printf("\n");
+    }
+    return(0);
+}
@@ -0,0 +1,50 @@
+// Reports post-transform cache efficiency of glTF models before and after each mesh optimization pass.
+// Usage: mesh_optimization_bench [model.gltf]...   (defaults to the models in ASSET_DIR)
+
+#include "utils/common.h"
+#include "utils/ModelContainer.h"
+#include "utils/MeshOptimizer.h"
+#include "BenchUtils.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static void report(const char* aStage, const std::vector<uint32_t>& aIndices, size_t aVertexCount, double aMilliseconds){
+    VertexCacheStatistics fifo16 = analyze_vertex_cache(aIndices, aVertexCount, 16);
+    VertexCacheStatistics fifo32 = analyze_vertex_cache(aIndices, aVertexCount, 32);
+    printf("  %-12s ACMR %.3f / %.3f   ATVR %.3f / %.3f   %8.3f ms\n", aStage, fifo16.acmr, fifo32.acmr, fifo16.atvr, fifo32.atvr, aMilliseconds);
+}
+
+int main(int argc, char** argv){
+    std::vector<std::string> models;
+    for(int i = 1; i < argc; ++i) models.push_back(argv[i]);
+    if(models.empty()){
+        models = {STRIFY(ASSET_DIR) "cube.gltf", STRIFY(ASSET_DIR) "suzanne.gltf"};
+    }
+
+    printf("Post-transform cache simulation, FIFO with 16 / 32 entries\n");
+    for(const std::string& path : models){
+        ModelContainer model(path, /* optimize = */ false);
+        std::vector<SimpleVertex>& vertices = model.verts;
+        std::vector<uint32_t>& indices = model.indices;
+        // Every vertex has to be transformed at least once, which bounds how far the ACMR can drop
+        printf("%s: %zu vertices, %zu triangles, ACMR lower bound %.3f\n",
+            path.c_str(), vertices.size(), indices.size() / 3, static_cast<float>(vertices.size()) / (indices.size() / 3));
+
+        report("original", indices, vertices.size(), 0.0);
+
+        double ms = time_ms([&](){ optimize_vertex_cache(indices, vertices.size()); });
+        report("vertex cache", indices, vertices.size(), ms);
+
+        ms = time_ms([&](){ optimize_overdraw(indices, model.positionData(), vertices.size(), sizeof(SimpleVertex)); });
+        report("overdraw", indices, vertices.size(), ms);
+
+        ms = time_ms([&](){
+            std::vector<uint32_t> remap;
+            size_t uniqueVertices = optimize_vertex_fetch_remap(remap, indices, vertices.size());
+            remap_vertices(vertices, indices, remap, uniqueVertices);
+        });
+        report("fetch remap", indices, vertices.size(), ms);
+    }
+    return(0);
+}
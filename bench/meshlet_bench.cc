@@ -0,0 +1,69 @@
+// Splits a model into meshlets and reports how many of its triangles CPU meshlet culling skips, averaged over views
+// from all around the model, and how long building and culling take.
+// Usage: meshlet_bench [model.glb]   (defaults to suzanne in ASSET_DIR)
+
+#include "utils/common.h"
+#include "utils/ModelContainer.h"
+#include "utils/Culling.h"
+#include "utils/Meshlets.h"
+#include "BenchUtils.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    std::string path = argc > 1 ? argv[1] : STRIFY(ASSET_DIR) "suzanne.glb";
+
+    ModelContainer model(path, /* optimize = */ true, /* useCache = */ false);
+    const CookedMesh::Lod& full = model.lods[0];
+    const size_t fullIndexCount = model.chunks[full.firstChunk + full.chunkCount - 1].firstIndex
+                                + model.chunks[full.firstChunk + full.chunkCount - 1].indexCount - model.chunks[full.firstChunk].firstIndex;
+
+    size_t vertexSum = 0;
+    for(uint32_t i = full.firstMeshlet; i < full.firstMeshlet + full.meshletCount; ++i) vertexSum += model.meshlets[i].vertexCount;
+    printf("%s: %zu triangles in %u meshlets, %.1f triangles and %.1f vertices per meshlet on average\n", path.c_str(),
+           fullIndexCount / 3, full.meshletCount, fullIndexCount / 3.0 / full.meshletCount, double(vertexSum) / full.meshletCount);
+
+    std::vector<Meshlet> meshlets;
+    const int repeats = 100;
+    double ms = time_ms([&](){
+        for(int i = 0; i < repeats; ++i){
+            meshlets.clear();
+            for(uint32_t chunk = full.firstChunk; chunk < full.firstChunk + full.chunkCount; ++chunk){
+                build_meshlets(meshlets, model.indices, model.chunks[chunk].firstIndex, model.chunks[chunk].indexCount,
+                               model.positionData(), model.verts.size(), sizeof(SimpleVertex));
+            }
+        }
+    }) / repeats;
+    printf("Building meshlets: %.3f ms (%.2f M triangles/s)\n\n", ms, fullIndexCount / 3 / ms / 1000.0);
+
+    // Cameras on a sphere around the model looking at its center. The closer ones only see part of it.
+    const glm::vec3 center = (model.min + model.max) * 0.5f;
+    const float radius = glm::length(model.max - model.min) * 0.5f;
+    const glm::mat4 projection = glm::perspective(60.0f * 3.14159265f / 180.0f, 16.0f / 9.0f, 0.01f, 100.0f * radius);
+    const int viewCount = 256;
+    for(float distance : {1.2f, 2.0f, 4.0f}){
+        std::vector<uint32_t> culled;
+        size_t keptMeshlets = 0, keptIndices = 0;
+        ms = time_ms([&](){
+            for(int view = 0; view < viewCount; ++view){
+                // Fibonacci sphere
+                float y = 1.0f - 2.0f * (view + 0.5f) / viewCount;
+                float ring = std::sqrt(1.0f - y * y), angle = 2.39996323f * view;
+                glm::vec3 camera = center + glm::vec3(ring * std::cos(angle), y, ring * std::sin(angle)) * radius * distance;
+                glm::vec3 up = std::abs(y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                Frustum frustum = extract_frustum(projection * glm::lookAt(camera, center, up));
+
+                culled.clear();
+                keptMeshlets += cull_meshlets(culled, model.meshlets, full.firstMeshlet, full.meshletCount, model.indices, frustum, camera);
+                keptIndices += culled.size();
+            }
+        });
+        printf("Camera at %.1f radii: %5.1f%% of meshlets and %5.1f%% of triangles drawn, culled in %.2f us per view\n",
+               distance, 100.0 * keptMeshlets / (viewCount * full.meshletCount), 100.0 * keptIndices / (viewCount * fullIndexCount),
+               ms * 1000.0 / viewCount);
+    }
+    return(0);
+}
@@ -0,0 +1,61 @@
+// Compares load times of the same model stored as .gltf (base64 buffer in JSON) and as binary .glb (mapped BIN chunk),
+// and of the cooked mesh that either of them produces in CACHE_DIR.
+// Usage: model_load_bench [iterations] [model]...   (defaults to suzanne.gltf and suzanne.glb in ASSET_DIR)
+
+#include "utils/common.h"
+#include "utils/ModelContainer.h"
+#include "BenchUtils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+    std::vector<std::string> models;
+    for(int i = 2; i < argc; ++i) models.push_back(argv[i]);
+    if(models.empty()){
+        models = {STRIFY(ASSET_DIR) "suzanne.gltf", STRIFY(ASSET_DIR) "suzanne.glb"};
+    }
+
+    printf("Load time including mesh optimization, %d iterations\n", iterations);
+    for(const std::string& path : models){
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        auto timeLoads = [&](const char* aLabel, bool aUseCache){
+            std::vector<double> times;
+            // ModelContainer reports every load on stdout, which would end up in the timings
+            std::stringstream discard;
+            std::streambuf* stdoutBuffer = std::cout.rdbuf(discard.rdbuf());
+            for(int i = 0; i < iterations; ++i){
+                // Destroyed outside of the timed load
+                std::unique_ptr<ModelContainer> model;
+                times.push_back(time_ms([&](){ model.reset(new ModelContainer(path, /* optimize = */ true, aUseCache)); }));
+                vertexCount = model->verts.size();
+                indexCount = model->indices.size();
+                discard.str(std::string());
+            }
+            std::cout.rdbuf(stdoutBuffer);
+
+            std::sort(times.begin(), times.end());
+            printf("  %-8s min %8.3f ms   median %8.3f ms   max %8.3f ms\n", aLabel, times.front(), times[times.size() / 2], times.back());
+        };
+
+        printf("%s\n", path.c_str());
+        timeLoads("source", false);
+        // The first cached load cooks the mesh, so it is left out of the timings
+        {
+            std::stringstream discard;
+            std::streambuf* stdoutBuffer = std::cout.rdbuf(discard.rdbuf());
+            ModelContainer(path, /* optimize = */ true, /* useCache = */ true);
+            std::cout.rdbuf(stdoutBuffer);
+        }
+        timeLoads("cooked", true);
+        printf("  %zu vertices, %zu indices\n", vertexCount, indexCount);
+    }
+    return(0);
+}
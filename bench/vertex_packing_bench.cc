@@ -0,0 +1,52 @@
+// Reports the vertex memory saved by the packed vertex formats and the precision they give up.
+// Usage: vertex_packing_bench [model]...   (defaults to the models in ASSET_DIR)
+//
+// Frame time is compared by running the app with and without --packed-vertices and reading the FpsTimer reports.
+
+#include "utils/common.h"
+#include "utils/ModelContainer.h"
+#include "utils/VertexPacking.h"
+#include "BenchUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv){
+    std::vector<std::string> models;
+    for(int i = 1; i < argc; ++i) models.push_back(argv[i]);
+    if(models.empty()){
+        models = {STRIFY(ASSET_DIR) "cube.gltf", STRIFY(ASSET_DIR) "suzanne.glb"};
+    }
+
+    for(const std::string& path : models){
+        ModelContainer model(path);
+        const size_t vertexCount = model.verts.size();
+
+        std::vector<PackedColorVertex> packed;
+        double packMs = time_ms([&](){ packed = model.packColorVertices(); });
+
+        QuantizationTransform quantization = model.getQuantization();
+        float maxPositionError = 0.0f;
+        float maxNormalDegrees = 0.0f;
+        for(size_t i = 0; i < vertexCount; ++i){
+            glm::vec3 position = dequantize_position(packed[i].position, quantization);
+            maxPositionError = std::max(maxPositionError, glm::length(position - model.verts[i].pos));
+            float cosine = glm::dot(decode_octahedral(packed[i].normal), glm::normalize(model.verts[i].normal));
+            maxNormalDegrees = std::max(maxNormalDegrees, std::acos(std::min(1.0f, cosine)) * 57.2957795f);
+        }
+        glm::vec3 extent = model.max - model.min;
+        float diagonal = glm::length(extent);
+
+        printf("%s: %zu vertices, bounds diagonal %.3f\n", path.c_str(), vertexCount, diagonal);
+        printf("  %-18s %3zu bytes/vertex %9zu bytes\n", "SimpleVertex", sizeof(SimpleVertex), vertexCount * sizeof(SimpleVertex));
+        printf("  %-18s %3zu bytes/vertex %9zu bytes  (%.2fx smaller)\n", "PackedColorVertex", sizeof(PackedColorVertex),
+            vertexCount * sizeof(PackedColorVertex), float(sizeof(SimpleVertex)) / sizeof(PackedColorVertex));
+        printf("  %-18s %3zu bytes/vertex %9zu bytes  (%.2fx smaller)\n", "PackedVertex", sizeof(PackedVertex),
+            vertexCount * sizeof(PackedVertex), float(sizeof(SimpleVertex)) / sizeof(PackedVertex));
+        printf("  max position error %.2e (%.2e of the diagonal), max normal error %.4f degrees, packed in %.3f ms\n",
+            maxPositionError, maxPositionError / diagonal, maxNormalDegrees, packMs);
+    }
+    return(0);
+}
@@ -0,0 +1,39 @@
+#version 450 core
+
+// Variant of standard.vert drawn once per instance, each copy moved and scaled in object space before the model
+// transform, so that the bounds of every copy stay fixed relative to the model (see GPU instance culling)
+layout(location = 0) in vec4 vertPos;
+layout(location = 1) in vec4 vertCol;
+layout(location = 2) in vec4 vertNor;
+layout(location = 3) in vec4 instanceOffsetScale; // Per instance: object space offset in xyz, uniform scale in w
+
+layout(location = 0) out vec4 fragVtxColor;
+
+// Computed exactly as by instanced_position.vert, so depths of the depth prepass compare equal
+invariant gl_Position;
+
+layout(binding = 0) uniform Transforms {
+    mat4 Model;
+    mat4 View;
+    mat4 Projection;
+} uTransforms;
+
+layout(binding = 1) uniform AnimationInfo{
+    float time;
+} uAnimInfo;
+
+// Variant toggles, fixed when the pipeline is created. Unused branches are compiled out.
+layout(constant_id = 0) const bool COLOR_BY_NORMAL = true;
+layout(constant_id = 1) const bool ANIMATE_COLOR = false;
+
+void main(){
+    vec4 worldPos = uTransforms.Model * vec4(vertPos.xyz * instanceOffsetScale.w + instanceOffsetScale.xyz, 1.0);
+    gl_Position =  uTransforms.Projection * uTransforms.View * worldPos;
+
+    vec4 baseColor = COLOR_BY_NORMAL ? vertNor*.5+.5 : vertCol;
+    if(ANIMATE_COLOR){
+        fragVtxColor = mix(baseColor, vec4(1.0, 1.0, 1.0, 0.0) - baseColor, (sin(uAnimInfo.time*2.5)+1.0) / 2.0);
+    }else{
+        fragVtxColor = baseColor;
+    }
+}
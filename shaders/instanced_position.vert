@@ -0,0 +1,18 @@
+#version 450 core
+
+// Depth prepass shader of instanced.vert, reading only the positions and the per instance offset and scale
+layout(location = 0) in vec4 vertPos;
+layout(location = 3) in vec4 instanceOffsetScale; // Per instance: object space offset in xyz, uniform scale in w
+
+layout(binding = 0) uniform Transforms {
+    mat4 Model;
+    mat4 View;
+    mat4 Projection;
+} uTransforms;
+
+invariant gl_Position;
+
+void main(){
+    vec4 worldPos = uTransforms.Model * vec4(vertPos.xyz * instanceOffsetScale.w + instanceOffsetScale.xyz, 1.0);
+    gl_Position =  uTransforms.Projection * uTransforms.View * worldPos;
+}
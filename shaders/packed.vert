@@ -0,0 +1,43 @@
+#version 450 core
+
+// Variant of standard.vert reading the compact vertex formats of VertexPacking.h
+layout(location = 0) in vec4 vertPos; // 16 bit unorm, dequantized by the model matrix
+layout(location = 1) in vec4 vertCol; // RGBA8 unorm
+layout(location = 2) in vec2 vertOct; // Octahedral encoded normal, 2x16 bit snorm
+
+layout(location = 0) out vec4 fragVtxColor;
+
+// Computed exactly as by the position-only shader of the depth prepass, so depths compare equal
+invariant gl_Position;
+
+layout(binding = 0) uniform Transforms {
+    mat4 Model;    
+    mat4 View;  
+    mat4 Projection;
+} uTransforms;
+
+layout(binding = 1) uniform AnimationInfo{
+    float time;
+} uAnimInfo;
+
+// Variant toggles, fixed when the pipeline is created. Unused branches are compiled out.
+layout(constant_id = 0) const bool COLOR_BY_NORMAL = true;
+layout(constant_id = 1) const bool ANIMATE_COLOR = false;
+
+vec3 decodeOctahedral(vec2 aEncoded){
+    vec3 normal = vec3(aEncoded, 1.0 - abs(aEncoded.x) - abs(aEncoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return(normalize(normal));
+}
+
+void main(){
+    gl_Position =  uTransforms.Projection * uTransforms.View * uTransforms.Model * vec4(vertPos.xyz, 1.0);
+
+    vec4 baseColor = COLOR_BY_NORMAL ? vec4(decodeOctahedral(vertOct)*.5+.5, 1.0) : vertCol;
+    if(ANIMATE_COLOR){
+        fragVtxColor = mix(baseColor, vec4(1.0, 1.0, 1.0, 0.0) - baseColor, (sin(uAnimInfo.time*2.5)+1.0) / 2.0);
+    }else{
+        fragVtxColor = baseColor;
+    }
+}
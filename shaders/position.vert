@@ -0,0 +1,20 @@
+#version 450 core
+
+// For position-only materials, which are only given the first vertex stream (e.g. depth-only passes). Also the
+// depth prepass shader of standard.vert and packed.vert, whose positions have w = 1.
+layout(location = 0) in vec4 vertPos;
+
+layout(location = 0) out vec4 fragVtxColor;
+
+invariant gl_Position;
+
+layout(binding = 0) uniform Transforms {
+    mat4 Model;    
+    mat4 View;  
+    mat4 Projection;
+} uTransforms;
+
+void main(){
+    gl_Position =  uTransforms.Projection * uTransforms.View * uTransforms.Model * vec4(vertPos.xyz, 1.0);
+    fragVtxColor = vec4(1.0);
+}
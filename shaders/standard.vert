@@ -6,6 +6,9 @@ layout(location = 2) in vec4 vertNor;
 
 layout(location = 0) out vec4 fragVtxColor;
 
+// Computed exactly as by the position-only shader of the depth prepass, so depths compare equal
+invariant gl_Position;
+
 layout(binding = 0) uniform Transforms {
     mat4 Model;    
     mat4 View;  
@@ -16,8 +19,17 @@ layout(binding = 1) uniform AnimationInfo{
     float time;
 } uAnimInfo;
 
+// Variant toggles, fixed when the pipeline is created. Unused branches are compiled out.
+layout(constant_id = 0) const bool COLOR_BY_NORMAL = true;
+layout(constant_id = 1) const bool ANIMATE_COLOR = false;
+
 void main(){
-    gl_Position =  uTransforms.Projection * uTransforms.View * uTransforms.Model * vertPos;
-    //fragVtxColor = mix(vertCol, vec4(1.0, 1.0, 1.0, 0.0) - vertCol, (sin(uAnimInfo.time*2.5)+1.0) / 2.0);
-    fragVtxColor = vertNor*.5+.5;
+    gl_Position =  uTransforms.Projection * uTransforms.View * uTransforms.Model * vec4(vertPos.xyz, 1.0);
+
+    vec4 baseColor = COLOR_BY_NORMAL ? vertNor*.5+.5 : vertCol;
+    if(ANIMATE_COLOR){
+        fragVtxColor = mix(baseColor, vec4(1.0, 1.0, 1.0, 0.0) - baseColor, (sin(uAnimInfo.time*2.5)+1.0) / 2.0);
+    }else{
+        fragVtxColor = baseColor;
+    }
 }
\ No newline at end of file
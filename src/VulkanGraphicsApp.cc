@@ -5,11 +5,18 @@
 #include <glm/glm.hpp>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
 
     
 void VulkanGraphicsApp::init(){
+    initShaderLibrary();
+    mPipelineManager.init(mDeviceBundle.logicalDevice.handle());
+
     initUniformBuffer();
     initDepthResources();
     initRenderPipeline();
@@ -27,7 +34,23 @@ void VulkanGraphicsApp::setVertexInput(
     const VkVertexInputBindingDescription& aBindingDescription,
     const std::vector<VkVertexInputAttributeDescription>& aAttributeDescriptions
 ){
-    mBindingDescription = aBindingDescription;
+    setVertexInput(std::vector<VkVertexInputBindingDescription>{aBindingDescription}, aAttributeDescriptions);
+}
+
+void VulkanGraphicsApp::setVertexInput(
+    const std::vector<VkVertexInputBindingDescription>& aBindingDescriptions,
+    const std::vector<VkVertexInputAttributeDescription>& aAttributeDescriptions
+){
+    for(size_t i = 0; i < aBindingDescriptions.size(); ++i){
+        if(aBindingDescriptions[i].binding != i){
+            throw std::runtime_error("VulkanGraphicsApp::setVertexInput() Error: Vertex input bindings must be numbered consecutively from 0!");
+        }
+        // Per vertex streams are bound from binding 0 and must not overlap the instance buffers
+        if(i > 0 && aBindingDescriptions[i - 1].inputRate == VK_VERTEX_INPUT_RATE_INSTANCE && aBindingDescriptions[i].inputRate == VK_VERTEX_INPUT_RATE_VERTEX){
+            throw std::runtime_error("VulkanGraphicsApp::setVertexInput() Error: Instance rate bindings must follow every vertex rate binding!");
+        }
+    }
+    mBindingDescriptions = aBindingDescriptions;
     mAttributeDescriptions = aAttributeDescriptions;
     if(mVertexInputsHaveBeenSet){
         //TODO: Verify this works 
@@ -37,34 +60,283 @@ void VulkanGraphicsApp::setVertexInput(
 }
 
 void VulkanGraphicsApp::setVertexBuffer(const VkBuffer& aBuffer, size_t aVertexCount){
-    bool needsReset = mVertexBuffer != VK_NULL_HANDLE && (mVertexBuffer != aBuffer || mVertexCount != aVertexCount); 
-    mVertexBuffer = aBuffer;
+    setVertexBuffers(std::vector<VkBuffer>{aBuffer}, aVertexCount);
+}
+
+void VulkanGraphicsApp::setVertexBuffers(const std::vector<VkBuffer>& aStreams, size_t aVertexCount){
+    // Recorded draws reference the buffers, but the pipeline doesn't, so rerecording the commands is enough
+    mCommandsDirty |= mRenderPipeline.isValid() && (mVertexStreams != aStreams || mVertexCount != aVertexCount);
+    mVertexStreams = aStreams;
     mVertexCount = aVertexCount;
-    if(needsReset) resetRenderSetup(); // TODO: Verify 
 }
 
-void VulkanGraphicsApp::setVertexShader(const std::string& aShaderName, const VkShaderModule& aShaderModule){
+void VulkanGraphicsApp::addInstanceBuffer(uint32_t aBinding, const VkBuffer& aBuffer){
+    if(aBinding >= mBindingDescriptions.size() || mBindingDescriptions[aBinding].inputRate != VK_VERTEX_INPUT_RATE_INSTANCE){
+        throw std::runtime_error("VulkanGraphicsApp::addInstanceBuffer() Error: Binding " + std::to_string(aBinding) + " is not an instance rate binding of the vertex input!");
+    }
+    auto previous = mInstanceBuffers.find(aBinding);
+    mCommandsDirty |= mRenderPipeline.isValid() && (previous == mInstanceBuffers.end() || previous->second != aBuffer);
+    mInstanceBuffers[aBinding] = aBuffer;
+}
+
+void VulkanGraphicsApp::setInstanceCount(uint32_t aInstanceCount){
+    if(aInstanceCount == mInstanceCount) return;
+    mCommandsDirty |= mRenderPipeline.isValid();
+    mInstanceCount = aInstanceCount;
+    // The indirect command of frame indexed draws holds the count as well
+    ++mFrameIndexGeneration;
+}
+
+void VulkanGraphicsApp::setIndexBuffer(const VkBuffer& aBuffer, size_t aIndexCount, VkIndexType aIndexType){
+    IndexedDrawRange range;
+    range.indexCount = static_cast<uint32_t>(aIndexCount);
+    setIndexBuffer(aBuffer, std::vector<IndexedDrawRange>{range}, aIndexType);
+}
+
+void VulkanGraphicsApp::setIndexBuffer(const VkBuffer& aBuffer, const std::vector<IndexedDrawRange>& aRanges, VkIndexType aIndexType){
+    auto sameRange = [](const IndexedDrawRange& aLeft, const IndexedDrawRange& aRight){
+        return(aLeft.firstIndex == aRight.firstIndex && aLeft.indexCount == aRight.indexCount && aLeft.vertexOffset == aRight.vertexOffset);
+    };
+    bool rangesChanged = aRanges.size() != mIndexRanges.size() || !std::equal(aRanges.begin(), aRanges.end(), mIndexRanges.begin(), sameRange);
+    mCommandsDirty |= mRenderPipeline.isValid() && (mIndexBuffer != aBuffer || rangesChanged || mIndexType != aIndexType);
+    mIndexBuffer = aBuffer;
+    mIndexRanges = aRanges;
+    mIndexType = aIndexType;
+}
+
+void VulkanGraphicsApp::setFrameIndexCapacity(size_t aMaxIndexCount){
+    // The buffers are recreated along with the commands that draw from them
+    mCommandsDirty |= mRenderPipeline.isValid() && aMaxIndexCount != mFrameIndexCapacity;
+    mFrameIndexCapacity = aMaxIndexCount;
+}
+
+void VulkanGraphicsApp::setFrameIndices(const std::vector<uint32_t>& aIndices){
+    // Whole triangles only
+    const size_t indexCount = std::min(aIndices.size(), mFrameIndexCapacity / 3 * 3);
+    mFrameIndices.assign(aIndices.begin(), aIndices.begin() + indexCount);
+    ++mFrameIndexGeneration;
+}
+
+void VulkanGraphicsApp::setGpuCulledInstances(const std::vector<glm::vec4>& aInstanceSpheres){
+    if(aInstanceSpheres == mCulledInstanceSpheres) return;
+    mCommandsDirty |= mRenderPipeline.isValid();
+    mInstanceCullerDirty = true;
+    mCulledInstanceSpheres = aInstanceSpheres;
+}
+
+void VulkanGraphicsApp::setCullingTransforms(const glm::mat4& aModelView, const glm::mat4& aProjection){
+    mCullingModelView = aModelView;
+    mCullingProjection = aProjection;
+}
+
+void VulkanGraphicsApp::setOcclusionCulling(bool aEnable){
+    if(aEnable == mOcclusionCulling) return;
+    mOcclusionCulling = aEnable;
+    mInstanceCullerDirty = true;
+    // The depth image must be created sampled
+    if(mRenderPipeline.isValid())
+        resetRenderSetup();
+}
+
+void VulkanGraphicsApp::setVertexShader(const std::string& aShaderName, const VkShaderModule& aShaderModule, SpecializationConstantsPtr aConstants){
     if(aShaderName.empty() || aShaderModule == VK_NULL_HANDLE){
         throw std::runtime_error("VulkanGraphicsApp::setVertexShader() Error: Arguments must be a non-empty string and valid shader module!");
     }
-    mShaderModules[aShaderName] = aShaderModule;
+    registerShaderModule(aShaderName, aShaderModule);
     mVertexKey = aShaderName;
+    mVertexConstants = aConstants;
     if(mVertexKey == mFragmentKey){
         throw std::runtime_error("Error: Keys/Names for the vertex and fragment shader cannot be the same!");
     }
 }
 
-void VulkanGraphicsApp::setFragmentShader(const std::string& aShaderName, const VkShaderModule& aShaderModule){
+void VulkanGraphicsApp::setFragmentShader(const std::string& aShaderName, const VkShaderModule& aShaderModule, SpecializationConstantsPtr aConstants){
     if(aShaderName.empty() || aShaderModule == VK_NULL_HANDLE){
         throw std::runtime_error("VulkanGraphicsApp::setFragmentShader() Error: Arguments must be a non-empty string and valid shader module!");
     }
-    mShaderModules[aShaderName] = aShaderModule;
+    registerShaderModule(aShaderName, aShaderModule);
     mFragmentKey = aShaderName;
+    mFragmentConstants = aConstants;
     if(mVertexKey == mFragmentKey){
         throw std::runtime_error("Error: Keys/Names for the vertex and fragment shader cannot be the same!");
     }
 }
 
+void VulkanGraphicsApp::setDepthPrepassShader(const std::string& aShaderName, const VkShaderModule& aShaderModule){
+    if(!aShaderName.empty() && aShaderModule == VK_NULL_HANDLE){
+        throw std::runtime_error("VulkanGraphicsApp::setDepthPrepassShader() Error: A named prepass shader needs a valid shader module!");
+    }
+    if(!aShaderName.empty()) registerShaderModule(aShaderName, aShaderModule);
+    mCommandsDirty |= mRenderPipeline.isValid() && aShaderName != mDepthPrepassKey;
+    mDepthPrepassKey = aShaderName;
+}
+
+void VulkanGraphicsApp::addShaderModule(const std::string& aShaderName, const VkShaderModule& aShaderModule){
+    if(aShaderName.empty() || aShaderModule == VK_NULL_HANDLE){
+        throw std::runtime_error("VulkanGraphicsApp::addShaderModule() Error: Arguments must be a non-empty string and valid shader module!");
+    }
+    registerShaderModule(aShaderName, aShaderModule);
+}
+
+void VulkanGraphicsApp::initShaderLibrary(){
+    if(mShaderLibrary.isInitialized()) return;
+    mShaderLibrary.init(mDeviceBundle.logicalDevice.handle());
+    // Built alongside the individual .spv files. Without it every shader is mapped from its own file.
+    mShaderLibrary.loadArchive(STRIFY(SHADER_DIR) "/shaders.spvpack");
+}
+
+VkShaderModule VulkanGraphicsApp::loadShader(const std::string& aShaderName){
+    // Shaders may be loaded before init(), as long as the device exists
+    initShaderLibrary();
+    VkShaderModule module = mShaderLibrary.get(aShaderName);
+    if(module == VK_NULL_HANDLE){
+        module = mShaderLibrary.load(STRIFY(SHADER_DIR) "/" + aShaderName + ".spv");
+    }
+    if(module == VK_NULL_HANDLE){
+        throw std::runtime_error("Error: Unable to create shader module for '" + aShaderName + "'!");
+    }
+    return(module);
+}
+
+void VulkanGraphicsApp::registerShaderModule(const std::string& aShaderName, const VkShaderModule& aShaderModule){
+    mShaderModules[aShaderName] = aShaderModule;
+    if(mShaderHotReload){
+        mShaderWatcher.watch(STRIFY(SHADER_DIR) "/" + aShaderName + ".spv");
+    }
+}
+
+void VulkanGraphicsApp::enableShaderHotReload(){
+    if(mShaderHotReload) return;
+    mShaderHotReload = true;
+    for(const std::pair<const std::string, VkShaderModule>& module : mShaderModules){
+        mShaderWatcher.watch(STRIFY(SHADER_DIR) "/" + module.first + ".spv");
+    }
+    mShaderWatcher.start();
+}
+
+void VulkanGraphicsApp::processShaderReloads(){
+    bool defaultPipelineAffected = false;
+    for(const std::string& path : mShaderWatcher.takeChangedFiles()){
+        size_t nameStart = path.find_last_of("/\\") + 1;
+        std::string shaderName = path.substr(nameStart, path.size() - nameStart - std::string(".spv").size());
+        auto found = mShaderModules.find(shaderName);
+        if(found == mShaderModules.end()) continue;
+
+        VkShaderModule reloaded = VK_NULL_HANDLE;
+        try{
+            reloaded = mShaderLibrary.load(path);
+        }catch(const std::runtime_error& e){
+            std::cerr << "Warning: Unable to reload shader '" << shaderName << "': " << e.what() << std::endl;
+        }
+        // Rebuilding a target rewrites the file even when the byte code is unchanged
+        if(reloaded == VK_NULL_HANDLE || reloaded == found->second) continue;
+
+        std::cout << "Reloaded shader '" << shaderName << "'" << std::endl;
+        if(!mShaderLibrary.owns(found->second)){
+            mRetiredShaderModules.push_back(found->second);
+        }
+        found->second = reloaded;
+
+        defaultPipelineAffected |= shaderName == mVertexKey || shaderName == mFragmentKey;
+        // The prepass pipelines are rebuilt with the commands. A reload of the default shaders rebuilds them as well,
+        // once the new default pipeline is swapped in, so the positions of both passes keep matching.
+        mCommandsDirty |= !mDepthPrepassKey.empty() && shaderName == mDepthPrepassKey;
+        for(const std::pair<const std::string, MaterialInfo>& material : mMaterials){
+            if(material.second.vertexShader == shaderName || material.second.fragmentShader == shaderName){
+                // Kicks off a background build. Draws keep the current pipeline until poll() reports it done.
+                getMaterialPipeline(material.first);
+            }
+        }
+    }
+
+    if(defaultPipelineAffected && mRenderPipeline.isValid()){
+        // A newer reload supersedes one that is still compiling
+        discardPendingShaderReload();
+
+        mReloadCtorSet.reset(new vkutils::GraphicsPipelineConstructionSet(mRenderPipeline.getConstructionSet()));
+        for(VkPipelineShaderStageCreateInfo& stage : mReloadCtorSet->mProgrammableStages){
+            const std::string& key = stage.stage == VK_SHADER_STAGE_VERTEX_BIT ? mVertexKey : mFragmentKey;
+            auto found = mShaderModules.find(key);
+            if(found != mShaderModules.end()) stage.module = found->second;
+        }
+        mReloadPipeline = mPipelineManager.getBuildQueue().submit(*mReloadCtorSet, mRenderPipeline.getLayout(), mRenderPipeline.getRenderpass());
+    }
+}
+
+void VulkanGraphicsApp::discardPendingShaderReload(){
+    if(mReloadPipeline.valid()){
+        try{
+            vkDestroyPipeline(mDeviceBundle.logicalDevice.handle(), mReloadPipeline.get(), nullptr);
+        }catch(const std::exception& e){
+            std::cerr << "Warning: Discarding failed pipeline build: " << e.what() << std::endl;
+        }
+    }
+    mReloadPipeline = std::shared_future<VkPipeline>();
+    mReloadCtorSet = nullptr;
+}
+
+void VulkanGraphicsApp::addMaterial(const std::string& aMaterialName, const MaterialInfo& aMaterialInfo){
+    if(aMaterialName.empty() || aMaterialInfo.vertexShader.empty() || aMaterialInfo.fragmentShader.empty()){
+        throw std::runtime_error("VulkanGraphicsApp::addMaterial() Error: Materials must have a name and both a vertex and fragment shader!");
+    }
+    mMaterials[aMaterialName] = aMaterialInfo;
+
+    if(mRenderPipeline.isValid() && !mDrawCalls.empty())
+        resetRenderSetup();
+}
+
+void VulkanGraphicsApp::addDrawCall(const std::string& aMaterialName, const VkBuffer& aVertexBuffer, size_t aVertexCount, uint32_t aInstanceCount){
+    addDrawCall(aMaterialName, std::vector<VkBuffer>{aVertexBuffer}, aVertexCount, aInstanceCount);
+}
+
+void VulkanGraphicsApp::addDrawCall(const std::string& aMaterialName, const std::vector<VkBuffer>& aVertexStreams, size_t aVertexCount, uint32_t aInstanceCount){
+    if(mMaterials.find(aMaterialName) == mMaterials.end()){
+        throw std::runtime_error("VulkanGraphicsApp::addDrawCall() Error: No material named '" + aMaterialName + "' has been added!");
+    }
+    DrawCall drawCall;{
+        drawCall.material = aMaterialName;
+        drawCall.vertexStreams = aVertexStreams;
+        drawCall.vertexCount = aVertexCount;
+        drawCall.instanceCount = aInstanceCount;
+    }
+    mDrawCalls.push_back(drawCall);
+
+    if(mRenderPipeline.isValid())
+        resetRenderSetup();
+}
+
+void VulkanGraphicsApp::addDrawCall(
+    const std::string& aMaterialName, const VkBuffer& aVertexBuffer,
+    const VkBuffer& aIndexBuffer, size_t aIndexCount, VkIndexType aIndexType,
+    uint32_t aFirstIndex, int32_t aVertexOffset, uint32_t aInstanceCount
+){
+    addDrawCall(aMaterialName, std::vector<VkBuffer>{aVertexBuffer}, aIndexBuffer, aIndexCount, aIndexType, aFirstIndex, aVertexOffset, aInstanceCount);
+}
+
+void VulkanGraphicsApp::addDrawCall(
+    const std::string& aMaterialName, const std::vector<VkBuffer>& aVertexStreams,
+    const VkBuffer& aIndexBuffer, size_t aIndexCount, VkIndexType aIndexType,
+    uint32_t aFirstIndex, int32_t aVertexOffset, uint32_t aInstanceCount
+){
+    if(mMaterials.find(aMaterialName) == mMaterials.end()){
+        throw std::runtime_error("VulkanGraphicsApp::addDrawCall() Error: No material named '" + aMaterialName + "' has been added!");
+    }
+    DrawCall drawCall;{
+        drawCall.material = aMaterialName;
+        drawCall.vertexStreams = aVertexStreams;
+        drawCall.indexBuffer = aIndexBuffer;
+        drawCall.indexCount = aIndexCount;
+        drawCall.indexType = aIndexType;
+        drawCall.firstIndex = aFirstIndex;
+        drawCall.vertexOffset = aVertexOffset;
+        drawCall.instanceCount = aInstanceCount;
+    }
+    mDrawCalls.push_back(drawCall);
+
+    if(mRenderPipeline.isValid())
+        resetRenderSetup();
+}
+
 void VulkanGraphicsApp::addUniform(uint32_t aBindingPoint, UniformDataInterfacePtr aUniformData, VkShaderStageFlags aStages){
     if(aUniformData == nullptr){
         std::cerr << "Ignoring attempt to add nullptr as uniform data!" << std::endl;
@@ -78,7 +350,10 @@ void VulkanGraphicsApp::addUniform(uint32_t aBindingPoint, UniformDataInterfaceP
 }
 
 void VulkanGraphicsApp::resetRenderSetup(){
-    vkDeviceWaitIdle(mDeviceBundle.logicalDevice.handle());
+    {
+        std::lock_guard<std::mutex> queueLock(mQueueMutex);
+        vkDeviceWaitIdle(mDeviceBundle.logicalDevice.handle());
+    }
 
     cleanupSwapchainDependents();
     VulkanSetupBaseApp::cleanupSwapchain();
@@ -95,6 +370,23 @@ void VulkanGraphicsApp::resetRenderSetup(){
 }
 
 void VulkanGraphicsApp::render(){
+    // Swap in any pipelines that finished compiling since the last frame. Reloads are processed first, as they may
+    // replace the pending build with one that has only just started.
+    if(mShaderHotReload){
+        processShaderReloads();
+    }
+    bool reloadReady = mReloadPipeline.valid() && mReloadPipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    bool materialsReady = mPipelineManager.getPendingCount() > 0 && mPipelineManager.poll() > 0;
+    if(reloadReady){
+        waitForInFlightFrames();
+        mRenderPipeline.swapPipeline(*mReloadCtorSet, mReloadPipeline.get());
+        mReloadPipeline = std::shared_future<VkPipeline>();
+        mReloadCtorSet = nullptr;
+    }
+    if(reloadReady || materialsReady || mCommandsDirty){
+        rerecordCommands();
+    }
+
     uint32_t targetImageIndex = 0;
     size_t syncObjectIndex = mFrameNumber % IN_FLIGHT_FRAME_LIMIT;
 
@@ -114,10 +406,25 @@ void VulkanGraphicsApp::render(){
         throw std::runtime_error("Failed to get next image in swapchain!");
     }
 
-    const static VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // The image's per-frame data may still be read by an earlier frame than the one the fence above belongs to
+    if(mImagesInFlight[targetImageIndex] != VK_NULL_HANDLE){
+        vkWaitForFences(mDeviceBundle.logicalDevice.handle(), 1, &mImagesInFlight[targetImageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+    mImagesInFlight[targetImageIndex] = mInFlightFences[syncObjectIndex];
+    uploadFrameIndices(targetImageIndex);
+    // Only the transforms and the index ranges are written, however many instances there are. Occlusion culling
+    // is part of the frame's command buffer and needs no semaphore.
+    if(mInstanceCuller.isValid()){
+        mInstanceCuller.update(targetImageIndex, mCullingModelView, mCullingProjection, mCulledRanges);
+    }
+    const bool cullInstances = mInstanceCuller.isValid() && !mInstanceCuller.usesOcclusion();
+
+    // The draws read the culling results as indirect arguments, which is the only stage that has to wait for them
+    const static VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT};
+    const VkSemaphore waitSemaphores[] = {mImageAvailableSemaphores[syncObjectIndex], mCullFinishedSemaphores[syncObjectIndex]};
     VkSubmitInfo submitInfo = {
         VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr,
-        1, &mImageAvailableSemaphores[syncObjectIndex], &waitStages,
+        cullInstances ? 2U : 1U, waitSemaphores, waitStages,
         1, &mCommandBuffers[targetImageIndex],
         1, &mRenderFinishSemaphores[syncObjectIndex]
     };
@@ -127,6 +434,11 @@ void VulkanGraphicsApp::render(){
     
     mUniformBuffer.updateDevice();
 
+    // Held through the present as well, the presentation queue is usually the graphics queue
+    std::lock_guard<std::mutex> queueLock(mQueueMutex);
+    if(cullInstances){
+        mInstanceCuller.submit(targetImageIndex, mCullFinishedSemaphores[syncObjectIndex]);
+    }
     if(vkQueueSubmit(mDeviceBundle.logicalDevice.getGraphicsQueue(), 1, &submitInfo, mInFlightFences[syncObjectIndex]) != VK_SUCCESS){
         throw std::runtime_error("Submit to graphics queue failed!");
     }
@@ -154,7 +466,13 @@ void VulkanGraphicsApp::initRenderPipeline(){
         throw std::runtime_error("Error! No fragment shader has been set! A vertex shader must be set using setFragmentShader()!");
     }
 
-    vkutils::GraphicsPipelineConstructionSet& ctorSet =  mRenderPipeline.setupConstructionSet(mDeviceBundle.logicalDevice.handle(), &mSwapchainBundle);
+    if(!mRenderPipeline.isValid()){
+        mRenderPipeline.setupConstructionSet(mDeviceBundle.logicalDevice.handle(), &mSwapchainBundle);
+    }
+    // Filled in on a copy, so that an existing pipeline can compare it against what it was built from and only
+    // recreate the objects whose inputs changed
+    vkutils::GraphicsPipelineConstructionSet ctorSet = mRenderPipeline.getConstructionSet();
+    ctorSet.mProgrammableStages.clear();
     vkutils::BasicVulkanRenderPipeline::prepareFixedStages(ctorSet);
 
     VkShaderModule vertShader = VK_NULL_HANDLE;
@@ -172,7 +490,7 @@ void VulkanGraphicsApp::initRenderPipeline(){
         if(findFrag != mShaderModules.end()){
             fragShader = findFrag->second;
         }else{
-            fragShader = vkutils::load_shader_module(mDeviceBundle.logicalDevice.handle(), STRIFY(SHADER_DIR) "/fallback.frag.spv");
+            fragShader = loadShader("fallback.frag");
             mShaderModules["fallback.frag"] = fragShader;
         }
     }else{
@@ -186,7 +504,7 @@ void VulkanGraphicsApp::initRenderPipeline(){
         vertStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
         vertStageInfo.module = vertShader;
         vertStageInfo.pName = "main";
-        vertStageInfo.pSpecializationInfo = nullptr;
+        vertStageInfo.pSpecializationInfo = mVertexConstants != nullptr ? &mVertexConstants->getSpecializationInfo() : nullptr;
     }
     VkPipelineShaderStageCreateInfo fragStageInfo;{
         fragStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -195,13 +513,13 @@ void VulkanGraphicsApp::initRenderPipeline(){
         fragStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         fragStageInfo.module = fragShader;
         fragStageInfo.pName = "main";
-        fragStageInfo.pSpecializationInfo = nullptr;
+        fragStageInfo.pSpecializationInfo = mFragmentConstants != nullptr ? &mFragmentConstants->getSpecializationInfo() : nullptr;
     }
     ctorSet.mProgrammableStages.emplace_back(vertStageInfo);
     ctorSet.mProgrammableStages.emplace_back(fragStageInfo);
 
-    ctorSet.mVtxInputInfo.pVertexBindingDescriptions = &mBindingDescription;
-    ctorSet.mVtxInputInfo.vertexBindingDescriptionCount = 1U;
+    ctorSet.mVtxInputInfo.pVertexBindingDescriptions = mBindingDescriptions.data();
+    ctorSet.mVtxInputInfo.vertexBindingDescriptionCount = mBindingDescriptions.size();
     ctorSet.mVtxInputInfo.pVertexAttributeDescriptions = mAttributeDescriptions.data();
     ctorSet.mVtxInputInfo.vertexAttributeDescriptionCount = mAttributeDescriptions.size();
 
@@ -215,10 +533,123 @@ void VulkanGraphicsApp::initRenderPipeline(){
 
     vkutils::BasicVulkanRenderPipeline::prepareViewport(ctorSet);
     vkutils::BasicVulkanRenderPipeline::prepareRenderPass(ctorSet, mDeviceBundle.physicalDevice);
-    mRenderPipeline.build(ctorSet);
+    ctorSet.mPipelineCache = mDeviceBundle.pipelineCache.handle();
+    uint32_t rebuilt = mRenderPipeline.rebuild(ctorSet);
+    if(!(rebuilt & vkutils::BasicVulkanRenderPipeline::REBUILT_PIPELINE)) return;
+
+    // The cache is warm if it was seeded from disk or if this pipeline has already been built once this run
+    bool warmCache = mDeviceBundle.pipelineCache.isWarm() || mPipelineBuildCount > 0;
+    ++mPipelineBuildCount;
+    std::cout << "Graphics pipeline created in " << mRenderPipeline.getLastCreationTime().count() / 1000.0 << " ms ("
+              << (warmCache ? "warm" : "cold") << " pipeline cache)" << std::endl;
+}
+
+VkPipeline VulkanGraphicsApp::getMaterialPipeline(const std::string& aMaterialName){
+    const MaterialInfo& material = mMaterials.at(aMaterialName);
+    auto findVert = mShaderModules.find(material.vertexShader);
+    auto findFrag = mShaderModules.find(material.fragmentShader);
+    if(findVert == mShaderModules.end() || findFrag == mShaderModules.end()){
+        throw std::runtime_error("Error: Material '" + aMaterialName + "' references a shader that has not been added!");
+    }
+
+    // Materials differ from the default pipeline only in shaders and a few fixed function states
+    vkutils::GraphicsPipelineConstructionSet ctorSet = mRenderPipeline.getConstructionSet();
+    for(VkPipelineShaderStageCreateInfo& stage : ctorSet.mProgrammableStages){
+        if(stage.stage == VK_SHADER_STAGE_VERTEX_BIT){
+            stage.module = findVert->second;
+            stage.pSpecializationInfo = material.vertexConstants != nullptr ? &material.vertexConstants->getSpecializationInfo() : nullptr;
+        }
+        if(stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT){
+            stage.module = findFrag->second;
+            stage.pSpecializationInfo = material.fragmentConstants != nullptr ? &material.fragmentConstants->getSpecializationInfo() : nullptr;
+        }
+    }
+    ctorSet.mRasterInfo.cullMode = material.cullMode;
+    ctorSet.mBlendAttachmentInfo.blendEnable = material.blendEnable;
+    ctorSet.mDepthInfo.depthTestEnable = material.depthTestEnable;
+    ctorSet.mDepthInfo.depthWriteEnable = material.depthWriteEnable;
+
+    // Submitting copies the construction set, so it may point at the local lists
+    std::vector<VkVertexInputBindingDescription> positionBindings;
+    std::vector<VkVertexInputAttributeDescription> positionAttributes;
+    if(material.positionOnly){
+        keepPositionInputs(ctorSet, positionBindings, positionAttributes);
+    }
+
+    // Compiled in the background. Until it's done the draw keeps the material's previous pipeline, or the default
+    // pipeline if there is none yet, and is re-recorded once ready. The default pipeline is stored as VK_NULL_HANDLE
+    // and looked up on return, as a shader reload may have replaced it since.
+    auto previous = mMaterialPipelines.find(aMaterialName);
+    VkPipeline fallback = previous != mMaterialPipelines.end() ? previous->second : VK_NULL_HANDLE;
+    VkPipeline pipeline = mPipelineManager.getPipelineAsync(ctorSet, mRenderPipeline.getRenderpass(), fallback);
+    mMaterialPipelines[aMaterialName] = pipeline;
+    return(pipeline != VK_NULL_HANDLE ? pipeline : mRenderPipeline.getPipeline());
+}
+
+void VulkanGraphicsApp::keepPositionInputs(
+    vkutils::GraphicsPipelineConstructionSet& aCtorSetInOut, std::vector<VkVertexInputBindingDescription>& aBindingsOut,
+    std::vector<VkVertexInputAttributeDescription>& aAttributesOut
+) const{
+    // Only the first stream and the instance buffers are kept. The construction set points at the output lists.
+    aBindingsOut.clear();
+    aAttributesOut.clear();
+    for(const VkVertexInputBindingDescription& binding : mBindingDescriptions){
+        if(binding.binding == 0 || binding.inputRate == VK_VERTEX_INPUT_RATE_INSTANCE) aBindingsOut.push_back(binding);
+    }
+    for(const VkVertexInputAttributeDescription& attribute : mAttributeDescriptions){
+        if(attribute.binding == 0 || mBindingDescriptions[attribute.binding].inputRate == VK_VERTEX_INPUT_RATE_INSTANCE){
+            aAttributesOut.push_back(attribute);
+        }
+    }
+    aCtorSetInOut.mVtxInputInfo.vertexBindingDescriptionCount = aBindingsOut.size();
+    aCtorSetInOut.mVtxInputInfo.pVertexBindingDescriptions = aBindingsOut.data();
+    aCtorSetInOut.mVtxInputInfo.vertexAttributeDescriptionCount = aAttributesOut.size();
+    aCtorSetInOut.mVtxInputInfo.pVertexAttributeDescriptions = aAttributesOut.data();
+}
+
+void VulkanGraphicsApp::initDepthPrepassPipelines(){
+    mDepthPrepassPipeline = VK_NULL_HANDLE;
+    mDepthEqualPipeline = VK_NULL_HANDLE;
+    if(mDepthPrepassKey.empty()) return;
+    auto findVert = mShaderModules.find(mDepthPrepassKey);
+    if(findVert == mShaderModules.end()){
+        throw std::runtime_error("VulkanGraphicsApp::initDepthPrepassPipelines() Error: Depth prepass shader '" + mDepthPrepassKey + "' has not been added!");
+    }
+
+    // Without a fragment stage and with color writes masked off only depth is written. Both pipelines are built
+    // right away, a fallback drawing with the wrong depth test would leave the default draws out of the frame.
+    vkutils::GraphicsPipelineConstructionSet depthCtorSet = mRenderPipeline.getConstructionSet();
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    for(const VkPipelineShaderStageCreateInfo& stage : depthCtorSet.mProgrammableStages){
+        if(stage.stage != VK_SHADER_STAGE_VERTEX_BIT) continue;
+        stages.push_back(stage);
+        stages.back().module = findVert->second;
+        stages.back().pSpecializationInfo = nullptr;
+    }
+    depthCtorSet.mProgrammableStages = stages;
+    depthCtorSet.mBlendAttachmentInfo.blendEnable = VK_FALSE;
+    depthCtorSet.mBlendAttachmentInfo.colorWriteMask = 0;
+    std::vector<VkVertexInputBindingDescription> positionBindings;
+    std::vector<VkVertexInputAttributeDescription> positionAttributes;
+    keepPositionInputs(depthCtorSet, positionBindings, positionAttributes);
+    mDepthPrepassPipeline = mPipelineManager.getPipeline(depthCtorSet, mRenderPipeline.getRenderpass());
+
+    vkutils::GraphicsPipelineConstructionSet shadeCtorSet = mRenderPipeline.getConstructionSet();
+    shadeCtorSet.mDepthInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    shadeCtorSet.mDepthInfo.depthWriteEnable = VK_FALSE;
+    mDepthEqualPipeline = mPipelineManager.getPipeline(shadeCtorSet, mRenderPipeline.getRenderpass());
 }
 
 void VulkanGraphicsApp::initCommands(){
+    mCommandsDirty = false;
+    // Nothing draws from the old buffers anymore, and the swapchain may have a different number of images
+    destroyFrameIndexBuffers();
+    initFrameIndexBuffers();
+    initInstanceCuller();
+    const bool occlusion = mInstanceCuller.isValid() && mInstanceCuller.usesOcclusion();
+    if(occlusion) initOcclusionRenderPasses();
+    initDepthPrepassPipelines();
+
     VkCommandPoolCreateInfo poolInfo;{
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.pNext = nullptr;
@@ -244,19 +675,119 @@ void VulkanGraphicsApp::initCommands(){
         throw std::runtime_error("Failed to allocate command buffers!");
     }
 
+    // Resolve every draw to a pipeline, then order the draws by the state they bind so each is bound only once
+    struct ResolvedDraw
+    {
+        VkPipeline pipeline;
+        std::vector<VkBuffer> vertexStreams;
+        size_t vertexCount;
+        VkBuffer indexBuffer;
+        size_t indexCount;
+        VkIndexType indexType;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t instanceCount;
+        // Drawn indirectly from the image's frame index buffer
+        bool frameIndexed;
+        // Drawn indirectly from the output of the instance culling pass
+        bool instanceCulled;
+        // Sort id of the draw's material, 0 for the default pipeline
+        uint32_t material;
+        // Draws of the depth prepass come first
+        uint32_t pass = 0;
+    };
+    std::vector<ResolvedDraw> resolvedDraws;
+    resolvedDraws.reserve(mDrawCalls.size() + mIndexRanges.size() + 1);
+    if(!mVertexStreams.empty() && mFrameIndexCapacity > 0){
+        resolvedDraws.push_back(ResolvedDraw{mRenderPipeline.getPipeline(), mVertexStreams, mVertexCount, VK_NULL_HANDLE, 0, VK_INDEX_TYPE_UINT32, 0, 0, mInstanceCount, true, false, 0});
+    }
+    else if(!mVertexStreams.empty() && mIndexBuffer == VK_NULL_HANDLE){
+        resolvedDraws.push_back(ResolvedDraw{mRenderPipeline.getPipeline(), mVertexStreams, mVertexCount, VK_NULL_HANDLE, 0, mIndexType, 0, 0, mInstanceCount, false, false, 0});
+    }
+    else if(!mVertexStreams.empty() && mInstanceCuller.isValid()){
+        resolvedDraws.push_back(ResolvedDraw{mRenderPipeline.getPipeline(), mVertexStreams, mVertexCount, mIndexBuffer, 0, mIndexType, 0, 0, 0, false, true, 0});
+    }
+    else if(!mVertexStreams.empty()){
+        for(const IndexedDrawRange& range : mIndexRanges){
+            resolvedDraws.push_back(ResolvedDraw{
+                mRenderPipeline.getPipeline(), mVertexStreams, mVertexCount,
+                mIndexBuffer, range.indexCount, mIndexType, range.firstIndex, range.vertexOffset, mInstanceCount, false, false, 0
+            });
+        }
+    }
+    // The default draws fill the depth buffer first, then shade only the fragments that are left, see
+    // setDepthPrepassShader(). Draw calls of materials are drawn after the prepass as they are.
+    const size_t defaultDrawCount = resolvedDraws.size();
+    if(mDepthPrepassPipeline != VK_NULL_HANDLE){
+        for(size_t d = 0; d < defaultDrawCount; ++d){
+            ResolvedDraw depthDraw = resolvedDraws[d];
+            depthDraw.pipeline = mDepthPrepassPipeline;
+            depthDraw.vertexStreams.resize(std::min<size_t>(depthDraw.vertexStreams.size(), 1));
+            resolvedDraws[d].pipeline = mDepthEqualPipeline;
+            resolvedDraws[d].pass = 1;
+            resolvedDraws.push_back(depthDraw);
+        }
+    }
+    const uint32_t materialPass = mDepthPrepassPipeline != VK_NULL_HANDLE ? 1 : 0;
+
+    // Ids follow the order state is first used in, so the keys of unchanged draws stay the same between recordings
+    std::unordered_map<std::string, uint32_t> materialIds;
+    for(const DrawCall& drawCall : mDrawCalls){
+        const uint32_t materialId = materialIds.emplace(drawCall.material, static_cast<uint32_t>(materialIds.size() + 1)).first->second;
+        resolvedDraws.push_back(ResolvedDraw{
+            getMaterialPipeline(drawCall.material), drawCall.vertexStreams, drawCall.vertexCount,
+            drawCall.indexBuffer, drawCall.indexCount, drawCall.indexType, drawCall.firstIndex, drawCall.vertexOffset,
+            drawCall.instanceCount, false, false, materialId, materialPass
+        });
+        if(mMaterials.at(drawCall.material).positionOnly && resolvedDraws.back().vertexStreams.size() > 1){
+            resolvedDraws.back().vertexStreams.resize(1);
+        }
+    }
+    size_t maxStreamCount = 0;
+    for(const ResolvedDraw& draw : resolvedDraws) maxStreamCount = std::max(maxStreamCount, draw.vertexStreams.size());
+    const std::vector<VkDeviceSize> streamOffsets(maxStreamCount, 0);
+    // Draws carry no depth of their own, so those sharing all state keep the order they were added in
+    std::unordered_map<VkPipeline, uint32_t> pipelineIds;
+    std::unordered_map<VkBuffer, uint32_t> vertexBufferIds;
+    mDrawQueue.clear();
+    mDrawQueue.reserve(resolvedDraws.size());
+    for(size_t d = 0; d < resolvedDraws.size(); ++d){
+        const ResolvedDraw& draw = resolvedDraws[d];
+        DrawKey key;{
+            key.pass = draw.pass;
+            key.pipeline = pipelineIds.emplace(draw.pipeline, static_cast<uint32_t>(pipelineIds.size())).first->second;
+            key.material = draw.material;
+            if(!draw.vertexStreams.empty()){
+                key.vertexBuffer = vertexBufferIds.emplace(draw.vertexStreams[0], static_cast<uint32_t>(vertexBufferIds.size())).first->second;
+            }
+        }
+        mDrawQueue.push(key, static_cast<uint32_t>(d));
+    }
+    mDrawQueue.sort();
+    // Every pipeline reads the instance rate bindings of the shared vertex input
+    if(!resolvedDraws.empty()){
+        for(const VkVertexInputBindingDescription& binding : mBindingDescriptions){
+            if(binding.inputRate == VK_VERTEX_INPUT_RATE_INSTANCE && mInstanceBuffers.count(binding.binding) == 0){
+                throw std::runtime_error("VulkanGraphicsApp::initCommands() Error: No instance buffer was added for binding " + std::to_string(binding.binding) + "!");
+            }
+        }
+    }
+
     for(size_t i = 0; i < mCommandBuffers.size(); ++i){
         VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, 0 , nullptr};
         if(vkBeginCommandBuffer(mCommandBuffers[i], &beginInfo) != VK_SUCCESS){
             throw std::runtime_error("Failed to begine command recording!");
         }
 
+        if(occlusion) mInstanceCuller.recordCull(mCommandBuffers[i], static_cast<uint32_t>(i), vkutils::GpuInstanceCuller::CULL_EARLY);
+
         std::array<VkClearValue, 2> clearValues = {};
         clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
         clearValues[1].depthStencil = {1.0f, 0};
         VkRenderPassBeginInfo renderBegin;{
             renderBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
             renderBegin.pNext = nullptr;
-            renderBegin.renderPass = mRenderPipeline.getRenderpass();
+            renderBegin.renderPass = occlusion ? mEarlyRenderPass : mRenderPipeline.getRenderpass();
             renderBegin.framebuffer = mSwapchainFramebuffers[i];
             renderBegin.renderArea = {{0,0}, mSwapchainBundle.extent};
             renderBegin.clearValueCount = static_cast<uint32_t>(clearValues.size());;
@@ -264,27 +795,283 @@ void VulkanGraphicsApp::initCommands(){
         }
 
         vkCmdBeginRenderPass(mCommandBuffers[i], &renderBegin, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mRenderPipeline.getPipeline());
-        vkCmdBindVertexBuffers(mCommandBuffers[i], 0, 1, &mVertexBuffer, std::array<VkDeviceSize, 1>{0}.data());
-
-        // Bind uniforms to graphics pipeline if they exist
-        if(mUniformBuffer.getBoundDataCount() > 0){
-            const VkDescriptorSet* descriptorSets = mUniformDescriptorSets.data() + i;
-            vkCmdBindDescriptorSets(
-                mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mRenderPipeline.getLayout(),
-                0, 1, descriptorSets, 0, nullptr
-            );
+
+        // Instance buffers are bound once. Their bindings follow the vertex streams, which never replace them.
+        const VkDeviceSize instanceOffset = 0;
+        for(const std::pair<const uint32_t, VkBuffer>& instanceBuffer : mInstanceBuffers){
+            vkCmdBindVertexBuffers(mCommandBuffers[i], instanceBuffer.first, 1, &instanceBuffer.second, &instanceOffset);
         }
 
-        vkCmdDraw(mCommandBuffers[i], mVertexCount, 1, 0, 0);
+        // State already bound by an earlier draw isn't bound again. Every image records the same draws, so the
+        // counts of the last one are kept.
+        DrawBindStats stats;
+        const bool hasUniforms = mUniformBuffer.getBoundDataCount() > 0;
+        bool descriptorSetsBound = false;
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        std::vector<VkBuffer> boundVertexStreams;
+        VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+        VkIndexType boundIndexType = VK_INDEX_TYPE_UINT32;
+        for(const DrawQueue::Packet& packet : mDrawQueue.getPackets()){
+            const ResolvedDraw& draw = resolvedDraws[packet.draw];
+            if(draw.pipeline != boundPipeline){
+                vkCmdBindPipeline(mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+                boundPipeline = draw.pipeline;
+                ++stats.pipelineBinds;
+            }else{
+                ++stats.pipelineBindsSaved;
+            }
+            // All materials share the same layout and uniforms, so the descriptor sets stay bound across pipeline
+            // changes
+            if(hasUniforms && !descriptorSetsBound){
+                vkCmdBindDescriptorSets(
+                    mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mRenderPipeline.getLayout(),
+                    0, 1, mUniformDescriptorSets.data() + i, 0, nullptr
+                );
+                descriptorSetsBound = true;
+                ++stats.descriptorSetBinds;
+            }else if(hasUniforms){
+                ++stats.descriptorSetBindsSaved;
+            }
+            // Streams that are already bound to the same binding stay bound
+            size_t firstChanged = 0;
+            while(firstChanged < draw.vertexStreams.size() && firstChanged < boundVertexStreams.size()
+                && draw.vertexStreams[firstChanged] == boundVertexStreams[firstChanged]){
+                ++firstChanged;
+            }
+            stats.vertexBufferBindsSaved += static_cast<uint32_t>(firstChanged);
+            if(firstChanged < draw.vertexStreams.size()){
+                vkCmdBindVertexBuffers(
+                    mCommandBuffers[i], static_cast<uint32_t>(firstChanged), static_cast<uint32_t>(draw.vertexStreams.size() - firstChanged),
+                    draw.vertexStreams.data() + firstChanged, streamOffsets.data()
+                );
+                boundVertexStreams.resize(std::max(boundVertexStreams.size(), draw.vertexStreams.size()));
+                std::copy(draw.vertexStreams.begin() + firstChanged, draw.vertexStreams.end(), boundVertexStreams.begin() + firstChanged);
+                stats.vertexBufferBinds += static_cast<uint32_t>(draw.vertexStreams.size() - firstChanged);
+            }
+            if(draw.frameIndexed){
+                const VkBuffer frameIndexBuffer = mFrameIndexBuffers[i].buffer;
+                vkCmdBindIndexBuffer(mCommandBuffers[i], frameIndexBuffer, FRAME_INDEX_OFFSET, VK_INDEX_TYPE_UINT32);
+                boundIndexBuffer = frameIndexBuffer;
+                boundIndexType = VK_INDEX_TYPE_UINT32;
+                ++stats.indexBufferBinds;
+                vkCmdDrawIndexedIndirect(mCommandBuffers[i], frameIndexBuffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+                continue;
+            }
+            if(draw.indexBuffer == VK_NULL_HANDLE){
+                vkCmdDraw(mCommandBuffers[i], draw.vertexCount, draw.instanceCount, 0, 0);
+                continue;
+            }
+            if(draw.indexBuffer != boundIndexBuffer || draw.indexType != boundIndexType){
+                vkCmdBindIndexBuffer(mCommandBuffers[i], draw.indexBuffer, 0, draw.indexType);
+                boundIndexBuffer = draw.indexBuffer;
+                boundIndexType = draw.indexType;
+                ++stats.indexBufferBinds;
+            }else{
+                ++stats.indexBufferBindsSaved;
+            }
+            if(draw.instanceCulled){
+                mInstanceCuller.recordDraws(mCommandBuffers[i], static_cast<uint32_t>(i), vkutils::GpuInstanceCuller::CULL_EARLY);
+                continue;
+            }
+            vkCmdDrawIndexed(mCommandBuffers[i], static_cast<uint32_t>(draw.indexCount), draw.instanceCount, draw.firstIndex, draw.vertexOffset, 0);
+        }
+        mDrawBindStats = stats;
+
         vkCmdEndRenderPass(mCommandBuffers[i]);
 
+        // The late phase tests against the depth just stored, and the second pass draws what the first one missed.
+        // Nothing stays bound across render passes that the culled draw needs, so it is bound again.
+        if(occlusion){
+            mInstanceCuller.recordCull(mCommandBuffers[i], static_cast<uint32_t>(i), vkutils::GpuInstanceCuller::CULL_LATE);
+            renderBegin.renderPass = mLateRenderPass;
+            renderBegin.clearValueCount = 0;
+            renderBegin.pClearValues = nullptr;
+            vkCmdBeginRenderPass(mCommandBuffers[i], &renderBegin, VK_SUBPASS_CONTENTS_INLINE);
+            if(mUniformBuffer.getBoundDataCount() > 0){
+                vkCmdBindDescriptorSets(
+                    mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mRenderPipeline.getLayout(),
+                    0, 1, mUniformDescriptorSets.data() + i, 0, nullptr
+                );
+            }
+            for(const std::pair<const uint32_t, VkBuffer>& instanceBuffer : mInstanceBuffers){
+                vkCmdBindVertexBuffers(mCommandBuffers[i], instanceBuffer.first, 1, &instanceBuffer.second, &instanceOffset);
+            }
+            vkCmdBindPipeline(mCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, mRenderPipeline.getPipeline());
+            vkCmdBindVertexBuffers(mCommandBuffers[i], 0, static_cast<uint32_t>(mVertexStreams.size()), mVertexStreams.data(), streamOffsets.data());
+            vkCmdBindIndexBuffer(mCommandBuffers[i], mIndexBuffer, 0, mIndexType);
+            mInstanceCuller.recordDraws(mCommandBuffers[i], static_cast<uint32_t>(i), vkutils::GpuInstanceCuller::CULL_LATE);
+            vkCmdEndRenderPass(mCommandBuffers[i]);
+        }
+
         if(vkEndCommandBuffer(mCommandBuffers[i]) != VK_SUCCESS){
             throw std::runtime_error("Failed to end command buffer " + std::to_string(i));
         }
     }
 }
 
+void VulkanGraphicsApp::waitForInFlightFrames(){
+    // Every submission signals one of these fences, so this waits for all rendering without idling the whole device
+    vkWaitForFences(mDeviceBundle.logicalDevice.handle(), mInFlightFences.size(), mInFlightFences.data(), VK_TRUE, std::numeric_limits<uint64_t>::max());
+}
+
+void VulkanGraphicsApp::initFrameIndexBuffers(){
+    if(mFrameIndexCapacity == 0) return;
+
+    mFrameIndexBuffers.resize(mSwapchainFramebuffers.size());
+    for(FrameIndexBuffer& frameBuffer : mFrameIndexBuffers){
+        VkBufferCreateInfo createInfo;{
+            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            createInfo.pNext = nullptr;
+            createInfo.flags = 0;
+            createInfo.size = FRAME_INDEX_OFFSET + mFrameIndexCapacity * sizeof(uint32_t);
+            createInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            createInfo.queueFamilyIndexCount = 0U;
+            createInfo.pQueueFamilyIndices = nullptr;
+        }
+        if(vkCreateBuffer(mDeviceBundle.logicalDevice.handle(), &createInfo, nullptr, &frameBuffer.buffer) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create frame index buffer!");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(mDeviceBundle.logicalDevice.handle(), frameBuffer.buffer, &requirements);
+        VkMemoryAllocateInfo allocInfo;{
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.allocationSize = requirements.size;
+            allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+        if(vkAllocateMemory(mDeviceBundle.logicalDevice.handle(), &allocInfo, nullptr, &frameBuffer.memory) != VK_SUCCESS){
+            throw std::runtime_error("Failed to allocate frame index buffer memory!");
+        }
+        vkBindBufferMemory(mDeviceBundle.logicalDevice.handle(), frameBuffer.buffer, frameBuffer.memory, 0);
+
+        // Stays mapped for as long as the buffer lives. The memory is coherent, so writes need no flush.
+        void* mapped = nullptr;
+        if(vkMapMemory(mDeviceBundle.logicalDevice.handle(), frameBuffer.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS){
+            throw std::runtime_error("Failed to map frame index buffer!");
+        }
+        frameBuffer.mapped = static_cast<uint8_t*>(mapped);
+        // Zero draw arguments draw nothing until the first upload
+        memset(frameBuffer.mapped, 0, FRAME_INDEX_OFFSET);
+        frameBuffer.capacity = mFrameIndexCapacity;
+        frameBuffer.generation = 0;
+    }
+}
+
+void VulkanGraphicsApp::destroyFrameIndexBuffers(){
+    for(FrameIndexBuffer& frameBuffer : mFrameIndexBuffers){
+        vkDestroyBuffer(mDeviceBundle.logicalDevice.handle(), frameBuffer.buffer, nullptr);
+        // Freeing mapped memory unmaps it
+        vkFreeMemory(mDeviceBundle.logicalDevice.handle(), frameBuffer.memory, nullptr);
+    }
+    mFrameIndexBuffers.clear();
+}
+
+void VulkanGraphicsApp::uploadFrameIndices(uint32_t aImageIndex){
+    if(aImageIndex >= mFrameIndexBuffers.size()) return;
+    FrameIndexBuffer& frameBuffer = mFrameIndexBuffers[aImageIndex];
+    if(frameBuffer.generation == mFrameIndexGeneration) return;
+
+    // The indices may have been set for a larger capacity than the buffer was created with, see setFrameIndexCapacity()
+    const size_t indexCount = std::min(mFrameIndices.size(), frameBuffer.capacity / 3 * 3);
+    if(indexCount > 0){
+        memcpy(frameBuffer.mapped + FRAME_INDEX_OFFSET, mFrameIndices.data(), indexCount * sizeof(uint32_t));
+    }
+    VkDrawIndexedIndirectCommand command;{
+        command.indexCount = static_cast<uint32_t>(indexCount);
+        command.instanceCount = mInstanceCount;
+        command.firstIndex = 0;
+        command.vertexOffset = 0;
+        command.firstInstance = 0;
+    }
+    memcpy(frameBuffer.mapped, &command, sizeof(command));
+    frameBuffer.generation = mFrameIndexGeneration;
+}
+
+void VulkanGraphicsApp::initInstanceCuller(){
+    const bool culled = !mCulledInstanceSpheres.empty() && !mVertexStreams.empty() && mIndexBuffer != VK_NULL_HANDLE && mFrameIndexCapacity == 0;
+    if(culled && !vkutils::GpuInstanceCuller::isSupported(mDeviceBundle.logicalDevice)){
+        if(mInstanceCullerDirty){
+            std::cerr << "Warning: The device lacks drawIndirectFirstInstance, drawing every instance without GPU culling" << std::endl;
+        }
+        mInstanceCullerDirty = false;
+        mInstanceCuller.destroy();
+        return;
+    }
+    if(culled && mIndexRanges.size() > vkutils::GpuInstanceCuller::MAX_RANGES){
+        if(mInstanceCullerDirty){
+            std::cerr << "Warning: The mesh has more than " << vkutils::GpuInstanceCuller::MAX_RANGES
+                      << " index ranges, drawing every instance without GPU culling" << std::endl;
+        }
+        mInstanceCullerDirty = false;
+        mInstanceCuller.destroy();
+        return;
+    }
+    if(!culled){
+        mInstanceCuller.destroy();
+        return;
+    }
+
+    mCulledRanges.clear();
+    for(size_t i = 0; i < mIndexRanges.size(); ++i){
+        vkutils::GpuInstanceCuller::DrawRange range;{
+            range.indexCount = mIndexRanges[i].indexCount;
+            range.firstIndex = mIndexRanges[i].firstIndex;
+            range.vertexOffset = mIndexRanges[i].vertexOffset;
+        }
+        mCulledRanges.push_back(range);
+    }
+    // Rebuilt only when the spheres or the number of swapchain images change. With occlusion it is also destroyed
+    // along with the depth image, see cleanupSwapchainDependents().
+    if(mInstanceCullerDirty || !mInstanceCuller.isValid() || mInstanceCuller.getImageCount() != mSwapchainFramebuffers.size()){
+        if(mOcclusionCulling){
+            vkutils::GpuInstanceCuller::OcclusionSetup occlusion;{
+                occlusion.pyramidShader = loadShader("depth_pyramid.comp");
+                occlusion.depthImage = depthImage;
+                occlusion.depthView = depthImageView;
+                occlusion.depthFormat = findDepthFormat();
+                occlusion.depthExtent = mSwapchainBundle.extent;
+            }
+            mInstanceCuller.init(mDeviceBundle, loadShader("cull_instances_occlusion.comp"), mCulledInstanceSpheres, mSwapchainFramebuffers.size(), &occlusion);
+        }else{
+            mInstanceCuller.init(mDeviceBundle, loadShader("cull_instances.comp"), mCulledInstanceSpheres, mSwapchainFramebuffers.size());
+        }
+        mInstanceCullerDirty = false;
+    }
+}
+
+void VulkanGraphicsApp::initOcclusionRenderPasses(){
+    if(mEarlyRenderPass != VK_NULL_HANDLE) return;
+
+    // Both are compatible with the main render pass, so its pipelines and framebuffers are used with them
+    vkutils::RenderPassConstructionSet earlyCtorSet = mRenderPipeline.getConstructionSet().mRenderpassCtorSet;
+    earlyCtorSet.mColorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    earlyCtorSet.mDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // The depth is cleared after the previous frame's depth pyramid is built from it
+    earlyCtorSet.mDependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    earlyCtorSet.mDependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    earlyCtorSet.mDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    earlyCtorSet.mDependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    mEarlyRenderPass = vkutils::BasicVulkanRenderPipeline::createRenderPass(earlyCtorSet);
+
+    vkutils::RenderPassConstructionSet lateCtorSet = mRenderPipeline.getConstructionSet().mRenderpassCtorSet;
+    lateCtorSet.mColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    lateCtorSet.mColorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    lateCtorSet.mDepthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    lateCtorSet.mDepthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    lateCtorSet.mDepthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    lateCtorSet.mDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    mLateRenderPass = vkutils::BasicVulkanRenderPipeline::createRenderPass(lateCtorSet);
+}
+
+void VulkanGraphicsApp::rerecordCommands(){
+    // Command buffers are pre-recorded per swapchain image and may still be executing
+    waitForInFlightFrames();
+    vkFreeCommandBuffers(mDeviceBundle.logicalDevice.handle(), mCommandPool, mCommandBuffers.size(), mCommandBuffers.data());
+    initCommands();
+}
+
 void VulkanGraphicsApp::initFramebuffers(){
     mSwapchainFramebuffers.resize(mSwapchainBundle.views.size());
     std::array<VkImageView, 2> attachments;
@@ -312,7 +1099,9 @@ void VulkanGraphicsApp::initFramebuffers(){
 void VulkanGraphicsApp::initSync(){
     mImageAvailableSemaphores.resize(IN_FLIGHT_FRAME_LIMIT);
     mRenderFinishSemaphores.resize(IN_FLIGHT_FRAME_LIMIT);
+    mCullFinishedSemaphores.resize(IN_FLIGHT_FRAME_LIMIT);
     mInFlightFences.resize(IN_FLIGHT_FRAME_LIMIT);
+    mImagesInFlight.assign(mSwapchainFramebuffers.size(), VK_NULL_HANDLE);
 
     VkFenceCreateInfo fenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, VK_FENCE_CREATE_SIGNALED_BIT};
     VkSemaphoreCreateInfo semaphoreCreate = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr, 0};
@@ -321,6 +1110,7 @@ void VulkanGraphicsApp::initSync(){
     for(size_t i = 0 ; i < IN_FLIGHT_FRAME_LIMIT; ++i){
         failure |= vkCreateSemaphore(mDeviceBundle.logicalDevice.handle(), &semaphoreCreate, nullptr, &mImageAvailableSemaphores[i]) != VK_SUCCESS;
         failure |= vkCreateSemaphore(mDeviceBundle.logicalDevice.handle(), &semaphoreCreate, nullptr, &mRenderFinishSemaphores[i]) != VK_SUCCESS;
+        failure |= vkCreateSemaphore(mDeviceBundle.logicalDevice.handle(), &semaphoreCreate, nullptr, &mCullFinishedSemaphores[i]) != VK_SUCCESS;
         failure |= vkCreateFence(mDeviceBundle.logicalDevice.handle(), &fenceInfo, nullptr, &mInFlightFences[i]);
     }
     if(failure){
@@ -335,6 +1125,7 @@ void VulkanGraphicsApp::cleanupSwapchainDependents(){
     for(size_t i = 0; i < IN_FLIGHT_FRAME_LIMIT; ++i){
         vkDestroySemaphore(mDeviceBundle.logicalDevice.handle(), mImageAvailableSemaphores[i], nullptr);
         vkDestroySemaphore(mDeviceBundle.logicalDevice.handle(), mRenderFinishSemaphores[i], nullptr);
+        vkDestroySemaphore(mDeviceBundle.logicalDevice.handle(), mCullFinishedSemaphores[i], nullptr);
         vkDestroyFence(mDeviceBundle.logicalDevice.handle(), mInFlightFences[i], nullptr);
     }
 
@@ -344,18 +1135,43 @@ void VulkanGraphicsApp::cleanupSwapchainDependents(){
         vkDestroyFramebuffer(mDeviceBundle.logicalDevice.handle(), fb, nullptr);
     }
 
+    // The occlusion culler reads the depth image, and its render passes use the swapchain format
+    if(mInstanceCuller.usesOcclusion()){
+        mInstanceCuller.destroy();
+    }
+    vkDestroyRenderPass(mDeviceBundle.logicalDevice.handle(), mEarlyRenderPass, nullptr);
+    vkDestroyRenderPass(mDeviceBundle.logicalDevice.handle(), mLateRenderPass, nullptr);
+    mEarlyRenderPass = VK_NULL_HANDLE;
+    mLateRenderPass = VK_NULL_HANDLE;
+
     vkDestroyImageView(mDeviceBundle.logicalDevice, depthImageView, nullptr);
     vkDestroyImage(mDeviceBundle.logicalDevice, depthImage, nullptr);
     vkFreeMemory(mDeviceBundle.logicalDevice, depthImageMemory, nullptr);
-    mRenderPipeline.destroy();
+    mPipelineManager.clear();
+    mMaterialPipelines.clear();
+    discardPendingShaderReload();
 }
 
 void VulkanGraphicsApp::cleanup(){
-    for(std::pair<const std::string, VkShaderModule>& module : mShaderModules){
-        vkDestroyShaderModule(mDeviceBundle.logicalDevice.handle(), module.second, nullptr);
-    }
+    mShaderWatcher.stop();
 
+    // Finishes any background pipeline builds before the modules they use are destroyed
     cleanupSwapchainDependents();
+    destroyFrameIndexBuffers();
+    mInstanceCuller.destroy();
+    mRenderPipeline.destroy();
+
+    // Modules created outside of the library may be registered under several names
+    std::unordered_set<VkShaderModule> externalModules(mRetiredShaderModules.begin(), mRetiredShaderModules.end());
+    for(std::pair<const std::string, VkShaderModule>& module : mShaderModules){
+        if(!mShaderLibrary.owns(module.second)) externalModules.insert(module.second);
+    }
+    for(VkShaderModule module : externalModules){
+        vkDestroyShaderModule(mDeviceBundle.logicalDevice.handle(), module, nullptr);
+    }
+    mRetiredShaderModules.clear();
+    mShaderModules.clear();
+    mShaderLibrary.destroy();
 
     mUniformBuffer.freeBuffer();
     mUniformDescriptorSets.clear();
@@ -451,7 +1267,9 @@ void VulkanGraphicsApp::initUniformDescriptorSets() {
 
 void VulkanGraphicsApp::initDepthResources(){
     VkFormat depthFormat = findDepthFormat();
-    createImage(mSwapchainBundle.extent.width, mSwapchainBundle.extent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+    // Occlusion culling builds its depth pyramid from the depth image
+    const VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (mOcclusionCulling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    createImage(mSwapchainBundle.extent.width, mSwapchainBundle.extent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
     depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 }
 
@@ -2,18 +2,69 @@
 #define VULKAN_GRAPHICS_APP_H_
 #include "VulkanSetupBaseApp.h"
 #include "vkutils/vkutils.h"
+#include "vkutils/PipelineManager.h"
+#include "vkutils/ShaderLibrary.h"
+#include "vkutils/GpuInstanceCuller.h"
 #include "data/VertexGeometry.h"
 #include "data/UniformBuffer.h"
+#include "data/SpecializationConstants.h"
+#include "utils/FileWatcher.h"
+#include "utils/DrawQueue.h"
 #include <map>
+#include <memory>
+#include <future>
+#include <mutex>
+
+/// Shaders and fixed function state for a group of draws. Materials share the vertex input, uniforms and render pass
+/// of the app and only differ in the state listed here.
+struct MaterialInfo
+{
+    std::string vertexShader;
+    std::string fragmentShader;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    // Alpha blending, e.g. for transparent materials
+    VkBool32 blendEnable = VK_FALSE;
+    VkBool32 depthTestEnable = VK_TRUE;
+    VkBool32 depthWriteEnable = VK_TRUE;
+    SpecializationConstantsPtr vertexConstants = nullptr;
+    SpecializationConstantsPtr fragmentConstants = nullptr;
+    // Only read positions from the first vertex stream (binding 0), e.g. for depth-only passes. Pipelines of such
+    // materials drop every other binding and their draws bind just the first stream.
+    bool positionOnly = false;
+};
+
+/// Part of an index buffer drawn with its own vertex offset, e.g. one 16 bit indexed chunk of a large mesh
+struct IndexedDrawRange
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+};
 
 class VulkanGraphicsApp : public VulkanSetupBaseApp{
  public:
+    /// Binds recorded into a command buffer, and those skipped because the state was already bound
+    struct DrawBindStats
+    {
+        uint32_t pipelineBinds = 0;
+        uint32_t pipelineBindsSaved = 0;
+        uint32_t descriptorSetBinds = 0;
+        uint32_t descriptorSetBindsSaved = 0;
+        // Counted per buffer, a single call may bind several streams
+        uint32_t vertexBufferBinds = 0;
+        uint32_t vertexBufferBindsSaved = 0;
+        uint32_t indexBufferBinds = 0;
+        uint32_t indexBufferBindsSaved = 0;
+    };
     
     void init();
     void cleanup();
     
     const VkExtent2D& getFramebufferSize() const;
 
+    /// Binds of the last recorded commands. Every swapchain image records the same draws, so these are per image.
+    const DrawBindStats& getDrawBindStats() const {return(mDrawBindStats);}
+
  protected:
 
     void render();
@@ -23,10 +74,117 @@ class VulkanGraphicsApp : public VulkanSetupBaseApp{
        const std::vector<VkVertexInputAttributeDescription>& aAttributeDescriptions
     );
 
+    /// Vertex input split over several streams. Bindings must be numbered consecutively from 0, with positions in
+    /// binding 0 so that position-only materials can skip the remaining streams. Bindings with
+    /// VK_VERTEX_INPUT_RATE_INSTANCE must come after every per vertex binding, and are fed by addInstanceBuffer().
+    void setVertexInput(
+       const std::vector<VkVertexInputBindingDescription>& aBindingDescriptions,
+       const std::vector<VkVertexInputAttributeDescription>& aAttributeDescriptions
+    );
+
     void setVertexBuffer(const VkBuffer& aBuffer, size_t aVertexCount);
 
-    void setVertexShader(const std::string& aShaderName, const VkShaderModule& aShaderModule);
-    void setFragmentShader(const std::string& aShaderName, const VkShaderModule& aShaderModule);
+    /// Set one buffer per vertex rate input binding, in binding order.
+    void setVertexBuffers(const std::vector<VkBuffer>& aStreams, size_t aVertexCount);
+
+    /** Read the per instance attributes of the instance rate binding 'aBinding' from 'aBuffer', see setVertexInput().
+     * Instance buffers are bound once for every draw, including those of position-only materials, and instance i of
+     * a draw reads element i of each. Adding a buffer for a binding that already has one replaces it.
+    */
+    void addInstanceBuffer(uint32_t aBinding, const VkBuffer& aBuffer);
+
+    /// Draw the default vertex buffers this many times in a single instanced draw per index range. 1 by default.
+    void setInstanceCount(uint32_t aInstanceCount);
+
+    /// Draw the default vertex buffer indexed by 'aIndexCount' indices from 'aBuffer'. Passing VK_NULL_HANDLE
+    /// switches back to drawing the vertex buffer as a plain triangle list.
+    void setIndexBuffer(const VkBuffer& aBuffer, size_t aIndexCount, VkIndexType aIndexType = VK_INDEX_TYPE_UINT32);
+
+    /// Like setIndexBuffer() above, but draws each of 'aRanges' from 'aBuffer'. Lets meshes with more than 64k
+    /// vertices be split into chunks that each fit VK_INDEX_TYPE_UINT16.
+    void setIndexBuffer(const VkBuffer& aBuffer, const std::vector<IndexedDrawRange>& aRanges, VkIndexType aIndexType = VK_INDEX_TYPE_UINT32);
+
+    /** Draw the default vertex buffers with 32 bit indices that are replaced every frame, e.g. by culling on the CPU,
+     * instead of from the index buffer. Every swapchain image gets a host visible buffer for up to 'aMaxIndexCount'
+     * indices, which render() fills from setFrameIndices() and draws indirectly, so new indices never cause the
+     * commands to be rerecorded. Passing 0 switches back to the index buffer set by setIndexBuffer().
+    */
+    void setFrameIndexCapacity(size_t aMaxIndexCount);
+
+    /// Indices into the default vertex buffers drawn from the next render() on, see setFrameIndexCapacity(). Indices
+    /// beyond the capacity are dropped.
+    void setFrameIndices(const std::vector<uint32_t>& aIndices);
+
+    /** Cull the instances of the default indexed draw in a compute pass and draw the visible ones indirectly, see
+     * vkutils::GpuInstanceCuller. Instance i has the bounding sphere 'aInstanceSpheres[i]' (center in xyz, radius in
+     * w) and is drawn with element i of the instance buffers, replacing setInstanceCount(). Passing an empty list
+     * switches back to drawing every instance. Devices without drawIndirectFirstInstance, and meshes with more than
+     * GpuInstanceCuller::MAX_RANGES index ranges, draw every instance as well.
+    */
+    void setGpuCulledInstances(const std::vector<glm::vec4>& aInstanceSpheres);
+
+    /// Transforms from the space of the culled instances' spheres to view space and on to clip space, used from the
+    /// next render() on. The instances are culled against the frustum they define.
+    void setCullingTransforms(const glm::mat4& aModelView, const glm::mat4& aProjection);
+
+    /** Also cull instances hidden behind others, tested against a depth pyramid of the frame's own depth buffer, see
+     * vkutils::GpuInstanceCuller. The frame is then drawn in two render passes, the second drawing the instances the
+     * first one missed. Expects a symmetric perspective projection. Changing it rebuilds the render setup.
+    */
+    void setOcclusionCulling(bool aEnable);
+
+    /** Set the shaders used by the default pipeline.
+     * 
+     * Arguments:
+     *   aShaderName: Name to register the module under. Materials can refer to the shader by this name.
+     *   aShaderModule: The compiled shader module.
+     *   aConstants: Optional specialization constant values the stage is compiled with.
+    */
+    void setVertexShader(const std::string& aShaderName, const VkShaderModule& aShaderModule, SpecializationConstantsPtr aConstants = nullptr);
+    void setFragmentShader(const std::string& aShaderName, const VkShaderModule& aShaderModule, SpecializationConstantsPtr aConstants = nullptr);
+
+    /** Draw the default vertex buffers in a depth prepass, so each of their pixels is shaded only once. The prepass
+     * fills the depth buffer with the position-only vertex shader 'aShaderModule' and no fragment shader, then the
+     * default pipeline draws again with depth writes off, keeping only fragments of equal depth. The prepass shader
+     * must compute gl_Position exactly as the default vertex shader does, with both declaring it invariant. Draw
+     * calls of materials are not part of the prepass. Passing an empty name turns the prepass off.
+    */
+    void setDepthPrepassShader(const std::string& aShaderName, const VkShaderModule& aShaderModule);
+
+    /** Load the compiled shader 'aShaderName' (e.g. "standard.vert"), from the packed shader archive if the build
+     * produced one and from SHADER_DIR/<aShaderName>.spv otherwise. Shaders with identical byte code share a single
+     * module, which the app owns and destroys on cleanup. Throws if the shader cannot be found.
+    */
+    VkShaderModule loadShader(const std::string& aShaderName);
+
+    /// Register a shader module under the given name without making it the default vertex or fragment shader.
+    /// Materials refer to shaders by these names.
+    void addShaderModule(const std::string& aShaderName, const VkShaderModule& aShaderModule);
+
+    /** Define a material that draws can be submitted with. Redefining an existing material replaces it.
+     * Pipelines are created lazily and shared between materials with identical state.
+    */
+    void addMaterial(const std::string& aMaterialName, const MaterialInfo& aMaterialInfo);
+
+    /** Draw 'aVertexCount' vertices from 'aVertexBuffer' with the given material in addition to the default
+     * vertex buffer set by setVertexBuffer(), 'aInstanceCount' times in one instanced draw. Draws are grouped by
+     * pipeline when recorded, so submission order between different materials is not preserved.
+    */
+    void addDrawCall(const std::string& aMaterialName, const VkBuffer& aVertexBuffer, size_t aVertexCount, uint32_t aInstanceCount = 1);
+    void addDrawCall(const std::string& aMaterialName, const std::vector<VkBuffer>& aVertexStreams, size_t aVertexCount, uint32_t aInstanceCount = 1);
+
+    /// Indexed variant of addDrawCall(), drawing 'aIndexCount' indices from 'aIndexBuffer' into 'aVertexBuffer',
+    /// starting at 'aFirstIndex' and with 'aVertexOffset' added to every index.
+    void addDrawCall(
+        const std::string& aMaterialName, const VkBuffer& aVertexBuffer,
+        const VkBuffer& aIndexBuffer, size_t aIndexCount, VkIndexType aIndexType = VK_INDEX_TYPE_UINT32,
+        uint32_t aFirstIndex = 0, int32_t aVertexOffset = 0, uint32_t aInstanceCount = 1
+    );
+    void addDrawCall(
+        const std::string& aMaterialName, const std::vector<VkBuffer>& aVertexStreams,
+        const VkBuffer& aIndexBuffer, size_t aIndexCount, VkIndexType aIndexType = VK_INDEX_TYPE_UINT32,
+        uint32_t aFirstIndex = 0, int32_t aVertexOffset = 0, uint32_t aInstanceCount = 1
+    );
 
     /** Add a new uniform to the graphics pipeline via the uniform handler interface class.
      * If a uniform handler already exists for the given binding point, the existing handler is freed and replaced. 
@@ -38,13 +196,41 @@ class VulkanGraphicsApp : public VulkanSetupBaseApp{
     */
     void addUniform(uint32_t aBindPoint, UniformDataInterfacePtr aUniformData, VkShaderStageFlags aStageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 
+    /** Watch the compiled SPIR-V of every registered shader (SHADER_DIR/<shader name>.spv) for changes.
+     * A changed module is reloaded and only the pipelines that use it are rebuilt in the background.
+     * They are swapped in at the start of a frame once ready. The render setup is not reset.
+    */
+    void enableShaderHotReload();
+
     size_t mFrameNumber = 0;
 
+    /// Held around every use of the device's queues. The graphics, presentation and transfer queues may all be the
+    /// same VkQueue, which must not be used from two threads at once (see AssetStreamer).
+    std::mutex mQueueMutex;
+
  private:
 
     void initRenderPipeline();
+    VkPipeline getMaterialPipeline(const std::string& aMaterialName);
+    void keepPositionInputs(
+        vkutils::GraphicsPipelineConstructionSet& aCtorSetInOut, std::vector<VkVertexInputBindingDescription>& aBindingsOut,
+        std::vector<VkVertexInputAttributeDescription>& aAttributesOut
+    ) const;
+    void initDepthPrepassPipelines();
     void initFramebuffers();
     void initCommands();
+    void rerecordCommands();
+    void waitForInFlightFrames();
+    void initFrameIndexBuffers();
+    void destroyFrameIndexBuffers();
+    void uploadFrameIndices(uint32_t aImageIndex);
+    void initInstanceCuller();
+    void initOcclusionRenderPasses();
+
+    void initShaderLibrary();
+    void registerShaderModule(const std::string& aShaderName, const VkShaderModule& aShaderModule);
+    void processShaderReloads();
+    void discardPendingShaderReload();
     void initSync();
     
     void resetRenderSetup();
@@ -67,23 +253,103 @@ class VulkanGraphicsApp : public VulkanSetupBaseApp{
     std::vector<VkFramebuffer> mSwapchainFramebuffers;
     std::vector<VkSemaphore> mImageAvailableSemaphores;
     std::vector<VkSemaphore> mRenderFinishSemaphores;
+    // Signaled by the instance culling pass, waited on by the draws that read its output
+    std::vector<VkSemaphore> mCullFinishedSemaphores;
     std::vector<VkFence> mInFlightFences;
+    // Fence of the last submission that rendered to each swapchain image, so per-image data isn't overwritten early
+    std::vector<VkFence> mImagesInFlight;
 
     vkutils::BasicVulkanRenderPipeline mRenderPipeline;
+    size_t mPipelineBuildCount = 0;
+
+    struct DrawCall
+    {
+        std::string material;
+        std::vector<VkBuffer> vertexStreams;
+        size_t vertexCount = 0U;
+        // Drawn indexed if set, in which case vertexCount is unused
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        size_t indexCount = 0U;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t instanceCount = 1;
+    };
+
+    vkutils::PipelineManager mPipelineManager;
+    std::unordered_map<std::string, MaterialInfo> mMaterials;
+    // VK_NULL_HANDLE while a material's first pipeline is compiling, meaning it is drawn with the default pipeline
+    std::unordered_map<std::string, VkPipeline> mMaterialPipelines;
+    std::vector<DrawCall> mDrawCalls;
+    // Orders the draws by the state they bind whenever the commands are recorded
+    DrawQueue mDrawQueue;
+    DrawBindStats mDrawBindStats;
+    // Owned by mPipelineManager, and looked up again whenever the commands are recorded
+    VkPipeline mDepthPrepassPipeline = VK_NULL_HANDLE;
+    VkPipeline mDepthEqualPipeline = VK_NULL_HANDLE;
+
+    bool mShaderHotReload = false;
+    FileWatcher mShaderWatcher;
+    // Replaced modules are kept alive until cleanup so their handles can't be reused while the pipeline cache
+    // still holds pipelines keyed by them.
+    std::vector<VkShaderModule> mRetiredShaderModules;
+    std::unique_ptr<vkutils::GraphicsPipelineConstructionSet> mReloadCtorSet = nullptr;
+    std::shared_future<VkPipeline> mReloadPipeline;
 
     VkCommandPool mCommandPool = VK_NULL_HANDLE;
     std::vector<VkCommandBuffer> mCommandBuffers;
+    // Set when the default vertex or index buffers change, so the next frame rerecords the command buffers
+    bool mCommandsDirty = false;
 
+    vkutils::ShaderLibrary mShaderLibrary;
     std::unordered_map<std::string, VkShaderModule> mShaderModules;
     std::string mVertexKey;
     std::string mFragmentKey;
+    std::string mDepthPrepassKey;
+    SpecializationConstantsPtr mVertexConstants = nullptr;
+    SpecializationConstantsPtr mFragmentConstants = nullptr;
 
     bool mVertexInputsHaveBeenSet = false;
-    VkVertexInputBindingDescription mBindingDescription = {};
+    std::vector<VkVertexInputBindingDescription> mBindingDescriptions;
     std::vector<VkVertexInputAttributeDescription> mAttributeDescriptions;
-    VkBuffer mVertexBuffer = VK_NULL_HANDLE;
+    std::vector<VkBuffer> mVertexStreams;
     size_t mVertexCount = 0U;
+    VkBuffer mIndexBuffer = VK_NULL_HANDLE;
+    std::vector<IndexedDrawRange> mIndexRanges;
+    VkIndexType mIndexType = VK_INDEX_TYPE_UINT32;
+    // Buffers of the instance rate bindings by binding number, and the instances of the default vertex buffers
+    std::map<uint32_t, VkBuffer> mInstanceBuffers;
+    uint32_t mInstanceCount = 1;
+
+    // Holds a VkDrawIndexedIndirectCommand followed by the indices, at FRAME_INDEX_OFFSET
+    struct FrameIndexBuffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        // Indices the buffer holds after its draw arguments
+        size_t capacity = 0;
+        // Value of mFrameIndexGeneration the contents were last written for
+        uint64_t generation = 0;
+    };
+    const static VkDeviceSize FRAME_INDEX_OFFSET = 32;
+    std::vector<FrameIndexBuffer> mFrameIndexBuffers;
+    size_t mFrameIndexCapacity = 0;
+    std::vector<uint32_t> mFrameIndices;
+    uint64_t mFrameIndexGeneration = 0;
 
+    vkutils::GpuInstanceCuller mInstanceCuller;
+    std::vector<glm::vec4> mCulledInstanceSpheres;
+    // Set when the spheres change, so the culler is recreated along with the commands
+    bool mInstanceCullerDirty = false;
+    std::vector<vkutils::GpuInstanceCuller::DrawRange> mCulledRanges;
+    glm::mat4 mCullingModelView = glm::mat4(1.0f);
+    glm::mat4 mCullingProjection = glm::mat4(1.0f);
+    bool mOcclusionCulling = false;
+    // Split of the main render pass for occlusion culling. The first stores the depth the pyramid is built from,
+    // the second loads color and depth to draw the instances found visible in between.
+    VkRenderPass mEarlyRenderPass = VK_NULL_HANDLE;
+    VkRenderPass mLateRenderPass = VK_NULL_HANDLE;
 
     UniformBuffer mUniformBuffer;
     VkDeviceSize mTotalUniformDescriptorSetCount = 0;
@@ -68,10 +68,14 @@ const std::vector<std::string>& VulkanSetupBaseApp::getRequiredDeviceExtensions(
 }
 const std::vector<std::string>& VulkanSetupBaseApp::getRequestedDeviceExtensions() const {
     const static std::vector<std::string> sRequested = {
-        // None
+        // Lets indirect draws read their count from a buffer written on the GPU
+        VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
     };
     return(sRequested);
 }
+std::string VulkanSetupBaseApp::getPipelineCachePath() const {
+    return(STRIFY(CACHE_DIR) "pipeline_cache.bin");
+}
 const std::unordered_map<std::string, bool>& VulkanSetupBaseApp::getValidationLayersState() const {
     return(_mValidationLayers);
 }
@@ -240,7 +244,15 @@ void VulkanSetupBaseApp::initVkDevices(){
 
     vkutils::find_extension_matches(mDeviceBundle.physicalDevice.mAvailableExtensions, requiredExts, requestedExts, deviceExtensions);
 
-    mDeviceBundle.logicalDevice = mDeviceBundle.physicalDevice.createPresentableCoreDevice(mVkSurface, vkutils::strings_to_cstrs(deviceExtensions));
+    // Optional features for GPU driven draws, enabled where available
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    enabledFeatures.multiDrawIndirect = mDeviceBundle.physicalDevice.mFeatures.multiDrawIndirect;
+    enabledFeatures.drawIndirectFirstInstance = mDeviceBundle.physicalDevice.mFeatures.drawIndirectFirstInstance;
+
+    mDeviceBundle.logicalDevice = mDeviceBundle.physicalDevice.createPresentableCoreDevice(mVkSurface, vkutils::strings_to_cstrs(deviceExtensions), &enabledFeatures);
+
+    // Seed the pipeline cache with whatever a previous run on this device and driver left behind
+    mDeviceBundle.pipelineCache = VulkanPipelineCache::create(mDeviceBundle.logicalDevice.handle(), mDeviceBundle.physicalDevice, getPipelineCachePath());
 }
 
 void VulkanSetupBaseApp::initPresentationSurface(){
@@ -384,6 +396,10 @@ const VkExtent2D VulkanSetupBaseApp::selectSwapChainExtent(const VkSurfaceCapabi
 void VulkanSetupBaseApp::cleanup(){
     cleanupSwapchain();
     vkDestroySurfaceKHR(mVkInstance, mVkSurface, nullptr);
+    if(!getPipelineCachePath().empty()){
+        mDeviceBundle.pipelineCache.save(getPipelineCachePath());
+    }
+    mDeviceBundle.pipelineCache.destroy();
     vkDestroyDevice(mDeviceBundle.logicalDevice.handle(), nullptr);
     vkDestroyInstance(mVkInstance, nullptr);
     glfwDestroyWindow(mWindow);
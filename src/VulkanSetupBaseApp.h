@@ -50,6 +50,8 @@ class VulkanSetupBaseApp{
     virtual const std::vector<std::string>& getRequestedInstanceExtensions() const;
     virtual const std::vector<std::string>& getRequiredDeviceExtensions() const;
     virtual const std::vector<std::string>& getRequestedDeviceExtensions() const;
+    // Location the pipeline cache is loaded from at startup and saved to on cleanup. Empty disables persistence.
+    virtual std::string getPipelineCachePath() const;
     // Functions used to determine swap chain configuration
     virtual const VkSurfaceFormatKHR selectSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& aFormats) const;
     virtual const VkPresentModeKHR selectPresentationMode(const std::vector<VkPresentModeKHR>& aModes) const;
@@ -0,0 +1,267 @@
+#include "AssetRegistry.h"
+#include "utils/Hash.h"
+#include <sys/stat.h>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+
+// Absolute path with symbolic links and '.' and '..' resolved, or 'aPath' itself if it can't be resolved
+static std::string canonical_path(const std::string& aPath){
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if(_fullpath(resolved, aPath.c_str(), _MAX_PATH) == nullptr) return(aPath);
+#else
+    char resolved[PATH_MAX];
+    if(realpath(aPath.c_str(), resolved) == nullptr) return(aPath);
+#endif
+    return(std::string(resolved));
+}
+
+// Changes whenever the file is rewritten, without reading it. Zero if the file doesn't exist.
+static uint64_t file_stamp(const std::string& aPath){
+    struct stat fileInfo;
+    if(stat(aPath.c_str(), &fileInfo) != 0) return(0);
+    uint64_t stamp = Fnv1aHasher().add(static_cast<uint64_t>(fileInfo.st_size)).add(static_cast<int64_t>(fileInfo.st_mtime)).value();
+    return(stamp != 0 ? stamp : 1);
+}
+
+static const char* state_name(AssetStateEnum aState){
+    switch(aState){
+        case ASSET_LOADING: return("loading");
+        case ASSET_READY: return("ready");
+        case ASSET_FAILED: return("failed");
+        default: return("unloaded");
+    }
+}
+
+AssetRegistry::~AssetRegistry(){
+    // Frees whatever is left, so the GPU must be done with every mesh by now
+    for(uint32_t i = 0; i < mEntries.size(); ++i){
+        if(mEntries[i].live) unload(i);
+    }
+}
+
+uint64_t AssetRegistry::content_key(uint64_t aContentHash, StreamedVertexFormat aFormat){
+    uint64_t key = aContentHash;
+    hash_combine(key, static_cast<uint64_t>(aFormat));
+    return(key);
+}
+
+MeshHandle AssetRegistry::acquire(const std::string& aPath, StreamedVertexFormat aFormat){
+    const std::string path = canonical_path(aPath);
+    const uint64_t fileStamp = file_stamp(path);
+    if(fileStamp == 0){
+        std::cerr << "Warning: Can't acquire missing asset '" << aPath << "'" << std::endl;
+        return(MeshHandle());
+    }
+
+    // Same file unchanged since it was requested
+    uint32_t index = MeshHandle::sInvalidIndex;
+    auto byPath = mByPath.find(std::make_pair(path, static_cast<int>(aFormat)));
+    if(byPath != mByPath.end() && mEntries[byPath->second].fileStamp == fileStamp){
+        index = byPath->second;
+    }
+
+    if(index == MeshHandle::sInvalidIndex){
+        if(mFreeEntries.empty()){
+            index = static_cast<uint32_t>(mEntries.size());
+            mEntries.emplace_back();
+        }else{
+            index = mFreeEntries.back();
+            mFreeEntries.pop_back();
+        }
+
+        Entry& entry = mEntries[index];
+        entry.live = true;
+        entry.state = ASSET_LOADING;
+        entry.references = 0;
+        entry.path = path;
+        entry.format = aFormat;
+        entry.fileStamp = fileStamp;
+        entry.contentHash = 0;
+        entry.ticket = mStreamer.requestModel(path, aFormat);
+        entry.mesh = StreamedMesh();
+        entry.sharedWith = MeshHandle::sInvalidIndex;
+
+        mByTicket[entry.ticket] = index;
+        // An edited file replaces the entry its path refers to, while the old version stays loaded for its users
+        mByPath[std::make_pair(path, static_cast<int>(aFormat))] = index;
+    }
+
+    Entry& entry = mEntries[index];
+    ++entry.references;
+    MeshHandle handle;
+    handle.index = index;
+    handle.generation = entry.generation;
+    return(handle);
+}
+
+void AssetRegistry::acquire(MeshHandle aHandle){
+    ++get(aHandle).references;
+}
+
+void AssetRegistry::release(MeshHandle aHandle){
+    Entry& entry = get(aHandle);
+    if(entry.references == 0){
+        throw std::runtime_error("AssetRegistry::release() called more often than acquire() for '" + entry.path + "'!");
+    }
+    --entry.references;
+}
+
+size_t AssetRegistry::update(){
+    size_t readyCount = 0;
+    StreamedMesh mesh;
+    while(mStreamer.poll(mesh)){
+        auto byTicket = mByTicket.find(mesh.ticket);
+        if(byTicket == mByTicket.end()){
+            // Not one of ours, or unloaded while it was still loading
+            mesh.freeBuffers();
+            continue;
+        }
+        const uint32_t index = byTicket->second;
+        Entry& entry = mEntries[index];
+        mByTicket.erase(byTicket);
+
+        if(!mesh.isValid()){
+            std::cerr << "Warning: Failed to load asset '" << entry.path << "': " << mesh.error << std::endl;
+            entry.state = ASSET_FAILED;
+            entry.mesh = std::move(mesh);
+            mesh = StreamedMesh();
+            // Acquiring the path again retries, while handles to this entry keep reporting the failure
+            forget(index);
+            continue;
+        }
+
+        entry.state = ASSET_READY;
+        entry.contentHash = mesh.contentHash;
+        ++readyCount;
+        const uint64_t contentKey = content_key(mesh.contentHash, entry.format);
+        auto byContent = mesh.contentHash != 0 ? mByContent.find(contentKey) : mByContent.end();
+        if(byContent != mByContent.end() && byContent->second != index){
+            // A different path to the same content arrived first
+            mesh.freeBuffers();
+            entry.sharedWith = byContent->second;
+            ++mEntries[entry.sharedWith].references;
+        }else{
+            entry.mesh = std::move(mesh);
+            if(entry.contentHash != 0) mByContent[contentKey] = index;
+        }
+        mesh = StreamedMesh();
+    }
+    return(readyCount);
+}
+
+size_t AssetRegistry::unloadUnused(){
+    // Unloading a mesh that shares another one's buffers releases that one, which may then be unused as well
+    size_t unloadCount = 0;
+    size_t passCount = 0;
+    do{
+        passCount = 0;
+        for(uint32_t i = 0; i < mEntries.size(); ++i){
+            if(mEntries[i].live && mEntries[i].references == 0){
+                unload(i);
+                ++passCount;
+            }
+        }
+        unloadCount += passCount;
+    }while(passCount > 0);
+    return(unloadCount);
+}
+
+void AssetRegistry::forget(uint32_t aIndex){
+    const Entry& entry = mEntries[aIndex];
+    for(auto byPath = mByPath.begin(); byPath != mByPath.end();){
+        byPath = byPath->second == aIndex ? mByPath.erase(byPath) : std::next(byPath);
+    }
+    auto byContent = mByContent.find(content_key(entry.contentHash, entry.format));
+    if(byContent != mByContent.end() && byContent->second == aIndex) mByContent.erase(byContent);
+}
+
+void AssetRegistry::unload(uint32_t aIndex){
+    Entry& entry = mEntries[aIndex];
+
+    forget(aIndex);
+    // A mesh still loading is freed by update() once it arrives
+    mByTicket.erase(entry.ticket);
+    if(entry.sharedWith != MeshHandle::sInvalidIndex){
+        Entry& shared = mEntries[entry.sharedWith];
+        // Only the destructor unloads an entry that is still shared, in which case the order doesn't matter
+        if(shared.live && shared.references > 0) --shared.references;
+        entry.sharedWith = MeshHandle::sInvalidIndex;
+    }
+
+    entry.mesh.freeBuffers();
+    entry.mesh = StreamedMesh();
+    entry.live = false;
+    entry.state = ASSET_UNLOADED;
+    entry.path.clear();
+    ++entry.generation;
+    mFreeEntries.push_back(aIndex);
+}
+
+const AssetRegistry::Entry* AssetRegistry::find(MeshHandle aHandle) const{
+    if(!aHandle.isValid() || aHandle.index >= mEntries.size()) return(nullptr);
+    const Entry& entry = mEntries[aHandle.index];
+    if(!entry.live || entry.generation != aHandle.generation) return(nullptr);
+    return(&entry);
+}
+
+AssetRegistry::Entry& AssetRegistry::get(MeshHandle aHandle){
+    const Entry* entry = find(aHandle);
+    if(entry == nullptr){
+        throw std::runtime_error("AssetRegistry: Invalid or stale mesh handle!");
+    }
+    return(mEntries[aHandle.index]);
+}
+
+AssetStateEnum AssetRegistry::getState(MeshHandle aHandle) const{
+    const Entry* entry = find(aHandle);
+    return(entry != nullptr ? entry->state : ASSET_UNLOADED);
+}
+
+const AssetRegistry::Entry& AssetRegistry::resolve(const Entry& aEntry) const{
+    return(aEntry.sharedWith != MeshHandle::sInvalidIndex ? mEntries[aEntry.sharedWith] : aEntry);
+}
+
+const StreamedMesh* AssetRegistry::getMesh(MeshHandle aHandle) const{
+    const Entry* entry = find(aHandle);
+    return(entry != nullptr && entry->state == ASSET_READY ? &resolve(*entry).mesh : nullptr);
+}
+
+AssetMemoryInfo AssetRegistry::getMemoryInfo(MeshHandle aHandle) const{
+    AssetMemoryInfo info;
+    const Entry* entry = find(aHandle);
+    if(entry != nullptr){
+        info.deviceBytes = resolve(*entry).mesh.deviceBytes;
+        info.meshCount = 1;
+        info.references = entry->references;
+    }
+    return(info);
+}
+
+AssetMemoryInfo AssetRegistry::getMemoryInfo() const{
+    AssetMemoryInfo info;
+    for(const Entry& entry : mEntries){
+        if(!entry.live) continue;
+        info.deviceBytes += entry.mesh.deviceBytes;
+        info.meshCount += 1;
+        info.references += entry.references;
+    }
+    return(info);
+}
+
+void AssetRegistry::printReport(std::ostream& aStream) const{
+    for(const Entry& entry : mEntries){
+        if(!entry.live) continue;
+        aStream << "  " << std::setw(8) << state_name(entry.state) << " " << std::setw(3) << entry.references << " refs "
+                << std::setw(10) << entry.mesh.deviceBytes << " bytes  " << entry.path
+                << (entry.format == STREAMED_VERTEX_PACKED ? " (packed)" : "");
+        if(entry.sharedWith != MeshHandle::sInvalidIndex) aStream << " (shares " << mEntries[entry.sharedWith].path << ")";
+        aStream << std::endl;
+    }
+    AssetMemoryInfo total = getMemoryInfo();
+    aStream << "Assets: " << total.meshCount << " meshes, " << total.references << " references, "
+            << total.deviceBytes / 1024.0 << " KiB device memory" << std::endl;
+}
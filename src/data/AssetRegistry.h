@@ -0,0 +1,135 @@
+#ifndef ASSET_REGISTRY_H_
+#define ASSET_REGISTRY_H_
+
+#include "AssetStreamer.h"
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Refers to a mesh held by an AssetRegistry. Plain data, so copying a handle does not add a reference.
+struct MeshHandle
+{
+    static const uint32_t sInvalidIndex = UINT32_MAX;
+
+    uint32_t index = sInvalidIndex;
+    // Handles to an unloaded mesh stay invalid even after its slot is reused
+    uint32_t generation = 0;
+
+    bool isValid() const {return(index != sInvalidIndex);}
+
+    friend bool operator==(const MeshHandle& aLeft, const MeshHandle& aRight){return(aLeft.index == aRight.index && aLeft.generation == aRight.generation);}
+    friend bool operator!=(const MeshHandle& aLeft, const MeshHandle& aRight){return(!(aLeft == aRight));}
+};
+
+enum AssetStateEnum
+{
+    ASSET_LOADING,
+    ASSET_READY,
+    ASSET_FAILED,
+    // The handle no longer refers to a mesh of the registry
+    ASSET_UNLOADED
+};
+
+/// Memory held by one mesh, or by every mesh of a registry
+struct AssetMemoryInfo
+{
+    VkDeviceSize deviceBytes = 0;
+    size_t meshCount = 0;
+    size_t references = 0;
+};
+
+/** Loads every mesh once, however many users it has.
+ *
+ * Meshes are keyed by their canonical path, and the size and modification time of the file. Acquiring a path that
+ * is already loaded or loading returns the existing mesh. Editing a file changes its key, so the next acquire loads
+ * the new version while the old one stays loaded for the users that still hold it. A mesh that fails to load is
+ * forgotten by its path, so acquiring the path again retries.
+ *
+ * The streamer also hashes the content of every file it loads. A mesh that arrives with the same content as one that
+ * is already loaded from a different path frees its own buffers and shares those of the other mesh instead.
+ *
+ * Every acquire() must be balanced by a release(). Meshes without references keep their buffers until
+ * unloadUnused() is called, which gives the caller a point to make sure the GPU is done with them.
+ *
+ * Loading goes through the given AssetStreamer. The registry polls it, so nothing else may. The registry itself
+ * is not thread safe and is meant to be used from the render thread.
+ */
+class AssetRegistry
+{
+ public:
+    explicit AssetRegistry(AssetStreamer& aStreamer) : mStreamer(aStreamer) {}
+    ~AssetRegistry();
+
+    AssetRegistry(const AssetRegistry& aOther) = delete;
+    AssetRegistry& operator=(const AssetRegistry& aOther) = delete;
+
+    /// Take a reference to the mesh at 'aPath' in the given format, requesting it from the streamer if it isn't
+    /// loaded yet. Returns an invalid handle if the file does not exist.
+    MeshHandle acquire(const std::string& aPath, StreamedVertexFormat aFormat = STREAMED_VERTEX_SPLIT);
+    /// Take another reference to an already acquired mesh
+    void acquire(MeshHandle aHandle);
+    /// Drop a reference. Releasing an invalid or stale handle is an error.
+    void release(MeshHandle aHandle);
+
+    /// Pick up meshes the streamer finished since the last call. Returns the number of meshes that became ready.
+    size_t update();
+
+    /// Free the buffers of every mesh without references. The GPU must not be using them anymore.
+    /// Returns the number of meshes unloaded.
+    size_t unloadUnused();
+
+    AssetStateEnum getState(MeshHandle aHandle) const;
+    bool isReady(MeshHandle aHandle) const {return(getState(aHandle) == ASSET_READY);}
+    /// The loaded mesh, or nullptr unless the mesh is ready
+    const StreamedMesh* getMesh(MeshHandle aHandle) const;
+
+    AssetMemoryInfo getMemoryInfo(MeshHandle aHandle) const;
+    /// Totals over every mesh held by the registry, including unreferenced ones that haven't been unloaded
+    AssetMemoryInfo getMemoryInfo() const;
+    /// One line per mesh with its state, references and allocated device memory
+    void printReport(std::ostream& aStream = std::cout) const;
+
+ protected:
+    struct Entry
+    {
+        uint32_t generation = 0;
+        bool live = false;
+        AssetStateEnum state = ASSET_UNLOADED;
+        size_t references = 0;
+
+        std::string path;
+        StreamedVertexFormat format = STREAMED_VERTEX_SPLIT;
+        // Size and modification time of the file when it was requested
+        uint64_t fileStamp = 0;
+        // Known once the mesh has arrived
+        uint64_t contentHash = 0;
+        uint64_t ticket = 0;
+        StreamedMesh mesh;
+        // Entry whose mesh this one shares, holding a reference to it. Its own mesh has no buffers then.
+        uint32_t sharedWith = MeshHandle::sInvalidIndex;
+    };
+
+    const Entry* find(MeshHandle aHandle) const;
+    Entry& get(MeshHandle aHandle);
+    // The entry holding the buffers of 'aEntry'
+    const Entry& resolve(const Entry& aEntry) const;
+    // Drop every lookup leading to the entry, so later acquires don't find it
+    void forget(uint32_t aIndex);
+    void unload(uint32_t aIndex);
+
+    static uint64_t content_key(uint64_t aContentHash, StreamedVertexFormat aFormat);
+
+    AssetStreamer& mStreamer;
+
+    std::vector<Entry> mEntries;
+    std::vector<uint32_t> mFreeEntries;
+    // Canonical path and format, and content hash and format, of every live entry that hasn't failed
+    std::map<std::pair<std::string, int>, uint32_t> mByPath;
+    std::unordered_map<uint64_t, uint32_t> mByContent;
+    std::unordered_map<uint64_t, uint32_t> mByTicket;
+};
+
+#endif
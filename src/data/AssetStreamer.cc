@@ -0,0 +1,386 @@
+#include "AssetStreamer.h"
+#include "DeviceLocalBuffer.h"
+#include "utils/ModelContainer.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+template<typename T>
+static std::vector<uint8_t> to_bytes(const std::vector<T>& aValues){
+    std::vector<uint8_t> bytes(aValues.size() * sizeof(T));
+    if(!bytes.empty()) memcpy(bytes.data(), aValues.data(), bytes.size());
+    return(bytes);
+}
+
+static VkDeviceSize align_staging(VkDeviceSize aOffset){
+    // vkCmdCopyBuffer has no alignment requirements, but keeping every source 16 byte aligned keeps the memcpy fast
+    return((aOffset + 15) & ~VkDeviceSize(15));
+}
+
+void StreamedMesh::freeBuffers(){
+    for(std::shared_ptr<DeviceSyncedBuffer>& stream : vertexStreams){
+        if(stream != nullptr) stream->freeBuffer();
+    }
+    vertexStreams.clear();
+    if(indices != nullptr){
+        indices->freeBuffer();
+        indices = nullptr;
+    }
+    deviceBytes = 0;
+}
+
+AssetStreamer::~AssetStreamer(){
+    stop();
+}
+
+void AssetStreamer::start(const VulkanDeviceBundle& aDeviceBundle, std::mutex& aQueueMutex, size_t aDecodeThreads){
+    if(isRunning()){
+        throw std::runtime_error("Attempting to start an AssetStreamer that is already running!");
+    }
+    if(!aDeviceBundle.isValid()){
+        throw std::runtime_error("AssetStreamer::start() called with an invalid device!");
+    }
+    if(aDecodeThreads == 0){
+        aDecodeThreads = std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+    }
+
+    mDevicePair = VulkanDeviceHandlePair(aDeviceBundle);
+    mQueueMutex = &aQueueMutex;
+
+    // Devices without a separate transfer queue get the graphics queue, which supports transfers as well
+    const VulkanPhysicalDevice& physicalDevice = aDeviceBundle.physicalDevice;
+    uint32_t graphicsFamily = physicalDevice.mGraphicsIdx ? *physicalDevice.mGraphicsIdx : 0U;
+    uint32_t transferFamily = physicalDevice.mTransferIdx ? *physicalDevice.mTransferIdx : graphicsFamily;
+    mTransferQueue = aDeviceBundle.logicalDevice.getTransferQueue();
+    if(mTransferQueue == VK_NULL_HANDLE){
+        mTransferQueue = aDeviceBundle.logicalDevice.getGraphicsQueue();
+        transferFamily = graphicsFamily;
+    }
+    // Buffers are shared concurrently between separate families, so they never change ownership
+    mQueueFamilies = transferFamily == graphicsFamily ? std::vector<uint32_t>{graphicsFamily} : std::vector<uint32_t>{transferFamily, graphicsFamily};
+
+    VkCommandPoolCreateInfo poolInfo;
+    {
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = transferFamily;
+    }
+    if(vkCreateCommandPool(mDevicePair.device, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create asset upload command pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo;
+    {
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+    }
+    if(vkAllocateCommandBuffers(mDevicePair.device, &allocInfo, &mCommandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate asset upload command buffer!");
+    }
+
+    VkFenceCreateInfo fenceInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+    if(vkCreateFence(mDevicePair.device, &fenceInfo, nullptr, &mUploadFence) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create asset upload fence!");
+    }
+
+    mStopping = false;
+    for(size_t i = 0; i < aDecodeThreads; ++i){
+        mDecoders.emplace_back(&AssetStreamer::decode, this);
+    }
+    mUploader = std::thread(&AssetStreamer::upload, this);
+}
+
+void AssetStreamer::stop(){
+    if(!isRunning()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mRequests.clear();
+    }
+    mRequestAvailable.notify_all();
+    mDecodedAvailable.notify_all();
+    for(std::thread& decoder : mDecoders){
+        decoder.join();
+    }
+    mDecoders.clear();
+    mUploader.join();
+    {
+        // Decoders may have finished a mesh after the queue was cleared. Nothing of it was uploaded yet.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDecoded.clear();
+    }
+
+    StreamedMesh unclaimed;
+    while(poll(unclaimed)){
+        unclaimed.freeBuffers();
+    }
+    mPendingCount = 0;
+
+    VkDevice device = mDevicePair.device;
+    vkDestroyFence(device, mUploadFence, nullptr);
+    vkDestroyCommandPool(device, mCommandPool, nullptr);
+    mUploadFence = VK_NULL_HANDLE;
+    mCommandPool = VK_NULL_HANDLE;
+    mCommandBuffer = VK_NULL_HANDLE;
+}
+
+uint64_t AssetStreamer::requestModel(const std::string& aPath, StreamedVertexFormat aFormat){
+    if(!isRunning()){
+        throw std::runtime_error("AssetStreamer::requestModel() called before start()!");
+    }
+
+    uint64_t ticket = mNextTicket++;
+    ++mPendingCount;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back(Request{ticket, aPath, aFormat, clock::now()});
+    }
+    mRequestAvailable.notify_one();
+    return(ticket);
+}
+
+bool AssetStreamer::poll(StreamedMesh& aMeshOut){
+    if(!mCompleted.tryPop(aMeshOut)) return(false);
+    --mPendingCount;
+    return(true);
+}
+
+AssetStreamer::DecodedMesh AssetStreamer::decodeModel(const Request& aRequest){
+    DecodedMesh decoded;
+    decoded.requested = aRequest.requested;
+    decoded.mesh.ticket = aRequest.ticket;
+    decoded.mesh.path = aRequest.path;
+    // Here rather than on the thread requesting the model, as it reads the whole file
+    decoded.mesh.contentHash = CookedMesh::hashFile(aRequest.path);
+
+    try{
+        ModelContainer model(aRequest.path);
+        if(model.shortIndices.empty()){
+            throw std::runtime_error("Model '" + aRequest.path + "' has no triangles to draw");
+        }
+        if(aRequest.format == STREAMED_VERTEX_PACKED){
+            decoded.mesh.quantization = model.getQuantization();
+            decoded.blobs.push_back(to_bytes(model.packColorVertices()));
+        }else{
+            decoded.blobs.push_back(to_bytes(model.positionStream()));
+            decoded.blobs.push_back(to_bytes(model.attributeStream()));
+        }
+        decoded.usages.assign(decoded.blobs.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        // Meshes are split into chunks of less than 64k vertices, so 16 bit indices are always enough
+        decoded.blobs.push_back(to_bytes(model.shortIndices));
+        decoded.usages.push_back(VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        decoded.mesh.indexType = VK_INDEX_TYPE_UINT16;
+        decoded.mesh.vertexCount = model.verts.size();
+        decoded.mesh.chunks = model.chunks;
+        decoded.mesh.lods = model.lods;
+        decoded.mesh.meshlets = model.meshlets;
+        decoded.mesh.meshletIndices = model.indices;
+        decoded.mesh.min = model.min;
+        decoded.mesh.max = model.max;
+        decoded.mesh.radius = model.radius;
+    }catch(const std::exception& e){
+        decoded.mesh.error = e.what();
+        decoded.blobs.clear();
+        decoded.usages.clear();
+    }
+    return(decoded);
+}
+
+void AssetStreamer::decode(){
+    while(true){
+        std::unique_lock<std::mutex> lock(mMutex);
+        mRequestAvailable.wait(lock, [this](){ return(mStopping || !mRequests.empty()); });
+        if(mStopping) return;
+
+        Request request = std::move(mRequests.front());
+        mRequests.pop_front();
+        lock.unlock();
+
+        DecodedMesh decoded = decodeModel(request);
+
+        lock.lock();
+        if(mStopping) return;
+        mDecoded.push_back(std::move(decoded));
+        lock.unlock();
+        mDecodedAvailable.notify_one();
+    }
+}
+
+void AssetStreamer::upload(){
+    while(true){
+        std::vector<DecodedMesh> batch;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDecodedAvailable.wait(lock, [this](){ return(mStopping || !mDecoded.empty()); });
+            if(mStopping) return;
+
+            // Take everything that is ready, up to the staging budget. A single mesh over budget still goes alone.
+            VkDeviceSize batchBytes = 0;
+            while(!mDecoded.empty() && (batch.empty() || batchBytes < sStagingBatchBytes)){
+                for(const std::vector<uint8_t>& blob : mDecoded.front().blobs) batchBytes += align_staging(blob.size());
+                batch.push_back(std::move(mDecoded.front()));
+                mDecoded.pop_front();
+            }
+        }
+
+        uploadBatch(batch);
+        for(DecodedMesh& decoded : batch){
+            decoded.mesh.latencySeconds = std::chrono::duration<double>(clock::now() - decoded.requested).count();
+            complete(std::move(decoded.mesh));
+        }
+    }
+}
+
+void AssetStreamer::uploadBatch(std::vector<DecodedMesh>& aBatch){
+    VkDevice device = mDevicePair.device;
+
+    // Lay out every blob of the batch in one staging buffer
+    VkDeviceSize stagingSize = 0;
+    for(const DecodedMesh& decoded : aBatch){
+        for(const std::vector<uint8_t>& blob : decoded.blobs) stagingSize += align_staging(blob.size());
+    }
+    if(stagingSize == 0) return; // Every mesh of the batch failed to decode
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    try{
+        VkBufferCreateInfo createInfo;
+        {
+            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            createInfo.pNext = nullptr;
+            createInfo.flags = 0;
+            createInfo.size = stagingSize;
+            createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            createInfo.queueFamilyIndexCount = 0U;
+            createInfo.pQueueFamilyIndices = nullptr;
+        }
+        if(vkCreateBuffer(device, &createInfo, nullptr, &stagingBuffer) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create asset staging buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, stagingBuffer, &memRequirements);
+        uint32_t memTypeIndex = DeviceLocalBuffer::findMemoryType(mDevicePair.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        if(memTypeIndex == VK_MAX_MEMORY_TYPES){
+            throw std::runtime_error("No host visible memory type could be found for asset staging buffer!");
+        }
+        VkMemoryAllocateInfo allocInfo;
+        {
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.allocationSize = memRequirements.size;
+            allocInfo.memoryTypeIndex = memTypeIndex;
+        }
+        if(vkAllocateMemory(device, &allocInfo, nullptr, &stagingMemory) != VK_SUCCESS){
+            throw std::runtime_error("Failed to allocate memory for asset staging buffer!");
+        }
+        vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0);
+
+        void* mappedPtr = nullptr;
+        VkResult mapResult = vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mappedPtr);
+        if(mapResult != VK_SUCCESS || mappedPtr == nullptr) throw std::runtime_error("Failed to map asset staging buffer!");
+
+        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, nullptr};
+        vkResetCommandBuffer(mCommandBuffer, 0);
+        if(vkBeginCommandBuffer(mCommandBuffer, &beginInfo) != VK_SUCCESS){
+            vkUnmapMemory(device, stagingMemory);
+            throw std::runtime_error("Failed to begin asset upload command buffer!");
+        }
+
+        VkDeviceSize stagingOffset = 0;
+        for(DecodedMesh& decoded : aBatch){
+            for(size_t i = 0; i < decoded.blobs.size(); ++i){
+                const std::vector<uint8_t>& blob = decoded.blobs[i];
+                std::shared_ptr<DeviceLocalBuffer> buffer = std::make_shared<DeviceLocalBuffer>(mDevicePair, blob.size(), decoded.usages[i], mQueueFamilies);
+                if(decoded.usages[i] & VK_BUFFER_USAGE_INDEX_BUFFER_BIT){
+                    decoded.mesh.indices = buffer;
+                }else{
+                    decoded.mesh.vertexStreams.push_back(buffer);
+                }
+
+                memcpy(static_cast<uint8_t*>(mappedPtr) + stagingOffset, blob.data(), blob.size());
+                VkBufferCopy region = {stagingOffset, 0, blob.size()};
+                vkCmdCopyBuffer(mCommandBuffer, stagingBuffer, buffer->getBuffer(), 1, &region);
+                stagingOffset += align_staging(blob.size());
+                decoded.mesh.deviceBytes += buffer->allocationSize();
+            }
+            // The CPU side copy isn't needed anymore
+            decoded.blobs.clear();
+        }
+
+        VkMappedMemoryRange mappedMemRange;
+        {
+            mappedMemRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            mappedMemRange.pNext = nullptr;
+            mappedMemRange.memory = stagingMemory;
+            mappedMemRange.offset = 0;
+            mappedMemRange.size = VK_WHOLE_SIZE;
+        }
+        VkResult flushResult = vkFlushMappedMemoryRanges(device, 1, &mappedMemRange);
+        vkUnmapMemory(device, stagingMemory); mappedPtr = nullptr;
+        if(flushResult != VK_SUCCESS){
+            throw std::runtime_error("Failed to flush asset staging buffer!");
+        }
+
+        // No barrier is needed: the fence wait below completes the copies before a buffer is handed out, so any
+        // draw using one is submitted after it, and the fence signal makes the transfer writes available.
+        if(vkEndCommandBuffer(mCommandBuffer) != VK_SUCCESS){
+            throw std::runtime_error("Failed to end asset upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo = {
+            VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr,
+            0, nullptr, nullptr,
+            1, &mCommandBuffer,
+            0, nullptr
+        };
+        {
+            std::lock_guard<std::mutex> queueLock(*mQueueMutex);
+            if(vkQueueSubmit(mTransferQueue, 1, &submitInfo, mUploadFence) != VK_SUCCESS){
+                throw std::runtime_error("Submit to transfer queue failed!");
+            }
+        }
+        vkWaitForFences(device, 1, &mUploadFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+        vkResetFences(device, 1, &mUploadFence);
+
+        for(DecodedMesh& decoded : aBatch){
+            for(std::shared_ptr<DeviceSyncedBuffer>& stream : decoded.mesh.vertexStreams){
+                std::static_pointer_cast<DeviceLocalBuffer>(stream)->markFilled();
+            }
+            if(decoded.mesh.indices != nullptr){
+                std::static_pointer_cast<DeviceLocalBuffer>(decoded.mesh.indices)->markFilled();
+            }
+        }
+    }catch(const std::exception& e){
+        for(DecodedMesh& decoded : aBatch){
+            decoded.mesh.freeBuffers();
+            if(decoded.mesh.error.empty()) decoded.mesh.error = e.what();
+        }
+    }
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+}
+
+void AssetStreamer::complete(StreamedMesh&& aMesh){
+    // The render thread drains the queue every frame, so it is only ever full for a moment
+    while(!mCompleted.tryPush(std::move(aMesh))){
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(mStopping){
+                aMesh.freeBuffers();
+                --mPendingCount;
+                return;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
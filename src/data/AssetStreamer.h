@@ -0,0 +1,166 @@
+#ifndef ASSET_STREAMER_H_
+#define ASSET_STREAMER_H_
+
+#include "DeviceSyncedBuffer.h"
+#include "utils/CookedMesh.h"
+#include "utils/MeshOptimizer.h"
+#include "utils/SpscQueue.h"
+#include "utils/VertexPacking.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Vertex layout a model is converted to before upload
+enum StreamedVertexFormat
+{
+    // Positions in one stream and SimpleVertexAttributes in a second one
+    STREAMED_VERTEX_SPLIT,
+    // A single stream of PackedColorVertex
+    STREAMED_VERTEX_PACKED
+};
+
+/// Geometry of a model loaded by AssetStreamer, resident in device local memory
+struct StreamedMesh
+{
+    uint64_t ticket = 0;
+    std::string path;
+    // Set if the model could not be loaded or uploaded, in which case there are no buffers
+    std::string error;
+    // Hash of the file's content, computed by the decode thread. Zero if the file couldn't be read.
+    uint64_t contentHash = 0;
+
+    // Vertex streams in binding order, see StreamedVertexFormat
+    std::vector<std::shared_ptr<DeviceSyncedBuffer>> vertexStreams;
+    std::shared_ptr<DeviceSyncedBuffer> indices = nullptr;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    size_t vertexCount = 0;
+    std::vector<IndexChunk> chunks;
+    // Levels of detail from full detail to coarsest, each drawn by its range of chunks
+    std::vector<CookedMesh::Lod> lods;
+    // Clusters of every level's triangles, and the 32 bit indices into the whole vertex stream they are ranges of.
+    // Kept on the host for culling meshlets on the CPU.
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletIndices;
+
+    // Maps packed positions back to object space. Identity for STREAMED_VERTEX_SPLIT.
+    QuantizationTransform quantization;
+    glm::vec3 min = glm::vec3(0);
+    glm::vec3 max = glm::vec3(0);
+    // Radius of the bounding sphere around the center of min and max
+    float radius = 0.0f;
+
+    // Time from the request until the mesh was ready to draw
+    double latencySeconds = 0.0;
+    // Device memory allocated for all buffers of the mesh
+    VkDeviceSize deviceBytes = 0;
+
+    bool isValid() const {return(error.empty() && indices != nullptr);}
+    /// Free every buffer of the mesh. The GPU must be done with them.
+    void freeBuffers();
+};
+
+/** Loads models in the background and uploads them to device local memory.
+ *
+ * Requests are parsed and converted by a pool of decode threads. A single upload thread collects whatever the
+ * decoders have finished, copies it into one staging buffer and records a single copy command buffer for the
+ * whole batch, which it submits to the transfer queue. Once the copies complete, the meshes are handed to the
+ * render thread through a lock-free queue, so polling for them never blocks rendering.
+ *
+ * poll() must only ever be called from one thread. requestModel() and poll() are virtual, so tests can stand in for
+ * the streamer without a device.
+ */
+class AssetStreamer
+{
+ public:
+    AssetStreamer(){}
+    virtual ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer& aOther) = delete;
+    AssetStreamer& operator=(const AssetStreamer& aOther) = delete;
+
+    /** Spin up the decode and upload threads.
+     *
+     * Arguments:
+     *   aDeviceBundle: Device to upload to. Copies go to its transfer queue.
+     *   aQueueMutex: Locked around every submission. Queues of different kinds may be the same VkQueue, so every
+     *                other thread submitting to or waiting on a queue of the device must hold it as well.
+     *   aDecodeThreads: Zero picks half the number of hardware threads, but at least one.
+    */
+    void start(const VulkanDeviceBundle& aDeviceBundle, std::mutex& aQueueMutex, size_t aDecodeThreads = 0);
+    /// Drop queued requests, wait for uploads in flight and join the threads. Meshes that finished but were never
+    /// polled are freed. Safe to call if not running.
+    void stop();
+
+    /// Queue 'aPath' for loading. Returns a ticket identifying the request in the StreamedMesh it produces.
+    virtual uint64_t requestModel(const std::string& aPath, StreamedVertexFormat aFormat = STREAMED_VERTEX_SPLIT);
+
+    /// Take the next finished mesh, if any. The caller owns its buffers from then on.
+    virtual bool poll(StreamedMesh& aMeshOut);
+
+    /// Requests that have not been polled yet
+    size_t getPendingCount() const {return(mPendingCount.load());}
+    bool isRunning() const {return(!mDecoders.empty());}
+
+ protected:
+    using clock = std::chrono::steady_clock;
+
+    struct Request
+    {
+        uint64_t ticket;
+        std::string path;
+        StreamedVertexFormat format;
+        clock::time_point requested;
+    };
+
+    // Converted model waiting for upload. Each blob becomes one device local buffer.
+    struct DecodedMesh
+    {
+        StreamedMesh mesh;
+        clock::time_point requested;
+        std::vector<std::vector<uint8_t>> blobs;
+        std::vector<VkBufferUsageFlags> usages;
+    };
+
+    void decode();
+    void upload();
+    void uploadBatch(std::vector<DecodedMesh>& aBatch);
+    void complete(StreamedMesh&& aMesh);
+
+    static DecodedMesh decodeModel(const Request& aRequest);
+
+    VulkanDeviceHandlePair mDevicePair;
+    std::mutex* mQueueMutex = nullptr;
+    VkQueue mTransferQueue = VK_NULL_HANDLE;
+    std::vector<uint32_t> mQueueFamilies;
+
+    // Only used by the upload thread
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    VkCommandBuffer mCommandBuffer = VK_NULL_HANDLE;
+    VkFence mUploadFence = VK_NULL_HANDLE;
+
+    std::vector<std::thread> mDecoders;
+    std::thread mUploader;
+    std::deque<Request> mRequests;
+    std::deque<DecodedMesh> mDecoded;
+    bool mStopping = false;
+    std::mutex mMutex;
+    std::condition_variable mRequestAvailable;
+    std::condition_variable mDecodedAvailable;
+
+    SpscQueue<StreamedMesh> mCompleted{64};
+    std::atomic<uint64_t> mNextTicket{1};
+    std::atomic<size_t> mPendingCount{0};
+
+    // Batches stop taking more meshes once their staging buffer reaches this size
+    static const VkDeviceSize sStagingBatchBytes = 64ull << 20;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "DeviceLocalBuffer.h"
+#include <iostream>
+#include <stdexcept>
+
+DeviceLocalBuffer::DeviceLocalBuffer(const VulkanDeviceHandlePair& aDevicePair, VkDeviceSize aSize, VkBufferUsageFlags aUsage, const std::vector<uint32_t>& aQueueFamilies)
+ :  mSize(aSize), mUsage(aUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT), mQueueFamilies(aQueueFamilies), mCurrentDevice(aDevicePair)
+{
+    if(!mCurrentDevice.isValid()) return;
+    try{
+        setupDeviceUpload(mCurrentDevice);
+        uploadToDevice(mCurrentDevice);
+        finalizeDeviceUpload(mCurrentDevice);
+    }catch(...){
+        // The destructor won't run for a half constructed buffer
+        _cleanup();
+        throw;
+    }
+}
+
+DeviceLocalBuffer::~DeviceLocalBuffer(){
+    // Warning if cleanup wasn't explicit to teach responsibility
+    if(mBuffer != VK_NULL_HANDLE || mBufferMemory != VK_NULL_HANDLE){
+        std::cerr << "Warning! DeviceLocalBuffer object destroyed before buffer was freed" << std::endl;
+        _cleanup();
+    }
+}
+
+void DeviceLocalBuffer::updateDevice(const VulkanDeviceBundle& aDeviceBundle){
+    if(aDeviceBundle.isValid() && aDeviceBundle != mCurrentDevice){
+        _cleanup();
+        mCurrentDevice = VulkanDeviceHandlePair(aDeviceBundle);
+    }
+
+    if(!mCurrentDevice.isValid()){
+        throw std::runtime_error("Attempting to updateDevice() from device local buffer with no associated device!");
+    }
+
+    setupDeviceUpload(mCurrentDevice);
+    uploadToDevice(mCurrentDevice);
+    finalizeDeviceUpload(mCurrentDevice);
+}
+
+void DeviceLocalBuffer::markFilled(){
+    if(mDeviceSyncState == DEVICE_EMPTY){
+        throw std::runtime_error("DeviceLocalBuffer::markFilled() called before the buffer was created with updateDevice()!");
+    }
+    mDeviceSyncState = CPU_DATA_FLUSHED;
+}
+
+uint32_t DeviceLocalBuffer::findMemoryType(VkPhysicalDevice aPhysicalDevice, uint32_t aTypeBits, VkMemoryPropertyFlags aProperties){
+    VkPhysicalDeviceMemoryProperties memoryProps;
+    vkGetPhysicalDeviceMemoryProperties(aPhysicalDevice, &memoryProps);
+
+    for(uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i){
+        if(aTypeBits & (1 << i) && (memoryProps.memoryTypes[i].propertyFlags & aProperties) == aProperties){
+            return(i);
+        }
+    }
+    return(VK_MAX_MEMORY_TYPES);
+}
+
+void DeviceLocalBuffer::setupDeviceUpload(VulkanDeviceHandlePair aDevicePair){
+    if(mBuffer != VK_NULL_HANDLE) return;
+    if(mSize == 0){
+        throw std::runtime_error("Attempting to create a device local buffer of size zero!");
+    }
+
+    VkBufferCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.size = mSize;
+        createInfo.usage = mUsage;
+        createInfo.sharingMode = mQueueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        createInfo.queueFamilyIndexCount = mQueueFamilies.size() > 1 ? static_cast<uint32_t>(mQueueFamilies.size()) : 0U;
+        createInfo.pQueueFamilyIndices = mQueueFamilies.size() > 1 ? mQueueFamilies.data() : nullptr;
+    }
+
+    if(vkCreateBuffer(aDevicePair.device, &createInfo, nullptr, &mBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create device local buffer!");
+    }
+}
+
+void DeviceLocalBuffer::uploadToDevice(VulkanDeviceHandlePair aDevicePair){
+    if(mBufferMemory != VK_NULL_HANDLE) return;
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(aDevicePair.device, mBuffer, &memRequirements);
+
+    // Integrated GPUs may not expose a device local type for every buffer, in which case any compatible type will do
+    uint32_t memTypeIndex = findMemoryType(aDevicePair.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(memTypeIndex == VK_MAX_MEMORY_TYPES){
+        memTypeIndex = findMemoryType(aDevicePair.physicalDevice, memRequirements.memoryTypeBits, 0);
+    }
+    if(memTypeIndex == VK_MAX_MEMORY_TYPES){
+        throw std::runtime_error("No compatible memory type could be found for device local buffer!");
+    }
+
+    VkMemoryAllocateInfo allocInfo;
+    {
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memTypeIndex;
+    }
+
+    if(vkAllocateMemory(aDevicePair.device, &allocInfo, nullptr, &mBufferMemory) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate memory for device local buffer!");
+    }
+
+    vkBindBufferMemory(aDevicePair.device, mBuffer, mBufferMemory, 0);
+    mAllocationSize = allocInfo.allocationSize;
+}
+
+void DeviceLocalBuffer::finalizeDeviceUpload(VulkanDeviceHandlePair aDevicePair){
+    // Contents are undefined until a transfer fills the buffer and markFilled() is called
+    if(mDeviceSyncState == DEVICE_EMPTY) mDeviceSyncState = DEVICE_OUT_OF_SYNC;
+}
+
+void DeviceLocalBuffer::_cleanup(){
+    if(mBuffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(mCurrentDevice.device, mBuffer, nullptr);
+        mBuffer = VK_NULL_HANDLE;
+    }
+    if(mBufferMemory != VK_NULL_HANDLE){
+        vkFreeMemory(mCurrentDevice.device, mBufferMemory, nullptr);
+        mBufferMemory = VK_NULL_HANDLE;
+    }
+    mAllocationSize = 0;
+    mDeviceSyncState = DEVICE_EMPTY;
+}
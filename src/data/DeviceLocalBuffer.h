@@ -0,0 +1,68 @@
+#ifndef DEVICE_LOCAL_BUFFER_H_
+#define DEVICE_LOCAL_BUFFER_H_
+
+#include "utils/common.h"
+#include "DeviceSyncedBuffer.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/** Buffer in device local memory without a CPU copy of its contents.
+ *
+ * Unlike VertexAttributeBuffer and IndexBuffer, the contents can't be written from the host. updateDevice() only
+ * creates the buffer and its memory, which must then be filled by a transfer command (see AssetStreamer) before
+ * markFilled() is called. Device local memory is usually not host visible, but is the fastest for the GPU to read.
+ */
+class DeviceLocalBuffer : public DeviceSyncedBuffer
+{
+ public:
+    /// Creates the buffer right away if 'aDevicePair' is valid. 'aUsage' does not need to include
+    /// VK_BUFFER_USAGE_TRANSFER_DST_BIT. If 'aQueueFamilies' names more than one queue family, the buffer is shared
+    /// concurrently between them, e.g. filled on a transfer queue and drawn on the graphics queue.
+    DeviceLocalBuffer(const VulkanDeviceHandlePair& aDevicePair, VkDeviceSize aSize, VkBufferUsageFlags aUsage, const std::vector<uint32_t>& aQueueFamilies = {});
+
+    // Disallow copy for the same reasons as VertexAttributeBuffer
+    DeviceLocalBuffer(const DeviceLocalBuffer& aOther) = delete;
+
+    virtual ~DeviceLocalBuffer();
+
+    virtual DeviceSyncStateEnum getDeviceSyncState() const override {return(mDeviceSyncState);}
+    virtual void updateDevice(const VulkanDeviceBundle& aDeviceBundle = {}) override;
+    virtual VulkanDeviceHandlePair getCurrentDevice() const override {return(mCurrentDevice);}
+
+    virtual const VkBuffer& getBuffer() const override {return(mBuffer);}
+
+    virtual void freeBuffer() override {_cleanup();}
+
+    /// Call once a transfer into the buffer has completed. There's no CPU data, so the buffer is then considered
+    /// 'CPU_DATA_FLUSHED'.
+    void markFilled();
+
+    VkDeviceSize size() const {return(mSize);}
+    /// Size of the device memory backing the buffer, which may exceed size() to meet the device's alignment
+    VkDeviceSize allocationSize() const {return(mAllocationSize);}
+
+    /// Index of a memory type in 'aTypeBits' with all of 'aProperties', or VK_MAX_MEMORY_TYPES if there is none
+    static uint32_t findMemoryType(VkPhysicalDevice aPhysicalDevice, uint32_t aTypeBits, VkMemoryPropertyFlags aProperties);
+
+ protected:
+
+    virtual void setupDeviceUpload(VulkanDeviceHandlePair aDevicePair) override;
+    virtual void uploadToDevice(VulkanDeviceHandlePair aDevicePair) override;
+    virtual void finalizeDeviceUpload(VulkanDeviceHandlePair aDevicePair) override;
+
+    const VkDeviceSize mSize;
+    const VkBufferUsageFlags mUsage;
+    std::vector<uint32_t> mQueueFamilies;
+
+    DeviceSyncStateEnum mDeviceSyncState = DEVICE_EMPTY;
+
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mBufferMemory = VK_NULL_HANDLE;
+    VkDeviceSize mAllocationSize = 0;
+    VulkanDeviceHandlePair mCurrentDevice = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+
+ private:
+    void _cleanup();
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef INDEX_BUFFER_H_
+#define INDEX_BUFFER_H_
+
+#include "utils/common.h"
+#include "DeviceSyncedBuffer.h"
+#include <vulkan/vulkan.h>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+/// Maps an index type to the matching VkIndexType
+template<typename IndexType> struct index_type_traits;
+template<> struct index_type_traits<uint16_t> { static constexpr VkIndexType vk_index_type = VK_INDEX_TYPE_UINT16; };
+template<> struct index_type_traits<uint32_t> { static constexpr VkIndexType vk_index_type = VK_INDEX_TYPE_UINT32; };
+
+/** Device buffer of triangle list indices into a VertexAttributeBuffer.
+ *
+ * Drawing indexed lets every unique vertex be stored and shaded once, with the post-transform cache reusing
+ * results for vertices shared between triangles. IndexType must be uint16_t or uint32_t.
+ */
+template<typename IndexType>
+class IndexBuffer : public DeviceSyncedBuffer
+{
+ public:
+    static_assert(std::is_same<IndexType, uint16_t>::value || std::is_same<IndexType, uint32_t>::value, "IndexBuffer only supports uint16_t and uint32_t indices");
+    using index_type = IndexType;
+
+    IndexBuffer(){}
+    explicit IndexBuffer(const std::vector<IndexType>& aIndices, const VulkanDeviceBundle& aDeviceBundle = {}, bool aSkipDeviceUpload = false) : mCpuIndexData(aIndices) {
+        if(aDeviceBundle.isValid() && !aSkipDeviceUpload) updateDevice(aDeviceBundle);
+    }
+
+    // Disallow copy for the same reasons as VertexAttributeBuffer
+    IndexBuffer(const IndexBuffer& aOther) = delete;
+
+    virtual ~IndexBuffer(){
+        if(mIndexBuffer != VK_NULL_HANDLE || mIndexBufferMemory != VK_NULL_HANDLE){
+            std::cerr << "Warning! IndexBuffer object destroyed before buffer was freed" << std::endl;
+            _cleanup();
+        }
+    }
+
+    virtual DeviceSyncStateEnum getDeviceSyncState() const override {return(mDeviceSyncState);}
+    virtual void updateDevice(const VulkanDeviceBundle& aDevicePair = {}) override;
+    virtual VulkanDeviceHandlePair getCurrentDevice() const override {return(mCurrentDevice);}
+
+    virtual const VkBuffer& getBuffer() const override {return(mIndexBuffer);}
+
+    virtual void freeBuffer() override {_cleanup();}
+
+    /// Clears the CPU copy of the indices, leaving the device buffer untouched. See VertexAttributeBuffer::flushCpuData().
+    virtual void flushCpuData() {
+        mCpuIndexData.clear();
+        mDeviceSyncState = mDeviceSyncState == DEVICE_IN_SYNC ? CPU_DATA_FLUSHED : mDeviceSyncState;
+    }
+
+    /// Number of indices on the device, or of the CPU copy if it has not been uploaded yet
+    virtual size_t indexCount() const {return(mDeviceSyncState == DEVICE_IN_SYNC || mDeviceSyncState == CPU_DATA_FLUSHED ? mIndexCount : mCpuIndexData.size());}
+    VkIndexType getIndexType() const {return(index_type_traits<IndexType>::vk_index_type);}
+
+    virtual const std::vector<IndexType>& getIndices() const {return(mCpuIndexData);}
+    virtual void setIndices(const std::vector<IndexType>& aIndices) {mCpuIndexData = aIndices; mDeviceSyncState = DEVICE_OUT_OF_SYNC;}
+
+ protected:
+
+    virtual void setupDeviceUpload(VulkanDeviceHandlePair aDevicePair) override;
+    virtual void uploadToDevice(VulkanDeviceHandlePair aDevicePair) override;
+    virtual void finalizeDeviceUpload(VulkanDeviceHandlePair aDevicePair) override;
+
+    std::vector<IndexType> mCpuIndexData;
+    size_t mIndexCount = 0U;
+    DeviceSyncStateEnum mDeviceSyncState = DEVICE_EMPTY;
+
+    VkBuffer mIndexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mIndexBufferMemory = VK_NULL_HANDLE;
+    VkDeviceSize mCurrentBufferSize = 0U;
+    VulkanDeviceHandlePair mCurrentDevice = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+
+ private:
+    void _cleanup();
+
+    VkDeviceSize _mCurrentDeviceAllocSize = 0U;
+};
+
+template<typename IndexType>
+void IndexBuffer<IndexType>::updateDevice(const VulkanDeviceBundle& aDeviceBundle){
+    if(aDeviceBundle.isValid() && aDeviceBundle != mCurrentDevice){
+        _cleanup();
+        mCurrentDevice = VulkanDeviceHandlePair(aDeviceBundle);
+    }
+
+    if(!mCurrentDevice.isValid()){
+        throw std::runtime_error("Attempting to updateDevice() from index buffer with no associated device!");
+    }
+    // Vulkan doesn't allow buffers of size zero
+    if(mCpuIndexData.empty()){
+        throw std::runtime_error("Attempting to updateDevice() from index buffer with no indices!");
+    }
+
+    setupDeviceUpload(mCurrentDevice);
+    uploadToDevice(mCurrentDevice);
+    finalizeDeviceUpload(mCurrentDevice);
+}
+
+template<typename IndexType>
+void IndexBuffer<IndexType>::setupDeviceUpload(VulkanDeviceHandlePair aDevicePair){
+    VkDeviceSize requiredSize = sizeof(IndexType) * mCpuIndexData.size();
+
+    if(mDeviceSyncState == DEVICE_EMPTY || requiredSize != mCurrentBufferSize){
+        // A resized buffer is replaced entirely
+        _cleanup();
+
+        VkBufferCreateInfo createInfo;
+        {
+            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            createInfo.pNext = nullptr;
+            createInfo.flags = 0;
+            createInfo.size = requiredSize;
+            createInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            createInfo.queueFamilyIndexCount = 0U;
+            createInfo.pQueueFamilyIndices = nullptr;
+        }
+
+        if(vkCreateBuffer(aDevicePair.device, &createInfo, nullptr, &mIndexBuffer) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create index buffer!");
+        }
+    }
+}
+
+template<typename IndexType>
+void IndexBuffer<IndexType>::uploadToDevice(VulkanDeviceHandlePair aDevicePair){
+    VkDeviceSize requiredSize = sizeof(IndexType) * mCpuIndexData.size();
+
+    if(mIndexBufferMemory == VK_NULL_HANDLE){
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(aDevicePair.device, mIndexBuffer, &memRequirements);
+
+        VkPhysicalDeviceMemoryProperties memoryProps;
+        vkGetPhysicalDeviceMemoryProperties(aDevicePair.physicalDevice, &memoryProps);
+
+        uint32_t memTypeIndex = VK_MAX_MEMORY_TYPES;
+        for(uint32_t i = 0; i < memoryProps.memoryTypeCount; ++i){
+            if(memRequirements.memoryTypeBits & (1 << i) && memoryProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+                memTypeIndex = i;
+                break;
+            }
+        }
+        if(memTypeIndex == VK_MAX_MEMORY_TYPES){
+            throw std::runtime_error("No compatible memory type could be found for uploading index buffer to device!");
+        }
+
+        VkMemoryAllocateInfo allocInfo;
+        {
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.allocationSize = memRequirements.size;
+            allocInfo.memoryTypeIndex = memTypeIndex;
+        }
+
+        _mCurrentDeviceAllocSize = memRequirements.size;
+
+        if(vkAllocateMemory(aDevicePair.device, &allocInfo, nullptr, &mIndexBufferMemory) != VK_SUCCESS){
+            throw std::runtime_error("Failed to allocate memory for index buffer!");
+        }
+
+        vkBindBufferMemory(aDevicePair.device, mIndexBuffer, mIndexBufferMemory, 0);
+        mCurrentBufferSize = requiredSize;
+    }
+
+    void* mappedPtr = nullptr;
+    VkResult mapResult = vkMapMemory(aDevicePair.device, mIndexBufferMemory, 0, _mCurrentDeviceAllocSize, 0, &mappedPtr);
+    if(mapResult != VK_SUCCESS || mappedPtr == nullptr) throw std::runtime_error("Failed to map memory during index buffer upload!");
+    {
+        memcpy(mappedPtr, mCpuIndexData.data(), mCurrentBufferSize);
+
+        VkMappedMemoryRange mappedMemRange;
+        {
+            mappedMemRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            mappedMemRange.pNext = nullptr;
+            mappedMemRange.memory = mIndexBufferMemory;
+            mappedMemRange.offset = 0;
+            mappedMemRange.size = _mCurrentDeviceAllocSize;
+        }
+        if(vkFlushMappedMemoryRanges(aDevicePair.device, 1, &mappedMemRange) != VK_SUCCESS){
+            throw std::runtime_error("Failed to flush mapped memory during index buffer upload!");
+        }
+    }vkUnmapMemory(aDevicePair.device, mIndexBufferMemory); mappedPtr = nullptr;
+
+    mIndexCount = mCpuIndexData.size();
+}
+
+template<typename IndexType>
+void IndexBuffer<IndexType>::finalizeDeviceUpload(VulkanDeviceHandlePair aDevicePair){
+    mDeviceSyncState = DEVICE_IN_SYNC;
+}
+
+template<typename IndexType>
+void IndexBuffer<IndexType>::_cleanup(){
+    if(mIndexBuffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(mCurrentDevice.device, mIndexBuffer, nullptr);
+        mIndexBuffer = VK_NULL_HANDLE;
+    }
+    if(mIndexBufferMemory != VK_NULL_HANDLE){
+        vkFreeMemory(mCurrentDevice.device, mIndexBufferMemory, nullptr);
+        mIndexBufferMemory = VK_NULL_HANDLE;
+    }
+    mCurrentBufferSize = 0U;
+    mIndexCount = 0U;
+    mDeviceSyncState = DEVICE_EMPTY;
+}
+
+#endif
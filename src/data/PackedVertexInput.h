@@ -0,0 +1,31 @@
+#ifndef PACKED_VERTEX_INPUT_H_
+#define PACKED_VERTEX_INPUT_H_
+
+#include "VertexInput.h"
+#include "utils/VertexPacking.h"
+#include <cstddef>
+
+/// Vertex input for PackedVertex on binding 0. Locations match standard.vert and packed.vert, minus the color.
+inline const VertexInputTemplate<PackedVertex>& getPackedVertexInput(){
+    const static VertexInputTemplate<PackedVertex> sInput( /*binding = */ 0U,
+        /*vertex attribute descriptions = */ {
+            {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position)},
+            {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)}
+        }
+    );
+    return(sInput);
+}
+
+/// Vertex input for PackedColorVertex on binding 0, matching packed.vert.
+inline const VertexInputTemplate<PackedColorVertex>& getPackedColorVertexInput(){
+    const static VertexInputTemplate<PackedColorVertex> sInput( /*binding = */ 0U,
+        /*vertex attribute descriptions = */ {
+            {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedColorVertex, position)},
+            {1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedColorVertex, color)},
+            {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedColorVertex, normal)}
+        }
+    );
+    return(sInput);
+}
+
+#endif
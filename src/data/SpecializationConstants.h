@@ -0,0 +1,78 @@
+#ifndef SPECIALIZATION_CONSTANTS_H_
+#define SPECIALIZATION_CONSTANTS_H_
+
+#include "../utils/common.h"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+class SpecializationConstantsInterface
+{
+ public:
+    virtual ~SpecializationConstantsInterface() = default;
+    virtual const VkSpecializationInfo& getSpecializationInfo() const = 0;
+};
+
+using SpecializationConstantsPtr = std::shared_ptr<const SpecializationConstantsInterface>;
+
+/** Typed set of specialization constant values for a shader stage.
+ *
+ * 'ConstantStruct' holds the values, and a layout of map entries describes where each constant_id lives in it.
+ * The layout is meant to be declared constexpr next to the struct, e.g.
+ *
+ *     struct LightingConstants { VkBool32 enableLighting; uint32_t lightCount; };
+ *     constexpr std::array<VkSpecializationMapEntry, 2> sLightingLayout = {{
+ *         {0, offsetof(LightingConstants, enableLighting), sizeof(VkBool32)},
+ *         {1, offsetof(LightingConstants, lightCount), sizeof(uint32_t)}
+ *     }};
+ *
+ * Values are fixed at creation. Bool constants must be stored as VkBool32. Each distinct set of values produces
+ * its own pipeline variant, which the driver compiles with the constants folded in.
+ */
+template<typename ConstantStruct, size_t constant_count>
+class SpecializationConstants : public SpecializationConstantsInterface
+{
+ public:
+    static_assert(std::is_trivially_copyable<ConstantStruct>::value, "Specialization constant structs must be trivially copyable");
+
+    using constant_struct_t = ConstantStruct;
+    using layout_t = std::array<VkSpecializationMapEntry, constant_count>;
+    using ptr_t = std::shared_ptr<const SpecializationConstants<ConstantStruct, constant_count>>;
+
+    static ptr_t create(const layout_t& aLayout, const ConstantStruct& aValues) {
+        return(ptr_t(new SpecializationConstants<ConstantStruct, constant_count>(aLayout, aValues)));
+    }
+
+    SpecializationConstants(const SpecializationConstants& aOther) = delete;
+    SpecializationConstants& operator=(const SpecializationConstants& aOther) = delete;
+
+    const ConstantStruct& getValues() const {return(mValues);}
+    const layout_t& getLayout() const {return(mLayout);}
+
+    virtual const VkSpecializationInfo& getSpecializationInfo() const override {return(mInfo);}
+
+ protected:
+    SpecializationConstants(const layout_t& aLayout, const ConstantStruct& aValues)
+    :   mLayout(aLayout), mValues(aValues)
+    {
+        for(const VkSpecializationMapEntry& entry : mLayout){
+            if(entry.offset + entry.size > sizeof(ConstantStruct)){
+                throw std::runtime_error("Specialization constant " + std::to_string(entry.constantID) + " lies outside of its constant struct!");
+            }
+        }
+
+        mInfo.mapEntryCount = static_cast<uint32_t>(mLayout.size());
+        mInfo.pMapEntries = mLayout.data();
+        mInfo.dataSize = sizeof(ConstantStruct);
+        mInfo.pData = &mValues;
+    }
+
+    const layout_t mLayout;
+    const ConstantStruct mValues;
+    VkSpecializationInfo mInfo;
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef VERTEX_INPUT_H_
+#define VERTEX_INPUT_H_
+
 #include "../utils/common.h"
 #include <array>
 #include <vector>
@@ -87,4 +90,6 @@ VertexInputTemplate<VertexT>::VertexInputTemplate(
     _mInputBinding.binding = aBinding;
     _mInputBinding.stride = aStrideOverride > 0 ? aStrideOverride : sizeof(VertexT);
     _mInputBinding.inputRate = aInputRate;
-}
\ No newline at end of file
+}
+
+#endif
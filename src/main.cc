@@ -1,21 +1,37 @@
 #include "VulkanGraphicsApp.h"
-#include "data/VertexGeometry.h"
+#include "data/AssetRegistry.h"
 #include "data/UniformBuffer.h"
+#include "data/VertexGeometry.h"
 #include "data/VertexInput.h"
+#include "data/PackedVertexInput.h"
+#include "data/SpecializationConstants.h"
+#include "utils/Culling.h"
 #include "utils/FpsTimer.h"
+#include "utils/MeshSimplifier.h"
+#include "utils/SimulationLoop.h"
+#include "utils/TripleBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <iostream>
+#include <atomic>
 #include <memory> // Include shared_ptr
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "utils/ModelContainer.h"
 
-using SimpleVertexBuffer = VertexAttributeBuffer<SimpleVertex>;
-using SimpleVertexInput = VertexInputTemplate<SimpleVertex>;
+using PositionInput = VertexInputTemplate<glm::vec3>;
+using AttributeInput = VertexInputTemplate<SimpleVertexAttributes>;
+
+// Per instance attributes of instanced.vert
+struct InstanceData {
+    glm::vec4 offsetScale; // Object space offset in xyz, uniform scale in w
+};
+using InstanceInput = VertexInputTemplate<InstanceData>;
+using InstanceBuffer = VertexAttributeBuffer<InstanceData>;
 
 struct Transforms {    
     alignas(16) glm::mat4 Model;
@@ -27,17 +43,49 @@ struct AnimationInfo {
     alignas(16) float time;
 };
 
+// Specialization constants of standard.vert
+struct StandardVertexConstants {
+    VkBool32 colorByNormal;
+    VkBool32 animateColor;
+};
+
+constexpr std::array<VkSpecializationMapEntry, 2> sStandardVertexLayout = {{
+    {/* constantID = */ 0, /* offset = */ offsetof(StandardVertexConstants, colorByNormal), /* size = */ sizeof(VkBool32)},
+    {/* constantID = */ 1, /* offset = */ offsetof(StandardVertexConstants, animateColor), /* size = */ sizeof(VkBool32)}
+}};
+
+using StandardVertexSpecialization = SpecializationConstants<StandardVertexConstants, 2>;
+
 using UniformTransformData = UniformStructData<Transforms>;
 using UniformTransformDataPtr = std::shared_ptr<UniformTransformData>;
 using UniformAnimationData = UniformStructData<AnimationInfo>;
 using UniformAnimationDataPtr = std::shared_ptr<UniformAnimationData>;
 
+// Immutable result of one simulation tick. Produced by the simulation thread and consumed by the render thread.
+struct FrameSnapshot {
+    uint64_t tick = 0;
+    Transforms transforms = {glm::mat4(1), glm::mat4(1), glm::mat4(1)};
+    AnimationInfo animation = {0.0f};
+};
+
 static glm::mat4 getOrthographicProjection(const VkExtent2D& frameDim);
 static glm::mat4 getPerspective(const VkExtent2D& frameDim, float fov, float near, float far);
 
 class Application : public VulkanGraphicsApp
 {
  public:
+    /// With 'aPackedVertices' set, geometry is drawn from the compact vertex format with packed.vert. With more than
+    /// one instance, copies of the model are drawn in a grid by a single instanced draw with instanced.vert, and with
+    /// 'aGpuCulling' only the copies in view are drawn, as selected by a compute pass, skipping those hidden behind
+    /// others as well with 'aOcclusionCulling'. 'aOverdraw' nests the copies inside each other instead, drawn from the
+    /// innermost out so every one of them is shaded where they overlap. With 'aDepthPrepass' depth is filled by a
+    /// position only pass first, so only the nearest surface is shaded.
+    explicit Application(
+        bool aPackedVertices = false, uint32_t aInstanceCount = 1, bool aGpuCulling = false, bool aOcclusionCulling = false,
+        bool aOverdraw = false, bool aDepthPrepass = false
+    ) : mPackedVertices(aPackedVertices), mInstanceCount(aInstanceCount), mGpuCulling(aGpuCulling), mOcclusionCulling(aOcclusionCulling),
+        mOverdraw(aOverdraw), mDepthPrepass(aDepthPrepass) {}
+
     void init();
     void run();
     void cleanup();
@@ -47,18 +95,100 @@ class Application : public VulkanGraphicsApp
     void initShaders();
     void initUniforms(); 
 
+    // Runs on the render thread. Starts drawing a model once the streamer has uploaded it.
+    void applyStreamedMesh(const StreamedMesh& aMesh);
+    // Runs on the render thread. Picks the coarsest level of detail of the model whose error stays below a pixel
+    // at its distance in 'aTransforms', and records new draw commands only when that level changes.
+    void selectModelLod(const StreamedMesh& aMesh, const Transforms& aTransforms);
+    // Runs on the render thread. Tests the bounds of every object against the view frustum of 'aTransforms' and
+    // keeps the visible ones in mVisibleObjects.
+    void cullObjects(const StreamedMesh& aMesh, const Transforms& aTransforms);
+    // Runs on the render thread. Draws only the meshlets of the selected level of detail that face the camera and
+    // lie in the view frustum of 'aTransforms', and nothing if the model itself is outside of it.
+    void cullModelMeshlets(const StreamedMesh& aMesh, const Transforms& aTransforms);
+
+    // Runs on the simulation thread. Must only write to the snapshot buffer's write slot.
+    void simulate(uint64_t aTick, double aTickSeconds);
+
     void render();
 
     glm::vec2 getMousePos();
 
-    std::shared_ptr<SimpleVertexBuffer> mGeometry = nullptr;
+    const bool mPackedVertices;
+    const uint32_t mInstanceCount;
+    const bool mGpuCulling;
+    const bool mOcclusionCulling;
+    const bool mOverdraw;
+    const bool mDepthPrepass;
+    std::shared_ptr<InstanceBuffer> mInstances = nullptr;
+    // Meshlets are culled for the single model in view, which doesn't hold for copies elsewhere in the world
+    bool mDrawMeshlets = false;
+    // Expands quantized positions to object space. Identity unless drawing packed vertices. Only used by the render
+    // thread, which applies it to the model matrix of each snapshot.
+    glm::mat4 mDequantize = glm::mat4(1);
+    // Models are loaded and uploaded in the background. Nothing is drawn until they arrive. The registry owns
+    // their buffers and shares them between every user of the same mesh.
+    AssetStreamer mStreamer;
+    AssetRegistry mAssets{mStreamer};
+    MeshHandle mModel;
+    // Level of detail of mModel the draw commands were recorded with
+    size_t mModelLod = SIZE_MAX;
+    // World space bounds of every object to draw, and the objects among them that are in view this frame
+    BoundsBatch mObjectBounds;
+    std::vector<uint32_t> mVisibleObjects;
+    // Indices of the meshlets that survived culling, and how many meshlets were tested and kept over the whole run
+    std::vector<uint32_t> mCulledIndices;
+    uint64_t mMeshletsTested = 0;
+    uint64_t mMeshletsKept = 0;
     UniformTransformDataPtr mTransformUniforms = nullptr;
     UniformAnimationDataPtr mAnimationUniforms = nullptr;
+
+    const static int SIMULATION_TICK_RATE = 120;
+    SimulationLoop mSimulation{SIMULATION_TICK_RATE};
+    TripleBuffer<FrameSnapshot> mSnapshots;
+
+    // Framebuffer size as last seen by the render thread, read by the simulation thread for its projection.
+    std::atomic<uint32_t> mSimFramebufferWidth{1};
+    std::atomic<uint32_t> mSimFramebufferHeight{1};
 };
 
 
 int main(int argc, char** argv){
-    Application app;
+    // Pass --packed-vertices to draw with the compact vertex formats, e.g. to compare frame times, and
+    // --instances <count> to draw that many copies of the model, culled on the GPU with --gpu-culling, or also
+    // against the depth of the frame with --occlusion-culling. --overdraw nests the copies for a scene shading each
+    // pixel many times, to compare frame times with and without --depth-prepass
+    bool packedVertices = false;
+    uint32_t instanceCount = 1;
+    bool gpuCulling = false;
+    bool occlusionCulling = false;
+    bool overdraw = false;
+    bool depthPrepass = false;
+    for(int i = 1; i < argc; ++i){
+        if(std::string(argv[i]) == "--packed-vertices") packedVertices = true;
+        if(std::string(argv[i]) == "--gpu-culling") gpuCulling = true;
+        if(std::string(argv[i]) == "--occlusion-culling") gpuCulling = occlusionCulling = true;
+        if(std::string(argv[i]) == "--overdraw") overdraw = true;
+        if(std::string(argv[i]) == "--depth-prepass") depthPrepass = true;
+        if(std::string(argv[i]) == "--instances" && i + 1 < argc){
+            char* end = nullptr;
+            const long long count = std::strtoll(argv[++i], &end, 10);
+            if(end == argv[i] || *end != '\0' || count < 1){
+                std::cout << "Ignoring invalid instance count '" << argv[i] << "'" << std::endl;
+            }else{
+                instanceCount = static_cast<uint32_t>(std::min<long long>(count, std::numeric_limits<uint32_t>::max()));
+            }
+        }
+    }
+    if(packedVertices && instanceCount > 1){
+        std::cout << "Instancing is only supported with the split vertex format, drawing a single instance" << std::endl;
+        instanceCount = 1;
+    }
+
+    Application app(
+        packedVertices, instanceCount, gpuCulling && instanceCount > 1, occlusionCulling && instanceCount > 1,
+        overdraw && instanceCount > 1, depthPrepass
+    );
     app.init();
     app.run();
     app.cleanup();
@@ -94,20 +224,37 @@ void Application::init(){
     initShaders();
     // Initialize shader uniform variables
     initUniforms();
+    // Before the render setup, which then creates the depth image sampled
+    VulkanGraphicsApp::setOcclusionCulling(mOcclusionCulling);
 
     // Initialize graphics pipeline and render setup 
     VulkanGraphicsApp::init();
+
+    // Simulate the first tick up front so a complete snapshot exists before the first frame is rendered
+    const VkExtent2D& frameExtent = getFramebufferSize();
+    mSimFramebufferWidth = frameExtent.width;
+    mSimFramebufferHeight = frameExtent.height;
+    simulate(0, mSimulation.getTickSeconds());
+    mSnapshots.update();
 }
 
 void Application::run(){
     FpsTimer globalRenderTimer(0);
     FpsTimer localRenderTimer(1024);
 
+    // Simulation runs at a fixed tick rate on its own thread, starting after the tick simulated during init()
+    mSimulation.start([this](uint64_t aTick, double aTickSeconds){ simulate(aTick, aTickSeconds); }, 1);
+
     // Run until the application is closed
     while(!glfwWindowShouldClose(mWindow)){
         // Poll for window events, keyboard and mouse button presses, ect...
         glfwPollEvents();
 
+        // Window events must be handled on this thread. Forward what the simulation needs.
+        const VkExtent2D& frameExtent = getFramebufferSize();
+        mSimFramebufferWidth = frameExtent.width;
+        mSimFramebufferHeight = frameExtent.height;
+
         // Render the frame 
         globalRenderTimer.frameStart();
         localRenderTimer.frameStart();
@@ -122,16 +269,32 @@ void Application::run(){
         ++mFrameNumber;
     }
 
+    mSimulation.stop();
+    mStreamer.stop();
+
     std::cout << "Average Performance: " << globalRenderTimer.getReportString() << std::endl;
+    std::cout << "Simulated " << mSimulation.getTickCount() << " ticks at " << mSimulation.getTicksPerSecond() << " Hz ("
+              << mSimulation.getDroppedTickCount() << " dropped)" << std::endl;
+    mAssets.printReport();
+    const DrawBindStats& binds = getDrawBindStats();
+    std::cout << "Binds per frame: " << binds.pipelineBinds << " pipelines (" << binds.pipelineBindsSaved << " saved), "
+              << binds.descriptorSetBinds << " descriptor sets (" << binds.descriptorSetBindsSaved << " saved), "
+              << binds.vertexBufferBinds << " vertex buffers (" << binds.vertexBufferBindsSaved << " saved), "
+              << binds.indexBufferBinds << " index buffers (" << binds.indexBufferBindsSaved << " saved)" << std::endl;
+    if(mMeshletsTested > 0){
+        std::cout << "Meshlet culling kept " << 100.0 * mMeshletsKept / mMeshletsTested << "% of " << mMeshletsTested << " meshlets tested" << std::endl;
+    }
     
     // Make sure the GPU is done rendering before moving on. 
     vkDeviceWaitIdle(mDeviceBundle.logicalDevice.handle());
 }
 
 void Application::cleanup(){
-    // Deallocate the buffer holding our geometry and delete the buffer
-    mGeometry->freeBuffer();
-    mGeometry = nullptr;
+    // Deallocate the buffers holding our geometry. The device is idle, so nothing still draws from them.
+    if(mModel.isValid()) mAssets.release(mModel);
+    mAssets.unloadUnused();
+    if(mInstances != nullptr) mInstances->freeBuffer();
+    mInstances = nullptr;
 
     mTransformUniforms = nullptr;
     mAnimationUniforms = nullptr;
@@ -139,6 +302,22 @@ void Application::cleanup(){
     VulkanGraphicsApp::cleanup();
 }
 
+void Application::simulate(uint64_t aTick, double aTickSeconds){
+    float time = static_cast<float>(aTick * aTickSeconds);
+    VkExtent2D frameDimensions = {mSimFramebufferWidth.load(), mSimFramebufferHeight.load()};
+
+    FrameSnapshot& snapshot = mSnapshots.getWriteBuffer();
+    snapshot.tick = aTick;
+    snapshot.transforms = {
+        glm::translate(glm::vec3(.1*cos(time), .1*sin(time), -5)) * glm::rotate(time, glm::vec3(0,1,0)),
+        glm::mat4(1),
+        getPerspective(frameDimensions, 120, 0.1, 150)
+    };
+    snapshot.animation = {time};
+
+    mSnapshots.publish();
+}
+
 void Application::render(){
 
     // Set the position of the top vertex 
@@ -149,17 +328,33 @@ void Application::render(){
     //    VulkanGraphicsApp::setVertexBuffer(mGeometry->getBuffer(), mGeometry->vertexCount());
     //}
 
-    float time = static_cast<float>(glfwGetTime());
-    VkExtent2D frameDimensions = getFramebufferSize();
-    static float angle = 0;
-    angle+=0.01;
-    // Set the value of our uniform variable
-    mTransformUniforms->pushUniformData({
-        glm::translate(glm::vec3(.1*cos(time), .1*sin(time), -5)) * glm::rotate(time, glm::vec3(0,1,0)),
-        glm::mat4(1),
-        getPerspective(frameDimensions, 120, 0.1, 150)
-    });
-    mAnimationUniforms->pushUniformData({time});
+    // Start drawing the model once it has finished streaming in
+    bool meshArrived = false;
+    if(mAssets.update() > 0 && mAssets.isReady(mModel)){
+        applyStreamedMesh(*mAssets.getMesh(mModel));
+        meshArrived = true;
+    }
+
+    // Pick up the latest completed simulation tick. Uniforms are only dirtied when there is a new one,
+    // so frames presented faster than the tick rate skip the uniform upload entirely.
+    if(mSnapshots.update() || mFrameNumber == 0 || meshArrived){
+        const FrameSnapshot& snapshot = mSnapshots.getReadBuffer();
+        const StreamedMesh* mesh = mAssets.getMesh(mModel);
+        if(mesh != nullptr){
+            selectModelLod(*mesh, snapshot.transforms);
+            cullObjects(*mesh, snapshot.transforms);
+            if(mDrawMeshlets) cullModelMeshlets(*mesh, snapshot.transforms);
+        }
+        // The instances are culled in object space, whatever their number
+        if(mGpuCulling){
+            const Transforms& t = snapshot.transforms;
+            VulkanGraphicsApp::setCullingTransforms(t.View * t.Model, t.Projection);
+        }
+        Transforms transforms = snapshot.transforms;
+        transforms.Model = transforms.Model * mDequantize;
+        mTransformUniforms->pushUniformData(transforms);
+        mAnimationUniforms->pushUniformData(snapshot.animation);
+    }
 
     // Tell the GPU to render a frame. 
     VulkanGraphicsApp::render();
@@ -167,41 +362,193 @@ void Application::render(){
 
 void Application::initGeometry(){
 
-    ModelContainer mc = ModelContainer("../assets/suzanne.gltf");
-
-
-    // Create a new vertex buffer on the GPU using the given geometry 
-    mGeometry = std::make_shared<SimpleVertexBuffer>(mc.verts, mDeviceBundle);
-
-    // Check to make sure the geometry was uploaded to the GPU correctly. 
-    assert(mGeometry->getDeviceSyncState() == DEVICE_IN_SYNC);
-    // Specify that we wish to render this vertex buffer
-    VulkanGraphicsApp::setVertexBuffer(mGeometry->handle(), mGeometry->vertexCount());
+    // Load the model in the background so the first frame doesn't wait for it. It is picked up in render().
+    mStreamer.start(mDeviceBundle, mQueueMutex);
+    mModel = mAssets.acquire("../assets/suzanne.glb", mPackedVertices ? STREAMED_VERTEX_PACKED : STREAMED_VERTEX_SPLIT);
 
-    // Define a description of the layout of the geometry data
-    const static SimpleVertexInput vtxInput( /*binding = */ 0U,
+    // Define a description of the layout of the geometry data, positions in binding 0 and everything else in binding 1
+    const static PositionInput positionInput( /*binding = */ 0U,
         /*vertex attribute descriptions = */ {
-            {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(SimpleVertex, pos)},
-            {1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SimpleVertex, color)},
-            {2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(SimpleVertex, normal)}
+            {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}
+        }
+    );
+    const static AttributeInput attributeInput( /*binding = */ 1U,
+        /*vertex attribute descriptions = */ {
+            {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(SimpleVertexAttributes, color)},
+            {2, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(SimpleVertexAttributes, normal)}
         }
     );
     // Send this description to the GPU so that it knows how to interpret our vertex buffer 
-    VulkanGraphicsApp::setVertexInput(vtxInput.getBindingDescription(), vtxInput.getAttributeDescriptions());
+    if(mPackedVertices){
+        const VertexInputTemplate<PackedColorVertex>& packedInput = getPackedColorVertexInput();
+        VulkanGraphicsApp::setVertexInput(packedInput.getBindingDescription(), packedInput.getAttributeDescriptions());
+    }else if(mInstanceCount > 1){
+        // Instance data comes after the vertex streams, in binding 2
+        const static InstanceInput instanceInput( /*binding = */ 2U,
+            /*vertex attribute descriptions = */ {
+                {3, 2, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, offsetScale)}
+            },
+            /*stride override = */ 0U, VK_VERTEX_INPUT_RATE_INSTANCE
+        );
+        std::vector<VkVertexInputAttributeDescription> attributes = positionInput.getAttributeDescriptions();
+        attributes.insert(attributes.end(), attributeInput.getAttributeDescriptions().begin(), attributeInput.getAttributeDescriptions().end());
+        attributes.insert(attributes.end(), instanceInput.getAttributeDescriptions().begin(), instanceInput.getAttributeDescriptions().end());
+        VulkanGraphicsApp::setVertexInput(
+            {positionInput.getBindingDescription(), attributeInput.getBindingDescription(), instanceInput.getBindingDescription()}, attributes
+        );
+
+        // A square grid of copies on the floor around the model, all drawn by one instanced draw and turning with it
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(mInstanceCount))));
+        const float spacing = 2.5f;
+        std::vector<InstanceData> instances(mInstanceCount);
+        for(uint32_t i = 0; i < mInstanceCount; ++i){
+            float column = static_cast<float>(i % side) - (side - 1) * 0.5f;
+            float row = static_cast<float>(i / side);
+            instances[i].offsetScale = glm::vec4(column * spacing, -2.0f, -row * spacing, 1.0f);
+        }
+        if(mOverdraw){
+            // Shells of the model growing outwards. Instances are rasterized in order, so each shell passes the depth
+            // test over the ones inside it and the pixels they cover are shaded once per shell, whichever way it turns.
+            for(uint32_t i = 0; i < mInstanceCount; ++i){
+                float scale = 0.5f + 1.5f * static_cast<float>(i) / static_cast<float>(mInstanceCount - 1);
+                instances[i].offsetScale = glm::vec4(0.0f, 0.0f, 0.0f, scale);
+            }
+        }
+        mInstances = std::make_shared<InstanceBuffer>(instances, mDeviceBundle);
+        VulkanGraphicsApp::addInstanceBuffer(instanceInput.getBinding(), mInstances->handle());
+        VulkanGraphicsApp::setInstanceCount(mInstanceCount);
+    }else{
+        std::vector<VkVertexInputAttributeDescription> attributes = positionInput.getAttributeDescriptions();
+        attributes.insert(attributes.end(), attributeInput.getAttributeDescriptions().begin(), attributeInput.getAttributeDescriptions().end());
+        VulkanGraphicsApp::setVertexInput({positionInput.getBindingDescription(), attributeInput.getBindingDescription()}, attributes);
+    }
+
+}
+
+void Application::applyStreamedMesh(const StreamedMesh& aMesh){
+    std::cout << "Streamed " << aMesh.path << " in " << aMesh.latencySeconds * 1000.0 << " ms (" << aMesh.vertexCount << " vertices)" << std::endl;
+
+    if(mPackedVertices){
+        mDequantize = glm::translate(aMesh.quantization.offset) * glm::scale(aMesh.quantization.scale);
+        std::cout << "Drawing packed vertices: " << sizeof(PackedColorVertex) << " instead of " << sizeof(SimpleVertex) << " bytes per vertex" << std::endl;
+    }
+
+    // Specify that we wish to render the mesh's vertex streams. Positions are kept in their own stream so
+    // position-only passes don't fetch the other attributes. Packed vertices are small enough to stay interleaved.
+    std::vector<VkBuffer> streams;
+    for(const std::shared_ptr<DeviceSyncedBuffer>& stream : aMesh.vertexStreams){
+        streams.push_back(stream->handle());
+    }
+    VulkanGraphicsApp::setVertexBuffers(streams, aMesh.vertexCount);
+    // The index buffer is set once the level of detail to draw is known. Meshes with meshlets are drawn from the
+    // indices of the meshlets that pass culling instead, at most all of the level with the most triangles.
+    mModelLod = SIZE_MAX;
+    mDrawMeshlets = !aMesh.meshlets.empty() && mInstanceCount == 1;
+    if(mGpuCulling){
+        // Copies are offset and scaled in object space, so their spheres never change. Only the frustum is updated.
+        const glm::vec3 center = (aMesh.min + aMesh.max) * 0.5f;
+        std::vector<glm::vec4> spheres;
+        spheres.reserve(mInstances->vertexCount());
+        for(const InstanceData& instance : mInstances->getVerticesConst()){
+            const glm::vec4& offsetScale = instance.offsetScale;
+            spheres.push_back(glm::vec4(center * offsetScale.w + glm::vec3(offsetScale), aMesh.radius * offsetScale.w));
+        }
+        VulkanGraphicsApp::setGpuCulledInstances(spheres);
+    }
+    if(!mDrawMeshlets){
+        // A previous model may have been drawn from meshlets
+        VulkanGraphicsApp::setFrameIndexCapacity(0);
+        return;
+    }
+    size_t maxLodIndexCount = 0;
+    for(const CookedMesh::Lod& lod : aMesh.lods){
+        size_t indexCount = 0;
+        for(uint32_t i = lod.firstMeshlet; i < lod.firstMeshlet + lod.meshletCount; ++i) indexCount += aMesh.meshlets[i].indexCount;
+        maxLodIndexCount = std::max(maxLodIndexCount, indexCount);
+    }
+    VulkanGraphicsApp::setFrameIndexCapacity(maxLodIndexCount);
+}
+
+void Application::selectModelLod(const StreamedMesh& aMesh, const Transforms& aTransforms){
+    // Distance from the camera to the nearest point of the model's bounding sphere
+    glm::vec3 center = (aMesh.min + aMesh.max) * 0.5f;
+    glm::vec4 viewCenter = aTransforms.View * aTransforms.Model * glm::vec4(center, 1.0f);
+    float distance = glm::length(glm::vec3(viewCenter)) - aMesh.radius;
+
+    const VkExtent2D& frameExtent = getFramebufferSize();
+    float pixelsPerUnit = std::abs(aTransforms.Projection[1][1]) * frameExtent.height * 0.5f;
+    size_t lod = select_lod(aMesh.lods, distance, pixelsPerUnit);
+    if(lod == mModelLod) return;
+    mModelLod = lod;
+    if(mDrawMeshlets) return;
+
+    // Draw just the chunks of the selected level. Every level shares the same index and vertex buffers.
+    std::vector<IndexedDrawRange> chunkRanges;
+    for(uint32_t i = aMesh.lods[lod].firstChunk; i < aMesh.lods[lod].firstChunk + aMesh.lods[lod].chunkCount; ++i){
+        const IndexChunk& chunk = aMesh.chunks[i];
+        IndexedDrawRange range;
+        range.firstIndex = chunk.firstIndex;
+        range.indexCount = chunk.indexCount;
+        range.vertexOffset = chunk.vertexOffset;
+        chunkRanges.push_back(range);
+    }
+    VulkanGraphicsApp::setIndexBuffer(aMesh.indices->handle(), chunkRanges, aMesh.indexType);
+}
 
+void Application::cullObjects(const StreamedMesh& aMesh, const Transforms& aTransforms){
+    // Bounds are brought to world space once, so every object is tested against the same frustum
+    mObjectBounds.clear();
+    mObjectBounds.push_back(transform_bounds(make_bounds(aMesh.min, aMesh.max, aMesh.radius), aTransforms.Model));
+    mVisibleObjects.clear();
+    cull_bounds(mVisibleObjects, mObjectBounds, extract_frustum(aTransforms.Projection * aTransforms.View));
+}
+
+void Application::cullModelMeshlets(const StreamedMesh& aMesh, const Transforms& aTransforms){
+    mCulledIndices.clear();
+    if(mVisibleObjects.empty()){
+        VulkanGraphicsApp::setFrameIndices(mCulledIndices);
+        return;
+    }
+
+    // Meshlet bounds are in object space, so the frustum and camera are brought there rather than every meshlet
+    // to view space
+    const glm::mat4 modelView = aTransforms.View * aTransforms.Model;
+    const Frustum frustum = extract_frustum(aTransforms.Projection * modelView);
+    const glm::vec3 camera = glm::vec3(glm::inverse(modelView)[3]);
+
+    const CookedMesh::Lod& lod = aMesh.lods[mModelLod];
+    mMeshletsKept += cull_meshlets(mCulledIndices, aMesh.meshlets, lod.firstMeshlet, lod.meshletCount, aMesh.meshletIndices, frustum, camera);
+    mMeshletsTested += lod.meshletCount;
+    VulkanGraphicsApp::setFrameIndices(mCulledIndices);
 }
 
 void Application::initShaders(){
 
     // Load the compiled shader code from disk. 
-    VkShaderModule vertShader = vkutils::load_shader_module(mDeviceBundle.logicalDevice.handle(), STRIFY(SHADER_DIR) "/standard.vert.spv");
-    VkShaderModule fragShader = vkutils::load_shader_module(mDeviceBundle.logicalDevice.handle(), STRIFY(SHADER_DIR) "/vertexColor.frag.spv");
+    const std::string vertShaderName = mPackedVertices ? "packed.vert" : mInstanceCount > 1 ? "instanced.vert" : "standard.vert";
+    VkShaderModule vertShader = VulkanGraphicsApp::loadShader(vertShaderName);
+    VkShaderModule fragShader = VulkanGraphicsApp::loadShader("vertexColor.frag");
     
     assert(vertShader != VK_NULL_HANDLE);
     assert(fragShader != VK_NULL_HANDLE);
 
-    VulkanGraphicsApp::setVertexShader("standard.vert", vertShader);
+    VulkanGraphicsApp::setVertexShader(vertShaderName, vertShader,
+        StandardVertexSpecialization::create(sStandardVertexLayout, {/* colorByNormal = */ VK_TRUE, /* animateColor = */ VK_FALSE})
+    );
     VulkanGraphicsApp::setFragmentShader("vertexColor.frag", fragShader);
+
+    if(mDepthPrepass){
+        // The prepass shaders must compute the same positions as the shaders above for the depths to compare equal
+        const std::string prepassShaderName = mInstanceCount > 1 ? "instanced_position.vert" : "position.vert";
+        VkShaderModule prepassShader = VulkanGraphicsApp::loadShader(prepassShaderName);
+        assert(prepassShader != VK_NULL_HANDLE);
+        VulkanGraphicsApp::setDepthPrepassShader(prepassShaderName, prepassShader);
+    }
+
+#ifndef NDEBUG
+    // Rebuilding the shader targets while the app is running swaps the new shaders in
+    VulkanGraphicsApp::enableShaderHotReload();
+#endif
 }
 
 void Application::initUniforms(){
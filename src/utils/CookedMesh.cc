@@ -0,0 +1,183 @@
+#include "CookedMesh.h"
+#include "Hash.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+static uint64_t align_blob(uint64_t aOffset, uint64_t aAlignment){
+    return((aOffset + aAlignment - 1) / aAlignment * aAlignment);
+}
+
+bool CookedMesh::open(const std::string& aFilePath, uint64_t aSourceKey, uint32_t aVertexStride){
+    close();
+    if(!mFile.open(aFilePath)) return(false);
+
+    const uint8_t* base = mFile.data();
+    const size_t fileSize = mFile.size();
+    auto reject = [&](const std::string& aReason) -> bool {
+        std::cerr << "Warning: Ignoring cooked mesh '" << aFilePath << "': " << aReason << std::endl;
+        close();
+        return(false);
+    };
+
+    FileHeader header;
+    if(fileSize < sizeof(FileHeader)) return(reject("file is truncated"));
+    memcpy(&header, base, sizeof(FileHeader));
+    if(header.magic != sFileMagic) return(reject("not a cooked mesh"));
+
+    // Meshes cooked by another version or from other source data are simply out of date
+    if(header.version != sFileVersion || header.sourceKey != aSourceKey || header.vertexStride != aVertexStride){
+        close();
+        return(false);
+    }
+
+    auto inside = [&](uint64_t aOffset, uint64_t aSize) -> bool {
+        return(aOffset % sBlobAlignment == 0 && aOffset <= fileSize && aSize <= fileSize - aOffset);
+    };
+    if(!inside(header.vertexOffset, uint64_t(header.vertexCount) * header.vertexStride)
+        || !inside(header.shortIndexOffset, uint64_t(header.indexCount) * sizeof(uint16_t))
+        || !inside(header.indexOffset, uint64_t(header.indexCount) * sizeof(uint32_t))
+        || !inside(header.chunkOffset, uint64_t(header.chunkCount) * sizeof(IndexChunk))
+        || !inside(header.lodOffset, uint64_t(header.lodCount) * sizeof(Lod))
+        || !inside(header.meshletOffset, uint64_t(header.meshletCount) * sizeof(Meshlet))){
+        return(reject("blobs lie outside of the file"));
+    }
+
+    mContents.sourceKey = header.sourceKey;
+    mContents.vertices = base + header.vertexOffset;
+    mContents.vertexStride = header.vertexStride;
+    mContents.vertexCount = header.vertexCount;
+    mContents.shortIndices = reinterpret_cast<const uint16_t*>(base + header.shortIndexOffset);
+    mContents.indices = reinterpret_cast<const uint32_t*>(base + header.indexOffset);
+    mContents.indexCount = header.indexCount;
+    mContents.chunks = reinterpret_cast<const IndexChunk*>(base + header.chunkOffset);
+    mContents.chunkCount = header.chunkCount;
+    mContents.lods = reinterpret_cast<const Lod*>(base + header.lodOffset);
+    mContents.lodCount = header.lodCount;
+    mContents.meshlets = reinterpret_cast<const Meshlet*>(base + header.meshletOffset);
+    mContents.meshletCount = header.meshletCount;
+    memcpy(mContents.boundsMin, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(mContents.boundsMax, header.boundsMax, sizeof(header.boundsMax));
+
+    for(uint32_t i = 0; i < mContents.chunkCount; ++i){
+        const IndexChunk& chunk = mContents.chunks[i];
+        if(uint64_t(chunk.firstIndex) + chunk.indexCount > header.indexCount || chunk.vertexOffset < 0
+            || uint64_t(chunk.vertexOffset) + chunk.vertexCount > header.vertexCount){
+            return(reject("chunk " + std::to_string(i) + " is out of range"));
+        }
+        for(uint32_t j = chunk.firstIndex; j < chunk.firstIndex + chunk.indexCount; ++j){
+            if(mContents.shortIndices[j] >= chunk.vertexCount) return(reject("chunk " + std::to_string(i) + " indexes past its vertices"));
+        }
+    }
+    for(uint32_t i = 0; i < mContents.indexCount; ++i){
+        if(mContents.indices[i] >= header.vertexCount) return(reject("index " + std::to_string(i) + " is out of range"));
+    }
+    for(uint32_t i = 0; i < mContents.lodCount; ++i){
+        if(uint64_t(mContents.lods[i].firstChunk) + mContents.lods[i].chunkCount > header.chunkCount
+            || uint64_t(mContents.lods[i].firstMeshlet) + mContents.lods[i].meshletCount > header.meshletCount){
+            return(reject("LOD " + std::to_string(i) + " is out of range"));
+        }
+    }
+    for(uint32_t i = 0; i < mContents.meshletCount; ++i){
+        if(uint64_t(mContents.meshlets[i].firstIndex) + mContents.meshlets[i].indexCount > header.indexCount){
+            return(reject("meshlet " + std::to_string(i) + " is out of range"));
+        }
+    }
+    return(true);
+}
+
+void CookedMesh::close(){
+    mContents = Contents();
+    mFile.close();
+}
+
+bool CookedMesh::write(const std::string& aFilePath, const Contents& aContents){
+    FileHeader header;{
+        header.magic = sFileMagic;
+        header.version = sFileVersion;
+        header.sourceKey = aContents.sourceKey;
+        header.vertexStride = aContents.vertexStride;
+        header.vertexCount = aContents.vertexCount;
+        header.indexCount = aContents.indexCount;
+        header.chunkCount = aContents.chunkCount;
+        header.lodCount = aContents.lodCount;
+        header.meshletCount = aContents.meshletCount;
+        memcpy(header.boundsMin, aContents.boundsMin, sizeof(header.boundsMin));
+        memcpy(header.boundsMax, aContents.boundsMax, sizeof(header.boundsMax));
+    }
+
+    struct Blob
+    {
+        const void* data;
+        uint64_t size;
+        uint64_t* offset;
+    };
+    const Blob blobs[] = {
+        {aContents.vertices, uint64_t(aContents.vertexCount) * aContents.vertexStride, &header.vertexOffset},
+        {aContents.shortIndices, uint64_t(aContents.indexCount) * sizeof(uint16_t), &header.shortIndexOffset},
+        {aContents.indices, uint64_t(aContents.indexCount) * sizeof(uint32_t), &header.indexOffset},
+        {aContents.chunks, uint64_t(aContents.chunkCount) * sizeof(IndexChunk), &header.chunkOffset},
+        {aContents.lods, uint64_t(aContents.lodCount) * sizeof(Lod), &header.lodOffset},
+        {aContents.meshlets, uint64_t(aContents.meshletCount) * sizeof(Meshlet), &header.meshletOffset}
+    };
+    uint64_t offset = sizeof(FileHeader);
+    for(const Blob& blob : blobs){
+        if(blob.size > 0 && blob.data == nullptr) return(false);
+        offset = align_blob(offset, sBlobAlignment);
+        *blob.offset = offset;
+        offset += blob.size;
+    }
+
+    // Written next to the destination and renamed into place, so a concurrent open() of the same path never
+    // maps a partially written file and two threads cooking the same mesh don't interleave their writes
+    const std::string tempPath = aFilePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) return(false);
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        const char padding[sBlobAlignment] = {};
+        for(const Blob& blob : blobs){
+            uint64_t written = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(*blob.offset - written));
+            file.write(static_cast<const char*>(blob.data), static_cast<std::streamsize>(blob.size));
+        }
+        if(!file.good()){
+            file.close();
+            std::remove(tempPath.c_str());
+            return(false);
+        }
+    }
+    // Windows refuses to rename onto an existing file
+    if(std::rename(tempPath.c_str(), aFilePath.c_str()) != 0){
+        std::remove(aFilePath.c_str());
+        if(std::rename(tempPath.c_str(), aFilePath.c_str()) != 0){
+            std::remove(tempPath.c_str());
+            return(false);
+        }
+    }
+    return(true);
+}
+
+uint64_t CookedMesh::hashFile(const std::string& aFilePath){
+    MappedFile file;
+    if(!file.open(aFilePath)) return(0);
+
+    // Runs on every load, so whole words are mixed in at a time rather than FNV-1a's single bytes. The shift
+    // folds the high bits back down, which multiplication alone never does.
+    const size_t wordCount = file.size() / sizeof(uint64_t);
+    uint64_t state = Fnv1aHasher::OFFSET_BASIS;
+    for(size_t i = 0; i < wordCount; ++i){
+        uint64_t word;
+        memcpy(&word, file.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+        state = (state ^ word) * Fnv1aHasher::PRIME;
+        state ^= state >> 32;
+    }
+    Fnv1aHasher tail(state);
+    tail.addBytes(file.data() + wordCount * sizeof(uint64_t), file.size() % sizeof(uint64_t));
+    tail.add(uint64_t(file.size()));
+    return(tail.value() != 0 ? tail.value() : 1);
+}
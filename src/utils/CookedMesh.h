@@ -0,0 +1,105 @@
+#ifndef COOKED_MESH_H_
+#define COOKED_MESH_H_
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include <cstdint>
+#include <string>
+
+/** A mesh preprocessed into the layout it is uploaded in, so it can be loaded by mapping a single file instead of
+ * parsing and processing its source. Layout (little endian):
+ *
+ *     FileHeader  {magic 'MSHC', version, sourceKey, vertex/index/chunk/LOD/meshlet counts, bounds, blob offsets}
+ *     vertex blob         vertexCount * vertexStride bytes
+ *     16 bit index blob   indexCount indices, relative to the vertexOffset of their chunk
+ *     32 bit index blob   indexCount indices into the whole vertex blob
+ *     IndexChunk table    chunkCount entries
+ *     Lod table           lodCount entries, each a range of chunks and of meshlets
+ *     Meshlet table       meshletCount entries, each a range of indices
+ *
+ * Every blob is 16 byte aligned and offsets are relative to the start of the file. The source key identifies the
+ * content and processing the mesh was cooked from; open() treats a file with a different key as stale.
+ */
+class CookedMesh
+{
+ public:
+    struct Lod
+    {
+        uint32_t firstChunk = 0;
+        uint32_t chunkCount = 0;
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+        float error = 0.0f; // Object space error of the LOD relative to the full detail mesh
+        uint32_t reserved = 0;
+    };
+
+    /// Arrays making up a cooked mesh. Filled by the caller for write(), or point into the mapping after open().
+    struct Contents
+    {
+        uint64_t sourceKey = 0;
+        const void* vertices = nullptr;
+        uint32_t vertexStride = 0;
+        uint32_t vertexCount = 0;
+        const uint16_t* shortIndices = nullptr;
+        const uint32_t* indices = nullptr;
+        uint32_t indexCount = 0;
+        const IndexChunk* chunks = nullptr;
+        uint32_t chunkCount = 0;
+        const Lod* lods = nullptr;
+        uint32_t lodCount = 0;
+        const Meshlet* meshlets = nullptr;
+        uint32_t meshletCount = 0;
+        float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+        float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+    };
+
+    CookedMesh(){}
+
+    /** Map 'aFilePath' if it holds a mesh cooked from 'aSourceKey' with vertices of 'aVertexStride' bytes.
+     * Returns false if the file is missing or stale; a corrupt file is additionally reported to std::cerr.
+    */
+    bool open(const std::string& aFilePath, uint64_t aSourceKey, uint32_t aVertexStride);
+    void close();
+    bool isOpen() const {return(mFile.isValid());}
+
+    /// Contents of the open file. The arrays stay valid until the mesh is closed or destroyed.
+    const Contents& getContents() const {return(mContents);}
+
+    /// Write 'aContents' to 'aFilePath'. Returns false if the file could not be written.
+    static bool write(const std::string& aFilePath, const Contents& aContents);
+
+    /// Hash of the whole content of 'aFilePath', or 0 if it cannot be read.
+    static uint64_t hashFile(const std::string& aFilePath);
+
+ protected:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceKey;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t chunkCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        float boundsMin[3];
+        float boundsMax[3];
+        uint64_t vertexOffset;
+        uint64_t shortIndexOffset;
+        uint64_t indexOffset;
+        uint64_t chunkOffset;
+        uint64_t lodOffset;
+        uint64_t meshletOffset;
+    };
+
+    static const uint32_t sFileMagic = 0x4348534D; // "MSHC"
+    static const uint32_t sFileVersion = 2;
+    static const uint64_t sBlobAlignment = 16;
+
+    MappedFile mFile;
+    Contents mContents;
+};
+
+#endif
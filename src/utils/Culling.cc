@@ -0,0 +1,205 @@
+#include "Culling.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define CULLING_SSE 1
+#endif
+
+Frustum extract_frustum(const glm::mat4& aViewProjection){
+    // Rows of the matrix, which is stored by column. Clip space points are inside where -w <= x, y <= w and 0 <= z <= w,
+    // see "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix" (Gribb and Hartmann, 2001).
+    glm::vec4 rows[4];
+    for(int row = 0; row < 4; ++row){
+        rows[row] = glm::vec4(aViewProjection[0][row], aViewProjection[1][row], aViewProjection[2][row], aViewProjection[3][row]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0]; // Left
+    frustum.planes[1] = rows[3] - rows[0]; // Right
+    frustum.planes[2] = rows[3] + rows[1]; // Bottom
+    frustum.planes[3] = rows[3] - rows[1]; // Top
+    frustum.planes[4] = rows[2];           // Near
+    frustum.planes[5] = rows[3] - rows[2]; // Far
+    for(glm::vec4& plane : frustum.planes){
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if(length > 0.0f) plane = plane * (1.0f / length);
+    }
+    return(frustum);
+}
+
+size_t cull_meshlets(
+    std::vector<uint32_t>& aIndicesOut, const std::vector<Meshlet>& aMeshlets, size_t aFirstMeshlet, size_t aMeshletCount,
+    const std::vector<uint32_t>& aIndices, const Frustum& aFrustum, const glm::vec3& aCameraPosition
+){
+    const float camera[3] = {aCameraPosition.x, aCameraPosition.y, aCameraPosition.z};
+    size_t keptCount = 0;
+    for(size_t i = aFirstMeshlet; i < aFirstMeshlet + aMeshletCount; ++i){
+        const Meshlet& meshlet = aMeshlets[i];
+        if(meshlet_backfacing(meshlet, camera)) continue;
+        if(!sphere_in_frustum(aFrustum, glm::vec3(meshlet.center[0], meshlet.center[1], meshlet.center[2]), meshlet.radius)) continue;
+
+        aIndicesOut.insert(aIndicesOut.end(), aIndices.begin() + meshlet.firstIndex, aIndices.begin() + meshlet.firstIndex + meshlet.indexCount);
+        ++keptCount;
+    }
+    return(keptCount);
+}
+
+Bounds make_bounds(const glm::vec3& aMin, const glm::vec3& aMax, float aRadius){
+    Bounds bounds;
+    bounds.center = (aMin + aMax) * 0.5f;
+    bounds.extent = (aMax - aMin) * 0.5f;
+    bounds.radius = aRadius;
+    return(bounds);
+}
+
+Bounds transform_bounds(const Bounds& aBounds, const glm::mat4& aTransform){
+    // The extent along each new axis is the extent projected onto it by the absolute matrix, see "Transforming
+    // Axis-Aligned Bounding Boxes" (Arvo, Graphics Gems, 1990). The sphere grows by the largest scale.
+    Bounds bounds;
+    bounds.center = glm::vec3(aTransform * glm::vec4(aBounds.center, 1.0f));
+    float maxScale = 0.0f;
+    for(int column = 0; column < 3; ++column){
+        glm::vec3 axis = glm::vec3(aTransform[column]);
+        bounds.extent += glm::abs(axis) * aBounds.extent[column];
+        maxScale = std::max(maxScale, glm::length(axis));
+    }
+    bounds.radius = aBounds.radius * maxScale;
+    return(bounds);
+}
+
+void BoundsBatch::clear(){
+    for(std::vector<float>* field : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius}){
+        field->clear();
+    }
+}
+
+void BoundsBatch::push_back(const Bounds& aBounds){
+    centerX.push_back(aBounds.center.x);
+    centerY.push_back(aBounds.center.y);
+    centerZ.push_back(aBounds.center.z);
+    extentX.push_back(aBounds.extent.x);
+    extentY.push_back(aBounds.extent.y);
+    extentZ.push_back(aBounds.extent.z);
+    radius.push_back(aBounds.radius);
+}
+
+// An object is outside of a plane if its center lies further behind it than the object reaches towards it. The box
+// reaches as far as its extent projected onto the plane normal, the sphere as far as its radius, and the object no
+// further than the smaller of the two.
+static bool bounds_in_frustum(const BoundsBatch& aBounds, size_t aIndex, const Frustum& aFrustum){
+    for(const glm::vec4& plane : aFrustum.planes){
+        float distance = plane.x * aBounds.centerX[aIndex] + plane.y * aBounds.centerY[aIndex] + plane.z * aBounds.centerZ[aIndex] + plane.w;
+        float boxReach = std::abs(plane.x) * aBounds.extentX[aIndex] + std::abs(plane.y) * aBounds.extentY[aIndex]
+                       + std::abs(plane.z) * aBounds.extentZ[aIndex];
+        if(distance < -std::min(boxReach, aBounds.radius[aIndex])) return(false);
+    }
+    return(true);
+}
+
+// Tests the objects from 'aFirst' on one at a time, writing the visible ones to 'aVisibleOut' from 'aWrite'
+static size_t cull_bounds_range(uint32_t* aVisibleOut, size_t aWrite, const BoundsBatch& aBounds, size_t aFirst, const Frustum& aFrustum){
+    for(size_t i = aFirst; i < aBounds.size(); ++i){
+        aVisibleOut[aWrite] = static_cast<uint32_t>(i);
+        aWrite += bounds_in_frustum(aBounds, i, aFrustum) ? 1 : 0;
+    }
+    return(aWrite);
+}
+
+size_t cull_bounds_scalar(std::vector<uint32_t>& aVisibleOut, const BoundsBatch& aBounds, const Frustum& aFrustum){
+    // Room for every object up front, so visible ones are written without checking for capacity
+    const size_t start = aVisibleOut.size();
+    aVisibleOut.resize(start + aBounds.size());
+    size_t end = cull_bounds_range(aVisibleOut.data(), start, aBounds, 0, aFrustum);
+    aVisibleOut.resize(end);
+    return(end - start);
+}
+
+size_t cull_bounds(std::vector<uint32_t>& aVisibleOut, const BoundsBatch& aBounds, const Frustum& aFrustum){
+#if defined(CULLING_AVX) || defined(CULLING_SSE)
+    const size_t start = aVisibleOut.size();
+    aVisibleOut.resize(start + aBounds.size());
+    uint32_t* visible = aVisibleOut.data();
+    size_t write = start;
+    size_t i = 0;
+
+#if defined(CULLING_AVX)
+    typedef __m256 Lanes;
+    const size_t width = 8;
+    #define LANES_SET1 _mm256_set1_ps
+    #define LANES_LOAD _mm256_loadu_ps
+    #define LANES_ADD _mm256_add_ps
+    #define LANES_MUL _mm256_mul_ps
+    #define LANES_MIN _mm256_min_ps
+    #define LANES_AND _mm256_and_ps
+    #define LANES_GE(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+    #define LANES_MASK _mm256_movemask_ps
+#else
+    typedef __m128 Lanes;
+    const size_t width = 4;
+    #define LANES_SET1 _mm_set1_ps
+    #define LANES_LOAD _mm_loadu_ps
+    #define LANES_ADD _mm_add_ps
+    #define LANES_MUL _mm_mul_ps
+    #define LANES_MIN _mm_min_ps
+    #define LANES_AND _mm_and_ps
+    #define LANES_GE _mm_cmpge_ps
+    #define LANES_MASK _mm_movemask_ps
+#endif
+
+    // Every plane broadcast to all lanes once, rather than for every batch
+    Lanes planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for(int p = 0; p < 6; ++p){
+        const glm::vec4& plane = aFrustum.planes[p];
+        planeX[p] = LANES_SET1(plane.x);
+        planeY[p] = LANES_SET1(plane.y);
+        planeZ[p] = LANES_SET1(plane.z);
+        planeW[p] = LANES_SET1(plane.w);
+        absX[p] = LANES_SET1(std::abs(plane.x));
+        absY[p] = LANES_SET1(std::abs(plane.y));
+        absZ[p] = LANES_SET1(std::abs(plane.z));
+    }
+
+    // Same test as bounds_in_frustum(), written as distance + reach >= 0 so the lanes that pass end up set
+    const Lanes zero = LANES_SET1(0.0f);
+    const Lanes all = LANES_GE(zero, zero);
+    for(; i + width <= aBounds.size(); i += width){
+        const Lanes centerX = LANES_LOAD(&aBounds.centerX[i]), centerY = LANES_LOAD(&aBounds.centerY[i]), centerZ = LANES_LOAD(&aBounds.centerZ[i]);
+        const Lanes extentX = LANES_LOAD(&aBounds.extentX[i]), extentY = LANES_LOAD(&aBounds.extentY[i]), extentZ = LANES_LOAD(&aBounds.extentZ[i]);
+        const Lanes radius = LANES_LOAD(&aBounds.radius[i]);
+        Lanes inside = all;
+        for(int p = 0; p < 6; ++p){
+            Lanes distance = LANES_ADD(LANES_ADD(LANES_MUL(planeX[p], centerX), LANES_MUL(planeY[p], centerY)),
+                                       LANES_ADD(LANES_MUL(planeZ[p], centerZ), planeW[p]));
+            Lanes boxReach = LANES_ADD(LANES_ADD(LANES_MUL(absX[p], extentX), LANES_MUL(absY[p], extentY)), LANES_MUL(absZ[p], extentZ));
+            inside = LANES_AND(inside, LANES_GE(LANES_ADD(distance, LANES_MIN(boxReach, radius)), zero));
+        }
+
+        // Write every index and only advance past the visible ones, which avoids a branch per object
+        int mask = LANES_MASK(inside);
+        for(size_t lane = 0; lane < width; ++lane){
+            visible[write] = static_cast<uint32_t>(i + lane);
+            write += (mask >> lane) & 1;
+        }
+    }
+
+    #undef LANES_SET1
+    #undef LANES_LOAD
+    #undef LANES_ADD
+    #undef LANES_MUL
+    #undef LANES_MIN
+    #undef LANES_AND
+    #undef LANES_GE
+    #undef LANES_MASK
+
+    // Objects left over after the last full batch
+    write = cull_bounds_range(visible, write, aBounds, i, aFrustum);
+    aVisibleOut.resize(write);
+    return(write - start);
+#else
+    return(cull_bounds_scalar(aVisibleOut, aBounds, aFrustum));
+#endif
+}
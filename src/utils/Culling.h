@@ -0,0 +1,79 @@
+#ifndef CULLING_H_
+#define CULLING_H_
+
+#include "Meshlets.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/// Six planes bounding the visible volume, as (normal, distance) with unit normals pointing inwards. A point p is
+/// inside a plane if dot(normal, p) + distance >= 0.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+/** Planes of the view frustum of 'aViewProjection', in the space the matrix transforms from. Passing
+ * Projection * View * Model gives the frustum in the object space of the model. Expects clip space depth from 0 to
+ * 1, as in Vulkan.
+ */
+Frustum extract_frustum(const glm::mat4& aViewProjection);
+
+/// False if the sphere lies entirely outside of one of the planes of 'aFrustum'
+inline bool sphere_in_frustum(const Frustum& aFrustum, const glm::vec3& aCenter, float aRadius){
+    for(const glm::vec4& plane : aFrustum.planes){
+        if(plane.x * aCenter.x + plane.y * aCenter.y + plane.z * aCenter.z + plane.w < -aRadius) return(false);
+    }
+    return(true);
+}
+
+/// Box and sphere around an object, sharing their center. Culling tests both and keeps the tighter result.
+struct Bounds
+{
+    glm::vec3 center = glm::vec3(0.0f);
+    // Half the size of the box along each axis
+    glm::vec3 extent = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+/// Bounds of the box from 'aMin' to 'aMax' and the sphere of 'aRadius' around its center
+Bounds make_bounds(const glm::vec3& aMin, const glm::vec3& aMax, float aRadius);
+
+/// Bounds enclosing 'aBounds' transformed by the affine 'aTransform'. The box stays axis aligned, so it grows when
+/// rotated.
+Bounds transform_bounds(const Bounds& aBounds, const glm::mat4& aTransform);
+
+/** Bounds of many objects as a structure of arrays, so the culling kernel loads the same field of several objects
+ * with one instruction. Objects are identified by the order they were added in.
+ */
+struct BoundsBatch
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+
+    size_t size() const {return(radius.size());}
+    void clear();
+    void push_back(const Bounds& aBounds);
+};
+
+/** Append the index of every object of 'aBounds' that is at least partly inside 'aFrustum' to 'aVisibleOut', in
+ * increasing order. The bounds and the frustum must be in the same space. Tests 8 objects at once when compiled
+ * with AVX, 4 with SSE, and one at a time otherwise. Returns the number of objects appended.
+ */
+size_t cull_bounds(std::vector<uint32_t>& aVisibleOut, const BoundsBatch& aBounds, const Frustum& aFrustum);
+
+/// cull_bounds() testing one object at a time, as a reference for the vectorized kernel
+size_t cull_bounds_scalar(std::vector<uint32_t>& aVisibleOut, const BoundsBatch& aBounds, const Frustum& aFrustum);
+
+/** Append the indices of every meshlet in [aFirstMeshlet, aFirstMeshlet + aMeshletCount) that may be visible to
+ * 'aIndicesOut', skipping meshlets outside of 'aFrustum' and meshlets facing away from 'aCameraPosition'. The frustum
+ * and camera are in the object space of the meshlets, and 'aIndices' is the index list they were built from.
+ * Returns the number of meshlets kept.
+ */
+size_t cull_meshlets(
+    std::vector<uint32_t>& aIndicesOut, const std::vector<Meshlet>& aMeshlets, size_t aFirstMeshlet, size_t aMeshletCount,
+    const std::vector<uint32_t>& aIndices, const Frustum& aFrustum, const glm::vec3& aCameraPosition
+);
+
+#endif
@@ -0,0 +1,61 @@
+#include "DrawQueue.h"
+#include <algorithm>
+
+static uint64_t clamp_field(uint32_t aValue, uint32_t aBits){
+    const uint64_t max = (uint64_t(1) << aBits) - 1;
+    return(std::min<uint64_t>(aValue, max));
+}
+
+uint64_t DrawKey::pack() const{
+    uint64_t key = clamp_field(pass, PASS_BITS);
+    key = (key << PIPELINE_BITS) | clamp_field(pipeline, PIPELINE_BITS);
+    key = (key << MATERIAL_BITS) | clamp_field(material, MATERIAL_BITS);
+    key = (key << VERTEX_BUFFER_BITS) | clamp_field(vertexBuffer, VERTEX_BUFFER_BITS);
+    key = (key << DEPTH_BITS) | clamp_field(depth, DEPTH_BITS);
+    return(key);
+}
+
+DrawKey DrawKey::unpack(uint64_t aKey){
+    DrawKey result;
+    result.depth = static_cast<uint32_t>(aKey & ((uint64_t(1) << DEPTH_BITS) - 1));
+    aKey >>= DEPTH_BITS;
+    result.vertexBuffer = static_cast<uint32_t>(aKey & ((uint64_t(1) << VERTEX_BUFFER_BITS) - 1));
+    aKey >>= VERTEX_BUFFER_BITS;
+    result.material = static_cast<uint32_t>(aKey & ((uint64_t(1) << MATERIAL_BITS) - 1));
+    aKey >>= MATERIAL_BITS;
+    result.pipeline = static_cast<uint32_t>(aKey & ((uint64_t(1) << PIPELINE_BITS) - 1));
+    aKey >>= PIPELINE_BITS;
+    result.pass = static_cast<uint32_t>(aKey & ((uint64_t(1) << PASS_BITS) - 1));
+    return(result);
+}
+
+uint32_t DrawKey::depthBucket(float aDepth){
+    const float max = static_cast<float>((1U << DEPTH_BITS) - 1);
+    // Also catches NaN, which fails both comparisons
+    if(!(aDepth > 0.0f)) return(0);
+    if(aDepth >= 1.0f) return(static_cast<uint32_t>(max));
+    return(static_cast<uint32_t>(aDepth * max));
+}
+
+void DrawQueue::sort(){
+    if(mPackets.size() < 2) return;
+    mScratch.resize(mPackets.size());
+
+    for(uint32_t shift = 0; shift < 64; shift += 8){
+        size_t offsets[256] = {};
+        for(const Packet& packet : mPackets) ++offsets[(packet.key >> shift) & 0xFF];
+        // Every key has the same byte here, so the order stays as it is
+        if(offsets[(mPackets.front().key >> shift) & 0xFF] == mPackets.size()) continue;
+
+        size_t offset = 0;
+        for(size_t& count : offsets){
+            const size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+        for(const Packet& packet : mPackets){
+            mScratch[offsets[(packet.key >> shift) & 0xFF]++] = packet;
+        }
+        mPackets.swap(mScratch);
+    }
+}
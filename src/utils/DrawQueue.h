@@ -0,0 +1,68 @@
+#ifndef DRAW_QUEUE_H_
+#define DRAW_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** State a draw needs bound, packed into a 64-bit key so that sorting the keys groups draws sharing state.
+ *
+ * From the most significant bits down: the render pass, the pipeline, the material (its descriptor sets), the
+ * vertex buffer and a depth bucket. Changing pipelines costs the most, so draws are grouped by pipeline first, and
+ * draws sharing all state are ordered front to back. The ids are chosen by the caller, values too wide for their
+ * field are clamped to its largest value.
+ */
+struct DrawKey
+{
+    const static uint32_t PASS_BITS = 4;
+    const static uint32_t PIPELINE_BITS = 16;
+    const static uint32_t MATERIAL_BITS = 12;
+    const static uint32_t VERTEX_BUFFER_BITS = 16;
+    const static uint32_t DEPTH_BITS = 16;
+
+    uint32_t pass = 0;
+    uint32_t pipeline = 0;
+    uint32_t material = 0;
+    uint32_t vertexBuffer = 0;
+    uint32_t depth = 0;
+
+    uint64_t pack() const;
+    static DrawKey unpack(uint64_t aKey);
+
+    /// Bucket of a depth from 0 (near) to 1 (far), clamped to that range
+    static uint32_t depthBucket(float aDepth);
+};
+
+/** Draws of a frame in the order of their sort keys, see DrawKey.
+ *
+ * Each packet holds a key and the caller's index of the draw. sort() is an LSD radix sort over the bytes of the key,
+ * linear in the number of draws and stable, so draws with equal keys keep the order they were pushed in. Bytes that
+ * are the same for every key, such as unused fields, are skipped.
+ */
+class DrawQueue
+{
+ public:
+    struct Packet
+    {
+        uint64_t key;
+        uint32_t draw;
+    };
+
+    void clear() {mPackets.clear();}
+    void reserve(size_t aCount) {mPackets.reserve(aCount);}
+    void push(uint64_t aKey, uint32_t aDraw) {mPackets.push_back(Packet{aKey, aDraw});}
+    void push(const DrawKey& aKey, uint32_t aDraw) {push(aKey.pack(), aDraw);}
+
+    void sort();
+
+    size_t size() const {return(mPackets.size());}
+    bool empty() const {return(mPackets.empty());}
+    const std::vector<Packet>& getPackets() const {return(mPackets);}
+
+ protected:
+    std::vector<Packet> mPackets;
+    // Kept between sorts so sorting every frame doesn't allocate
+    std::vector<Packet> mScratch;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "FileWatcher.h"
+#include <sys/stat.h>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#define FILE_WATCHER_USE_INOTIFY
+#endif
+
+static int64_t get_modification_time(const std::string& aFilePath){
+    struct stat fileInfo;
+    if(stat(aFilePath.c_str(), &fileInfo) != 0) return(-1);
+    return(static_cast<int64_t>(fileInfo.st_mtime));
+}
+
+static std::string get_directory(const std::string& aFilePath){
+    size_t separator = aFilePath.find_last_of("/\\");
+    return(separator == std::string::npos ? std::string(".") : aFilePath.substr(0, separator));
+}
+
+FileWatcher::~FileWatcher(){
+    stop();
+}
+
+void FileWatcher::watch(const std::string& aFilePath){
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWatched.insert(aFilePath);
+    mLastModified[aFilePath] = get_modification_time(aFilePath);
+}
+
+void FileWatcher::start(){
+    if(mRunning.load()) return;
+    mRunning = true;
+    mThread = std::thread(&FileWatcher::run, this);
+}
+
+void FileWatcher::stop(){
+    mRunning = false;
+    if(mThread.joinable()){
+        mThread.join();
+    }
+}
+
+std::vector<std::string> FileWatcher::takeChangedFiles(){
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<std::string> changed(mChanged.begin(), mChanged.end());
+    mChanged.clear();
+    return(changed);
+}
+
+void FileWatcher::markChanged(const std::string& aFilePath){
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mWatched.count(aFilePath) > 0){
+        mChanged.insert(aFilePath);
+        mLastModified[aFilePath] = get_modification_time(aFilePath);
+    }
+}
+
+void FileWatcher::run(){
+#ifdef FILE_WATCHER_USE_INOTIFY
+    int notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notifyFd < 0){
+        std::cerr << "Warning: inotify unavailable, falling back to polling for file changes." << std::endl;
+        runPolling();
+        return;
+    }
+
+    // Watch descriptor -> directory path. Directories are added lazily as files are added to the watch list.
+    std::unordered_map<int, std::string> directories;
+    std::set<std::string> watchedDirectories;
+    alignas(struct inotify_event) char buffer[4096];
+
+    while(mRunning.load()){
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for(const std::string& file : mWatched){
+                std::string directory = get_directory(file);
+                if(watchedDirectories.count(directory) > 0) continue;
+                int wd = inotify_add_watch(notifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if(wd >= 0){
+                    directories[wd] = directory;
+                }
+                watchedDirectories.insert(directory);
+            }
+        }
+
+        // Wake up regularly to notice stop() and newly watched files
+        struct pollfd pollInfo = {notifyFd, POLLIN, 0};
+        if(poll(&pollInfo, 1, static_cast<int>(mPollInterval.count())) <= 0) continue;
+
+        ssize_t length = 0;
+        while((length = read(notifyFd, buffer, sizeof(buffer))) > 0){
+            for(char* ptr = buffer; ptr < buffer + length; ){
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                auto directory = directories.find(event->wd);
+                if(event->len > 0 && directory != directories.end()){
+                    markChanged(directory->second + "/" + event->name);
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+
+    close(notifyFd);
+#else
+    runPolling();
+#endif
+}
+
+void FileWatcher::runPolling(){
+    while(mRunning.load()){
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for(const std::string& file : mWatched){
+                int64_t modified = get_modification_time(file);
+                int64_t& lastModified = mLastModified[file];
+                if(modified != lastModified && modified >= 0){
+                    mChanged.insert(file);
+                }
+                lastModified = modified;
+            }
+        }
+        std::this_thread::sleep_for(mPollInterval);
+    }
+}
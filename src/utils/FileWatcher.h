@@ -0,0 +1,55 @@
+#ifndef FILE_WATCHER_H_
+#define FILE_WATCHER_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** Watches a set of files on a background thread and collects the ones that have been rewritten.
+ *
+ * On Linux this uses inotify on the files' directories and only reports a file once the writer has closed it
+ * (or renamed it into place), so half-written files are never reported. Elsewhere it falls back to polling
+ * modification times. Consumers call takeChangedFiles() whenever convenient, e.g. once per frame.
+ */
+class FileWatcher
+{
+ public:
+    explicit FileWatcher(std::chrono::milliseconds aPollInterval = std::chrono::milliseconds(250)) : mPollInterval(aPollInterval) {}
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher& aOther) = delete;
+    FileWatcher& operator=(const FileWatcher& aOther) = delete;
+
+    /// Add a file to the watch list. May be called before or after start(). The file does not need to exist yet.
+    void watch(const std::string& aFilePath);
+
+    void start();
+    void stop();
+
+    bool isRunning() const {return(mRunning.load());}
+
+    /// Paths passed to watch() that changed since the last call, each reported once.
+    std::vector<std::string> takeChangedFiles();
+
+ protected:
+    void run();
+    void runPolling();
+    void markChanged(const std::string& aFilePath);
+
+    const std::chrono::milliseconds mPollInterval;
+
+    std::mutex mMutex;
+    std::set<std::string> mWatched;
+    std::set<std::string> mChanged;
+    std::unordered_map<std::string, int64_t> mLastModified;
+
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+/** Incremental 64-bit FNV-1a hasher.
+ *
+ * Values are fed in one field at a time rather than hashing whole structs so that padding bytes and
+ * pointer members never leak into the result. Only trivially copyable values may be added directly.
+ */
+class Fnv1aHasher
+{
+ public:
+    const static uint64_t OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    const static uint64_t PRIME = 0x100000001b3ULL;
+
+    Fnv1aHasher(uint64_t aSeed = OFFSET_BASIS) : mState(aSeed) {}
+
+    Fnv1aHasher& addBytes(const void* aData, size_t aSize){
+        const uint8_t* bytes = static_cast<const uint8_t*>(aData);
+        for(size_t i = 0; i < aSize; ++i){
+            mState ^= bytes[i];
+            mState *= PRIME;
+        }
+        return(*this);
+    }
+
+    template<typename T>
+    Fnv1aHasher& add(const T& aValue){
+        static_assert(std::is_trivially_copyable<T>::value, "Fnv1aHasher::add() requires a trivially copyable type");
+        return(addBytes(&aValue, sizeof(T)));
+    }
+
+    Fnv1aHasher& add(const std::string& aString){
+        add(aString.size());
+        return(addBytes(aString.data(), aString.size()));
+    }
+
+    Fnv1aHasher& add(const char* aString){
+        return(add(std::string(aString != nullptr ? aString : "")));
+    }
+
+    uint64_t value() const {return(mState);}
+
+ protected:
+    uint64_t mState;
+};
+
+inline uint64_t fnv1a_hash(const void* aData, size_t aSize){
+    return(Fnv1aHasher().addBytes(aData, aSize).value());
+}
+
+/// Mix 'aValue' into 'aSeed'. Order dependent, so combining (a, b) and (b, a) yields different results.
+inline void hash_combine(uint64_t& aSeed, uint64_t aValue){
+    aSeed ^= aValue + 0x9e3779b97f4a7c15ULL + (aSeed << 6) + (aSeed >> 2);
+}
+
+#endif
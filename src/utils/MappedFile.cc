@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& aFilePath){
+    open(aFilePath);
+}
+
+MappedFile::~MappedFile(){
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& aOther){
+    *this = std::move(aOther);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& aOther){
+    if(this == &aOther) return(*this);
+    close();
+    std::swap(mData, aOther.mData);
+    std::swap(mSize, aOther.mSize);
+    std::swap(mPath, aOther.mPath);
+#ifdef _WIN32
+    std::swap(_mFileHandle, aOther._mFileHandle);
+    std::swap(_mMappingHandle, aOther._mMappingHandle);
+#endif
+    return(*this);
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& aFilePath){
+    close();
+    HANDLE file = CreateFileA(aFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE) return(false);
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0){
+        CloseHandle(file);
+        return(false);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr){
+        CloseHandle(file);
+        return(false);
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == nullptr){
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return(false);
+    }
+
+    _mFileHandle = file;
+    _mMappingHandle = mapping;
+    mData = static_cast<const uint8_t*>(view);
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+    mPath = aFilePath;
+    return(true);
+}
+
+void MappedFile::close(){
+    if(mData != nullptr) UnmapViewOfFile(mData);
+    if(_mMappingHandle != nullptr) CloseHandle(_mMappingHandle);
+    if(_mFileHandle != nullptr) CloseHandle(_mFileHandle);
+    _mFileHandle = _mMappingHandle = nullptr;
+    mData = nullptr;
+    mSize = 0;
+    mPath.clear();
+}
+
+#else
+
+bool MappedFile::open(const std::string& aFilePath){
+    close();
+    int fd = ::open(aFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return(false);
+
+    struct stat fileInfo;
+    if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0){
+        ::close(fd);
+        return(false);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapped = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED) return(false);
+
+    mData = static_cast<const uint8_t*>(mapped);
+    mSize = static_cast<size_t>(fileInfo.st_size);
+    mPath = aFilePath;
+    return(true);
+}
+
+void MappedFile::close(){
+    if(mData != nullptr){
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mPath.clear();
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** Read-only memory mapping of a whole file. The mapping is released when the object is destroyed.
+ *
+ * The mapped address is page aligned, so data at any 4 byte aligned offset may be handed directly to APIs
+ * that require aligned words (e.g. SPIR-V) without copying. Movable but not copyable.
+ */
+class MappedFile
+{
+ public:
+    MappedFile(){}
+    explicit MappedFile(const std::string& aFilePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile& aOther) = delete;
+    MappedFile& operator=(const MappedFile& aOther) = delete;
+    MappedFile(MappedFile&& aOther);
+    MappedFile& operator=(MappedFile&& aOther);
+
+    /// Map 'aFilePath', releasing any previous mapping. Returns false if the file could not be mapped.
+    bool open(const std::string& aFilePath);
+    void close();
+
+    bool isValid() const {return(mData != nullptr);}
+    const uint8_t* data() const {return(mData);}
+    size_t size() const {return(mSize);}
+    const std::string& getPath() const {return(mPath);}
+
+ protected:
+    const uint8_t* mData = nullptr;
+    size_t mSize = 0;
+    std::string mPath;
+
+ private:
+#ifdef _WIN32
+    void* _mFileHandle = nullptr;
+    void* _mMappingHandle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,317 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Scoring constants from Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006)
+static const size_t sForsythCacheSize = 32;
+static const float sCacheDecayPower = 1.5f;
+static const float sLastTriangleScore = 0.75f;
+static const float sValenceBoostScale = 2.0f;
+static const float sValenceBoostPower = 0.5f;
+
+static float forsyth_vertex_score(int aCachePosition, uint32_t aRemainingValence){
+    // Vertices without triangles left to draw are irrelevant
+    if(aRemainingValence == 0) return(-1.0f);
+
+    float score = 0.0f;
+    if(aCachePosition >= 0){
+        if(aCachePosition < 3){
+            // Vertices of the triangle just drawn get a fixed score, so the next triangle doesn't favour one of them
+            score = sLastTriangleScore;
+        }else{
+            const float scale = 1.0f / (sForsythCacheSize - 3);
+            score = std::pow(1.0f - (aCachePosition - 3) * scale, sCacheDecayPower);
+        }
+    }
+    // Boost vertices with few triangles left, so they are finished off instead of leaving lone triangles for later
+    score += sValenceBoostScale * std::pow(static_cast<float>(aRemainingValence), -sValenceBoostPower);
+    return(score);
+}
+
+VertexCacheStatistics analyze_vertex_cache(const std::vector<uint32_t>& aIndices, size_t aVertexCount, size_t aCacheSize){
+    VertexCacheStatistics stats;
+    if(aIndices.empty() || aVertexCount == 0) return(stats);
+
+    // A vertex is in the FIFO if fewer than aCacheSize misses happened since it was last loaded
+    std::vector<size_t> loadedAt(aVertexCount, 0);
+    size_t time = aCacheSize + 1;
+    for(uint32_t index : aIndices){
+        if(time - loadedAt[index] > aCacheSize){
+            loadedAt[index] = time++;
+            ++stats.transformedVertices;
+        }
+    }
+
+    size_t uniqueVertices = 0;
+    std::vector<bool> referenced(aVertexCount, false);
+    for(uint32_t index : aIndices){
+        if(!referenced[index]){
+            referenced[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(stats.transformedVertices) / (aIndices.size() / 3);
+    stats.atvr = static_cast<float>(stats.transformedVertices) / uniqueVertices;
+    return(stats);
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& aIndices, size_t aVertexCount){
+    const size_t triangleCount = aIndices.size() / 3;
+    if(triangleCount == 0) return;
+
+    // Triangles adjacent to each vertex. The first remainingValence[v] entries of a vertex are still to be drawn.
+    std::vector<uint32_t> remainingValence(aVertexCount, 0);
+    for(uint32_t index : aIndices){
+        ++remainingValence[index];
+    }
+    std::vector<uint32_t> adjacencyOffsets(aVertexCount + 1, 0);
+    std::partial_sum(remainingValence.begin(), remainingValence.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(aIndices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(size_t i = 0; i < aIndices.size(); ++i){
+            adjacency[fill[aIndices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePositions(aVertexCount, -1);
+    std::vector<float> vertexScores(aVertexCount);
+    for(size_t v = 0; v < aVertexCount; ++v){
+        vertexScores[v] = forsyth_vertex_score(-1, remainingValence[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for(size_t t = 0; t < triangleCount; ++t){
+        triangleScores[t] = vertexScores[aIndices[t * 3]] + vertexScores[aIndices[t * 3 + 1]] + vertexScores[aIndices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(aIndices.size());
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(sForsythCacheSize + 3);
+    nextCache.reserve(sForsythCacheSize + 3);
+
+    int64_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t scanCursor = 0;
+
+    for(size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount){
+        if(bestTriangle < 0){
+            // Nothing in the cache has triangles left. Starting anywhere is as good as anywhere else.
+            while(emitted[scanCursor]) ++scanCursor;
+            bestTriangle = static_cast<int64_t>(scanCursor);
+        }
+
+        const uint32_t* triangle = &aIndices[bestTriangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t vertex = triangle[k];
+            uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* end = begin + remainingValence[vertex];
+            uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+            std::iter_swap(found, end - 1);
+            --remainingValence[vertex];
+        }
+
+        // Most recently used first. Entries past the cache size have just been evicted and are rescored as such.
+        nextCache.clear();
+        for(size_t k = 0; k < 3; ++k){
+            if(std::find(nextCache.begin(), nextCache.end(), triangle[k]) == nextCache.end()) nextCache.push_back(triangle[k]);
+        }
+        for(uint32_t vertex : cache){
+            if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) nextCache.push_back(vertex);
+        }
+        for(size_t i = 0; i < nextCache.size(); ++i){
+            uint32_t vertex = nextCache[i];
+            cachePositions[vertex] = i < sForsythCacheSize ? static_cast<int>(i) : -1;
+            vertexScores[vertex] = forsyth_vertex_score(cachePositions[vertex], remainingValence[vertex]);
+        }
+
+        // Only triangles touching the cache changed score, and the best next triangle is almost always among them
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for(uint32_t vertex : nextCache){
+            for(uint32_t a = 0; a < remainingValence[vertex]; ++a){
+                uint32_t t = adjacency[adjacencyOffsets[vertex] + a];
+                triangleScores[t] = vertexScores[aIndices[t * 3]] + vertexScores[aIndices[t * 3 + 1]] + vertexScores[aIndices[t * 3 + 2]];
+                if(triangleScores[t] > bestScore){
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if(nextCache.size() > sForsythCacheSize) nextCache.resize(sForsythCacheSize);
+        cache.swap(nextCache);
+    }
+
+    aIndices.swap(output);
+}
+
+void optimize_overdraw(std::vector<uint32_t>& aIndices, const float* aPositions, size_t aVertexCount, size_t aPositionStride, float aThreshold){
+    const size_t triangleCount = aIndices.size() / 3;
+    if(triangleCount < 2 || aVertexCount == 0) return;
+
+    auto position = [&](uint32_t aVertex) -> const float* {
+        return(reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(aPositions) + aVertex * aPositionStride));
+    };
+
+    // Split wherever all three vertices of a triangle miss the cache. The cache restarts there regardless of
+    // what came before, so moving the clusters around costs little.
+    const size_t cacheSize = 16;
+    std::vector<size_t> clusterStarts;
+    {
+        std::vector<size_t> loadedAt(aVertexCount, 0);
+        size_t time = cacheSize + 1;
+        for(size_t t = 0; t < triangleCount; ++t){
+            size_t misses = 0;
+            for(size_t k = 0; k < 3; ++k){
+                uint32_t index = aIndices[t * 3 + k];
+                if(time - loadedAt[index] > cacheSize){
+                    loadedAt[index] = time++;
+                    ++misses;
+                }
+            }
+            if(misses == 3 || t == 0) clusterStarts.push_back(t);
+        }
+    }
+    if(clusterStarts.size() < 2) return;
+    clusterStarts.push_back(triangleCount);
+
+    float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+    for(uint32_t index : aIndices){
+        for(size_t c = 0; c < 3; ++c) meshCentroid[c] += position(index)[c];
+    }
+    for(size_t c = 0; c < 3; ++c) meshCentroid[c] /= aIndices.size();
+
+    // Sort key: how far a cluster's centroid lies in front of the mesh center along the cluster's average normal.
+    // Clusters facing outward on the hull come first, since they are the ones that occlude the rest.
+    const size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for(size_t cluster = 0; cluster < clusterCount; ++cluster){
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float totalArea = 0.0f;
+        for(size_t t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; ++t){
+            const float* p0 = position(aIndices[t * 3]);
+            const float* p1 = position(aIndices[t * 3 + 1]);
+            const float* p2 = position(aIndices[t * 3 + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float cross[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+            for(size_t c = 0; c < 3; ++c){
+                // Area weighted, the cross product is already scaled by twice the area
+                centroid[c] += (p0[c] + p1[c] + p2[c]) * area / 3.0f;
+                normal[c] += cross[c];
+            }
+            totalArea += area;
+        }
+
+        float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if(totalArea <= 0.0f || normalLength <= 0.0f){
+            sortKeys[cluster] = 0.0f;
+            continue;
+        }
+        float key = 0.0f;
+        for(size_t c = 0; c < 3; ++c){
+            key += (centroid[c] / totalArea - meshCentroid[c]) * normal[c] / normalLength;
+        }
+        sortKeys[cluster] = key;
+    }
+
+    std::vector<size_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](size_t aLeft, size_t aRight){
+        return(sortKeys[aLeft] > sortKeys[aRight]);
+    });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(aIndices.size());
+    for(size_t cluster : clusterOrder){
+        sorted.insert(sorted.end(), aIndices.begin() + clusterStarts[cluster] * 3, aIndices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+
+    float before = analyze_vertex_cache(aIndices, aVertexCount, cacheSize).acmr;
+    float after = analyze_vertex_cache(sorted, aVertexCount, cacheSize).acmr;
+    if(after <= before * aThreshold){
+        aIndices.swap(sorted);
+    }
+}
+
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& aRemapOut, const std::vector<uint32_t>& aIndices, size_t aVertexCount){
+    aRemapOut.assign(aVertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+    for(uint32_t index : aIndices){
+        if(aRemapOut[index] == UINT32_MAX){
+            aRemapOut[index] = nextVertex++;
+        }
+    }
+    return(nextVertex);
+}
+
+std::vector<IndexChunk> split_index_chunks(
+    const std::vector<uint32_t>& aIndices, size_t aVertexCount,
+    std::vector<uint16_t>& aLocalIndicesOut, std::vector<uint32_t>& aVertexSourceOut, size_t aMaxChunkVertices
+){
+    std::vector<IndexChunk> chunks;
+    aLocalIndicesOut.clear();
+    aVertexSourceOut.clear();
+    if(aIndices.empty()) return(chunks);
+    aMaxChunkVertices = std::min<size_t>(aMaxChunkVertices, 0x10000);
+
+    if(aVertexCount <= aMaxChunkVertices){
+        // Everything fits, so skip the duplication and keep the existing vertex order
+        IndexChunk chunk;
+        chunk.indexCount = static_cast<uint32_t>(aIndices.size());
+        chunk.vertexCount = static_cast<uint32_t>(aVertexCount);
+        chunks.push_back(chunk);
+        aLocalIndicesOut.assign(aIndices.begin(), aIndices.end());
+        aVertexSourceOut.resize(aVertexCount);
+        std::iota(aVertexSourceOut.begin(), aVertexSourceOut.end(), 0);
+        return(chunks);
+    }
+
+    aLocalIndicesOut.reserve(aIndices.size());
+    std::vector<uint32_t> localIndex(aVertexCount, UINT32_MAX);
+    std::vector<uint32_t> chunkVertices;
+
+    IndexChunk chunk;
+    auto closeChunk = [&](){
+        chunk.indexCount = static_cast<uint32_t>(aLocalIndicesOut.size()) - chunk.firstIndex;
+        chunk.vertexCount = static_cast<uint32_t>(chunkVertices.size());
+        chunks.push_back(chunk);
+        for(uint32_t vertex : chunkVertices) localIndex[vertex] = UINT32_MAX;
+        chunkVertices.clear();
+        chunk.firstIndex = static_cast<uint32_t>(aLocalIndicesOut.size());
+        chunk.vertexOffset = static_cast<int32_t>(aVertexSourceOut.size());
+    };
+
+    for(size_t t = 0; t + 2 < aIndices.size(); t += 3){
+        const uint32_t* triangle = &aIndices[t];
+        size_t newVertices = 0;
+        for(size_t k = 0; k < 3; ++k){
+            bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+            if(localIndex[triangle[k]] == UINT32_MAX && !repeated) ++newVertices;
+        }
+        if(chunkVertices.size() + newVertices > aMaxChunkVertices){
+            closeChunk();
+        }
+
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t vertex = triangle[k];
+            if(localIndex[vertex] == UINT32_MAX){
+                localIndex[vertex] = static_cast<uint32_t>(chunkVertices.size());
+                chunkVertices.push_back(vertex);
+                aVertexSourceOut.push_back(vertex);
+            }
+            aLocalIndicesOut.push_back(static_cast<uint16_t>(localIndex[vertex]));
+        }
+    }
+    closeChunk();
+    return(chunks);
+}
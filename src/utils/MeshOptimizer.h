@@ -0,0 +1,90 @@
+#ifndef MESH_OPTIMIZER_H_
+#define MESH_OPTIMIZER_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Reordering passes for indexed triangle lists. None of them change what is drawn, only the order it is drawn in.
+ *
+ * The passes are meant to run in this order, since each one relies on the previous one's output:
+ *
+ *     optimize_vertex_cache(indices, vertexCount);                       // Triangle order for post-transform cache hits
+ *     optimize_overdraw(indices, positions, vertexCount, stride);        // Coarse front to back order of triangle clusters
+ *     size_t unique = optimize_vertex_fetch_remap(remap, indices, vertexCount);
+ *     remap_vertices(vertices, indices, remap, unique);                  // Vertex order for memory locality when fetching
+ */
+
+struct VertexCacheStatistics
+{
+    size_t transformedVertices = 0;
+    // Average cache miss ratio, transformed vertices per triangle. Ranges from ~0.5 on large regular grids to 3.
+    float acmr = 0.0f;
+    // Average transformed to vertex ratio, transformed vertices per unique vertex. 1.0 is ideal.
+    float atvr = 0.0f;
+};
+
+/// Simulate a FIFO post-transform cache holding 'aCacheSize' vertices over the triangle list.
+VertexCacheStatistics analyze_vertex_cache(const std::vector<uint32_t>& aIndices, size_t aVertexCount, size_t aCacheSize = 16);
+
+/// Reorder triangles for vertex cache locality using Tom Forsyth's linear-speed vertex cache optimization.
+void optimize_vertex_cache(std::vector<uint32_t>& aIndices, size_t aVertexCount);
+
+/** Reorder clusters of a cache optimized triangle list so that outward facing clusters on the hull of the mesh are
+ * drawn first, which lets early depth testing reject more of the triangles behind them from any view direction.
+ * Clusters are split where the cache would restart anyway. The new order is discarded if it would raise the ACMR
+ * by more than 'aThreshold'. 'aPositionStride' is the distance in bytes between consecutive positions.
+ */
+void optimize_overdraw(std::vector<uint32_t>& aIndices, const float* aPositions, size_t aVertexCount, size_t aPositionStride, float aThreshold = 1.05f);
+
+/// Compute a table mapping each vertex to its position in order of first use by aIndices. Unreferenced vertices
+/// map to UINT32_MAX. Returns the number of referenced vertices.
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& aRemapOut, const std::vector<uint32_t>& aIndices, size_t aVertexCount);
+
+/// Range of an index list drawn with its own vertex offset, see split_index_chunks()
+struct IndexChunk
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+};
+
+/** Split a triangle list into chunks that each reference at most 'aMaxChunkVertices' vertices, so that every chunk
+ * can be drawn with 16 bit indices relative to its own vertexOffset. Triangle order is preserved.
+ *
+ * aLocalIndicesOut receives the chunk relative indices. Vertices are laid out chunk after chunk in order of first
+ * use, and aVertexSourceOut receives the original vertex for each of them; vertices used by several chunks are
+ * duplicated. A mesh that fits into one chunk keeps its vertex order unchanged. The default limit keeps 0xFFFF
+ * free, since it is the primitive restart index.
+ */
+std::vector<IndexChunk> split_index_chunks(
+    const std::vector<uint32_t>& aIndices, size_t aVertexCount,
+    std::vector<uint16_t>& aLocalIndicesOut, std::vector<uint32_t>& aVertexSourceOut, size_t aMaxChunkVertices = 0xFFFF
+);
+
+/// Apply a remap table from optimize_vertex_fetch_remap() to a vertex array and the indices into it.
+template<typename VertexType>
+void remap_vertices(std::vector<VertexType>& aVertices, std::vector<uint32_t>& aIndices, const std::vector<uint32_t>& aRemap, size_t aNewVertexCount){
+    std::vector<VertexType> remapped(aNewVertexCount);
+    for(size_t i = 0; i < aVertices.size(); ++i){
+        if(aRemap[i] != UINT32_MAX) remapped[aRemap[i]] = aVertices[i];
+    }
+    for(uint32_t& index : aIndices){
+        index = aRemap[index];
+    }
+    aVertices.swap(remapped);
+}
+
+/// Build the vertex array for split_index_chunks() output from the original vertices
+template<typename VertexType>
+std::vector<VertexType> gather_vertices(const std::vector<VertexType>& aVertices, const std::vector<uint32_t>& aVertexSource){
+    std::vector<VertexType> gathered;
+    gathered.reserve(aVertexSource.size());
+    for(uint32_t source : aVertexSource){
+        gathered.push_back(aVertices[source]);
+    }
+    return(gathered);
+}
+
+#endif
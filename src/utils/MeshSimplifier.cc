@@ -0,0 +1,551 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+// Weight of the planes that hold borders and seams in place, relative to the area weighted planes of triangles
+static const double sBorderWeight = 10.0;
+// Collapses may turn a triangle by at most ~75 degrees
+static const double sMinNormalCosine = 0.25;
+// Seams between normals more than 60 degrees apart are hard edges, which are kept when simplifying with normals
+static const double sHardSeamCosine = 0.5;
+
+// Types local to this file
+namespace {
+
+struct Point
+{
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+};
+
+static Point sub(const Point& aLeft, const Point& aRight){
+    Point result;
+    result.x = aLeft.x - aRight.x;
+    result.y = aLeft.y - aRight.y;
+    result.z = aLeft.z - aRight.z;
+    return(result);
+}
+
+static Point cross(const Point& aLeft, const Point& aRight){
+    Point result;
+    result.x = aLeft.y * aRight.z - aLeft.z * aRight.y;
+    result.y = aLeft.z * aRight.x - aLeft.x * aRight.z;
+    result.z = aLeft.x * aRight.y - aLeft.y * aRight.x;
+    return(result);
+}
+
+static double dot(const Point& aLeft, const Point& aRight){
+    return(aLeft.x * aRight.x + aLeft.y * aRight.y + aLeft.z * aRight.z);
+}
+
+// Sum of weighted squared distances to a set of planes, as the upper triangle of a symmetric 4x4 matrix
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+};
+
+// Plane through 'aPoint' with the unit normal 'aNormal'
+static Quadric plane_quadric(const Point& aNormal, const Point& aPoint, double aWeight){
+    const double d = -dot(aNormal, aPoint);
+    Quadric q;
+    q.a00 = aWeight * aNormal.x * aNormal.x;
+    q.a01 = aWeight * aNormal.x * aNormal.y;
+    q.a02 = aWeight * aNormal.x * aNormal.z;
+    q.a11 = aWeight * aNormal.y * aNormal.y;
+    q.a12 = aWeight * aNormal.y * aNormal.z;
+    q.a22 = aWeight * aNormal.z * aNormal.z;
+    q.b0 = aWeight * aNormal.x * d;
+    q.b1 = aWeight * aNormal.y * d;
+    q.b2 = aWeight * aNormal.z * d;
+    q.c = aWeight * d * d;
+    q.weight = aWeight;
+    return(q);
+}
+
+static void add_quadric(Quadric& aTo, const Quadric& aFrom){
+    aTo.a00 += aFrom.a00; aTo.a01 += aFrom.a01; aTo.a02 += aFrom.a02;
+    aTo.a11 += aFrom.a11; aTo.a12 += aFrom.a12; aTo.a22 += aFrom.a22;
+    aTo.b0 += aFrom.b0; aTo.b1 += aFrom.b1; aTo.b2 += aFrom.b2;
+    aTo.c += aFrom.c;
+    aTo.weight += aFrom.weight;
+}
+
+// Weighted mean squared distance of 'aPoint' to the planes of the quadric
+static double quadric_error(const Quadric& aQuadric, const Point& aPoint){
+    const Point& p = aPoint;
+    const Quadric& q = aQuadric;
+    double error = p.x * (q.a00 * p.x + q.a01 * p.y + q.a02 * p.z)
+                 + p.y * (q.a01 * p.x + q.a11 * p.y + q.a12 * p.z)
+                 + p.z * (q.a02 * p.x + q.a12 * p.y + q.a22 * p.z)
+                 + 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+    return(std::fabs(error) / (q.weight > 0.0 ? q.weight : 1.0));
+}
+
+static uint64_t edge_key(uint32_t aFirst, uint32_t aSecond){
+    return(aFirst < aSecond ? (uint64_t(aFirst) << 32) | aSecond : (uint64_t(aSecond) << 32) | aFirst);
+}
+
+// Edges between two points of the surface, classified by the triangles sharing them
+struct EdgeInfo
+{
+    // edge_key() of the two points, or UINT64_MAX for an empty slot of an EdgeTable
+    uint64_t key = UINT64_MAX;
+    uint32_t triangles = 0;
+    // Vertices of the first triangle on the edge, ordered by point
+    uint64_t vertices = 0;
+    bool seam = false;
+};
+
+// Open addressing hash table of edges. Unlike std::unordered_map it doesn't allocate per edge, which matters since
+// the edges are classified again after every pass.
+class EdgeTable
+{
+ public:
+    /// Empty the table and make room for at least 'aMaxEdges'
+    void reset(size_t aMaxEdges){
+        size_t capacity = 16;
+        mShift = 60;
+        while(capacity < aMaxEdges + aMaxEdges / 4){
+            capacity *= 2;
+            --mShift;
+        }
+        mSlots.assign(capacity, EdgeInfo());
+    }
+
+    EdgeInfo& insert(uint64_t aKey){
+        size_t slot = home(aKey);
+        while(mSlots[slot].key != aKey && mSlots[slot].key != UINT64_MAX) slot = (slot + 1) & (mSlots.size() - 1);
+        mSlots[slot].key = aKey;
+        return(mSlots[slot]);
+    }
+
+    const EdgeInfo& find(uint64_t aKey) const{
+        static const EdgeInfo sMissing;
+        size_t slot = home(aKey);
+        while(mSlots[slot].key != aKey){
+            if(mSlots[slot].key == UINT64_MAX) return(sMissing);
+            slot = (slot + 1) & (mSlots.size() - 1);
+        }
+        return(mSlots[slot]);
+    }
+
+    /// Every slot, including empty ones
+    const std::vector<EdgeInfo>& slots() const {return(mSlots);}
+
+ private:
+    size_t home(uint64_t aKey) const {return(static_cast<size_t>((aKey * 0x9E3779B97F4A7C15ull) >> mShift));}
+
+    std::vector<EdgeInfo> mSlots;
+    int mShift = 60;
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+class Simplifier
+{
+ public:
+    Simplifier(
+        const std::vector<uint32_t>& aIndices, const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+        const float* aNormals, size_t aNormalStride
+    );
+
+    float run(size_t aTargetIndexCount, float aTargetError);
+    void output(std::vector<uint32_t>& aIndicesOut) const;
+
+ private:
+    void weldPositions(const float* aPositions, size_t aVertexCount, size_t aPositionStride);
+    void classifyEdges();
+    void buildAdjacency();
+    void computeQuadrics();
+    bool canCollapseAlong(uint32_t aFrom, const EdgeInfo& aEdge) const;
+    bool tryCollapse(uint32_t aFrom, uint32_t aTo);
+    bool mapVertex(uint32_t aFromVertex, uint32_t aToVertex);
+    uint32_t closestNormal(uint32_t aVertex, uint32_t aPoint) const;
+    double normalCosine(uint32_t aFirst, uint32_t aSecond) const;
+
+    uint32_t cornerPoint(size_t aTriangle, size_t aCorner) const {return(mWeld[mTriangles[aTriangle * 3 + aCorner]]);}
+
+    // Vertex to the point of the surface at its position, and the positions of those points
+    std::vector<uint32_t> mWeld;
+    std::vector<Point> mPoints;
+    // Vertices of each point are mPointVertices[mPointStart[point]] up to the start of the next point
+    std::vector<uint32_t> mPointVertices;
+    std::vector<uint32_t> mPointStart;
+    const uint8_t* mNormals = nullptr;
+    size_t mNormalStride = 0;
+    std::vector<Quadric> mQuadrics;
+
+    std::vector<uint32_t> mTriangles;
+    std::vector<bool> mAlive;
+    size_t mLiveTriangles = 0;
+
+    EdgeTable mEdges;
+    std::vector<std::vector<uint32_t>> mPointTriangles;
+    std::vector<uint8_t> mBorderEdges;
+    std::vector<uint8_t> mSeamEdges;
+    std::vector<bool> mLocked;
+
+    // Scratch space of tryCollapse()
+    std::vector<uint32_t> mNeighbourMark;
+    uint32_t mMarkStamp = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> mVertexMap;
+};
+
+Simplifier::Simplifier(
+    const std::vector<uint32_t>& aIndices, const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+    const float* aNormals, size_t aNormalStride
+) : mNormals(reinterpret_cast<const uint8_t*>(aNormals)), mNormalStride(aNormalStride) {
+    weldPositions(aPositions, aVertexCount, aPositionStride);
+
+    // Triangles with two corners at the same position have no area and are dropped right away
+    mTriangles.reserve(aIndices.size());
+    for(size_t t = 0; t + 2 < aIndices.size(); t += 3){
+        uint32_t a = mWeld[aIndices[t]], b = mWeld[aIndices[t + 1]], c = mWeld[aIndices[t + 2]];
+        if(a == b || b == c || a == c) continue;
+        mTriangles.insert(mTriangles.end(), &aIndices[t], &aIndices[t] + 3);
+    }
+    mLiveTriangles = mTriangles.size() / 3;
+    mAlive.assign(mLiveTriangles, true);
+
+    mNeighbourMark.assign(mPoints.size(), 0);
+    classifyEdges();
+    computeQuadrics();
+}
+
+void Simplifier::weldPositions(const float* aPositions, size_t aVertexCount, size_t aPositionStride){
+    auto position = [&](uint32_t aVertex){
+        return(reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(aPositions) + aVertex * aPositionStride));
+    };
+
+    // Sorting by the bits of the position brings vertices at exactly the same position together
+    std::vector<uint32_t> order(aVertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t aLeft, uint32_t aRight){
+        int compared = memcmp(position(aLeft), position(aRight), 3 * sizeof(float));
+        return(compared != 0 ? compared < 0 : aLeft < aRight);
+    });
+
+    mWeld.assign(aVertexCount, 0);
+    for(size_t i = 0; i < order.size(); ++i){
+        if(i == 0 || memcmp(position(order[i - 1]), position(order[i]), 3 * sizeof(float)) != 0){
+            const float* p = position(order[i]);
+            Point point;
+            point.x = p[0];
+            point.y = p[1];
+            point.z = p[2];
+            mPoints.push_back(point);
+            mPointStart.push_back(static_cast<uint32_t>(i));
+        }
+        mWeld[order[i]] = static_cast<uint32_t>(mPoints.size() - 1);
+    }
+    mPointStart.push_back(static_cast<uint32_t>(order.size()));
+    mPointVertices.swap(order);
+}
+
+double Simplifier::normalCosine(uint32_t aFirst, uint32_t aSecond) const{
+    const float* first = reinterpret_cast<const float*>(mNormals + aFirst * mNormalStride);
+    const float* second = reinterpret_cast<const float*>(mNormals + aSecond * mNormalStride);
+    return(double(first[0]) * second[0] + double(first[1]) * second[1] + double(first[2]) * second[2]);
+}
+
+uint32_t Simplifier::closestNormal(uint32_t aVertex, uint32_t aPoint) const{
+    uint32_t closest = mPointVertices[mPointStart[aPoint]];
+    double closestCosine = -DBL_MAX;
+    for(uint32_t i = mPointStart[aPoint]; i < mPointStart[aPoint + 1]; ++i){
+        double cosine = normalCosine(aVertex, mPointVertices[i]);
+        if(cosine > closestCosine){
+            closest = mPointVertices[i];
+            closestCosine = cosine;
+        }
+    }
+    return(closest);
+}
+
+void Simplifier::classifyEdges(){
+    mEdges.reset(mLiveTriangles * 3);
+    for(size_t t = 0; t < mAlive.size(); ++t){
+        if(!mAlive[t]) continue;
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t a = cornerPoint(t, k), b = cornerPoint(t, (k + 1) % 3);
+            uint32_t va = mTriangles[t * 3 + k], vb = mTriangles[t * 3 + (k + 1) % 3];
+            uint64_t vertices = a < b ? (uint64_t(va) << 32) | vb : (uint64_t(vb) << 32) | va;
+
+            EdgeInfo& edge = mEdges.insert(edge_key(a, b));
+            if(edge.triangles++ == 0){
+                edge.vertices = vertices;
+            }else if(edge.vertices != vertices){
+                // The triangles on either side use different vertices at the same positions
+                uint32_t first = static_cast<uint32_t>(edge.vertices >> 32), second = static_cast<uint32_t>(edge.vertices);
+                edge.seam = edge.seam || mNormals == nullptr
+                    || normalCosine(first, static_cast<uint32_t>(vertices >> 32)) < sHardSeamCosine
+                    || normalCosine(second, static_cast<uint32_t>(vertices)) < sHardSeamCosine;
+            }
+        }
+    }
+
+    mBorderEdges.assign(mPoints.size(), 0);
+    mSeamEdges.assign(mPoints.size(), 0);
+    mLocked.assign(mPoints.size(), false);
+    for(const EdgeInfo& edge : mEdges.slots()){
+        if(edge.key == UINT64_MAX) continue;
+        uint32_t a = static_cast<uint32_t>(edge.key >> 32), b = static_cast<uint32_t>(edge.key);
+        if(edge.triangles > 2){
+            mLocked[a] = mLocked[b] = true;
+        }else if(edge.triangles == 1){
+            mBorderEdges[a] = static_cast<uint8_t>(std::min(mBorderEdges[a] + 1, 255));
+            mBorderEdges[b] = static_cast<uint8_t>(std::min(mBorderEdges[b] + 1, 255));
+        }else if(edge.seam){
+            mSeamEdges[a] = static_cast<uint8_t>(std::min(mSeamEdges[a] + 1, 255));
+            mSeamEdges[b] = static_cast<uint8_t>(std::min(mSeamEdges[b] + 1, 255));
+        }
+    }
+
+    // Points where borders or seams meet, branch or end can't move without changing their outline
+    for(size_t p = 0; p < mPoints.size(); ++p){
+        bool border = mBorderEdges[p] != 0, seam = mSeamEdges[p] != 0;
+        if((border && mBorderEdges[p] != 2) || (seam && mSeamEdges[p] != 2) || (border && seam)) mLocked[p] = true;
+    }
+}
+
+void Simplifier::buildAdjacency(){
+    for(std::vector<uint32_t>& triangles : mPointTriangles) triangles.clear();
+    mPointTriangles.resize(mPoints.size());
+    for(size_t t = 0; t < mAlive.size(); ++t){
+        if(!mAlive[t]) continue;
+        for(size_t k = 0; k < 3; ++k) mPointTriangles[cornerPoint(t, k)].push_back(static_cast<uint32_t>(t));
+    }
+}
+
+void Simplifier::computeQuadrics(){
+    mQuadrics.assign(mPoints.size(), Quadric());
+    for(size_t t = 0; t < mAlive.size(); ++t){
+        const Point& a = mPoints[cornerPoint(t, 0)];
+        Point normal = cross(sub(mPoints[cornerPoint(t, 1)], a), sub(mPoints[cornerPoint(t, 2)], a));
+        double length = std::sqrt(dot(normal, normal));
+        if(length == 0.0) continue;
+
+        // Weighted by area, so large triangles hold their vertices in place more firmly than small ones
+        Point unit;
+        unit.x = normal.x / length;
+        unit.y = normal.y / length;
+        unit.z = normal.z / length;
+        Quadric q = plane_quadric(unit, a, length * 0.5);
+        for(size_t k = 0; k < 3; ++k) add_quadric(mQuadrics[cornerPoint(t, k)], q);
+
+        // Borders and seams get a plane through the edge, perpendicular to the triangle, which keeps vertices
+        // on them from sliding away from the edge
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t from = cornerPoint(t, k), to = cornerPoint(t, (k + 1) % 3);
+            const EdgeInfo& edge = mEdges.find(edge_key(from, to));
+            if(edge.triangles != 1 && !edge.seam) continue;
+
+            Point direction = sub(mPoints[to], mPoints[from]);
+            Point side = cross(direction, unit);
+            double sideLength = std::sqrt(dot(side, side));
+            if(sideLength == 0.0) continue;
+            side.x /= sideLength;
+            side.y /= sideLength;
+            side.z /= sideLength;
+            Quadric constraint = plane_quadric(side, mPoints[from], dot(direction, direction) * sBorderWeight);
+            add_quadric(mQuadrics[from], constraint);
+            add_quadric(mQuadrics[to], constraint);
+        }
+    }
+}
+
+bool Simplifier::canCollapseAlong(uint32_t aFrom, const EdgeInfo& aEdge) const{
+    if(mLocked[aFrom] || aEdge.triangles > 2) return(false);
+    // Points on a border or seam may only slide along it
+    if(mBorderEdges[aFrom] != 0) return(aEdge.triangles == 1);
+    if(mSeamEdges[aFrom] != 0) return(aEdge.seam);
+    return(true);
+}
+
+bool Simplifier::tryCollapse(uint32_t aFrom, uint32_t aTo){
+    const std::vector<uint32_t>& fromTriangles = mPointTriangles[aFrom];
+
+    // Each vertex at aFrom moves to the vertex at aTo it shares a triangle with, so the attributes on either side
+    // of a seam stay apart. Vertices without such a triangle are handled below.
+    mVertexMap.clear();
+    uint32_t edgeTriangles = 0;
+    for(uint32_t t : fromTriangles){
+        if(!mAlive[t]) continue;
+        uint32_t fromVertex = UINT32_MAX, toVertex = UINT32_MAX;
+        for(size_t k = 0; k < 3; ++k){
+            if(cornerPoint(t, k) == aFrom) fromVertex = mTriangles[t * 3 + k];
+            if(cornerPoint(t, k) == aTo) toVertex = mTriangles[t * 3 + k];
+        }
+        if(toVertex == UINT32_MAX) continue;
+        ++edgeTriangles;
+        if(!mapVertex(fromVertex, toVertex)) return(false);
+    }
+    if(edgeTriangles == 0) return(false);
+
+    // The collapse must not join the surface to itself anywhere but along the edge, which is the case if the two
+    // points share no neighbours other than the corners opposite the edge
+    if(++mMarkStamp == 0){
+        std::fill(mNeighbourMark.begin(), mNeighbourMark.end(), 0);
+        mMarkStamp = 1;
+    }
+    for(uint32_t t : mPointTriangles[aTo]){
+        if(!mAlive[t]) continue;
+        for(size_t k = 0; k < 3; ++k) mNeighbourMark[cornerPoint(t, k)] = mMarkStamp;
+    }
+    const uint32_t countedStamp = ++mMarkStamp;
+    uint32_t sharedNeighbours = 0;
+    for(uint32_t t : fromTriangles){
+        if(!mAlive[t]) continue;
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t point = cornerPoint(t, k);
+            if(point == aFrom || point == aTo || mNeighbourMark[point] != countedStamp - 1) continue;
+            mNeighbourMark[point] = countedStamp;
+            ++sharedNeighbours;
+        }
+    }
+    if(sharedNeighbours > edgeTriangles) return(false);
+
+    for(uint32_t t : fromTriangles){
+        if(!mAlive[t]) continue;
+        size_t fromCorner = 3;
+        bool onEdge = false;
+        for(size_t k = 0; k < 3; ++k){
+            if(cornerPoint(t, k) == aFrom) fromCorner = k;
+            if(cornerPoint(t, k) == aTo) onEdge = true;
+        }
+        if(onEdge) continue;
+
+        // Without normals to go by, a vertex that shares no triangle with aTo has nowhere to go
+        uint32_t fromVertex = mTriangles[t * 3 + fromCorner];
+        bool mapped = false;
+        for(const std::pair<uint32_t, uint32_t>& entry : mVertexMap) mapped = mapped || entry.first == fromVertex;
+        if(!mapped && mNormals == nullptr) return(false);
+        if(!mapped) mVertexMap.emplace_back(fromVertex, closestNormal(fromVertex, aTo));
+
+        // Reject collapses that turn a triangle too far, or fold it over
+        const Point& b = mPoints[cornerPoint(t, (fromCorner + 1) % 3)];
+        const Point& c = mPoints[cornerPoint(t, (fromCorner + 2) % 3)];
+        Point before = cross(sub(b, mPoints[aFrom]), sub(c, mPoints[aFrom]));
+        Point after = cross(sub(b, mPoints[aTo]), sub(c, mPoints[aTo]));
+        if(dot(before, after) <= sMinNormalCosine * std::sqrt(dot(before, before) * dot(after, after))) return(false);
+    }
+
+    for(uint32_t t : fromTriangles){
+        if(!mAlive[t]) continue;
+        bool onEdge = false;
+        for(size_t k = 0; k < 3; ++k) onEdge = onEdge || cornerPoint(t, k) == aTo;
+        if(onEdge){
+            mAlive[t] = false;
+            --mLiveTriangles;
+            continue;
+        }
+        for(size_t k = 0; k < 3; ++k){
+            uint32_t& vertex = mTriangles[t * 3 + k];
+            if(mWeld[vertex] != aFrom) continue;
+            for(const std::pair<uint32_t, uint32_t>& entry : mVertexMap){
+                if(entry.first == vertex){
+                    vertex = entry.second;
+                    break;
+                }
+            }
+        }
+        mPointTriangles[aTo].push_back(t);
+    }
+    mPointTriangles[aFrom].clear();
+    add_quadric(mQuadrics[aTo], mQuadrics[aFrom]);
+    return(true);
+}
+
+bool Simplifier::mapVertex(uint32_t aFromVertex, uint32_t aToVertex){
+    for(std::pair<uint32_t, uint32_t>& mapped : mVertexMap){
+        if(mapped.first != aFromVertex || mapped.second == aToVertex) continue;
+        // The vertex borders different vertices at aTo on either side of the edge, which only soft seams allow
+        if(mNormals == nullptr) return(false);
+        if(normalCosine(aFromVertex, aToVertex) > normalCosine(aFromVertex, mapped.second)) mapped.second = aToVertex;
+        return(true);
+    }
+    mVertexMap.emplace_back(aFromVertex, aToVertex);
+    return(true);
+}
+
+float Simplifier::run(size_t aTargetIndexCount, float aTargetError){
+    const size_t targetTriangles = aTargetIndexCount / 3;
+    const double maxError = aTargetError < FLT_MAX ? double(aTargetError) * aTargetError : DBL_MAX;
+    double largestError = 0.0;
+
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched;
+    while(mLiveTriangles > targetTriangles){
+        buildAdjacency();
+
+        // Every allowed direction of every edge, cheapest first
+        collapses.clear();
+        for(const EdgeInfo& edge : mEdges.slots()){
+            if(edge.key == UINT64_MAX) continue;
+            uint32_t a = static_cast<uint32_t>(edge.key >> 32), b = static_cast<uint32_t>(edge.key);
+            bool forward = canCollapseAlong(a, edge), backward = canCollapseAlong(b, edge);
+            if(!forward && !backward) continue;
+            Quadric merged = mQuadrics[a];
+            add_quadric(merged, mQuadrics[b]);
+            if(forward) collapses.push_back(Collapse{a, b, quadric_error(merged, mPoints[b])});
+            if(backward) collapses.push_back(Collapse{b, a, quadric_error(merged, mPoints[a])});
+        }
+        if(collapses.empty()) break;
+
+        // A pass never needs more than a few candidates per triangle still to remove, so only those are sorted
+        auto cheaper = [](const Collapse& aLeft, const Collapse& aRight){return(aLeft.error < aRight.error);};
+        size_t sortedCount = std::min(collapses.size(), (mLiveTriangles - targetTriangles) * 4 + 64);
+        std::nth_element(collapses.begin(), collapses.begin() + (sortedCount - 1), collapses.end(), cheaper);
+        collapses.resize(sortedCount);
+        std::sort(collapses.begin(), collapses.end(), cheaper);
+
+        // Each point takes part in at most one collapse per pass, since the errors of the others are stale after it
+        touched.assign(mPoints.size(), false);
+        size_t collapsed = 0;
+        for(const Collapse& collapse : collapses){
+            if(mLiveTriangles <= targetTriangles || collapse.error > maxError) break;
+            if(touched[collapse.from] || touched[collapse.to]) continue;
+            if(!tryCollapse(collapse.from, collapse.to)) continue;
+            touched[collapse.from] = touched[collapse.to] = true;
+            largestError = std::max(largestError, collapse.error);
+            ++collapsed;
+        }
+        if(collapsed == 0) break;
+        classifyEdges();
+    }
+    return(static_cast<float>(std::sqrt(largestError)));
+}
+
+void Simplifier::output(std::vector<uint32_t>& aIndicesOut) const{
+    aIndicesOut.clear();
+    aIndicesOut.reserve(mLiveTriangles * 3);
+    for(size_t t = 0; t < mAlive.size(); ++t){
+        if(mAlive[t]) aIndicesOut.insert(aIndicesOut.end(), &mTriangles[t * 3], &mTriangles[t * 3] + 3);
+    }
+}
+
+} // namespace
+
+float simplify_mesh(
+    std::vector<uint32_t>& aIndicesOut, const std::vector<uint32_t>& aIndices,
+    const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+    size_t aTargetIndexCount, float aTargetError, const float* aNormals, size_t aNormalStride
+){
+    if(aIndices.size() <= aTargetIndexCount || aVertexCount == 0){
+        aIndicesOut = aIndices;
+        return(0.0f);
+    }
+    Simplifier simplifier(aIndices, aPositions, aVertexCount, aPositionStride, aNormals, aNormalStride);
+    float error = simplifier.run(aTargetIndexCount, aTargetError);
+    simplifier.output(aIndicesOut);
+    return(error);
+}
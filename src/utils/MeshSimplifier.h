@@ -0,0 +1,49 @@
+#ifndef MESH_SIMPLIFIER_H_
+#define MESH_SIMPLIFIER_H_
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Reduce the triangle count of an indexed triangle list by collapsing edges, picking the collapses that change
+ * the surface least according to the quadric error metric (Garland and Heckbert, "Surface Simplification Using
+ * Quadric Error Metrics", 1997). Vertices only ever collapse onto one of their neighbours, so the vertex array is
+ * left untouched and the simplified indices refer to the same vertices as the input.
+ *
+ * Vertices sharing a position are treated as one point of the surface. An edge between two such points whose
+ * triangles use different vertices on either side is an attribute seam and is kept intact along with open borders
+ * of the mesh. Given 'aNormals', only seams where the normals differ by more than 60 degrees are kept, so faceted
+ * meshes can still be simplified; vertices on the softer seams move to the vertex with the closest normal at the
+ * point they collapse onto. Collapses that would flip a triangle are rejected.
+ *
+ * Stops once the index count is at most 'aTargetIndexCount', or when the next collapse would move the surface
+ * further than 'aTargetError'. Returns the largest error of any collapse made, an object space distance.
+ */
+float simplify_mesh(
+    std::vector<uint32_t>& aIndicesOut, const std::vector<uint32_t>& aIndices,
+    const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+    size_t aTargetIndexCount, float aTargetError = FLT_MAX,
+    const float* aNormals = nullptr, size_t aNormalStride = 0
+);
+
+/// Size in pixels of an object space error 'aError' at 'aDistance' from the camera. 'aPixelsPerUnit' is the
+/// height of the viewport in pixels over the height of the view frustum at distance 1.
+inline float projected_error(float aError, float aDistance, float aPixelsPerUnit){
+    return(aError * aPixelsPerUnit / std::fmax(aDistance, FLT_MIN));
+}
+
+/// Index of the coarsest level of detail whose projected error stays below 'aMaxPixelError'. 'aLods' is ordered
+/// from finest to coarsest and each entry has an object space 'error'.
+template<typename LodType>
+size_t select_lod(const std::vector<LodType>& aLods, float aDistance, float aPixelsPerUnit, float aMaxPixelError = 1.0f){
+    size_t selected = 0;
+    for(size_t i = 1; i < aLods.size(); ++i){
+        if(projected_error(aLods[i].error, aDistance, aPixelsPerUnit) > aMaxPixelError) break;
+        selected = i;
+    }
+    return(selected);
+}
+
+#endif
@@ -0,0 +1,240 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static const float* position_at(const float* aPositions, size_t aPositionStride, uint32_t aVertex){
+    return(reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(aPositions) + aVertex * aPositionStride));
+}
+
+// Bounding sphere and normal cone of the triangles of 'aMeshlet', whose index range and vertex count are set
+static void compute_meshlet_bounds(Meshlet& aMeshlet, const std::vector<uint32_t>& aIndices, const float* aPositions, size_t aPositionStride){
+    // Sphere around the center of the bounding box. Not the smallest sphere, but close for compact clusters.
+    float boxMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float boxMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for(uint32_t i = aMeshlet.firstIndex; i < aMeshlet.firstIndex + aMeshlet.indexCount; ++i){
+        const float* position = position_at(aPositions, aPositionStride, aIndices[i]);
+        for(int k = 0; k < 3; ++k){
+            boxMin[k] = std::min(boxMin[k], position[k]);
+            boxMax[k] = std::max(boxMax[k], position[k]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for(int k = 0; k < 3; ++k) aMeshlet.center[k] = (boxMin[k] + boxMax[k]) * 0.5f;
+    for(uint32_t i = aMeshlet.firstIndex; i < aMeshlet.firstIndex + aMeshlet.indexCount; ++i){
+        const float* position = position_at(aPositions, aPositionStride, aIndices[i]);
+        float distanceSquared = 0.0f;
+        for(int k = 0; k < 3; ++k) distanceSquared += (position[k] - aMeshlet.center[k]) * (position[k] - aMeshlet.center[k]);
+        radiusSquared = std::max(radiusSquared, distanceSquared);
+    }
+    aMeshlet.radius = std::sqrt(radiusSquared);
+
+    // The cone axis is the average face normal, and its opening the widest angle of any face normal to it
+    std::vector<float> normals;
+    normals.reserve(aMeshlet.indexCount);
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for(uint32_t i = aMeshlet.firstIndex; i < aMeshlet.firstIndex + aMeshlet.indexCount; i += 3){
+        const float* a = position_at(aPositions, aPositionStride, aIndices[i]);
+        const float* b = position_at(aPositions, aPositionStride, aIndices[i + 1]);
+        const float* c = position_at(aPositions, aPositionStride, aIndices[i + 2]);
+        const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        // Degenerate triangles are never rasterized, so they don't constrain the cone
+        if(length <= 0.0f) continue;
+        for(int k = 0; k < 3; ++k){
+            normals.push_back(normal[k] / length);
+            axis[k] += normal[k] / length;
+        }
+    }
+
+    aMeshlet.coneCutoff = 1.0f;
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if(normals.empty() || axisLength < 1e-6f) return;
+    for(int k = 0; k < 3; ++k) aMeshlet.coneAxis[k] = axis[k] / axisLength;
+
+    float minDot = 1.0f;
+    for(size_t i = 0; i < normals.size(); i += 3){
+        minDot = std::min(minDot, normals[i] * aMeshlet.coneAxis[0] + normals[i + 1] * aMeshlet.coneAxis[1] + normals[i + 2] * aMeshlet.coneAxis[2]);
+    }
+    // Normals 90 degrees or more off the axis face every direction some of the time
+    if(minDot <= 0.0f) return;
+    // Back facing directions form the cone opening 90 degrees further on both sides, flipped. Its cosine is the
+    // sine of the widest normal angle.
+    aMeshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// Score of a candidate triangle relative to the rest of the meshlet. Triangles adding fewer vertices come first, then
+// those facing the same way and lying close to the meshlet, which keeps the normal cone and bounding sphere tight.
+static const float sConeWeight = 2.0f;
+
+void build_meshlets(
+    std::vector<Meshlet>& aMeshletsOut, std::vector<uint32_t>& aIndices, size_t aFirstIndex, size_t aIndexCount,
+    const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+    size_t aMaxVertices, size_t aMaxTriangles
+){
+    const size_t triangleCount = aIndexCount / 3;
+    if(triangleCount == 0) return;
+    const uint32_t* triangles = &aIndices[aFirstIndex];
+
+    // Weld the vertices of the range into points by position, so that triangles on either side of an attribute seam
+    // still count as neighbours
+    std::vector<uint32_t> vertexPoint(aVertexCount, UINT32_MAX);
+    std::vector<uint32_t> usedVertices;
+    for(size_t i = 0; i < triangleCount * 3; ++i){
+        if(vertexPoint[triangles[i]] == UINT32_MAX){
+            vertexPoint[triangles[i]] = 0;
+            usedVertices.push_back(triangles[i]);
+        }
+    }
+    std::sort(usedVertices.begin(), usedVertices.end(), [&](uint32_t aLeft, uint32_t aRight){
+        const float* left = position_at(aPositions, aPositionStride, aLeft);
+        const float* right = position_at(aPositions, aPositionStride, aRight);
+        return(std::lexicographical_compare(left, left + 3, right, right + 3));
+    });
+    uint32_t pointCount = 0;
+    for(size_t i = 0; i < usedVertices.size(); ++i){
+        const float* position = position_at(aPositions, aPositionStride, usedVertices[i]);
+        if(i > 0 && !std::equal(position, position + 3, position_at(aPositions, aPositionStride, usedVertices[i - 1]))) ++pointCount;
+        vertexPoint[usedVertices[i]] = pointCount;
+    }
+    ++pointCount;
+
+    // Triangles around each point
+    std::vector<uint32_t> pointTriangleStart(pointCount + 1, 0);
+    for(size_t i = 0; i < triangleCount * 3; ++i) ++pointTriangleStart[vertexPoint[triangles[i]] + 1];
+    for(uint32_t point = 0; point < pointCount; ++point) pointTriangleStart[point + 1] += pointTriangleStart[point];
+    std::vector<uint32_t> pointTriangles(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(pointTriangleStart.begin(), pointTriangleStart.end() - 1);
+        for(size_t i = 0; i < triangleCount * 3; ++i) pointTriangles[fill[vertexPoint[triangles[i]]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    // Unit normal, area and centroid of every triangle
+    std::vector<float> triangleData(triangleCount * 7);
+    for(size_t t = 0; t < triangleCount; ++t){
+        const float* a = position_at(aPositions, aPositionStride, triangles[t * 3]);
+        const float* b = position_at(aPositions, aPositionStride, triangles[t * 3 + 1]);
+        const float* c = position_at(aPositions, aPositionStride, triangles[t * 3 + 2]);
+        const float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float* data = &triangleData[t * 7];
+        for(int k = 0; k < 3; ++k){
+            data[k] = length > 0.0f ? normal[k] / length : 0.0f;
+            data[4 + k] = (a[k] + b[k] + c[k]) / 3.0f;
+        }
+        data[3] = length * 0.5f;
+    }
+
+    // Grow each meshlet from the first triangle not taken yet by repeatedly adding the best scoring neighbour, until
+    // it is full or has no neighbours left
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+    std::vector<uint32_t> vertexMeshlet(aVertexCount, UINT32_MAX);
+    std::vector<uint32_t> candidateMeshlet(triangleCount, UINT32_MAX);
+    std::vector<uint32_t> candidates;
+    std::vector<Meshlet> meshlets;
+    size_t seed = 0;
+    for(uint32_t meshletId = 0; order.size() < triangleCount; ++meshletId){
+        while(emitted[seed]) ++seed;
+
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(aFirstIndex + order.size() * 3);
+        float normalSum[3] = {0.0f, 0.0f, 0.0f};
+        float centroidSum[3] = {0.0f, 0.0f, 0.0f};
+        float areaSum = 0.0f;
+        candidates.clear();
+
+        size_t next = seed;
+        while(next != SIZE_MAX){
+            emitted[next] = true;
+            order.push_back(static_cast<uint32_t>(next));
+            meshlet.indexCount += 3;
+            const float* data = &triangleData[next * 7];
+            for(int k = 0; k < 3; ++k){
+                normalSum[k] += data[k];
+                centroidSum[k] += data[4 + k];
+            }
+            areaSum += data[3];
+            for(size_t k = 0; k < 3; ++k){
+                const uint32_t vertex = triangles[next * 3 + k];
+                if(vertexMeshlet[vertex] != meshletId){
+                    vertexMeshlet[vertex] = meshletId;
+                    ++meshlet.vertexCount;
+                }
+                const uint32_t point = vertexPoint[vertex];
+                for(uint32_t i = pointTriangleStart[point]; i < pointTriangleStart[point + 1]; ++i){
+                    const uint32_t neighbour = pointTriangles[i];
+                    if(!emitted[neighbour] && candidateMeshlet[neighbour] != meshletId){
+                        candidateMeshlet[neighbour] = meshletId;
+                        candidates.push_back(neighbour);
+                    }
+                }
+            }
+            if(meshlet.indexCount / 3 >= aMaxTriangles) break;
+
+            float axisLength = std::sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1] + normalSum[2] * normalSum[2]);
+            const float axisScale = axisLength > 0.0f ? 1.0f / axisLength : 0.0f;
+            const float centerScale = 1.0f / (meshlet.indexCount / 3);
+            const float distanceScale = areaSum > 0.0f ? 1.0f / std::sqrt(areaSum) : 0.0f;
+            next = SIZE_MAX;
+            float bestScore = FLT_MAX;
+            for(size_t i = 0; i < candidates.size();){
+                const uint32_t candidate = candidates[i];
+                if(emitted[candidate]){
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                ++i;
+
+                const uint32_t* vertices = &triangles[candidate * 3];
+                size_t newVertices = (vertexMeshlet[vertices[0]] != meshletId)
+                    + (vertexMeshlet[vertices[1]] != meshletId && vertices[1] != vertices[0])
+                    + (vertexMeshlet[vertices[2]] != meshletId && vertices[2] != vertices[0] && vertices[2] != vertices[1]);
+                if(meshlet.vertexCount + newVertices > aMaxVertices) continue;
+
+                const float* candidateData = &triangleData[candidate * 7];
+                float facing = (candidateData[0] * normalSum[0] + candidateData[1] * normalSum[1] + candidateData[2] * normalSum[2]) * axisScale;
+                float distanceSquared = 0.0f;
+                for(int k = 0; k < 3; ++k){
+                    float offset = candidateData[4 + k] - centroidSum[k] * centerScale;
+                    distanceSquared += offset * offset;
+                }
+                float score = newVertices + sConeWeight * (1.0f - facing) + std::sqrt(distanceSquared) * distanceScale;
+                if(score < bestScore){
+                    bestScore = score;
+                    next = candidate;
+                }
+            }
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    // Store the triangles in meshlet order, so each meshlet is a contiguous range
+    std::vector<uint32_t> reordered(triangleCount * 3);
+    for(size_t i = 0; i < triangleCount; ++i){
+        std::copy(triangles + order[i] * 3, triangles + order[i] * 3 + 3, reordered.begin() + i * 3);
+    }
+    std::copy(reordered.begin(), reordered.end(), aIndices.begin() + aFirstIndex);
+
+    for(Meshlet& meshlet : meshlets){
+        compute_meshlet_bounds(meshlet, aIndices, aPositions, aPositionStride);
+        aMeshletsOut.push_back(meshlet);
+    }
+}
+
+bool meshlet_backfacing(const Meshlet& aMeshlet, const float aCameraPosition[3]){
+    if(aMeshlet.coneCutoff >= 1.0f) return(false);
+    const float view[3] = {
+        aMeshlet.center[0] - aCameraPosition[0], aMeshlet.center[1] - aCameraPosition[1], aMeshlet.center[2] - aCameraPosition[2]
+    };
+    float distance = std::sqrt(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+    float alongAxis = view[0] * aMeshlet.coneAxis[0] + view[1] * aMeshlet.coneAxis[1] + view[2] * aMeshlet.coneAxis[2];
+    // The whole sphere sees the meshlet from behind, see "Optimizing the Graphics Pipeline with Compute" (Wihlidal, 2016)
+    return(alongAxis >= aMeshlet.coneCutoff * distance + aMeshlet.radius);
+}
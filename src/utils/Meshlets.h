@@ -0,0 +1,48 @@
+#ifndef MESHLETS_H_
+#define MESHLETS_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** A cluster of neighbouring triangles that is culled as a whole. The triangles are a contiguous range of the index
+ * list the meshlet was built from, so drawing a meshlet is drawing that range. The bounds are in the object space of
+ * the positions it was built from.
+ *
+ * Laid out as three 16 byte rows, so an array of meshlets can be read by shaders as well.
+ */
+struct Meshlet
+{
+    // Sphere enclosing every vertex of the meshlet
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;
+    // Cone around the face normals. Every triangle faces away from cameras inside the cone mirrored at the center,
+    // see meshlet_backfacing(). A cutoff of 1 marks meshlets whose triangles face too many ways to ever be culled.
+    float coneAxis[3] = {0.0f, 0.0f, 0.0f};
+    float coneCutoff = 1.0f;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t reserved = 0;
+};
+
+/** Split the 'aIndexCount' indices of 'aIndices' starting at 'aFirstIndex' into meshlets of at most 'aMaxVertices'
+ * unique vertices and 'aMaxTriangles' triangles, and append them to 'aMeshletsOut'. Meshlets are grown over
+ * neighbouring triangles, preferring those that add few vertices and face the way the meshlet does. Triangles
+ * sharing a position are neighbours even across attribute seams.
+ *
+ * The triangles of the range are reordered so that each meshlet is a contiguous range of it. Triangles within a
+ * meshlet keep a local order that stays friendly to the vertex cache. 'aPositionStride' is the distance in bytes
+ * between consecutive positions.
+ */
+void build_meshlets(
+    std::vector<Meshlet>& aMeshletsOut, std::vector<uint32_t>& aIndices, size_t aFirstIndex, size_t aIndexCount,
+    const float* aPositions, size_t aVertexCount, size_t aPositionStride,
+    size_t aMaxVertices = 64, size_t aMaxTriangles = 124
+);
+
+/// True if every triangle of 'aMeshlet' faces away from 'aCameraPosition', given in the meshlet's object space.
+/// Triangles are front facing when wound counter-clockwise.
+bool meshlet_backfacing(const Meshlet& aMeshlet, const float aCameraPosition[3]);
+
+#endif
@@ -1,14 +1,130 @@
 
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "ModelContainer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Hash.h"
+#include "common.h"
+#include "json.hpp"
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
 
+// glTF binary container, see the "GLB File Format Specification" of the glTF 2.0 spec
+static const uint32_t GLB_MAGIC = 0x46546C67;       // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;   // "BIN\0"
 
-ModelContainer::ModelContainer(const std::string filename) 
+// Bump whenever the processing of loaded meshes changes, so previously cooked meshes are treated as stale
+static const uint32_t COOKER_VERSION = 3;
+
+// Each level of detail aims for half the triangles of the previous one. The chain ends at MAX_LOD_COUNT levels, once
+// a level drops below MIN_LOD_TRIANGLES, or when simplification can't remove at least a quarter of the triangles.
+static const size_t MAX_LOD_COUNT = 8;
+static const size_t MIN_LOD_TRIANGLES = 64;
+
+static bool ends_with(const std::string& str, const std::string& suffix)
+{
+  return(str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+// Cooked meshes are named after the source file and keyed by its path and the load options
+static std::string cooked_mesh_path(const std::string& filename, bool optimize)
+{
+  size_t nameStart = filename.find_last_of("/\\");
+  std::string name = filename.substr(nameStart == std::string::npos ? 0 : nameStart + 1);
+  char key[17];
+  snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(Fnv1aHasher().add(filename).add(optimize).value()));
+  return(STRIFY(CACHE_DIR) + name + "." + key + ".mesh");
+}
+
+static int accessor_type(const std::string& type)
 {
+  if (type == "SCALAR") return(TINYGLTF_TYPE_SCALAR);
+  if (type == "VEC2") return(TINYGLTF_TYPE_VEC2);
+  if (type == "VEC3") return(TINYGLTF_TYPE_VEC3);
+  if (type == "VEC4") return(TINYGLTF_TYPE_VEC4);
+  if (type == "MAT2") return(TINYGLTF_TYPE_MAT2);
+  if (type == "MAT3") return(TINYGLTF_TYPE_MAT3);
+  if (type == "MAT4") return(TINYGLTF_TYPE_MAT4);
+  return(-1);
+}
+
+// Whether every element of 'accessor' lies within 'bufferView'
+static bool accessor_fits_view(const tinygltf::Accessor& accessor, const tinygltf::BufferView& bufferView)
+{
+  const int32_t componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType));
+  const int32_t componentCount = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+  const int stride = accessor.ByteStride(bufferView);
+  if (componentSize <= 0 || componentCount <= 0 || stride <= 0)
+    return(false);
+  if (accessor.count == 0)
+    return(accessor.byteOffset <= bufferView.byteLength);
+  const size_t elementSize = size_t(componentSize) * size_t(componentCount);
+  // Compared piecewise so a huge count can't overflow the sum
+  const size_t available = bufferView.byteLength;
+  if (accessor.byteOffset > available || elementSize > available - accessor.byteOffset)
+    return(false);
+  return((accessor.count - 1) <= (available - accessor.byteOffset - elementSize) / size_t(stride));
+}
+
+// Append 'count' indices of type T, offset by 'baseVertex'. Each must refer to one of the primitive's 'vertexCount' vertices.
+template<typename T>
+static void append_typed_indices(std::vector<uint32_t>& out, const unsigned char* data, size_t count, uint32_t baseVertex, size_t vertexCount)
+{
+  const T* typed = reinterpret_cast<const T*>(data);
+  for(size_t i = 0; i < count; i++) {
+    if (typed[i] >= vertexCount)
+      throw std::runtime_error("ModelContainer: Index " + std::to_string(typed[i]) + " is past the " + std::to_string(vertexCount) + " vertices of its primitive");
+    out.push_back(baseVertex + static_cast<uint32_t>(typed[i]));
+  }
+}
+
+// Append 'count' indices of any glTF index component type, offset by 'baseVertex'
+static void append_indices(std::vector<uint32_t>& out, const unsigned char* data, size_t count, int componentType, uint32_t baseVertex, size_t vertexCount)
+{
+  switch(componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      append_typed_indices<uint8_t>(out, data, count, baseVertex, vertexCount);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      append_typed_indices<uint16_t>(out, data, count, baseVertex, vertexCount);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+      append_typed_indices<uint32_t>(out, data, count, baseVertex, vertexCount);
+      break;
+    default:
+      throw std::runtime_error("ModelContainer: Unsupported index component type " + std::to_string(componentType));
+  }
+}
+
+
+ModelContainer::ModelContainer(const std::string filename, bool optimize, bool useCache) 
+{
+  std::string cachePath;
+  uint64_t sourceKey = 0;
+  if (useCache) {
+    uint64_t sourceHash = CookedMesh::hashFile(filename);
+    if (sourceHash != 0) {
+      cachePath = cooked_mesh_path(filename, optimize);
+      sourceKey = sourceHash;
+      hash_combine(sourceKey, COOKER_VERSION);
+      hash_combine(sourceKey, optimize);
+      if (loadCooked(cachePath, sourceKey)) {
+        std::cout << "Loaded cooked mesh: " << cachePath << " (" << verts.size() << " vertices, " << indices.size() << " indices, "
+                  << chunks.size() << " chunk" << (chunks.size() == 1 ? "" : "s") << ", " << lods.size() << " LOD" << (lods.size() == 1 ? "" : "s") << ", " << meshlets.size() << " meshlets)" << std::endl;
+        return;
+      }
+    }
+  }
+
   tinygltf::TinyGLTF loader;
   std::string err;
   std::string warn;
 
-  bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+  bool res = ends_with(filename, ".glb") ? loadBinaryModel(filename, err) : loader.LoadASCIIFromFile(&model, &err, &warn, filename);
 
   if (!warn.empty()) 
     std::cout << "WARN: " << warn << std::endl;
@@ -19,18 +135,150 @@ ModelContainer::ModelContainer(const std::string filename)
   
 
   if (!res) {
-    std::cout << "Failed to load glTF: " << filename << std::endl;
-    exit(EXIT_FAILURE);
+    throw std::runtime_error("Failed to load glTF: " + filename);
   }
-  else 
-    std::cout << "Loaded glTF: " << filename << std::endl;
-
   createModelContainer();
+  std::vector<std::vector<uint32_t>> lodIndices = {indices};
+  std::vector<float> lodErrors = {0.0f};
+  if (optimize) {
+    optimizeMesh();
+    lodIndices = buildLods(lodErrors);
+  }
+  buildChunks(lodIndices, lodErrors);
+  if (optimize)
+    buildMeshlets();
+  measure();
+  if (!cachePath.empty())
+    writeCooked(cachePath, sourceKey);
+  binaryFile.close();
+  binaryChunk = nullptr;
+  binaryChunkSize = 0;
+  std::cout << "Loaded glTF: " << filename << " (" << verts.size() << " vertices, " << indices.size() << " indices, "
+            << chunks.size() << " chunk" << (chunks.size() == 1 ? "" : "s") << ", " << lods.size() << " LOD" << (lods.size() == 1 ? "" : "s") << ", " << meshlets.size() << " meshlets)" << std::endl;
 
 }
 
 ModelContainer::~ModelContainer() {}
 
+// tinygltf always copies the BIN chunk into a std::vector, so .glb files are mapped and only the structure of the
+// document (meshes, accessors and buffer views) is read from the JSON chunk. The geometry is then read directly from
+// the mapping by bufferData().
+bool ModelContainer::loadBinaryModel(const std::string& filename, std::string& err)
+{
+  if (!binaryFile.open(filename)) {
+    err = "Failed to map file: " + filename;
+    return(false);
+  }
+  const unsigned char* bytes = binaryFile.data();
+  const size_t size = binaryFile.size();
+
+  uint32_t header[5];
+  if (size < sizeof(header)) {
+    err = "File too small for glTF binary: " + filename;
+    return(false);
+  }
+  memcpy(header, bytes, sizeof(header));
+  if (header[0] != GLB_MAGIC || header[1] != 2 || header[2] > size || header[4] != GLB_CHUNK_JSON || 20 + size_t(header[3]) > header[2]) {
+    err = "Invalid glTF binary header: " + filename;
+    return(false);
+  }
+  const char* jsonChunk = reinterpret_cast<const char*>(bytes + 20);
+  const size_t jsonSize = header[3];
+
+  // The BIN chunk is optional and must directly follow the JSON chunk
+  size_t binOffset = 20 + jsonSize;
+  if (binOffset + 8 <= header[2]) {
+    uint32_t chunk[2];
+    memcpy(chunk, bytes + binOffset, sizeof(chunk));
+    if (chunk[1] == GLB_CHUNK_BIN && binOffset + 8 + chunk[0] <= header[2]) {
+      binaryChunk = bytes + binOffset + 8;
+      binaryChunkSize = chunk[0];
+    }
+  }
+
+  nlohmann::json document = nlohmann::json::parse(jsonChunk, jsonChunk + jsonSize, nullptr, false);
+  if (document.is_discarded()) {
+    err = "Invalid JSON chunk in glTF binary: " + filename;
+    return(false);
+  }
+
+  // Required properties are read with at(), so missing ones and mistyped values end up in the catch below
+  try {
+    if (document.count("buffers")) {
+      for (const nlohmann::json& jsonBuffer : document["buffers"]) {
+        // Only the embedded BIN chunk is supported, so buffers with a uri (external or data) are rejected
+        if (jsonBuffer.count("uri") || jsonBuffer.value("byteLength", size_t(0)) > binaryChunkSize || document["buffers"].size() > 1) {
+          err = "Only glTF binaries with a single embedded buffer are supported: " + filename;
+          return(false);
+        }
+        model.buffers.push_back(tinygltf::Buffer());
+      }
+    }
+    if (document.count("bufferViews")) {
+      for (const nlohmann::json& jsonView : document["bufferViews"]) {
+        tinygltf::BufferView bufferView;
+        bufferView.buffer = jsonView.value("buffer", -1);
+        bufferView.byteOffset = jsonView.value("byteOffset", size_t(0));
+        bufferView.byteLength = jsonView.value("byteLength", size_t(0));
+        bufferView.byteStride = jsonView.value("byteStride", size_t(0));
+        if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= model.buffers.size() || bufferView.byteOffset + bufferView.byteLength > binaryChunkSize) {
+          err = "Buffer view out of range in glTF binary: " + filename;
+          return(false);
+        }
+        model.bufferViews.push_back(bufferView);
+      }
+    }
+    if (document.count("accessors")) {
+      for (const nlohmann::json& jsonAccessor : document["accessors"]) {
+        tinygltf::Accessor accessor;
+        accessor.bufferView = jsonAccessor.value("bufferView", -1);
+        accessor.byteOffset = jsonAccessor.value("byteOffset", size_t(0));
+        accessor.componentType = jsonAccessor.value("componentType", -1);
+        accessor.count = jsonAccessor.value("count", size_t(0));
+        accessor.type = accessor_type(jsonAccessor.value("type", std::string()));
+        accessor.normalized = jsonAccessor.value("normalized", false);
+        if (accessor.bufferView < 0 || size_t(accessor.bufferView) >= model.bufferViews.size() || accessor.type < 0) {
+          err = "Unsupported accessor in glTF binary: " + filename;
+          return(false);
+        }
+        if (!accessor_fits_view(accessor, model.bufferViews[accessor.bufferView])) {
+          err = "Accessor out of range of its buffer view in glTF binary: " + filename;
+          return(false);
+        }
+        model.accessors.push_back(accessor);
+      }
+    }
+    if (document.count("meshes")) {
+      for (const nlohmann::json& jsonMesh : document["meshes"]) {
+        tinygltf::Mesh mesh;
+        mesh.name = jsonMesh.value("name", std::string());
+        for (const nlohmann::json& jsonPrimitive : jsonMesh.at("primitives")) {
+          tinygltf::Primitive primitive;
+          primitive.indices = jsonPrimitive.value("indices", -1);
+          primitive.mode = jsonPrimitive.value("mode", TINYGLTF_MODE_TRIANGLES);
+          for (auto attribute = jsonPrimitive.at("attributes").begin(); attribute != jsonPrimitive.at("attributes").end(); ++attribute) {
+            primitive.attributes[attribute.key()] = attribute.value().get<int>();
+          }
+          mesh.primitives.push_back(primitive);
+        }
+        model.meshes.push_back(mesh);
+      }
+    }
+  }
+  catch (const nlohmann::json::exception& e) {
+    err = "Malformed glTF binary " + filename + ": " + e.what();
+    return(false);
+  }
+  return(true);
+}
+
+const unsigned char* ModelContainer::bufferData(const tinygltf::BufferView& bufferView) const
+{
+  if (binaryChunk != nullptr)
+    return(binaryChunk + bufferView.byteOffset);
+  return(&model.buffers[bufferView.buffer].data[bufferView.byteOffset]);
+}
+
 void ModelContainer::createModelContainer()
 {
   for(auto mesh : model.meshes) 
@@ -39,38 +287,269 @@ void ModelContainer::createModelContainer()
     {
       const tinygltf::Accessor& accessor = model.accessors[prim.attributes["POSITION"]];
       const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-      const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
       // bufferView byteoffset + accessor byteoffset tells you where the actual position data is within the buffer. From there
       // you should already know how the data needs to be interpreted.
-      const float* positions = reinterpret_cast<const float*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
+      const unsigned char* positions = bufferData(bufferView) + accessor.byteOffset;
+      const size_t positionStride = accessor.ByteStride(bufferView);
 
       const tinygltf::Accessor& accessor2 = model.accessors[prim.attributes["NORMAL"]];
       const tinygltf::BufferView& bufferView2 = model.bufferViews[accessor2.bufferView];
-      const tinygltf::Buffer& buffer2 = model.buffers[bufferView2.buffer];
       // bufferView byteoffset + accessor byteoffset tells you where the actual position data is within the buffer. From there
       // you should already know how the data needs to be interpreted.
-      const float* normals = reinterpret_cast<const float*>(&buffer2.data[bufferView2.byteOffset + accessor2.byteOffset]);
+      const unsigned char* normals = bufferData(bufferView2) + accessor2.byteOffset;
+      const size_t normalStride = accessor2.ByteStride(bufferView2);
+      // Normals are read for every position, so there must be as many of them
+      if (accessor2.count < accessor.count)
+        throw std::runtime_error("ModelContainer: Primitive has fewer normals than positions");
+
+      // glTF vertices are already unique, so they are copied once and triangles refer to them through the indices.
+      // Indices of every primitive after the first are offset past the vertices of the ones before it.
+      const uint32_t baseVertex = static_cast<uint32_t>(verts.size());
+      for(size_t i = 0; i < accessor.count; i++) {
+        const float* position = reinterpret_cast<const float*>(positions + i * positionStride);
+        const float* normal = reinterpret_cast<const float*>(normals + i * normalStride);
+        verts.push_back(SimpleVertex {
+                  glm::vec3(position[0], position[1], position[2]), 
+                  glm::vec4(1,0,0,1), 
+                  glm::vec3(normal[0], normal[1], normal[2])} 
+                  );
+      }
+
+      if(prim.indices < 0) {
+        // Non-indexed primitives draw their vertices in order
+        for(size_t i = 0; i < accessor.count; i++) {
+          indices.push_back(baseVertex + static_cast<uint32_t>(i));
+        }
+        continue;
+      }
 
       const tinygltf::Accessor& accessor1 = model.accessors[prim.indices];
       const tinygltf::BufferView& bufferView1 = model.bufferViews[accessor1.bufferView];
-      const tinygltf::Buffer& buffer1 = model.buffers[bufferView1.buffer];
-      const unsigned short* indices = reinterpret_cast<const unsigned short*>(&buffer1.data[bufferView1.byteOffset + accessor1.byteOffset]);     
+      const unsigned char* primIndices = bufferData(bufferView1) + accessor1.byteOffset;
+      append_indices(indices, primIndices, accessor1.count, accessor1.componentType, baseVertex, accessor.count);
+    }
+  }
+}
+
+void ModelContainer::optimizeMesh()
+{
+  VertexCacheStatistics before = analyze_vertex_cache(indices, verts.size());
 
+  optimize_vertex_cache(indices, verts.size());
+  optimize_overdraw(indices, positionData(), verts.size(), sizeof(SimpleVertex));
 
-      for(size_t i = 0; i < accessor1.count; i++) {
-        verts.push_back(SimpleVertex {
-                  glm::vec3(positions[(int)indices[i] * 3],
-                            positions[(int)indices[i] * 3 + 1],
-                            positions[(int)indices[i] * 3 + 2]), 
-                  glm::vec4(1,0,0,1), 
-                  glm::vec3(normals[(int)indices[i] * 3],
-                            normals[(int)indices[i] * 3 + 1],
-                            normals[(int)indices[i] * 3 + 2])} 
-                  );
-        
-        //std::cout << "N: " << normals[(int)indices[i] * 3] << " " << normals[(int)indices[i] * 3 + 1]  << " " << normals[(int)indices[i] * 3 + 2] << std::endl;
-        //std::cout << "P: " << positions[(int)indices[i] * 3] << " " << positions[(int)indices[i] * 3 + 1]  << " " << positions[(int)indices[i] * 3 + 2] << std::endl;
+  std::vector<uint32_t> remap;
+  size_t uniqueVertices = optimize_vertex_fetch_remap(remap, indices, verts.size());
+  remap_vertices(verts, indices, remap, uniqueVertices);
+
+  VertexCacheStatistics after = analyze_vertex_cache(indices, verts.size());
+  std::cout << "Optimized mesh: ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+// Simplifies the optimized mesh into a chain of coarser levels, each from the one before it. The errors add up
+// along the chain, which keeps them an upper estimate of each level's distance from the full detail surface.
+std::vector<std::vector<uint32_t>> ModelContainer::buildLods(std::vector<float>& errorsOut) const
+{
+  std::vector<std::vector<uint32_t>> levels = {indices};
+  errorsOut = {0.0f};
+  while (levels.size() < MAX_LOD_COUNT && levels.back().size() / 3 >= MIN_LOD_TRIANGLES) {
+    const std::vector<uint32_t>& previous = levels.back();
+    std::vector<uint32_t> simplified;
+    float error = simplify_mesh(simplified, previous, positionData(), verts.size(), sizeof(SimpleVertex),
+                                previous.size() / 6 * 3, FLT_MAX, normalData(), sizeof(SimpleVertex));
+    if (simplified.empty() || simplified.size() > previous.size() / 4 * 3)
+      break;
+
+    optimize_vertex_cache(simplified, verts.size());
+    errorsOut.push_back(errorsOut.back() + error);
+    levels.push_back(std::move(simplified));
+  }
+  return(levels);
+}
+
+void ModelContainer::buildChunks(const std::vector<std::vector<uint32_t>>& lodIndices, const std::vector<float>& lodErrors)
+{
+  // All levels draw from the same vertices if they fit into a single chunk. Otherwise each level is split on its
+  // own, over a copy of just the vertices it uses.
+  const bool shareVertices = verts.size() <= 0xFFFF;
+  std::vector<uint32_t> vertexSource;
+  shortIndices.clear();
+  chunks.clear();
+  lods.clear();
+  for (size_t level = 0; level < lodIndices.size(); level++) {
+    std::vector<uint32_t> levelIndices = lodIndices[level];
+    std::vector<uint32_t> usedVertices;
+    if (!shareVertices) {
+      std::vector<uint32_t> remap;
+      usedVertices.resize(optimize_vertex_fetch_remap(remap, levelIndices, verts.size()));
+      for (size_t i = 0; i < remap.size(); i++) {
+        if (remap[i] != UINT32_MAX)
+          usedVertices[remap[i]] = static_cast<uint32_t>(i);
       }
+      for (uint32_t& index : levelIndices)
+        index = remap[index];
+    }
+
+    std::vector<uint16_t> levelShortIndices;
+    std::vector<uint32_t> levelSource;
+    std::vector<IndexChunk> levelChunks = split_index_chunks(levelIndices, shareVertices ? verts.size() : usedVertices.size(), levelShortIndices, levelSource);
+
+    CookedMesh::Lod lod;
+    lod.firstChunk = static_cast<uint32_t>(chunks.size());
+    lod.chunkCount = static_cast<uint32_t>(levelChunks.size());
+    lod.error = lodErrors[level];
+    lods.push_back(lod);
+    for (IndexChunk chunk : levelChunks) {
+      chunk.firstIndex += static_cast<uint32_t>(shortIndices.size());
+      chunk.vertexOffset += static_cast<int32_t>(vertexSource.size());
+      chunks.push_back(chunk);
     }
+    shortIndices.insert(shortIndices.end(), levelShortIndices.begin(), levelShortIndices.end());
+    if (!shareVertices) {
+      for (uint32_t source : levelSource)
+        vertexSource.push_back(usedVertices[source]);
+    }
+  }
+
+  // Vertices were duplicated into the chunks that share them, so rebuild the 32 bit indices over the new layout
+  if (!shareVertices)
+    verts = gather_vertices(verts, vertexSource);
+  indices.resize(shortIndices.size());
+  for (const IndexChunk& chunk : chunks) {
+    for (uint32_t i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; i++)
+      indices[i] = static_cast<uint32_t>(chunk.vertexOffset) + shortIndices[i];
+  }
+}
+
+// Meshlets never straddle chunks, so each one can be drawn from the 16 bit indices of its chunk as well. Building
+// them reorders the triangles within each chunk.
+void ModelContainer::buildMeshlets()
+{
+  meshlets.clear();
+  if (verts.empty())
+    return;
+  for (CookedMesh::Lod& lod : lods) {
+    lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+    for (uint32_t i = lod.firstChunk; i < lod.firstChunk + lod.chunkCount; i++) {
+      const IndexChunk& chunk = chunks[i];
+      build_meshlets(meshlets, indices, chunk.firstIndex, chunk.indexCount, positionData(), verts.size(), sizeof(SimpleVertex));
+      for (uint32_t j = chunk.firstIndex; j < chunk.firstIndex + chunk.indexCount; j++)
+        shortIndices[j] = static_cast<uint16_t>(indices[j] - static_cast<uint32_t>(chunk.vertexOffset));
+    }
+    lod.meshletCount = static_cast<uint32_t>(meshlets.size()) - lod.firstMeshlet;
+  }
+}
+
+void ModelContainer::measure()
+{
+  min = verts.empty() ? glm::vec3(0.0f) : verts[0].pos;
+  max = min;
+  for (const SimpleVertex& vertex : verts) {
+    min = glm::min(min, vertex.pos);
+    max = glm::max(max, vertex.pos);
+  }
+  measureRadius();
+}
+
+void ModelContainer::measureRadius()
+{
+  glm::vec3 center = (min + max) * 0.5f;
+  float radiusSquared = 0.0f;
+  for (const SimpleVertex& vertex : verts) {
+    glm::vec3 offset = vertex.pos - center;
+    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
   }
-}
\ No newline at end of file
+  radius = std::sqrt(radiusSquared);
+}
+
+bool ModelContainer::loadCooked(const std::string& cachePath, uint64_t sourceKey)
+{
+  CookedMesh cooked;
+  if (!cooked.open(cachePath, sourceKey, sizeof(SimpleVertex)))
+    return(false);
+
+  const CookedMesh::Contents& contents = cooked.getContents();
+  const SimpleVertex* cookedVerts = static_cast<const SimpleVertex*>(contents.vertices);
+  verts.assign(cookedVerts, cookedVerts + contents.vertexCount);
+  indices.assign(contents.indices, contents.indices + contents.indexCount);
+  shortIndices.assign(contents.shortIndices, contents.shortIndices + contents.indexCount);
+  chunks.assign(contents.chunks, contents.chunks + contents.chunkCount);
+  lods.assign(contents.lods, contents.lods + contents.lodCount);
+  meshlets.assign(contents.meshlets, contents.meshlets + contents.meshletCount);
+  min = glm::vec3(contents.boundsMin[0], contents.boundsMin[1], contents.boundsMin[2]);
+  max = glm::vec3(contents.boundsMax[0], contents.boundsMax[1], contents.boundsMax[2]);
+  measureRadius();
+  return(true);
+}
+
+void ModelContainer::writeCooked(const std::string& cachePath, uint64_t sourceKey) const
+{
+  CookedMesh::Contents contents;
+  contents.sourceKey = sourceKey;
+  contents.vertices = verts.data();
+  contents.vertexStride = sizeof(SimpleVertex);
+  contents.vertexCount = static_cast<uint32_t>(verts.size());
+  contents.shortIndices = shortIndices.data();
+  contents.indices = indices.data();
+  contents.indexCount = static_cast<uint32_t>(indices.size());
+  contents.chunks = chunks.data();
+  contents.chunkCount = static_cast<uint32_t>(chunks.size());
+  contents.lods = lods.data();
+  contents.lodCount = static_cast<uint32_t>(lods.size());
+  contents.meshlets = meshlets.data();
+  contents.meshletCount = static_cast<uint32_t>(meshlets.size());
+  memcpy(contents.boundsMin, &min.x, sizeof(contents.boundsMin));
+  memcpy(contents.boundsMax, &max.x, sizeof(contents.boundsMax));
+
+  if (!CookedMesh::write(cachePath, contents))
+    std::cerr << "Warning: Failed to write cooked mesh: " << cachePath << std::endl;
+}
+
+std::vector<glm::vec3> ModelContainer::positionStream() const
+{
+  std::vector<glm::vec3> positions(verts.size());
+  for (size_t i = 0; i < verts.size(); i++)
+    positions[i] = verts[i].pos;
+  return(positions);
+}
+
+std::vector<SimpleVertexAttributes> ModelContainer::attributeStream() const
+{
+  std::vector<SimpleVertexAttributes> attributes(verts.size());
+  for (size_t i = 0; i < verts.size(); i++)
+    attributes[i] = SimpleVertexAttributes {verts[i].color, verts[i].normal};
+  return(attributes);
+}
+
+QuantizationTransform ModelContainer::getQuantization() const
+{
+  return(make_quantization(min, max));
+}
+
+std::vector<PackedVertex> ModelContainer::packVertices() const
+{
+  QuantizationTransform quantization = getQuantization();
+  std::vector<PackedVertex> packed(verts.size());
+  for (size_t i = 0; i < verts.size(); i++) {
+    std::array<uint16_t, 4> position = quantize_position(verts[i].pos, quantization);
+    std::array<int16_t, 2> normal = encode_octahedral(verts[i].normal);
+    std::copy(position.begin(), position.end(), packed[i].position);
+    std::copy(normal.begin(), normal.end(), packed[i].normal);
+  }
+  return(packed);
+}
+
+std::vector<PackedColorVertex> ModelContainer::packColorVertices() const
+{
+  QuantizationTransform quantization = getQuantization();
+  std::vector<PackedColorVertex> packed(verts.size());
+  for (size_t i = 0; i < verts.size(); i++) {
+    std::array<uint16_t, 4> position = quantize_position(verts[i].pos, quantization);
+    std::array<int16_t, 2> normal = encode_octahedral(verts[i].normal);
+    std::array<uint8_t, 4> color = pack_color(verts[i].color);
+    std::copy(position.begin(), position.end(), packed[i].position);
+    std::copy(normal.begin(), normal.end(), packed[i].normal);
+    std::copy(color.begin(), color.end(), packed[i].color);
+  }
+  return(packed);
+}
@@ -4,6 +4,11 @@
 #include <iostream>
 // #define TINYGLTF_NOEXCEPTION // optional. disable exception handling.
 #include "tiny_gltf.h"
+#include "MeshOptimizer.h"
+#include "MappedFile.h"
+#include "CookedMesh.h"
+#include "Meshlets.h"
+#include "VertexPacking.h"
 using namespace tinygltf;
 
 class Program;
@@ -14,21 +19,75 @@ struct SimpleVertex {
 	glm::vec3 normal;
 };
 
+// Attributes of SimpleVertex other than the position, for drawing from separate position and attribute streams
+struct SimpleVertexAttributes {
+    glm::vec4 color;
+	glm::vec3 normal;
+};
+
 class ModelContainer
 {
 public:
-	ModelContainer(const std::string filename);
+	// Loads .gltf and binary .glb files. With 'optimize' set, triangles and vertices are reordered for the vertex
+	// cache, overdraw and fetch locality, a chain of simplified levels of detail is generated, and every level is split
+	// into meshlets for culling. With 'useCache' set, the processed mesh is cooked into CACHE_DIR on first load and
+	// later loads of the unchanged file read the cooked mesh instead.
+	ModelContainer(const std::string filename, bool optimize = true, bool useCache = true);
 	virtual ~ModelContainer();
 	//void draw(const std::shared_ptr<Program> prog) const;
-	//glm::vec3 min;
-	//glm::vec3 max;
+	// Bounding box of verts
+	glm::vec3 min;
+	glm::vec3 max;
+	// Radius of the sphere around the center of the bounding box that encloses verts
+	float radius = 0.0f;
+	// Unique vertices of all primitives, drawn as an indexed triangle list
 	std::vector<SimpleVertex> verts;
+	// 32 bit indices into verts, the triangles of every level of detail one after the other
+	std::vector<uint32_t> indices;
+	// The same triangles as 16 bit indices relative to each chunk's vertexOffset. Every level of detail is a single
+	// chunk over all of verts unless the mesh has more than 64k vertices. Then each level is split into chunks of its
+	// own, and verts holds the vertices of each chunk separately.
+	std::vector<uint16_t> shortIndices;
+	std::vector<IndexChunk> chunks;
+	// Levels of detail as ranges of chunks and meshlets, from full detail to coarsest. Only the full detail level
+	// without 'optimize'.
+	std::vector<CookedMesh::Lod> lods;
+	// Clusters of each level's triangles for culling, each a range of indices within one chunk. Only with 'optimize'.
+	std::vector<Meshlet> meshlets;
+
+	// Position and normal of the first of verts, both strided by sizeof(SimpleVertex). nullptr without vertices.
+	const float* positionData() const {return(verts.empty() ? nullptr : &verts.data()->pos.x);}
+	const float* normalData() const {return(verts.empty() ? nullptr : &verts.data()->normal.x);}
+
+	// verts split into a position stream and a stream of the remaining attributes
+	std::vector<glm::vec3> positionStream() const;
+	std::vector<SimpleVertexAttributes> attributeStream() const;
+
+	// verts converted to the compact formats of VertexPacking.h. Positions are quantized to the bounding box and
+	// getQuantization() maps them back to object space.
+	QuantizationTransform getQuantization() const;
+	std::vector<PackedVertex> packVertices() const;
+	std::vector<PackedColorVertex> packColorVertices() const;
 private:	
 	//void init();
 	//void measure();
 	void loadModel();
+	bool loadBinaryModel(const std::string& filename, std::string& err);
+	const unsigned char* bufferData(const tinygltf::BufferView& bufferView) const;
 	void createModelContainer();
+	void optimizeMesh();
+	std::vector<std::vector<uint32_t>> buildLods(std::vector<float>& errorsOut) const;
+	void buildChunks(const std::vector<std::vector<uint32_t>>& lodIndices, const std::vector<float>& lodErrors);
+	void buildMeshlets();
+	void measure();
+	void measureRadius();
+	bool loadCooked(const std::string& cachePath, uint64_t sourceKey);
+	void writeCooked(const std::string& cachePath, uint64_t sourceKey) const;
 	Model model;
+	// .glb files stay mapped while loading, and geometry is read straight from their BIN chunk
+	MappedFile binaryFile;
+	const unsigned char* binaryChunk = nullptr;
+	size_t binaryChunkSize = 0;
 	
 	std::vector<unsigned int> eleBuf;
 	std::vector<float> posBuf;
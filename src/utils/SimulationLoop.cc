@@ -0,0 +1,65 @@
+#include "SimulationLoop.h"
+#include <stdexcept>
+
+SimulationLoop::SimulationLoop(double aTicksPerSecond, uint32_t aMaxCatchUpTicks)
+: mTicksPerSecond(aTicksPerSecond), mMaxCatchUpTicks(aMaxCatchUpTicks)
+{
+    if(aTicksPerSecond <= 0.0){
+        throw std::runtime_error("SimulationLoop tick rate must be greater than zero!");
+    }
+}
+
+SimulationLoop::~SimulationLoop(){
+    stop();
+}
+
+void SimulationLoop::start(tick_function_t aTickFunction, uint64_t aFirstTick){
+    if(mRunning.load()){
+        throw std::runtime_error("Attempting to start a SimulationLoop that is already running!");
+    }
+    if(!aTickFunction){
+        throw std::runtime_error("SimulationLoop::start() requires a valid tick function!");
+    }
+
+    mTickFunction = aTickFunction;
+    mTickCount = 0;
+    mDroppedTicks = 0;
+    mRunning = true;
+    mThread = std::thread(&SimulationLoop::run, this, aFirstTick);
+}
+
+void SimulationLoop::stop(){
+    mRunning = false;
+    if(mThread.joinable()){
+        mThread.join();
+    }
+}
+
+void SimulationLoop::run(uint64_t aFirstTick){
+    using clock = std::chrono::steady_clock;
+    const clock::duration tickDuration = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(getTickSeconds()));
+    const double tickSeconds = getTickSeconds();
+
+    uint64_t tick = aFirstTick;
+    clock::time_point nextDeadline = clock::now();
+
+    while(mRunning.load()){
+        uint32_t ticksThisWake = 0;
+        while(clock::now() >= nextDeadline && ticksThisWake < mMaxCatchUpTicks && mRunning.load()){
+            mTickFunction(tick, tickSeconds);
+            ++tick;
+            ++ticksThisWake;
+            ++mTickCount;
+            nextDeadline += tickDuration;
+        }
+
+        // Still behind after catching up as much as allowed. Drop the backlog rather than falling further behind.
+        clock::time_point now = clock::now();
+        if(now >= nextDeadline){
+            mDroppedTicks += static_cast<uint64_t>((now - nextDeadline) / tickDuration) + 1;
+            nextDeadline = now + tickDuration;
+        }
+
+        std::this_thread::sleep_until(nextDeadline);
+    }
+}
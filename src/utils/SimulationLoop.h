@@ -0,0 +1,52 @@
+#ifndef SIMULATION_LOOP_H_
+#define SIMULATION_LOOP_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+/** Runs a tick function on a dedicated thread at a fixed rate, independent of how fast frames are presented.
+ *
+ * Ticks are scheduled against absolute deadlines so that the rate doesn't drift. If a tick overruns, the loop
+ * catches up by running the missed ticks back to back, but never more than mMaxCatchUpTicks at a time. Beyond that
+ * the simulation is considered stalled and the schedule is reset instead of spiraling.
+ */
+class SimulationLoop
+{
+ public:
+    /// Arguments: index of the tick being simulated, and the fixed duration of a tick in seconds.
+    using tick_function_t = std::function<void(uint64_t aTick, double aTickSeconds)>;
+
+    explicit SimulationLoop(double aTicksPerSecond = 120.0, uint32_t aMaxCatchUpTicks = 8);
+    ~SimulationLoop();
+
+    SimulationLoop(const SimulationLoop& aOther) = delete;
+    SimulationLoop& operator=(const SimulationLoop& aOther) = delete;
+
+    /// Start ticking on a new thread. The first tick simulated is 'aFirstTick'.
+    void start(tick_function_t aTickFunction, uint64_t aFirstTick = 0);
+    /// Request the simulation thread to finish and join it. Safe to call if not running.
+    void stop();
+
+    bool isRunning() const {return(mRunning.load());}
+    double getTicksPerSecond() const {return(mTicksPerSecond);}
+    double getTickSeconds() const {return(1.0 / mTicksPerSecond);}
+    uint64_t getTickCount() const {return(mTickCount.load());}
+    uint64_t getDroppedTickCount() const {return(mDroppedTicks.load());}
+
+ protected:
+    void run(uint64_t aFirstTick);
+
+    const double mTicksPerSecond;
+    const uint32_t mMaxCatchUpTicks;
+
+    tick_function_t mTickFunction;
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+    std::atomic<uint64_t> mTickCount{0};
+    std::atomic<uint64_t> mDroppedTicks{0};
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "SpirvArchive.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+bool SpirvArchive::open(const std::string& aFilePath){
+    close();
+    if(!mFile.open(aFilePath)) return(false);
+
+    const uint8_t* base = mFile.data();
+    const size_t fileSize = mFile.size();
+    auto reject = [&](const std::string& aReason) -> bool {
+        std::cerr << "Warning: Ignoring shader archive '" << aFilePath << "': " << aReason << std::endl;
+        close();
+        return(false);
+    };
+
+    FileHeader header;
+    if(fileSize < sizeof(FileHeader)) return(reject("file is truncated"));
+    memcpy(&header, base, sizeof(FileHeader));
+    if(header.magic != sFileMagic) return(reject("not a shader archive"));
+    if(header.version != sFileVersion) return(reject("unsupported version " + std::to_string(header.version)));
+
+    const uint64_t tableEnd = sizeof(FileHeader) + uint64_t(header.entryCount) * sizeof(FileEntry);
+    if(tableEnd > fileSize) return(reject("entry table is truncated"));
+
+    for(uint32_t i = 0; i < header.entryCount; ++i){
+        FileEntry entry;
+        memcpy(&entry, base + sizeof(FileHeader) + i * sizeof(FileEntry), sizeof(FileEntry));
+        if(uint64_t(entry.nameOffset) + entry.nameSize > fileSize || uint64_t(entry.dataOffset) + entry.dataSize > fileSize){
+            return(reject("entry " + std::to_string(i) + " lies outside of the file"));
+        }
+        // Vulkan consumes SPIR-V as an array of words, which the page aligned mapping provides as long as offsets are aligned
+        if(entry.dataOffset % sizeof(uint32_t) != 0 || entry.dataSize % sizeof(uint32_t) != 0 || entry.dataSize == 0){
+            return(reject("entry " + std::to_string(i) + " is not word aligned"));
+        }
+
+        Blob blob;
+        blob.code = reinterpret_cast<const uint32_t*>(base + entry.dataOffset);
+        blob.size = entry.dataSize;
+        if(blob.code[0] != sSpirvMagic){
+            return(reject("entry " + std::to_string(i) + " is not SPIR-V"));
+        }
+        mEntries[std::string(reinterpret_cast<const char*>(base + entry.nameOffset), entry.nameSize)] = blob;
+    }
+    return(true);
+}
+
+void SpirvArchive::close(){
+    mEntries.clear();
+    mFile.close();
+}
+
+SpirvArchive::Blob SpirvArchive::find(const std::string& aName) const {
+    auto found = mEntries.find(aName);
+    if(found == mEntries.end()) return(Blob());
+    return(found->second);
+}
+
+std::vector<std::string> SpirvArchive::getNames() const {
+    std::vector<std::string> names;
+    names.reserve(mEntries.size());
+    for(const std::pair<const std::string, Blob>& entry : mEntries){
+        names.push_back(entry.first);
+    }
+    return(names);
+}
+
+bool SpirvArchive::write(const std::string& aFilePath, const std::vector<std::pair<std::string, std::vector<uint8_t>>>& aEntries){
+    FileHeader header;{
+        header.magic = sFileMagic;
+        header.version = sFileVersion;
+        header.entryCount = static_cast<uint32_t>(aEntries.size());
+        header.reserved = 0;
+    }
+
+    std::vector<FileEntry> table(aEntries.size());
+    uint64_t offset = sizeof(FileHeader) + table.size() * sizeof(FileEntry);
+    for(size_t i = 0; i < aEntries.size(); ++i){
+        table[i].nameOffset = static_cast<uint32_t>(offset);
+        table[i].nameSize = static_cast<uint32_t>(aEntries[i].first.size());
+        offset += aEntries[i].first.size();
+    }
+    for(size_t i = 0; i < aEntries.size(); ++i){
+        offset = (offset + sDataAlignment - 1) / sDataAlignment * sDataAlignment;
+        table[i].dataOffset = static_cast<uint32_t>(offset);
+        table[i].dataSize = static_cast<uint32_t>(aEntries[i].second.size());
+        offset += aEntries[i].second.size();
+    }
+    if(offset > UINT32_MAX) return(false);
+
+    std::ofstream file(aFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) return(false);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(FileEntry));
+    for(const std::pair<std::string, std::vector<uint8_t>>& entry : aEntries){
+        file.write(entry.first.data(), entry.first.size());
+    }
+    const char padding[sDataAlignment] = {};
+    for(size_t i = 0; i < aEntries.size(); ++i){
+        size_t written = static_cast<size_t>(file.tellp());
+        file.write(padding, table[i].dataOffset - written);
+        file.write(reinterpret_cast<const char*>(aEntries[i].second.data()), aEntries[i].second.size());
+    }
+    return(file.good());
+}
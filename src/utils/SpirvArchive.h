@@ -0,0 +1,76 @@
+#ifndef SPIRV_ARCHIVE_H_
+#define SPIRV_ARCHIVE_H_
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** Read access to a packed archive of named SPIR-V blobs.
+ *
+ * The whole archive is memory mapped by open(), so looking up and creating modules from any number of shaders
+ * costs a single open/mmap instead of one open/read/close per file. Layout (all values little endian uint32):
+ *
+ *     FileHeader  {magic 'SPVP', version, entryCount, reserved}
+ *     FileEntry   {nameOffset, nameSize, dataOffset, dataSize} x entryCount
+ *     entry names (not null terminated)
+ *     entry data, each blob aligned to 8 bytes
+ *
+ * Offsets are relative to the start of the file. Blobs returned by find() point into the mapping and stay valid
+ * until the archive is closed or destroyed.
+ */
+class SpirvArchive
+{
+ public:
+    struct Blob
+    {
+        const uint32_t* code = nullptr;
+        size_t size = 0; // In bytes
+    };
+
+    SpirvArchive(){}
+
+    /// Map and validate 'aFilePath'. Returns false if the file is missing; a corrupt archive is reported to std::cerr.
+    bool open(const std::string& aFilePath);
+    void close();
+    bool isOpen() const {return(mFile.isValid());}
+
+    /// Returns an empty blob if no entry has the given name.
+    Blob find(const std::string& aName) const;
+    std::vector<std::string> getNames() const;
+    size_t getEntryCount() const {return(mEntries.size());}
+    const std::string& getPath() const {return(mFile.getPath());}
+
+    /// Write an archive holding the given (name, SPIR-V) pairs. Returns false if the file could not be written.
+    static bool write(const std::string& aFilePath, const std::vector<std::pair<std::string, std::vector<uint8_t>>>& aEntries);
+
+    static const uint32_t sSpirvMagic = 0x07230203;
+
+ protected:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+    };
+
+    struct FileEntry
+    {
+        uint32_t nameOffset;
+        uint32_t nameSize;
+        uint32_t dataOffset;
+        uint32_t dataSize;
+    };
+
+    static const uint32_t sFileMagic = 0x50565053; // "SPVP"
+    static const uint32_t sFileVersion = 1;
+    static const uint32_t sDataAlignment = 8;
+
+    MappedFile mFile;
+    std::unordered_map<std::string, Blob> mEntries;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/** Lock-free, bounded single producer, single consumer FIFO queue.
+ *
+ * A ring of slots indexed by two ever increasing counters. The producer only writes the tail and the consumer
+ * only writes the head, so pushing and popping never block and never contend on the same cache line. Each
+ * side keeps a private copy of the other side's counter and only reloads it when the ring looks full or empty.
+ */
+template<typename T>
+class SpscQueue
+{
+ public:
+    using value_type = T;
+
+    /// 'aCapacity' is rounded up to the next power of two
+    explicit SpscQueue(size_t aCapacity = 64){
+        if(aCapacity == 0){
+            throw std::runtime_error("SpscQueue capacity must be at least 1!");
+        }
+        size_t capacity = 1;
+        while(capacity < aCapacity) capacity <<= 1;
+        mSlots.resize(capacity);
+        _mMask = capacity - 1;
+    }
+
+    SpscQueue(const SpscQueue& aOther) = delete;
+    SpscQueue& operator=(const SpscQueue& aOther) = delete;
+
+    /// Producer side: Move 'aValue' into the queue. Returns false, leaving 'aValue' untouched, if the queue is full.
+    bool tryPush(T&& aValue){
+        size_t tail = _mTail.load(std::memory_order_relaxed);
+        if(tail - _mCachedHead == mSlots.size()){
+            _mCachedHead = _mHead.load(std::memory_order_acquire);
+            if(tail - _mCachedHead == mSlots.size()) return(false);
+        }
+        mSlots[tail & _mMask] = std::move(aValue);
+        _mTail.store(tail + 1, std::memory_order_release);
+        return(true);
+    }
+
+    /// Consumer side: Move the oldest value into 'aValueOut'. Returns false if the queue is empty.
+    bool tryPop(T& aValueOut){
+        size_t head = _mHead.load(std::memory_order_relaxed);
+        if(head == _mCachedTail){
+            _mCachedTail = _mTail.load(std::memory_order_acquire);
+            if(head == _mCachedTail) return(false);
+        }
+        aValueOut = std::move(mSlots[head & _mMask]);
+        // Leave a default value behind so the slot doesn't keep resources alive until it is overwritten
+        mSlots[head & _mMask] = T();
+        _mHead.store(head + 1, std::memory_order_release);
+        return(true);
+    }
+
+    /// Approximate when called concurrently with the other side
+    size_t size() const {return(_mTail.load(std::memory_order_acquire) - _mHead.load(std::memory_order_acquire));}
+    bool empty() const {return(size() == 0);}
+    size_t capacity() const {return(mSlots.size());}
+
+ protected:
+    std::vector<T> mSlots;
+
+ private:
+    size_t _mMask = 0;
+
+    alignas(64) std::atomic<size_t> _mHead{0};
+    size_t _mCachedTail = 0;   // Consumer's copy of _mTail
+    alignas(64) std::atomic<size_t> _mTail{0};
+    size_t _mCachedHead = 0;   // Producer's copy of _mHead
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+/** Lock-free single producer, single consumer triple buffer.
+ *
+ * The producer always owns a private slot to write the next value into, the consumer always owns a private
+ * slot to read the latest value from, and the third slot is handed between the two with a single atomic
+ * exchange. Neither side ever blocks. If the producer publishes faster than the consumer reads, the
+ * intermediate values are dropped and the consumer only sees the most recently published one.
+ */
+template<typename T>
+class TripleBuffer
+{
+ public:
+    using value_type = T;
+
+    TripleBuffer() {}
+    explicit TripleBuffer(const T& aInitialValue) {mSlots.fill(aInitialValue);}
+
+    TripleBuffer(const TripleBuffer& aOther) = delete;
+    TripleBuffer& operator=(const TripleBuffer& aOther) = delete;
+
+    /// Producer side: Slot the next value should be written to. Only valid until the next call to publish().
+    T& getWriteBuffer() {return(mSlots[_mWriteIndex]);}
+
+    /// Producer side: Make the contents of the write buffer visible to the consumer and
+    /// take ownership of a different slot to write the next value into.
+    void publish(){
+        uint8_t previous = _mShared.exchange(static_cast<uint8_t>(_mWriteIndex | sFreshBit), std::memory_order_acq_rel);
+        _mWriteIndex = previous & sIndexMask;
+    }
+
+    /// Consumer side: Acquire the most recently published value if there is one that hasn't been seen yet.
+    /// Returns true if the read buffer changed.
+    bool update(){
+        if((_mShared.load(std::memory_order_relaxed) & sFreshBit) == 0) return(false);
+        uint8_t previous = _mShared.exchange(_mReadIndex, std::memory_order_acq_rel);
+        _mReadIndex = previous & sIndexMask;
+        return(true);
+    }
+
+    /// Consumer side: The latest value acquired by update().
+    const T& getReadBuffer() const {return(mSlots[_mReadIndex]);}
+
+    /// True if the producer has published a value the consumer has not yet acquired.
+    bool hasFreshValue() const {return((_mShared.load(std::memory_order_relaxed) & sFreshBit) != 0);}
+
+ protected:
+    std::array<T, 3> mSlots;
+
+ private:
+    static const uint8_t sIndexMask = 0x3;
+    static const uint8_t sFreshBit = 0x4;
+
+    uint8_t _mWriteIndex = 0;
+    std::atomic<uint8_t> _mShared{1};
+    uint8_t _mReadIndex = 2;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cmath>
+
+static float sign_not_zero(float aValue){
+    return(aValue >= 0.0f ? 1.0f : -1.0f);
+}
+
+static int16_t to_snorm16(float aValue){
+    return(static_cast<int16_t>(std::round(std::max(-1.0f, std::min(1.0f, aValue)) * 32767.0f)));
+}
+
+static float from_snorm16(int16_t aValue){
+    return(std::max(-1.0f, aValue / 32767.0f));
+}
+
+QuantizationTransform make_quantization(const glm::vec3& aMin, const glm::vec3& aMax){
+    QuantizationTransform transform;
+    transform.offset = aMin;
+    for(int axis = 0; axis < 3; ++axis){
+        transform.scale[axis] = std::max(aMax[axis] - aMin[axis], 1e-6f);
+    }
+    return(transform);
+}
+
+std::array<uint16_t, 4> quantize_position(const glm::vec3& aPosition, const QuantizationTransform& aTransform){
+    std::array<uint16_t, 4> quantized = {{0, 0, 0, 65535}};
+    for(int axis = 0; axis < 3; ++axis){
+        float normalized = (aPosition[axis] - aTransform.offset[axis]) / aTransform.scale[axis];
+        quantized[axis] = static_cast<uint16_t>(std::round(std::max(0.0f, std::min(1.0f, normalized)) * 65535.0f));
+    }
+    return(quantized);
+}
+
+glm::vec3 dequantize_position(const uint16_t* aQuantized, const QuantizationTransform& aTransform){
+    glm::vec3 position;
+    for(int axis = 0; axis < 3; ++axis){
+        position[axis] = aTransform.offset[axis] + aTransform.scale[axis] * (aQuantized[axis] / 65535.0f);
+    }
+    return(position);
+}
+
+// Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals, see
+// "A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al. 2014)
+std::array<int16_t, 2> encode_octahedral(const glm::vec3& aNormal){
+    float length = std::abs(aNormal.x) + std::abs(aNormal.y) + std::abs(aNormal.z);
+    std::array<int16_t, 2> encoded = {{0, 0}};
+    if(length == 0.0f) return(encoded);
+    float x = aNormal.x / length;
+    float y = aNormal.y / length;
+    if(aNormal.z < 0.0f){
+        float foldedX = (1.0f - std::abs(y)) * sign_not_zero(x);
+        float foldedY = (1.0f - std::abs(x)) * sign_not_zero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = to_snorm16(x);
+    encoded[1] = to_snorm16(y);
+    return(encoded);
+}
+
+glm::vec3 decode_octahedral(const int16_t* aEncoded){
+    glm::vec3 normal(from_snorm16(aEncoded[0]), from_snorm16(aEncoded[1]), 0.0f);
+    normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+    float fold = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return(glm::normalize(normal));
+}
+
+std::array<uint8_t, 4> pack_color(const glm::vec4& aColor){
+    std::array<uint8_t, 4> packed;
+    for(int channel = 0; channel < 4; ++channel){
+        packed[channel] = static_cast<uint8_t>(std::round(std::max(0.0f, std::min(1.0f, aColor[channel])) * 255.0f));
+    }
+    return(packed);
+}
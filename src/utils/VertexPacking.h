@@ -0,0 +1,51 @@
+#ifndef VERTEX_PACKING_H_
+#define VERTEX_PACKING_H_
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+
+/* Compact vertex formats and the conversions into them.
+ *
+ * Positions are stored as 16 bit unsigned normalized values relative to the mesh bounds and expanded again by a
+ * per-mesh QuantizationTransform, which can be folded into the model matrix so shaders read them as plain [0, 1]
+ * coordinates. Normals are octahedral encoded into two 16 bit signed normalized values. Both keep the error well
+ * below what is visible at typical mesh scales while fetching a fraction of the bytes of 32 bit floats.
+ */
+
+/// Maps quantized [0, 1] positions back to object space: position = offset + scale * quantized
+struct QuantizationTransform
+{
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+/// 12 bytes. VK_FORMAT_R16G16B16A16_UNORM position (w unused) and VK_FORMAT_R16G16_SNORM octahedral normal.
+struct PackedVertex
+{
+    uint16_t position[4];
+    int16_t normal[2];
+};
+
+/// 16 bytes. PackedVertex with an additional VK_FORMAT_R8G8B8A8_UNORM color.
+struct PackedColorVertex
+{
+    uint16_t position[4];
+    int16_t normal[2];
+    uint8_t color[4];
+};
+
+/// Quantization covering the box from 'aMin' to 'aMax'. Flat axes get a tiny extent to keep the transform invertible.
+QuantizationTransform make_quantization(const glm::vec3& aMin, const glm::vec3& aMax);
+
+/// Quantize 'aPosition' (which should lie inside the quantization's box) to 16 bit unsigned normalized values.
+std::array<uint16_t, 4> quantize_position(const glm::vec3& aPosition, const QuantizationTransform& aTransform);
+glm::vec3 dequantize_position(const uint16_t* aQuantized, const QuantizationTransform& aTransform);
+
+/// Octahedral encoding of the unit vector 'aNormal' into 16 bit signed normalized values, and its inverse.
+std::array<int16_t, 2> encode_octahedral(const glm::vec3& aNormal);
+glm::vec3 decode_octahedral(const int16_t* aEncoded);
+
+std::array<uint8_t, 4> pack_color(const glm::vec4& aColor);
+
+#endif
@@ -0,0 +1,619 @@
+#include "GpuInstanceCuller.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace vkutils;
+
+// Contents of the CullParams buffer of cull_instances.glinl
+struct CullParams
+{
+    glm::mat4 modelView;
+    glm::mat4 projection;
+    glm::vec4 planes[6];
+    uint32_t instanceCount;
+    uint32_t rangeCount;
+    uint32_t compact;
+    uint32_t padding;
+    GpuInstanceCuller::DrawRange ranges[GpuInstanceCuller::MAX_RANGES];
+};
+
+const static uint32_t sWorkgroupSize = 64;
+const static uint32_t sPyramidWorkgroupSize = 8;
+
+static uint32_t previous_power_of_two(uint32_t aValue){
+    uint32_t power = 1;
+    while(power <= aValue / 2) power *= 2;
+    return(power);
+}
+
+bool GpuInstanceCuller::isSupported(const VulkanDevice& aDevice){
+    // Draws select their instance through firstInstance
+    return(aDevice.getEnabledFeatures().drawIndirectFirstInstance == VK_TRUE);
+}
+
+void GpuInstanceCuller::init(
+    const VulkanDeviceBundle& aDeviceBundle, VkShaderModule aShader, const std::vector<glm::vec4>& aSpheres,
+    size_t aImageCount, const OcclusionSetup* aOcclusion
+){
+    if(isValid()) destroy();
+    if(!isSupported(aDeviceBundle.logicalDevice)){
+        throw std::runtime_error("GpuInstanceCuller::init() Error: The device was created without drawIndirectFirstInstance!");
+    }
+    if(aSpheres.empty() || aImageCount == 0){
+        throw std::runtime_error("GpuInstanceCuller::init() Error: Nothing to cull!");
+    }
+    mDevice = aDeviceBundle.logicalDevice.handle();
+    mPhysicalDevice = aDeviceBundle.physicalDevice.handle();
+    mComputeQueue = aDeviceBundle.logicalDevice.getComputeQueue();
+    mInstanceCount = static_cast<uint32_t>(aSpheres.size());
+
+    // Buffers written on the compute queue and read by the graphics queue are shared if the families differ. With
+    // occlusion everything stays on the graphics queue.
+    mQueueFamilies.assign(1, *aDeviceBundle.physicalDevice.mGraphicsIdx);
+    if(aOcclusion == nullptr && *aDeviceBundle.physicalDevice.mComputeIdx != mQueueFamilies[0]){
+        mQueueFamilies.insert(mQueueFamilies.begin(), *aDeviceBundle.physicalDevice.mComputeIdx);
+    }
+
+    mMultiDrawIndirect = aDeviceBundle.logicalDevice.getEnabledFeatures().multiDrawIndirect == VK_TRUE;
+    mMaxDrawIndirectCount = mMultiDrawIndirect ? std::max(aDeviceBundle.physicalDevice.mProperites.limits.maxDrawIndirectCount, 1U) : 1U;
+    mDrawIndexedIndirectCount = nullptr;
+    if(aDeviceBundle.logicalDevice.isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)){
+        mDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(mDevice, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
+
+    mSpheres = createBuffer(aSpheres.size() * sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    memcpy(mSpheres.mapped, aSpheres.data(), aSpheres.size() * sizeof(glm::vec4));
+
+    if(aOcclusion != nullptr){
+        // Nothing was visible before the first frame, so its late phase draws everything in the frustum
+        mVisibility = createBuffer(aSpheres.size() * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        memset(mVisibility.mapped, 0, aSpheres.size() * sizeof(uint32_t));
+        initPyramid(*aOcclusion);
+    }
+    initPipeline(aShader);
+    initFrames(aImageCount);
+}
+
+void GpuInstanceCuller::destroy(){
+    if(!isValid()) return;
+    for(Frame& frame : mFrames){
+        destroyBuffer(frame.params);
+        destroyBuffer(frame.draws);
+        destroyBuffer(frame.count);
+    }
+    mFrames.clear();
+    destroyBuffer(mSpheres);
+    destroyBuffer(mVisibility);
+
+    // Destroying the pools frees the command buffers and descriptor sets allocated from them
+    vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    vkDestroyPipeline(mDevice, mPipeline, nullptr);
+    vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+    mDescriptorPool = VK_NULL_HANDLE;
+    mPipeline = VK_NULL_HANDLE;
+    mPipelineLayout = VK_NULL_HANDLE;
+    mDescriptorSetLayout = VK_NULL_HANDLE;
+
+    vkDestroyPipeline(mDevice, mPyramidPipeline, nullptr);
+    vkDestroyPipelineLayout(mDevice, mPyramidPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(mDevice, mPyramidSetLayout, nullptr);
+    vkDestroySampler(mDevice, mPyramidSampler, nullptr);
+    for(VkImageView view : mPyramidLevelViews) vkDestroyImageView(mDevice, view, nullptr);
+    vkDestroyImageView(mDevice, mPyramidView, nullptr);
+    vkDestroyImage(mDevice, mPyramid, nullptr);
+    vkFreeMemory(mDevice, mPyramidMemory, nullptr);
+    mPyramidPipeline = VK_NULL_HANDLE;
+    mPyramidPipelineLayout = VK_NULL_HANDLE;
+    mPyramidSetLayout = VK_NULL_HANDLE;
+    mPyramidSampler = VK_NULL_HANDLE;
+    mPyramidLevelViews.clear();
+    mPyramidSets.clear();
+    mPyramidView = VK_NULL_HANDLE;
+    mPyramid = VK_NULL_HANDLE;
+    mPyramidMemory = VK_NULL_HANDLE;
+    mDepthImage = VK_NULL_HANDLE;
+    mDepthView = VK_NULL_HANDLE;
+
+    mInstanceCount = 0;
+    mDevice = VK_NULL_HANDLE;
+}
+
+void GpuInstanceCuller::update(uint32_t aImageIndex, const glm::mat4& aModelView, const glm::mat4& aProjection, const std::vector<DrawRange>& aRanges){
+    if(aImageIndex >= mFrames.size()) return;
+
+    const Frustum frustum = extract_frustum(aProjection * aModelView);
+    CullParams params;{
+        params.modelView = aModelView;
+        params.projection = aProjection;
+        std::copy(frustum.planes, frustum.planes + 6, params.planes);
+        params.instanceCount = mInstanceCount;
+        params.rangeCount = static_cast<uint32_t>(std::min<size_t>(aRanges.size(), MAX_RANGES));
+        params.compact = usesDrawCount() ? 1U : 0U;
+        params.padding = 0;
+        std::copy(aRanges.begin(), aRanges.begin() + params.rangeCount, params.ranges);
+    }
+    // Coherent memory, and submitting makes host writes visible to the device
+    memcpy(mFrames[aImageIndex].params.mapped, &params, sizeof(params));
+}
+
+void GpuInstanceCuller::submit(uint32_t aImageIndex, VkSemaphore aSignalSemaphore){
+    if(usesOcclusion()){
+        throw std::runtime_error("GpuInstanceCuller::submit() Error: Occlusion culling is recorded into the graphics commands!");
+    }
+    VkSubmitInfo submitInfo = {
+        VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr,
+        0, nullptr, nullptr,
+        1, &mFrames[aImageIndex].commands,
+        1, &aSignalSemaphore
+    };
+    if(vkQueueSubmit(mComputeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::submit() Error: Submit to compute queue failed!");
+    }
+}
+
+void GpuInstanceCuller::recordCull(VkCommandBuffer aCommandBuffer, uint32_t aImageIndex, CullPhase aPhase) const{
+    if(aPhase == CULL_LATE) recordPyramid(aCommandBuffer);
+    recordDispatch(aCommandBuffer, mFrames[aImageIndex], aPhase);
+
+    // The draws of the phase follow in the same command buffer
+    VkMemoryBarrier drawBarrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT};
+    vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuInstanceCuller::recordDraws(VkCommandBuffer aCommandBuffer, uint32_t aImageIndex, CullPhase aPhase) const{
+    const Frame& frame = mFrames[aImageIndex];
+    const uint32_t slotCount = mInstanceCount * MAX_RANGES;
+    const VkDeviceSize listOffset = aPhase * slotCount * sizeof(VkDrawIndexedIndirectCommand);
+    if(mDrawIndexedIndirectCount != nullptr){
+        mDrawIndexedIndirectCount(aCommandBuffer, frame.draws.buffer, listOffset, frame.count.buffer, aPhase * sizeof(uint32_t), slotCount, sizeof(VkDrawIndexedIndirectCommand));
+        return;
+    }
+    // Without a count every slot is drawn. Those of culled instances and unused ranges have no instances.
+    for(uint32_t first = 0; first < slotCount; first += mMaxDrawIndirectCount){
+        uint32_t drawCount = std::min(slotCount - first, mMaxDrawIndirectCount);
+        vkCmdDrawIndexedIndirect(aCommandBuffer, frame.draws.buffer, listOffset + first * sizeof(VkDrawIndexedIndirectCommand), drawCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+uint32_t GpuInstanceCuller::findMemoryType(uint32_t aTypeBits, VkMemoryPropertyFlags aProperties) const{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memoryProperties);
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i){
+        if((aTypeBits & (1U << i)) && (memoryProperties.memoryTypes[i].propertyFlags & aProperties) == aProperties) return(i);
+    }
+    throw std::runtime_error("GpuInstanceCuller::findMemoryType() Error: No suitable memory type!");
+}
+
+GpuInstanceCuller::Buffer GpuInstanceCuller::createBuffer(VkDeviceSize aSize, VkBufferUsageFlags aUsage, VkMemoryPropertyFlags aProperties) const{
+    Buffer result;
+    VkBufferCreateInfo createInfo;{
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.size = aSize;
+        createInfo.usage = aUsage;
+        createInfo.sharingMode = mQueueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+        createInfo.queueFamilyIndexCount = mQueueFamilies.size() > 1 ? static_cast<uint32_t>(mQueueFamilies.size()) : 0U;
+        createInfo.pQueueFamilyIndices = mQueueFamilies.size() > 1 ? mQueueFamilies.data() : nullptr;
+    }
+    if(vkCreateBuffer(mDevice, &createInfo, nullptr, &result.buffer) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::createBuffer() Error: Failed to create buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(mDevice, result.buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo;{
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, aProperties);
+    }
+    if(vkAllocateMemory(mDevice, &allocInfo, nullptr, &result.memory) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::createBuffer() Error: Failed to allocate buffer memory!");
+    }
+    vkBindBufferMemory(mDevice, result.buffer, result.memory, 0);
+
+    // Host visible buffers stay mapped for as long as they live
+    if(aProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
+        if(vkMapMemory(mDevice, result.memory, 0, VK_WHOLE_SIZE, 0, &result.mapped) != VK_SUCCESS){
+            throw std::runtime_error("GpuInstanceCuller::createBuffer() Error: Failed to map buffer memory!");
+        }
+    }
+    return(result);
+}
+
+void GpuInstanceCuller::destroyBuffer(Buffer& aBuffer) const{
+    vkDestroyBuffer(mDevice, aBuffer.buffer, nullptr);
+    // Freeing mapped memory unmaps it
+    vkFreeMemory(mDevice, aBuffer.memory, nullptr);
+    aBuffer = Buffer();
+}
+
+VkDescriptorSetLayout GpuInstanceCuller::createSetLayout(const std::vector<VkDescriptorType>& aBindings) const{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(aBindings.size());
+    for(uint32_t i = 0; i < bindings.size(); ++i){
+        bindings[i].binding = i;
+        bindings[i].descriptorType = aBindings[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo;{
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = nullptr;
+        layoutInfo.flags = 0;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+    }
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    if(vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::createSetLayout() Error: Failed to create descriptor set layout!");
+    }
+    return(layout);
+}
+
+VkPipeline GpuInstanceCuller::createPipeline(VkShaderModule aShader, VkPipelineLayout aLayout) const{
+    VkComputePipelineCreateInfo pipelineInfo;{
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.pNext = nullptr;
+        pipelineInfo.flags = 0;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.pNext = nullptr;
+        pipelineInfo.stage.flags = 0;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = aShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = nullptr;
+        pipelineInfo.layout = aLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+    }
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if(vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::createPipeline() Error: Failed to create compute pipeline!");
+    }
+    return(pipeline);
+}
+
+void GpuInstanceCuller::initPipeline(VkShaderModule aShader){
+    // Spheres, params, draws and count, then the visibility and the depth pyramid for occlusion
+    std::vector<VkDescriptorType> bindings(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    if(usesOcclusion()){
+        bindings.push_back(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        bindings.push_back(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    }
+    mDescriptorSetLayout = createSetLayout(bindings);
+
+    // The phase is all that differs between the two dispatches of a frame
+    VkPushConstantRange phaseRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t)};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;{
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.pNext = nullptr;
+        pipelineLayoutInfo.flags = 0;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &phaseRange;
+    }
+    if(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initPipeline() Error: Failed to create pipeline layout!");
+    }
+    mPipeline = createPipeline(aShader, mPipelineLayout);
+}
+
+void GpuInstanceCuller::initPyramid(const OcclusionSetup& aOcclusion){
+    mDepthImage = aOcclusion.depthImage;
+    const bool hasStencil = aOcclusion.depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || aOcclusion.depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+    mDepthAspects = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+
+    // A power of two at most the size of the depth attachment, so every level is exactly half the one before it
+    mPyramidExtent = {previous_power_of_two(aOcclusion.depthExtent.width), previous_power_of_two(aOcclusion.depthExtent.height)};
+    uint32_t levelCount = 1;
+    while((std::max(mPyramidExtent.width, mPyramidExtent.height) >> levelCount) > 0) ++levelCount;
+
+    VkImageCreateInfo imageInfo = {};{
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R32_SFLOAT;
+        imageInfo.extent = {mPyramidExtent.width, mPyramidExtent.height, 1};
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    if(vkCreateImage(mDevice, &imageInfo, nullptr, &mPyramid) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initPyramid() Error: Failed to create depth pyramid!");
+    }
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(mDevice, mPyramid, &requirements);
+    VkMemoryAllocateInfo allocInfo;{
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    if(vkAllocateMemory(mDevice, &allocInfo, nullptr, &mPyramidMemory) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initPyramid() Error: Failed to allocate depth pyramid memory!");
+    }
+    vkBindImageMemory(mDevice, mPyramid, mPyramidMemory, 0);
+
+    // A view of every level for the culling shader, and one of each level on its own to build them
+    mPyramidLevelViews.resize(levelCount);
+    for(uint32_t level = 0; level <= levelCount; ++level){
+        VkImageViewCreateInfo viewInfo = {};{
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = mPyramid;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = VK_FORMAT_R32_SFLOAT;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = level < levelCount ? level : 0;
+            viewInfo.subresourceRange.levelCount = level < levelCount ? 1 : levelCount;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+        }
+        VkImageView& view = level < levelCount ? mPyramidLevelViews[level] : mPyramidView;
+        if(vkCreateImageView(mDevice, &viewInfo, nullptr, &view) != VK_SUCCESS){
+            throw std::runtime_error("GpuInstanceCuller::initPyramid() Error: Failed to create depth pyramid view!");
+        }
+    }
+
+    // Only read with texelFetch(), which ignores filtering
+    VkSamplerCreateInfo samplerInfo = {};{
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = static_cast<float>(levelCount);
+    }
+    if(vkCreateSampler(mDevice, &samplerInfo, nullptr, &mPyramidSampler) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initPyramid() Error: Failed to create depth pyramid sampler!");
+    }
+
+    mPyramidSetLayout = createSetLayout({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE});
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;{
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.pNext = nullptr;
+        pipelineLayoutInfo.flags = 0;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &mPyramidSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    }
+    if(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPyramidPipelineLayout) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initPyramid() Error: Failed to create pipeline layout!");
+    }
+    mPyramidPipeline = createPipeline(aOcclusion.pyramidShader, mPyramidPipelineLayout);
+
+    // The sets of the levels are allocated once the descriptor pool exists, see initFrames()
+    mDepthView = aOcclusion.depthView;
+    mPyramidSets.assign(levelCount, VK_NULL_HANDLE);
+}
+
+void GpuInstanceCuller::initFrames(size_t aImageCount){
+    const uint32_t imageCount = static_cast<uint32_t>(aImageCount);
+    const uint32_t levelCount = static_cast<uint32_t>(mPyramidLevelViews.size());
+    const uint32_t bindingCount = usesOcclusion() ? 6 : 4;
+    std::vector<VkDescriptorPoolSize> poolSizes = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, imageCount * 5}};
+    if(usesOcclusion()){
+        poolSizes.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount + levelCount});
+        poolSizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levelCount});
+    }
+    VkDescriptorPoolCreateInfo poolInfo;{
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.pNext = nullptr;
+        poolInfo.flags = 0;
+        poolInfo.maxSets = imageCount + levelCount;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+    }
+    if(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::initFrames() Error: Failed to create descriptor pool!");
+    }
+
+    // Occlusion culling is recorded into the graphics commands and needs no pool of its own
+    if(!usesOcclusion()){
+        VkCommandPoolCreateInfo commandPoolInfo;{
+            commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            commandPoolInfo.pNext = nullptr;
+            commandPoolInfo.flags = 0;
+            commandPoolInfo.queueFamilyIndex = mQueueFamilies[0];
+        }
+        if(vkCreateCommandPool(mDevice, &commandPoolInfo, nullptr, &mCommandPool) != VK_SUCCESS){
+            throw std::runtime_error("GpuInstanceCuller::initFrames() Error: Failed to create command pool for compute queue!");
+        }
+    }
+
+    // Level 0 reduces the depth attachment, every other level the one before it
+    for(uint32_t level = 0; level < levelCount; ++level){
+        VkDescriptorSetAllocateInfo allocInfo;{
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.descriptorPool = mDescriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &mPyramidSetLayout;
+        }
+        if(vkAllocateDescriptorSets(mDevice, &allocInfo, &mPyramidSets[level]) != VK_SUCCESS){
+            throw std::runtime_error("GpuInstanceCuller::initFrames() Error: Failed to allocate descriptor set!");
+        }
+        const VkDescriptorImageInfo sourceInfo = level == 0
+            ? VkDescriptorImageInfo{mPyramidSampler, mDepthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
+            : VkDescriptorImageInfo{mPyramidSampler, mPyramidLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+        const VkDescriptorImageInfo targetInfo = {VK_NULL_HANDLE, mPyramidLevelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        VkWriteDescriptorSet writes[2];
+        for(uint32_t i = 0; i < 2; ++i){
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].pNext = nullptr;
+            writes[i].dstSet = mPyramidSets[level];
+            writes[i].dstBinding = i;
+            writes[i].dstArrayElement = 0;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[i].pImageInfo = i == 0 ? &sourceInfo : &targetInfo;
+            writes[i].pBufferInfo = nullptr;
+            writes[i].pTexelBufferView = nullptr;
+        }
+        vkUpdateDescriptorSets(mDevice, 2, writes, 0, nullptr);
+    }
+
+    mFrames.resize(aImageCount);
+    const uint32_t phaseCount = usesOcclusion() ? 2 : 1;
+    const VkDeviceSize drawsSize = static_cast<VkDeviceSize>(mInstanceCount) * MAX_RANGES * phaseCount * sizeof(VkDrawIndexedIndirectCommand);
+    for(Frame& frame : mFrames){
+        frame.params = createBuffer(sizeof(CullParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.draws = createBuffer(drawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        frame.count = createBuffer(2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // An empty frustum test until the first update(), which keeps every instance
+        CullParams params = {};
+        params.instanceCount = mInstanceCount;
+        params.compact = usesDrawCount() ? 1U : 0U;
+        memcpy(frame.params.mapped, &params, sizeof(params));
+
+        VkDescriptorSetAllocateInfo allocInfo;{
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.pNext = nullptr;
+            allocInfo.descriptorPool = mDescriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &mDescriptorSetLayout;
+        }
+        if(vkAllocateDescriptorSets(mDevice, &allocInfo, &frame.descriptorSet) != VK_SUCCESS){
+            throw std::runtime_error("GpuInstanceCuller::initFrames() Error: Failed to allocate descriptor set!");
+        }
+        const VkDescriptorBufferInfo bufferInfos[5] = {
+            {mSpheres.buffer, 0, VK_WHOLE_SIZE},
+            {frame.params.buffer, 0, VK_WHOLE_SIZE},
+            {frame.draws.buffer, 0, VK_WHOLE_SIZE},
+            {frame.count.buffer, 0, VK_WHOLE_SIZE},
+            {mVisibility.buffer, 0, VK_WHOLE_SIZE}
+        };
+        const VkDescriptorImageInfo pyramidInfo = {mPyramidSampler, mPyramidView, VK_IMAGE_LAYOUT_GENERAL};
+        VkWriteDescriptorSet writes[6];
+        for(uint32_t i = 0; i < bindingCount; ++i){
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].pNext = nullptr;
+            writes[i].dstSet = frame.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].dstArrayElement = 0;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i < 5 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[i].pImageInfo = i < 5 ? nullptr : &pyramidInfo;
+            writes[i].pBufferInfo = i < 5 ? &bufferInfos[i] : nullptr;
+            writes[i].pTexelBufferView = nullptr;
+        }
+        vkUpdateDescriptorSets(mDevice, bindingCount, writes, 0, nullptr);
+
+        if(!usesOcclusion()) recordPass(frame);
+    }
+}
+
+void GpuInstanceCuller::recordPass(Frame& aFrame){
+    VkCommandBufferAllocateInfo allocInfo;{
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.commandPool = mCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+    }
+    if(vkAllocateCommandBuffers(mDevice, &allocInfo, &aFrame.commands) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::recordPass() Error: Failed to allocate command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, 0, nullptr};
+    if(vkBeginCommandBuffer(aFrame.commands, &beginInfo) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::recordPass() Error: Failed to begin command recording!");
+    }
+    // The semaphore signaled on submission makes the results available to the draws
+    recordDispatch(aFrame.commands, aFrame, CULL_EARLY);
+    if(vkEndCommandBuffer(aFrame.commands) != VK_SUCCESS){
+        throw std::runtime_error("GpuInstanceCuller::recordPass() Error: Failed to end command buffer!");
+    }
+}
+
+void GpuInstanceCuller::recordDispatch(VkCommandBuffer aCommandBuffer, const Frame& aFrame, CullPhase aPhase) const{
+    // The count of the phase is reset before the shader adds to it. The barrier also orders the visibility written
+    // by the previous frame's late phase before this frame reads it.
+    vkCmdFillBuffer(aCommandBuffer, aFrame.count.buffer, aPhase * sizeof(uint32_t), sizeof(uint32_t), 0);
+    VkMemoryBarrier fillBarrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+    vkCmdPipelineBarrier(
+        aCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &fillBarrier, 0, nullptr, 0, nullptr
+    );
+
+    const uint32_t phase = aPhase;
+    vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &aFrame.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(aCommandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+    vkCmdDispatch(aCommandBuffer, (mInstanceCount + sWorkgroupSize - 1) / sWorkgroupSize, 1, 1);
+}
+
+void GpuInstanceCuller::recordPyramid(VkCommandBuffer aCommandBuffer) const{
+    VkImageMemoryBarrier depthBarrier;{
+        depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        depthBarrier.pNext = nullptr;
+        depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        depthBarrier.image = mDepthImage;
+        depthBarrier.subresourceRange = {mDepthAspects, 0, 1, 0, 1};
+    }
+    // Every level is rewritten, so the previous contents are discarded once the last frame is done reading them
+    VkImageMemoryBarrier pyramidBarrier;{
+        pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        pyramidBarrier.pNext = nullptr;
+        pyramidBarrier.srcAccessMask = 0;
+        pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        pyramidBarrier.image = mPyramid;
+        pyramidBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+    }
+    const VkImageMemoryBarrier startBarriers[2] = {depthBarrier, pyramidBarrier};
+    vkCmdPipelineBarrier(
+        aCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 2, startBarriers
+    );
+
+    vkCmdBindPipeline(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPyramidPipeline);
+    for(uint32_t level = 0; level < mPyramidSets.size(); ++level){
+        const uint32_t width = std::max(mPyramidExtent.width >> level, 1U);
+        const uint32_t height = std::max(mPyramidExtent.height >> level, 1U);
+        vkCmdBindDescriptorSets(aCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPyramidPipelineLayout, 0, 1, &mPyramidSets[level], 0, nullptr);
+        vkCmdDispatch(aCommandBuffer, (width + sPyramidWorkgroupSize - 1) / sPyramidWorkgroupSize, (height + sPyramidWorkgroupSize - 1) / sPyramidWorkgroupSize, 1);
+
+        // The next level and the late phase read this one
+        VkImageMemoryBarrier levelBarrier = pyramidBarrier;
+        levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        levelBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        vkCmdPipelineBarrier(aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+    }
+
+    // Back to an attachment for the late render pass, which loads it
+    depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    vkCmdPipelineBarrier(
+        aCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &depthBarrier
+    );
+}
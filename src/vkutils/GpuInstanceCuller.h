@@ -0,0 +1,182 @@
+#ifndef GPU_INSTANCE_CULLER_H_
+#define GPU_INSTANCE_CULLER_H_
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "VulkanDevices.h"
+#include "../utils/Culling.h"
+
+namespace vkutils{
+
+/** Culls the instances of a mesh on the GPU and draws the survivors indirectly.
+ *
+ * Every instance has a bounding sphere, uploaded once by init(). Each frame a compute shader tests every sphere and
+ * writes a VkDrawIndexedIndirectCommand per index range of each visible instance, with the instance as firstInstance
+ * so the instance rate vertex attributes of that instance are read. The host only writes the transforms and the index
+ * ranges, so the CPU cost of a frame does not depend on the number of instances.
+ *
+ * Without occlusion, instances are only tested against the view frustum (cull_instances.comp). There is one set of
+ * buffers and one prerecorded compute command buffer per swapchain image. submit() runs the pass on the device's
+ * compute queue and signals a semaphore that the graphics submission must wait on at
+ * VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT. recordDraws() records the indirect draws into the graphics commands once.
+ *
+ * With occlusion (cull_instances_occlusion.comp), culling runs in two phases recorded into the graphics commands by
+ * recordCull(). The early phase, before the first render pass, draws the instances in the frustum that were visible
+ * last frame. After that pass the depth attachment is reduced into a depth pyramid (Hi-Z) holding the farthest depth
+ * of ever larger areas, and the late phase tests the screen rectangle of every sphere in the frustum against it. Its
+ * results decide what the next frame's early phase draws, and the instances it finds visible that the early phase
+ * skipped are drawn by a second render pass, so instances coming out from behind others never show up a frame late.
+ * Everything runs on the graphics queue, as the late phase depends on the depth of the same frame.
+ *
+ * With VK_KHR_draw_indirect_count enabled, visible draws are packed to the front of the buffer and counted on the
+ * GPU. Otherwise every instance keeps a slot per range, culled ones with no instances, and all slots are drawn with
+ * multi-draw indirect, or one indirect draw each if that feature is missing too. Either way the device must have
+ * drawIndirectFirstInstance enabled, see isSupported().
+ */
+class GpuInstanceCuller
+{
+ public:
+    /// Index ranges drawn per instance. update() draws only the first MAX_RANGES of longer lists.
+    const static uint32_t MAX_RANGES = 4;
+
+    enum CullPhase : uint32_t
+    {
+        CULL_EARLY = 0,
+        CULL_LATE = 1
+    };
+
+    /// Part of the bound index buffer drawn for each visible instance, laid out as in the shader
+    struct DrawRange
+    {
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t padding = 0;
+    };
+
+    /// Depth attachment tested against for occlusion culling. It must have been created with
+    /// VK_IMAGE_USAGE_SAMPLED_BIT, and 'depthView' must only have the depth aspect.
+    struct OcclusionSetup
+    {
+        // Module of depth_pyramid.comp
+        VkShaderModule pyramidShader = VK_NULL_HANDLE;
+        VkImage depthImage = VK_NULL_HANDLE;
+        VkImageView depthView = VK_NULL_HANDLE;
+        VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+        VkExtent2D depthExtent = {0, 0};
+    };
+
+    GpuInstanceCuller(){}
+
+    /// Whether 'aDevice' was created with the features the culler needs
+    static bool isSupported(const VulkanDevice& aDevice);
+
+    /** Create the pipelines and the buffers for 'aImageCount' swapchain images, and upload one bounding sphere per
+     * instance (center in xyz, radius in w). 'aShader' is the module of cull_instances.comp, or of
+     * cull_instances_occlusion.comp if 'aOcclusion' is given. Throws on failure.
+     */
+    void init(
+        const VulkanDeviceBundle& aDeviceBundle, VkShaderModule aShader, const std::vector<glm::vec4>& aSpheres,
+        size_t aImageCount, const OcclusionSetup* aOcclusion = nullptr
+    );
+    bool isValid() const {return(mDevice != VK_NULL_HANDLE);}
+
+    /// Destroy everything created by init(). The device must not be using any of it.
+    void destroy();
+
+    /** Set the transforms from the space of the spheres to view space and on to clip space, and the index ranges the
+     * next pass of image 'aImageIndex' draws. The previous submission for the image must have finished. The
+     * occlusion test expects a symmetric perspective projection with depth from 0 to 1.
+     */
+    void update(uint32_t aImageIndex, const glm::mat4& aModelView, const glm::mat4& aProjection, const std::vector<DrawRange>& aRanges);
+
+    /// Without occlusion, submit the pass of image 'aImageIndex' to the compute queue, signaling 'aSignalSemaphore'
+    /// when done. The caller must hold whatever guards the queue.
+    void submit(uint32_t aImageIndex, VkSemaphore aSignalSemaphore);
+
+    /** With occlusion, record a phase of image 'aImageIndex' into graphics commands, outside of a render pass. The
+     * late phase first builds the depth pyramid, so the depth attachment must have been stored by the render pass
+     * before it, in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, and is returned to that layout.
+     */
+    void recordCull(VkCommandBuffer aCommandBuffer, uint32_t aImageIndex, CullPhase aPhase) const;
+
+    /// Record the draws of a phase of image 'aImageIndex' into a render pass, with the pipeline, vertex and index
+    /// buffers bound. Without occlusion there is only the early phase.
+    void recordDraws(VkCommandBuffer aCommandBuffer, uint32_t aImageIndex, CullPhase aPhase = CULL_EARLY) const;
+
+    uint32_t getInstanceCount() const {return(mInstanceCount);}
+    size_t getImageCount() const {return(mFrames.size());}
+    bool usesDrawCount() const {return(mDrawIndexedIndirectCount != nullptr);}
+    bool usesOcclusion() const {return(mPyramid != VK_NULL_HANDLE);}
+
+ protected:
+    struct Buffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+    };
+
+    // Resources of one swapchain image
+    struct Frame
+    {
+        Buffer params;
+        Buffer draws;
+        Buffer count;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+    };
+
+    uint32_t findMemoryType(uint32_t aTypeBits, VkMemoryPropertyFlags aProperties) const;
+    Buffer createBuffer(VkDeviceSize aSize, VkBufferUsageFlags aUsage, VkMemoryPropertyFlags aProperties) const;
+    void destroyBuffer(Buffer& aBuffer) const;
+    VkDescriptorSetLayout createSetLayout(const std::vector<VkDescriptorType>& aBindings) const;
+    VkPipeline createPipeline(VkShaderModule aShader, VkPipelineLayout aLayout) const;
+    void initPipeline(VkShaderModule aShader);
+    void initPyramid(const OcclusionSetup& aOcclusion);
+    void initFrames(size_t aImageCount);
+    void recordPass(Frame& aFrame);
+    void recordDispatch(VkCommandBuffer aCommandBuffer, const Frame& aFrame, CullPhase aPhase) const;
+    void recordPyramid(VkCommandBuffer aCommandBuffer) const;
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+    VkQueue mComputeQueue = VK_NULL_HANDLE;
+    std::vector<uint32_t> mQueueFamilies;
+    bool mMultiDrawIndirect = false;
+    uint32_t mMaxDrawIndirectCount = 1;
+    PFN_vkCmdDrawIndexedIndirectCountKHR mDrawIndexedIndirectCount = nullptr;
+
+    VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+
+    uint32_t mInstanceCount = 0;
+    Buffer mSpheres;
+    std::vector<Frame> mFrames;
+
+    // Occlusion only. The pyramid is rebuilt every frame and shared by all of them, as is the visibility of the
+    // instances, which is written by the late phase and read by the early phase of the next frame.
+    Buffer mVisibility;
+    VkImage mDepthImage = VK_NULL_HANDLE;
+    VkImageView mDepthView = VK_NULL_HANDLE;
+    VkImageAspectFlags mDepthAspects = 0;
+    VkImage mPyramid = VK_NULL_HANDLE;
+    VkDeviceMemory mPyramidMemory = VK_NULL_HANDLE;
+    VkExtent2D mPyramidExtent = {0, 0};
+    VkImageView mPyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> mPyramidLevelViews;
+    VkSampler mPyramidSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mPyramidSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mPyramidPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mPyramidPipeline = VK_NULL_HANDLE;
+    // One per level, reading the level before it or the depth attachment
+    std::vector<VkDescriptorSet> mPyramidSets;
+};
+
+} // end namespace vkutils
+
+#endif
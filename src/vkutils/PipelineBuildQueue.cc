@@ -0,0 +1,86 @@
+#include "PipelineBuildQueue.h"
+#include <algorithm>
+
+namespace vkutils
+{
+
+PipelineBuildQueue::~PipelineBuildQueue(){
+    stop();
+}
+
+void PipelineBuildQueue::start(size_t aThreadCount){
+    if(isRunning()){
+        throw std::runtime_error("Attempting to start a PipelineBuildQueue that is already running!");
+    }
+    if(aThreadCount == 0){
+        size_t hardwareThreads = std::thread::hardware_concurrency();
+        aThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    mStopping = false;
+    for(size_t i = 0; i < aThreadCount; ++i){
+        mWorkers.emplace_back(&PipelineBuildQueue::run, this);
+    }
+}
+
+void PipelineBuildQueue::stop(){
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mJobAvailable.notify_all();
+    for(std::thread& worker : mWorkers){
+        worker.join();
+    }
+    mWorkers.clear();
+}
+
+std::shared_future<VkPipeline> PipelineBuildQueue::submit(const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass){
+    if(!isRunning()){
+        throw std::runtime_error("PipelineBuildQueue::submit() called before start()!");
+    }
+
+    std::shared_future<VkPipeline> result;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(Job{aCtorSet, aLayout, aRenderPass, std::promise<VkPipeline>()});
+        result = mJobs.back().promise.get_future().share();
+    }
+    mJobAvailable.notify_one();
+    return(result);
+}
+
+void PipelineBuildQueue::waitIdle(){
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this](){ return(mJobs.empty() && mActiveJobs == 0); });
+}
+
+void PipelineBuildQueue::run(){
+    while(true){
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobAvailable.wait(lock, [this](){ return(mStopping || !mJobs.empty()); });
+        if(mJobs.empty()){
+            // Only reachable when stopping. Queued jobs are always drained first so no future is left unresolved.
+            return;
+        }
+
+        Job job = std::move(mJobs.front());
+        mJobs.pop_front();
+        ++mActiveJobs;
+        lock.unlock();
+
+        try{
+            job.promise.set_value(BasicVulkanRenderPipeline::createGraphicsPipeline(job.ctorSet, job.layout, job.renderPass));
+        }catch(...){
+            job.promise.set_exception(std::current_exception());
+        }
+
+        lock.lock();
+        --mActiveJobs;
+        if(mJobs.empty() && mActiveJobs == 0){
+            mIdle.notify_all();
+        }
+    }
+}
+
+} // end namespace vkutils
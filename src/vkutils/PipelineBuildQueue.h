@@ -0,0 +1,67 @@
+#ifndef PIPELINE_BUILD_QUEUE_H_
+#define PIPELINE_BUILD_QUEUE_H_
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "vkutils.h"
+
+namespace vkutils{
+
+/** Compiles graphics pipelines on a pool of worker threads.
+ *
+ * Each submitted construction set is copied, so the caller may modify or discard its own copy immediately.
+ * Workers create pipelines through the construction set's mPipelineCache. VkPipelineCache is internally
+ * synchronized, so every worker shares the one cache and sees what the others have already compiled.
+ * The layout and render pass given with a job must stay alive until its future is ready.
+ */
+class PipelineBuildQueue
+{
+ public:
+    PipelineBuildQueue(){}
+    ~PipelineBuildQueue();
+
+    PipelineBuildQueue(const PipelineBuildQueue& aOther) = delete;
+    PipelineBuildQueue& operator=(const PipelineBuildQueue& aOther) = delete;
+
+    /// Spin up worker threads. Zero picks one less than the number of hardware threads, but at least one.
+    void start(size_t aThreadCount = 0);
+    /// Finish all queued jobs and join the workers. Safe to call if not running.
+    void stop();
+
+    /// Queue a pipeline for creation. The future yields the pipeline, or rethrows the creation error.
+    std::shared_future<VkPipeline> submit(const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass);
+
+    /// Block until every job submitted so far has finished.
+    void waitIdle();
+
+    bool isRunning() const {return(!mWorkers.empty());}
+    size_t getThreadCount() const {return(mWorkers.size());}
+
+ protected:
+    struct Job
+    {
+        GraphicsPipelineConstructionSet ctorSet;
+        VkPipelineLayout layout;
+        VkRenderPass renderPass;
+        std::promise<VkPipeline> promise;
+    };
+
+    void run();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<Job> mJobs;
+    size_t mActiveJobs = 0;
+    bool mStopping = false;
+
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mIdle;
+};
+
+} // end namespace vkutils
+
+#endif
@@ -0,0 +1,358 @@
+#include "PipelineManager.h"
+#include "utils/Hash.h"
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <chrono>
+
+namespace vkutils
+{
+
+// Takes the same fields as Fnv1aHasher, but keeps their bytes, so states with equal hashes can be told apart
+class StateRecorder
+{
+ public:
+    explicit StateRecorder(std::vector<uint8_t>& aBytesOut) : mBytes(aBytesOut) {}
+
+    StateRecorder& addBytes(const void* aData, size_t aSize){
+        const uint8_t* bytes = static_cast<const uint8_t*>(aData);
+        mBytes.insert(mBytes.end(), bytes, bytes + aSize);
+        return(*this);
+    }
+
+    template<typename T>
+    StateRecorder& add(const T& aValue){
+        static_assert(std::is_trivially_copyable<T>::value, "StateRecorder::add() requires a trivially copyable type");
+        return(addBytes(&aValue, sizeof(T)));
+    }
+
+    StateRecorder& add(const std::string& aString){
+        add(aString.size());
+        return(addBytes(aString.data(), aString.size()));
+    }
+
+    StateRecorder& add(const char* aString){
+        return(add(std::string(aString != nullptr ? aString : "")));
+    }
+
+ protected:
+    std::vector<uint8_t>& mBytes;
+};
+
+template<typename Sink>
+static void hash_attachment_reference(Sink& aHasher, const VkAttachmentReference* aReference){
+    // Layouts don't affect compatibility, only which attachment is referenced
+    aHasher.add(aReference != nullptr ? aReference->attachment : VK_ATTACHMENT_UNUSED);
+}
+
+template<typename Sink>
+static void hash_attachment_description(Sink& aHasher, const VkAttachmentDescription& aAttachment){
+    aHasher.add(aAttachment.format);
+    aHasher.add(aAttachment.samples);
+}
+
+template<typename Sink>
+static void hash_specialization(Sink& aHasher, const VkSpecializationInfo* aInfo){
+    if(aInfo == nullptr){
+        aHasher.add(uint32_t(0));
+        return;
+    }
+    aHasher.add(aInfo->mapEntryCount);
+    for(uint32_t i = 0; i < aInfo->mapEntryCount; ++i){
+        aHasher.add(aInfo->pMapEntries[i].constantID);
+        aHasher.add(aInfo->pMapEntries[i].offset);
+        aHasher.add(static_cast<uint64_t>(aInfo->pMapEntries[i].size));
+    }
+    aHasher.add(static_cast<uint64_t>(aInfo->dataSize));
+    aHasher.addBytes(aInfo->pData, aInfo->dataSize);
+}
+
+template<typename Sink>
+static void hash_render_pass_compatibility(Sink& hasher, const RenderPassConstructionSet& aCtorSet){
+    hash_attachment_description(hasher, aCtorSet.mColorAttachment);
+    hash_attachment_description(hasher, aCtorSet.mDepthAttachment);
+
+    const VkSubpassDescription& subpass = aCtorSet.mSubpass;
+    hasher.add(subpass.pipelineBindPoint);
+    hasher.add(subpass.inputAttachmentCount);
+    for(uint32_t i = 0; i < subpass.inputAttachmentCount; ++i){
+        hash_attachment_reference(hasher, &subpass.pInputAttachments[i]);
+    }
+    hasher.add(subpass.colorAttachmentCount);
+    for(uint32_t i = 0; i < subpass.colorAttachmentCount; ++i){
+        hash_attachment_reference(hasher, &subpass.pColorAttachments[i]);
+        hash_attachment_reference(hasher, subpass.pResolveAttachments != nullptr ? &subpass.pResolveAttachments[i] : nullptr);
+    }
+    hash_attachment_reference(hasher, subpass.pDepthStencilAttachment);
+}
+
+template<typename Sink>
+static void hash_pipeline_layout(Sink& hasher, const VkPipelineLayoutCreateInfo& aLayoutInfo){
+    hasher.add(aLayoutInfo.setLayoutCount);
+    for(uint32_t i = 0; i < aLayoutInfo.setLayoutCount; ++i){
+        hasher.add(aLayoutInfo.pSetLayouts[i]);
+    }
+    hasher.add(aLayoutInfo.pushConstantRangeCount);
+    for(uint32_t i = 0; i < aLayoutInfo.pushConstantRangeCount; ++i){
+        hasher.add(aLayoutInfo.pPushConstantRanges[i].stageFlags);
+        hasher.add(aLayoutInfo.pPushConstantRanges[i].offset);
+        hasher.add(aLayoutInfo.pPushConstantRanges[i].size);
+    }
+}
+
+// Everything but the layout and the render pass
+template<typename Sink>
+static void hash_pipeline_state(Sink& hasher, const GraphicsPipelineConstructionSet& aCtorSet){
+    hasher.add(static_cast<uint64_t>(aCtorSet.mProgrammableStages.size()));
+    for(const VkPipelineShaderStageCreateInfo& stage : aCtorSet.mProgrammableStages){
+        hasher.add(stage.stage);
+        hasher.add(stage.module);
+        hasher.add(stage.pName);
+        hash_specialization(hasher, stage.pSpecializationInfo);
+    }
+
+    const VkPipelineVertexInputStateCreateInfo& vtxInput = aCtorSet.mVtxInputInfo;
+    hasher.add(vtxInput.vertexBindingDescriptionCount);
+    for(uint32_t i = 0; i < vtxInput.vertexBindingDescriptionCount; ++i){
+        hasher.add(vtxInput.pVertexBindingDescriptions[i].binding);
+        hasher.add(vtxInput.pVertexBindingDescriptions[i].stride);
+        hasher.add(vtxInput.pVertexBindingDescriptions[i].inputRate);
+    }
+    hasher.add(vtxInput.vertexAttributeDescriptionCount);
+    for(uint32_t i = 0; i < vtxInput.vertexAttributeDescriptionCount; ++i){
+        hasher.add(vtxInput.pVertexAttributeDescriptions[i].location);
+        hasher.add(vtxInput.pVertexAttributeDescriptions[i].binding);
+        hasher.add(vtxInput.pVertexAttributeDescriptions[i].format);
+        hasher.add(vtxInput.pVertexAttributeDescriptions[i].offset);
+    }
+
+    hasher.add(aCtorSet.mInputAsmInfo.topology);
+    hasher.add(aCtorSet.mInputAsmInfo.primitiveRestartEnable);
+
+    const std::vector<VkDynamicState>& dynamic = aCtorSet.mDynamicStates;
+    hasher.add(static_cast<uint64_t>(dynamic.size()));
+    for(VkDynamicState state : dynamic){
+        hasher.add(state);
+    }
+    if(std::find(dynamic.begin(), dynamic.end(), VK_DYNAMIC_STATE_VIEWPORT) == dynamic.end()){
+        hasher.add(aCtorSet.mViewport.x).add(aCtorSet.mViewport.y);
+        hasher.add(aCtorSet.mViewport.width).add(aCtorSet.mViewport.height);
+        hasher.add(aCtorSet.mViewport.minDepth).add(aCtorSet.mViewport.maxDepth);
+    }
+    if(std::find(dynamic.begin(), dynamic.end(), VK_DYNAMIC_STATE_SCISSOR) == dynamic.end()){
+        hasher.add(aCtorSet.mScissor.offset.x).add(aCtorSet.mScissor.offset.y);
+        hasher.add(aCtorSet.mScissor.extent.width).add(aCtorSet.mScissor.extent.height);
+    }
+
+    const VkPipelineRasterizationStateCreateInfo& raster = aCtorSet.mRasterInfo;
+    hasher.add(raster.depthClampEnable).add(raster.rasterizerDiscardEnable);
+    hasher.add(raster.polygonMode).add(raster.cullMode).add(raster.frontFace);
+    hasher.add(raster.depthBiasEnable).add(raster.depthBiasConstantFactor);
+    hasher.add(raster.depthBiasClamp).add(raster.depthBiasSlopeFactor);
+    hasher.add(raster.lineWidth);
+
+    const VkPipelineMultisampleStateCreateInfo& multisample = aCtorSet.mMultisampleInfo;
+    hasher.add(multisample.rasterizationSamples).add(multisample.sampleShadingEnable);
+    hasher.add(multisample.minSampleShading);
+    hasher.add(multisample.pSampleMask != nullptr ? *multisample.pSampleMask : ~VkSampleMask(0));
+    hasher.add(multisample.alphaToCoverageEnable).add(multisample.alphaToOneEnable);
+
+    const VkPipelineDepthStencilStateCreateInfo& depth = aCtorSet.mDepthInfo;
+    hasher.add(depth.depthTestEnable).add(depth.depthWriteEnable).add(depth.depthCompareOp);
+    hasher.add(depth.depthBoundsTestEnable).add(depth.minDepthBounds).add(depth.maxDepthBounds);
+    hasher.add(depth.stencilTestEnable);
+    if(depth.stencilTestEnable){
+        for(const VkStencilOpState* op : {&depth.front, &depth.back}){
+            hasher.add(op->failOp).add(op->passOp).add(op->depthFailOp).add(op->compareOp);
+            hasher.add(op->compareMask).add(op->writeMask).add(op->reference);
+        }
+    }
+
+    const VkPipelineColorBlendStateCreateInfo& blend = aCtorSet.mColorBlendInfo;
+    hasher.add(blend.logicOpEnable).add(blend.logicOp);
+    hasher.add(blend.attachmentCount);
+    for(uint32_t i = 0; i < blend.attachmentCount; ++i){
+        const VkPipelineColorBlendAttachmentState& attachment = blend.pAttachments[i];
+        hasher.add(attachment.blendEnable);
+        hasher.add(attachment.srcColorBlendFactor).add(attachment.dstColorBlendFactor).add(attachment.colorBlendOp);
+        hasher.add(attachment.srcAlphaBlendFactor).add(attachment.dstAlphaBlendFactor).add(attachment.alphaBlendOp);
+        hasher.add(attachment.colorWriteMask);
+    }
+    hasher.add(blend.blendConstants);
+}
+
+uint64_t PipelineManager::hashRenderPassCompatibility(const RenderPassConstructionSet& aCtorSet){
+    Fnv1aHasher hasher;
+    hash_render_pass_compatibility(hasher, aCtorSet);
+    return(hasher.value());
+}
+
+uint64_t PipelineManager::hashPipelineLayout(const VkPipelineLayoutCreateInfo& aLayoutInfo){
+    Fnv1aHasher hasher;
+    hash_pipeline_layout(hasher, aLayoutInfo);
+    return(hasher.value());
+}
+
+uint64_t PipelineManager::hashPipelineState(const GraphicsPipelineConstructionSet& aCtorSet){
+    Fnv1aHasher hasher;
+    hash_pipeline_state(hasher, aCtorSet);
+    uint64_t result = hasher.value();
+    hash_combine(result, hashPipelineLayout(aCtorSet.mPipelineLayoutInfo));
+    hash_combine(result, hashRenderPassCompatibility(aCtorSet.mRenderpassCtorSet));
+    return(result);
+}
+
+std::vector<uint8_t> PipelineManager::recordPipelineLayout(const VkPipelineLayoutCreateInfo& aLayoutInfo){
+    std::vector<uint8_t> bytes;
+    StateRecorder recorder(bytes);
+    hash_pipeline_layout(recorder, aLayoutInfo);
+    return(bytes);
+}
+
+std::vector<uint8_t> PipelineManager::recordPipelineState(const GraphicsPipelineConstructionSet& aCtorSet){
+    std::vector<uint8_t> bytes;
+    StateRecorder recorder(bytes);
+    hash_pipeline_state(recorder, aCtorSet);
+    hash_pipeline_layout(recorder, aCtorSet.mPipelineLayoutInfo);
+    hash_render_pass_compatibility(recorder, aCtorSet.mRenderpassCtorSet);
+    return(bytes);
+}
+
+uint64_t PipelineManager::resolveKey(const std::unordered_map<uint64_t, std::vector<uint8_t>>& aStates, uint64_t aKey, const std::vector<uint8_t>& aState){
+    // Probe the keys after a colliding one until one is free or holds the same state
+    for(auto found = aStates.find(aKey); found != aStates.end() && found->second != aState; found = aStates.find(aKey)){
+        ++aKey;
+    }
+    return(aKey);
+}
+
+void PipelineManager::init(VkDevice aDevice, size_t aBuildThreads){
+    mDevice = aDevice;
+    if(!mBuildQueue.isRunning()){
+        mBuildQueue.start(aBuildThreads);
+    }
+}
+
+VkPipelineLayout PipelineManager::getLayout(const GraphicsPipelineConstructionSet& aCtorSet){
+    const std::vector<uint8_t> state = recordPipelineLayout(aCtorSet.mPipelineLayoutInfo);
+    const uint64_t key = resolveKey(mLayoutStates, hashPipelineLayout(aCtorSet.mPipelineLayoutInfo), state);
+    auto found = mLayouts.find(key);
+    if(found != mLayouts.end()){
+        return(found->second);
+    }
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    if(vkCreatePipelineLayout(mDevice, &aCtorSet.mPipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("PipelineManager: Failed to create pipeline layout!");
+    }
+    mLayouts.emplace(key, layout);
+    mLayoutStates.emplace(key, state);
+    return(layout);
+}
+
+VkPipeline PipelineManager::getPipeline(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass aRenderPass){
+    if(mDevice == VK_NULL_HANDLE || mDevice != aCtorSet.mLogicalDevice){
+        throw std::runtime_error("PipelineManager: Construction set device does not match the device the manager was initialized with.");
+    }
+
+    const std::vector<uint8_t> state = recordPipelineState(aCtorSet);
+    const uint64_t key = resolveKey(mStates, hashPipelineState(aCtorSet), state);
+    auto found = mPipelines.find(key);
+    if(found != mPipelines.end()){
+        ++mCacheHits;
+        return(found->second);
+    }
+
+    // Already being built asynchronously. Waiting for it is cheaper than compiling a duplicate. If that build failed,
+    // the pipeline is created here instead, which throws on failure as usual.
+    auto pending = mPending.find(key);
+    if(pending != mPending.end()){
+        try{
+            VkPipeline pipeline = pending->second.get();
+            mPending.erase(pending);
+            ++mCacheHits;
+            mPipelines.emplace(key, pipeline);
+            return(pipeline);
+        }catch(const std::exception& e){
+            std::cerr << "Warning: Asynchronous pipeline build failed, retrying: " << e.what() << std::endl;
+            mPending.erase(pending);
+        }
+    }
+    mFailed.erase(key);
+
+    ++mCacheMisses;
+    VkPipeline pipeline = BasicVulkanRenderPipeline::createGraphicsPipeline(aCtorSet, getLayout(aCtorSet), aRenderPass);
+    mPipelines.emplace(key, pipeline);
+    mStates[key] = state;
+    return(pipeline);
+}
+
+VkPipeline PipelineManager::getPipelineAsync(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass aRenderPass, VkPipeline aFallback){
+    if(mDevice == VK_NULL_HANDLE || mDevice != aCtorSet.mLogicalDevice){
+        throw std::runtime_error("PipelineManager: Construction set device does not match the device the manager was initialized with.");
+    }
+
+    const std::vector<uint8_t> state = recordPipelineState(aCtorSet);
+    const uint64_t key = resolveKey(mStates, hashPipelineState(aCtorSet), state);
+    auto found = mPipelines.find(key);
+    if(found != mPipelines.end()){
+        ++mCacheHits;
+        return(found->second);
+    }
+
+    // Builds that failed aren't retried until clear(), the draw keeps its fallback
+    if(mPending.find(key) == mPending.end() && mFailed.count(key) == 0){
+        ++mCacheMisses;
+        mPending.emplace(key, mBuildQueue.submit(aCtorSet, getLayout(aCtorSet), aRenderPass));
+        mStates[key] = state;
+    }
+    return(aFallback);
+}
+
+size_t PipelineManager::poll(){
+    size_t completed = 0;
+    for(auto pending = mPending.begin(); pending != mPending.end();){
+        if(pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+            ++pending;
+            continue;
+        }
+        // get() rethrows if creation failed on the worker. One broken shader must not take down the frame, so the
+        // draws using it keep their fallback.
+        try{
+            mPipelines.emplace(pending->first, pending->second.get());
+            ++completed;
+        }catch(const std::exception& e){
+            std::cerr << "Warning: Asynchronous pipeline build failed, keeping the fallback pipeline: " << e.what() << std::endl;
+            mFailed.insert(pending->first);
+        }
+        pending = mPending.erase(pending);
+    }
+    return(completed);
+}
+
+void PipelineManager::clear(){
+    // Pipelines still being compiled reference layouts about to be destroyed, so let them finish first
+    mBuildQueue.waitIdle();
+    for(std::pair<const uint64_t, std::shared_future<VkPipeline>>& pending : mPending){
+        try{
+            vkDestroyPipeline(mDevice, pending.second.get(), nullptr);
+        }catch(const std::exception& e){
+            std::cerr << "Warning: Discarding failed pipeline build: " << e.what() << std::endl;
+        }
+    }
+    mPending.clear();
+    mFailed.clear();
+
+    for(std::pair<const uint64_t, VkPipeline>& entry : mPipelines){
+        vkDestroyPipeline(mDevice, entry.second, nullptr);
+    }
+    for(std::pair<const uint64_t, VkPipelineLayout>& entry : mLayouts){
+        vkDestroyPipelineLayout(mDevice, entry.second, nullptr);
+    }
+    mPipelines.clear();
+    mLayouts.clear();
+    mStates.clear();
+    mLayoutStates.clear();
+}
+
+} // end namespace vkutils
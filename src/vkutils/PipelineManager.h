@@ -0,0 +1,92 @@
+#ifndef PIPELINE_MANAGER_H_
+#define PIPELINE_MANAGER_H_
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+#include <vector>
+#include <cstdint>
+#include "vkutils.h"
+#include "PipelineBuildQueue.h"
+
+namespace vkutils{
+
+/** Owns graphics pipelines and pipeline layouts created from construction sets, de-duplicated by content.
+ *
+ * Each construction set is reduced to a 64-bit hash of everything that affects the compiled pipeline: shader stages,
+ * vertex input, input assembly, viewport (unless dynamic), raster, multisample, depth, blend, dynamic state, pipeline
+ * layout and render pass compatibility. Requests with an equal state return the same VkPipeline, so any number of
+ * materials can share one render pass and draws can be grouped by the returned handle to minimize binds. The bytes of
+ * the state are kept next to each hash and compared on lookup, so states whose hashes collide get pipelines of
+ * their own.
+ *
+ * Pipelines are created against the render pass given on first request, but stay usable with any render pass that
+ * is compatible with it. Handles stay valid until clear() is called.
+ *
+ * getPipelineAsync() hands creation off to a PipelineBuildQueue and returns a fallback until the pipeline is done.
+ * poll() must be called periodically from the owning thread to pick up finished pipelines. A build that fails is
+ * reported as a warning and not retried asynchronously, so its draws keep using the fallback.
+ */
+class PipelineManager
+{
+ public:
+    PipelineManager(){}
+
+    /// Set the device and start the build queue with 'aBuildThreads' workers (zero picks a default).
+    void init(VkDevice aDevice, size_t aBuildThreads = 0);
+
+    /// Find or create a pipeline for aCtorSet. aRenderPass must have been created from aCtorSet.mRenderpassCtorSet.
+    VkPipeline getPipeline(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass aRenderPass);
+
+    /// Like getPipeline(), but a missing pipeline is queued for creation on a worker thread and 'aFallback'
+    /// is returned until poll() has seen it finish.
+    VkPipeline getPipelineAsync(const GraphicsPipelineConstructionSet& aCtorSet, VkRenderPass aRenderPass, VkPipeline aFallback);
+
+    /// Move pipelines finished by the build queue into the cache. Returns how many became available.
+    size_t poll();
+
+    /// Find or create the pipeline layout described by aCtorSet.mPipelineLayoutInfo.
+    VkPipelineLayout getLayout(const GraphicsPipelineConstructionSet& aCtorSet);
+
+    /// Wait for outstanding builds, then destroy all pipelines and layouts owned by the manager.
+    void clear();
+
+    /// Queue shared by the manager, for pipelines that are owned elsewhere.
+    PipelineBuildQueue& getBuildQueue() {return(mBuildQueue);}
+
+    size_t getPipelineCount() const {return(mPipelines.size());}
+    size_t getPendingCount() const {return(mPending.size());}
+    size_t getCacheHits() const {return(mCacheHits);}
+    size_t getCacheMisses() const {return(mCacheMisses);}
+
+    static uint64_t hashPipelineState(const GraphicsPipelineConstructionSet& aCtorSet);
+    static uint64_t hashPipelineLayout(const VkPipelineLayoutCreateInfo& aLayoutInfo);
+    static uint64_t hashRenderPassCompatibility(const RenderPassConstructionSet& aCtorSet);
+
+ protected:
+    // The fields the hashes above are computed from, as bytes
+    static std::vector<uint8_t> recordPipelineState(const GraphicsPipelineConstructionSet& aCtorSet);
+    static std::vector<uint8_t> recordPipelineLayout(const VkPipelineLayoutCreateInfo& aLayoutInfo);
+    // Key in 'aStates' for 'aState', starting at its hash 'aKey'
+    static uint64_t resolveKey(const std::unordered_map<uint64_t, std::vector<uint8_t>>& aStates, uint64_t aKey, const std::vector<uint8_t>& aState);
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+
+    std::unordered_map<uint64_t, VkPipeline> mPipelines;
+    std::unordered_map<uint64_t, VkPipelineLayout> mLayouts;
+    std::unordered_map<uint64_t, std::shared_future<VkPipeline>> mPending;
+    // Keys whose asynchronous build threw, see poll()
+    std::unordered_set<uint64_t> mFailed;
+    // State of every key in use by mPipelines, mPending or mFailed, and by mLayouts
+    std::unordered_map<uint64_t, std::vector<uint8_t>> mStates;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> mLayoutStates;
+
+    PipelineBuildQueue mBuildQueue;
+
+    size_t mCacheHits = 0;
+    size_t mCacheMisses = 0;
+};
+
+} // end namespace vkutils
+
+#endif
@@ -0,0 +1,76 @@
+#include "ShaderLibrary.h"
+#include "vkutils.h"
+#include "../utils/Hash.h"
+#include "../utils/MappedFile.h"
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+
+namespace vkutils{
+
+void ShaderLibrary::init(VkDevice aDevice){
+    mDevice = aDevice;
+}
+
+bool ShaderLibrary::loadArchive(const std::string& aArchivePath){
+    SpirvArchive archive;
+    if(!archive.open(aArchivePath)) return(false);
+    mArchives.push_back(std::move(archive));
+    return(true);
+}
+
+VkShaderModule ShaderLibrary::get(const std::string& aName){
+    for(auto archive = mArchives.rbegin(); archive != mArchives.rend(); ++archive){
+        SpirvArchive::Blob blob = archive->find(aName);
+        if(blob.code != nullptr) return(create(blob.code, blob.size));
+    }
+    return(VK_NULL_HANDLE);
+}
+
+VkShaderModule ShaderLibrary::load(const std::string& aFilePath){
+    MappedFile shaderFile(aFilePath);
+    if(!shaderFile.isValid()){
+        throw std::runtime_error("Failed to open shader file '" + aFilePath + "'!");
+    }
+    if(shaderFile.size() % sizeof(uint32_t) != 0){
+        throw std::runtime_error("Shader file '" + aFilePath + "' is not valid SPIR-V!");
+    }
+    return(create(reinterpret_cast<const uint32_t*>(shaderFile.data()), shaderFile.size()));
+}
+
+VkShaderModule ShaderLibrary::create(const uint32_t* aCode, size_t aCodeSize){
+    if(mDevice == VK_NULL_HANDLE){
+        throw std::runtime_error("ShaderLibrary::create() Error: Library has not been initialized with a device!");
+    }
+
+    uint64_t key = fnv1a_hash(aCode, aCodeSize);
+    hash_combine(key, aCodeSize);
+    // Probe the keys after a colliding one until one is free or holds the same code
+    for(auto found = mModules.find(key); found != mModules.end(); found = mModules.find(++key)){
+        const std::vector<uint8_t>& code = found->second.code;
+        if(code.size() == aCodeSize && memcmp(code.data(), aCode, aCodeSize) == 0){
+            ++mSharedLoads;
+            return(found->second.module);
+        }
+    }
+
+    VkShaderModule module = create_shader_module(mDevice, aCode, aCodeSize);
+    if(module != VK_NULL_HANDLE){
+        Module& entry = mModules[key];
+        entry.module = module;
+        entry.code.assign(reinterpret_cast<const uint8_t*>(aCode), reinterpret_cast<const uint8_t*>(aCode) + aCodeSize);
+        mOwnedModules.insert(module);
+    }
+    return(module);
+}
+
+void ShaderLibrary::destroy(){
+    for(const std::pair<const uint64_t, Module>& module : mModules){
+        vkDestroyShaderModule(mDevice, module.second.module, nullptr);
+    }
+    mModules.clear();
+    mOwnedModules.clear();
+    mArchives.clear();
+}
+
+} // end namespace vkutils
@@ -0,0 +1,72 @@
+#ifndef SHADER_LIBRARY_H_
+#define SHADER_LIBRARY_H_
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../utils/SpirvArchive.h"
+
+namespace vkutils{
+
+/** Owns shader modules, shared between everyone that loads the same SPIR-V.
+ *
+ * Modules are keyed by a hash of their byte code rather than by name or path, so loading the same shader through
+ * different paths, or two files with identical contents, returns one VkShaderModule. That keeps pipeline state
+ * hashes equal for identical shaders and lets the PipelineManager share the resulting pipelines as well. The byte
+ * code is kept next to each module and compared on lookup, so colliding hashes never share a module.
+ *
+ * Shaders are read from memory mapped files. Packed archives written by the spvpack tool can be mapped with
+ * loadArchive(), after which get() creates modules straight from the archive without touching the file system.
+ * All modules stay alive until destroy().
+ */
+class ShaderLibrary
+{
+ public:
+    ShaderLibrary(){}
+
+    void init(VkDevice aDevice);
+    bool isInitialized() const {return(mDevice != VK_NULL_HANDLE);}
+
+    /// Map an archive of SPIR-V blobs. Entries of archives loaded later take precedence over earlier ones.
+    /// Returns false if the archive is missing or invalid.
+    bool loadArchive(const std::string& aArchivePath);
+
+    /// Module for the archive entry 'aName', e.g. "standard.vert". Returns VK_NULL_HANDLE if no loaded archive has it.
+    VkShaderModule get(const std::string& aName);
+
+    /// Module for the SPIR-V file at 'aFilePath'. Throws if the file cannot be read.
+    VkShaderModule load(const std::string& aFilePath);
+
+    /// Module for the given byte code. aCode must be 4 byte aligned and aCodeSize is in bytes.
+    VkShaderModule create(const uint32_t* aCode, size_t aCodeSize);
+
+    /// True if the module was created by this library, and must not be destroyed by anyone else.
+    bool owns(VkShaderModule aModule) const {return(mOwnedModules.count(aModule) > 0);}
+
+    /// Destroy all modules and unmap all archives.
+    void destroy();
+
+    size_t getModuleCount() const {return(mModules.size());}
+    size_t getSharedLoads() const {return(mSharedLoads);}
+
+ protected:
+    VkDevice mDevice = VK_NULL_HANDLE;
+
+    std::vector<SpirvArchive> mArchives;
+    struct Module
+    {
+        VkShaderModule module = VK_NULL_HANDLE;
+        std::vector<uint8_t> code;
+    };
+
+    std::unordered_map<uint64_t, Module> mModules;
+    std::unordered_set<VkShaderModule> mOwnedModules;
+
+    size_t mSharedLoads = 0;
+};
+
+} // end namespace vkutils
+
+#endif
@@ -79,7 +79,7 @@ opt::optional<uint32_t> VulkanPhysicalDevice::getPresentableQueueIndex(const VkS
     return(opt::optional<uint32_t>());
 }
 
-VulkanDevice VulkanPhysicalDevice::createDevice(VkQueueFlags aQueues, const std::vector<const char*>& aExtensions, VkSurfaceKHR aSurface) const{
+VulkanDevice VulkanPhysicalDevice::createDevice(VkQueueFlags aQueues, const std::vector<const char*>& aExtensions, VkSurfaceKHR aSurface, const VkPhysicalDeviceFeatures* aFeatures) const{
     std::set<uint32_t> queueFamilyIndices;
     if(aQueues | VK_QUEUE_GRAPHICS_BIT && mGraphicsIdx) queueFamilyIndices.emplace(*mGraphicsIdx);
     if(aQueues | VK_QUEUE_COMPUTE_BIT && mComputeIdx) queueFamilyIndices.emplace(*mComputeIdx);
@@ -114,7 +114,7 @@ VulkanDevice VulkanPhysicalDevice::createDevice(VkQueueFlags aQueues, const std:
     {
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pNext = nullptr;
-        createInfo.pEnabledFeatures = {};
+        createInfo.pEnabledFeatures = aFeatures;
         createInfo.flags = 0;
         createInfo.ppEnabledLayerNames = nullptr;
         createInfo.enabledLayerCount = 0;
@@ -130,6 +130,8 @@ VulkanDevice VulkanPhysicalDevice::createDevice(VkQueueFlags aQueues, const std:
     }
 
     VulkanDevice device = VulkanDevice(deviceHandle);
+    if(aFeatures != nullptr) device.mEnabledFeatures = *aFeatures;
+    device.mEnabledExtensions.assign(aExtensions.begin(), aExtensions.end());
 
     if(mGraphicsIdx) vkGetDeviceQueue(deviceHandle, *mGraphicsIdx, 0, &device.mGraphicsQueue);
     if(mComputeIdx) vkGetDeviceQueue(deviceHandle, *mComputeIdx, 0, &device.mComputeQueue);
@@ -2,7 +2,9 @@
 #define VULKAN_DEVICES_H_
 #include <vulkan/vulkan.h>
 #include "utils/optional.h"
+#include "VulkanPipelineCache.h"
 #include <vector>
+#include <string>
 #include <stdexcept>
 #include <limits>
 
@@ -58,6 +60,15 @@ class VulkanDevice
     VkQueue getProtectedQueue() const {return(mProtectedQueue);}
     VkQueue getPresentationQueue() const {return(mPresentationQueue);}
 
+    /// Optional features and extensions the device was created with
+    const VkPhysicalDeviceFeatures& getEnabledFeatures() const {return(mEnabledFeatures);}
+    bool isExtensionEnabled(const std::string& aExtensionName) const {
+        for(const std::string& extension : mEnabledExtensions){
+            if(extension == aExtensionName) return(true);
+        }
+        return(false);
+    }
+
     operator VkDevice() const {return(mHandle);}
 
  protected:
@@ -73,6 +84,9 @@ class VulkanDevice
     VkQueue mSparseBindingQueue = VK_NULL_HANDLE;
     VkQueue mProtectedQueue = VK_NULL_HANDLE;
     VkQueue mPresentationQueue = VK_NULL_HANDLE;
+
+    VkPhysicalDeviceFeatures mEnabledFeatures = {};
+    std::vector<std::string> mEnabledExtensions;
 };
 
 struct SwapChainSupportInfo;
@@ -92,14 +106,18 @@ class VulkanPhysicalDevice
    VulkanDevice createDevice(
       VkQueueFlags aQueues,
       const std::vector<const char*>& aExtensions = std::vector<const char*>(),
-      VkSurfaceKHR aSurface = VK_NULL_HANDLE
+      VkSurfaceKHR aSurface = VK_NULL_HANDLE,
+      const VkPhysicalDeviceFeatures* aFeatures = nullptr
    ) const;
 
    VulkanDevice createCoreDevice() const { return(createDevice(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)); }
 
-   VulkanDevice createPresentableCoreDevice(VkSurfaceKHR aSurface, const std::vector<const char*>& aExtensions = std::vector<const char*>()) const {
+   VulkanDevice createPresentableCoreDevice(
+      VkSurfaceKHR aSurface, const std::vector<const char*>& aExtensions = std::vector<const char*>(),
+      const VkPhysicalDeviceFeatures* aFeatures = nullptr
+   ) const {
       if(aSurface == VK_NULL_HANDLE) throw std::runtime_error("Attempted to create presentable core device with invalid surface handle!");
-      return(createDevice(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, aExtensions, aSurface));
+      return(createDevice(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, aExtensions, aSurface, aFeatures));
    }
 
    VkPhysicalDeviceProperties mProperites;
@@ -137,6 +155,7 @@ struct VulkanDeviceBundle
 {
    VulkanDevice logicalDevice;
    VulkanPhysicalDevice physicalDevice;
+   VulkanPipelineCache pipelineCache;
 
    bool isValid() const {return(logicalDevice.isValid() && physicalDevice.isValid());}
 
@@ -0,0 +1,160 @@
+#include "VulkanPipelineCache.h"
+#include "VulkanDevices.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+VulkanPipelineCache VulkanPipelineCache::create(VkDevice aDevice, const VulkanPhysicalDevice& aPhysicalDevice, const std::string& aFilePath){
+    VulkanPipelineCache cache;
+    cache.mDevice = aDevice;
+    cache.mDeviceProperties = aPhysicalDevice.mProperites;
+
+    std::vector<uint8_t> initialData;
+    if(!aFilePath.empty()){
+        initialData = readValidatedCacheData(aFilePath, aPhysicalDevice.mProperites);
+    }
+
+    VkPipelineCacheCreateInfo createInfo;
+    {
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    }
+
+    if(vkCreatePipelineCache(aDevice, &createInfo, nullptr, &cache.mHandle) != VK_SUCCESS){
+        // The driver is allowed to reject data it doesn't like. Fall back to an empty cache before giving up.
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        initialData.clear();
+        if(vkCreatePipelineCache(aDevice, &createInfo, nullptr, &cache.mHandle) != VK_SUCCESS){
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+    }
+
+    cache.mLoadedSize = initialData.size();
+    if(cache.isWarm()){
+        std::cout << "Loaded pipeline cache '" << aFilePath << "' (" << cache.mLoadedSize << " bytes)" << std::endl;
+    }
+
+    return(cache);
+}
+
+std::vector<uint8_t> VulkanPipelineCache::readValidatedCacheData(const std::string& aFilePath, const VkPhysicalDeviceProperties& aProperties){
+    std::ifstream cacheFile(aFilePath, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!cacheFile.is_open()){
+        // No cache yet, most likely the first launch.
+        return(std::vector<uint8_t>());
+    }
+    const std::streamoff fileSize = cacheFile.tellg();
+    cacheFile.seekg(0, std::ios::beg);
+
+    FileHeader header;
+    if(fileSize < static_cast<std::streamoff>(sizeof(header)) || !cacheFile.read(reinterpret_cast<char*>(&header), sizeof(header))){
+        std::cerr << "Warning: Pipeline cache '" << aFilePath << "' is truncated. Ignoring it." << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    bool headerMatches = header.magic == sFileMagic && header.fileVersion == sFileVersion;
+    bool deviceMatches = header.vendorID == aProperties.vendorID && header.deviceID == aProperties.deviceID
+        && header.driverVersion == aProperties.driverVersion
+        && memcmp(header.pipelineCacheUUID, aProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if(!headerMatches || !deviceMatches){
+        std::cerr << "Warning: Pipeline cache '" << aFilePath << "' was created by a different device, driver, or version. Ignoring it." << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    // Checked before allocating, so a corrupt size can't ask for more memory than the file holds
+    if(header.dataSize != static_cast<uint64_t>(fileSize) - sizeof(header)){
+        std::cerr << "Warning: Pipeline cache '" << aFilePath << "' is truncated or corrupt. Ignoring it." << std::endl;
+        return(std::vector<uint8_t>());
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(header.dataSize));
+    if(!cacheFile.read(reinterpret_cast<char*>(data.data()), data.size())){
+        std::cerr << "Warning: Pipeline cache '" << aFilePath << "' is truncated. Ignoring it." << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    // Also verify the driver's own header (VkPipelineCacheHeaderVersionOne) in case the blob was tampered with.
+    const size_t driverHeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if(data.size() < driverHeaderSize){
+        return(std::vector<uint8_t>());
+    }
+    uint32_t driverHeader[4];
+    memcpy(driverHeader, data.data(), sizeof(driverHeader));
+    bool driverHeaderMatches = driverHeader[0] >= driverHeaderSize
+        && driverHeader[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && driverHeader[2] == aProperties.vendorID
+        && driverHeader[3] == aProperties.deviceID
+        && memcmp(data.data() + sizeof(driverHeader), aProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if(!driverHeaderMatches){
+        std::cerr << "Warning: Pipeline cache '" << aFilePath << "' contains an incompatible driver header. Ignoring it." << std::endl;
+        return(std::vector<uint8_t>());
+    }
+
+    return(data);
+}
+
+bool VulkanPipelineCache::save(const std::string& aFilePath) const{
+    if(!isValid()) return(false);
+
+    size_t dataSize = 0;
+    if(vkGetPipelineCacheData(mDevice, mHandle, &dataSize, nullptr) != VK_SUCCESS){
+        return(false);
+    }
+    std::vector<uint8_t> data(dataSize);
+    if(vkGetPipelineCacheData(mDevice, mHandle, &dataSize, data.data()) != VK_SUCCESS){
+        return(false);
+    }
+    data.resize(dataSize);
+
+    // Zeroed so the padding written with it is too
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    {
+        header.magic = sFileMagic;
+        header.fileVersion = sFileVersion;
+        header.vendorID = mDeviceProperties.vendorID;
+        header.deviceID = mDeviceProperties.deviceID;
+        header.driverVersion = mDeviceProperties.driverVersion;
+        memcpy(header.pipelineCacheUUID, mDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.dataSize = data.size();
+    }
+
+    // Written next to the cache and renamed over it once complete, so a crash while saving leaves the old file intact
+    const std::string tempPath = aFilePath + ".tmp";
+    {
+        std::ofstream cacheFile(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!cacheFile.is_open()){
+            std::cerr << "Warning: Unable to open '" << tempPath << "' to save the pipeline cache." << std::endl;
+            return(false);
+        }
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        cacheFile.write(reinterpret_cast<const char*>(data.data()), data.size());
+        cacheFile.close();
+        if(cacheFile.fail()){
+            std::remove(tempPath.c_str());
+            return(false);
+        }
+    }
+    if(std::rename(tempPath.c_str(), aFilePath.c_str()) != 0){
+        // Renaming onto an existing file fails on Windows
+        std::remove(aFilePath.c_str());
+        if(std::rename(tempPath.c_str(), aFilePath.c_str()) != 0){
+            std::cerr << "Warning: Unable to replace '" << aFilePath << "' with the saved pipeline cache." << std::endl;
+            std::remove(tempPath.c_str());
+            return(false);
+        }
+    }
+    return(true);
+}
+
+void VulkanPipelineCache::destroy(){
+    if(mHandle != VK_NULL_HANDLE){
+        vkDestroyPipelineCache(mDevice, mHandle, nullptr);
+        mHandle = VK_NULL_HANDLE;
+    }
+    mLoadedSize = 0;
+}
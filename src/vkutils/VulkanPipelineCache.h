@@ -0,0 +1,61 @@
+#ifndef VULKAN_PIPELINE_CACHE_H_
+#define VULKAN_PIPELINE_CACHE_H_
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class VulkanPhysicalDevice;
+
+/** Thin wrapper around a VkPipelineCache that can be persisted to and restored from disk.
+ *
+ * The file written by save() prefixes the driver's cache blob with a small header identifying the device and
+ * driver that produced it. On load the header and the driver's own VkPipelineCacheHeaderVersionOne are both
+ * checked against the current physical device, and a mismatching or corrupt file is ignored in favour of an
+ * empty cache. Like VulkanDevice this is a handle wrapper and is freely copyable; only one copy should destroy().
+ */
+class VulkanPipelineCache
+{
+ public:
+    VulkanPipelineCache(){}
+
+    /// Create a pipeline cache on the given device, seeded from 'aFilePath' if it holds a valid cache for the device.
+    static VulkanPipelineCache create(VkDevice aDevice, const VulkanPhysicalDevice& aPhysicalDevice, const std::string& aFilePath = "");
+
+    /// Write the current cache contents to 'aFilePath'. Returns false if the file could not be written.
+    bool save(const std::string& aFilePath) const;
+    void destroy();
+
+    inline VkPipelineCache handle() const {return(mHandle);}
+    inline bool isValid() const {return(mHandle != VK_NULL_HANDLE);}
+
+    /// True if the cache was seeded with data from disk, i.e. pipeline creation should hit warm paths.
+    bool isWarm() const {return(mLoadedSize > 0);}
+    size_t getLoadedSize() const {return(mLoadedSize);}
+
+    operator VkPipelineCache() const {return(mHandle);}
+
+ protected:
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t fileVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+    };
+
+    static const uint32_t sFileMagic = 0x43505042; // "BPPC"
+    static const uint32_t sFileVersion = 1;
+
+    static std::vector<uint8_t> readValidatedCacheData(const std::string& aFilePath, const VkPhysicalDeviceProperties& aProperties);
+
+    VkPipelineCache mHandle = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties mDeviceProperties = {};
+    size_t mLoadedSize = 0;
+};
+
+#endif
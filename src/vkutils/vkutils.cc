@@ -1,4 +1,5 @@
 #include "vkutils.h"
+#include "../utils/MappedFile.h"
 #include <iostream>
 #include <fstream>
 #include <algorithm>
@@ -85,30 +86,29 @@ void find_layer_matches(
 }
 
 VkShaderModule load_shader_module(const VkDevice& aDevice, const std::string& aFilePath){
-    std::ifstream shaderFile(aFilePath, std::ios::in | std::ios::binary | std::ios::ate);
-    if(!shaderFile.is_open()){
+    // Mapped pages are handed to the driver as-is, without staging the byte code in a heap buffer first
+    MappedFile shaderFile(aFilePath);
+    if(!shaderFile.isValid()){
         perror(aFilePath.c_str());
         throw std::runtime_error("Failed to open shader file" + aFilePath + "!");
     }
-    size_t fileSize = static_cast<size_t>(shaderFile.tellg());
-    std::vector<uint8_t> byteCode(fileSize);
-    shaderFile.seekg(std::ios::beg);
-    shaderFile.read(reinterpret_cast<char*>(byteCode.data()), fileSize);
-    shaderFile.close();
 
-    VkShaderModule resultModule = create_shader_module(aDevice, byteCode, true);
+    VkShaderModule resultModule = create_shader_module(aDevice, reinterpret_cast<const uint32_t*>(shaderFile.data()), shaderFile.size(), true);
     if(resultModule == VK_NULL_HANDLE){
         std::cerr << "Failed to create shader module from '" << aFilePath << "'!" << std::endl;
     }
     return(resultModule);
 }
 VkShaderModule create_shader_module(const VkDevice& aDevice, const std::vector<uint8_t>& aByteCode, bool silent){
+    return(create_shader_module(aDevice, reinterpret_cast<const uint32_t*>(aByteCode.data()), aByteCode.size(), silent));
+}
+VkShaderModule create_shader_module(const VkDevice& aDevice, const uint32_t* aCode, size_t aCodeSize, bool silent){
     VkShaderModuleCreateInfo createInfo;{
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.pNext = nullptr;
         createInfo.flags = 0;
-        createInfo.codeSize = aByteCode.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(aByteCode.data());
+        createInfo.codeSize = aCodeSize;
+        createInfo.pCode = aCode;
     }
 
     VkShaderModule resultModule = VK_NULL_HANDLE;
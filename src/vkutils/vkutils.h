@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <chrono>
 #include "VulkanDevices.h"
 
 namespace vkutils{
@@ -30,6 +31,8 @@ std::vector<T> duplicate_extend_vector(const std::vector<T>& aVector, size_t ext
 
 VkShaderModule load_shader_module(const VkDevice& aDevice, const std::string& aFilePath);
 VkShaderModule create_shader_module(const VkDevice& aDevice, const std::vector<uint8_t>& aByteCode, bool silent = false);
+/// aCode must be 4 byte aligned and aCodeSize is in bytes
+VkShaderModule create_shader_module(const VkDevice& aDevice, const uint32_t* aCode, size_t aCodeSize, bool silent = false);
 
 struct VulkanSwapchainBundle
 {
@@ -61,6 +64,10 @@ class RenderPassConstructionSet
     VkSubpassDescription mSubpass = {};
     VkSubpassDependency mDependency = {};
 
+    // Copies re-point the subpass attachment references at their own members
+    RenderPassConstructionSet(const RenderPassConstructionSet& aOther){ *this = aOther; }
+    RenderPassConstructionSet& operator=(const RenderPassConstructionSet& aOther);
+
  protected:
     friend class GraphicsPipelineConstructionSet;
     friend class BasicVulkanRenderPipeline;
@@ -100,12 +107,37 @@ class GraphicsPipelineConstructionSet
     VkPipelineLayoutCreateInfo mPipelineLayoutInfo;
     std::vector<VkDynamicState> mDynamicStates;
 
+    // Optional cache used when creating the pipeline. Left as VK_NULL_HANDLE, pipelines are compiled from scratch.
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+
+    // Copies are self-contained: the blend state is re-pointed at the copy's own blend attachment, and the arrays
+    // referenced by the vertex input, pipeline layout and stage specialization infos are duplicated into storage
+    // owned by the copy.
+    // This makes it safe to hand a copy to another thread or keep it after the original inputs are gone.
+    GraphicsPipelineConstructionSet(const GraphicsPipelineConstructionSet& aOther){ *this = aOther; }
+    GraphicsPipelineConstructionSet& operator=(const GraphicsPipelineConstructionSet& aOther);
+
  protected:
     friend class BasicVulkanRenderPipeline;
     GraphicsPipelineConstructionSet(){}
     GraphicsPipelineConstructionSet(const VkDevice& aDevice, const VulkanSwapchainBundle* aChainBundle)
     :   mLogicalDevice(aDevice), mSwapchainBundle(aChainBundle), mRenderpassCtorSet(aDevice, aChainBundle) {}
 
+ private:
+    std::vector<VkVertexInputBindingDescription> _mVertexBindings;
+    std::vector<VkVertexInputAttributeDescription> _mVertexAttributes;
+    std::vector<VkDescriptorSetLayout> _mSetLayouts;
+    std::vector<VkPushConstantRange> _mPushConstantRanges;
+
+    // Deep copies of each programmable stage's specialization info, indexed like mProgrammableStages
+    struct OwnedSpecialization
+    {
+        VkSpecializationInfo info;
+        std::vector<VkSpecializationMapEntry> entries;
+        std::vector<uint8_t> data;
+    };
+    std::vector<OwnedSpecialization> _mSpecializations;
+
 };
 
 class BasicVulkanRenderPipeline
@@ -137,15 +169,48 @@ class BasicVulkanRenderPipeline
     static VkFormat findDepthFormat(VkPhysicalDevice mPhysicalDevice);
 
 
+    /// Create a render pass from the render pass portion of a construction set. Caller owns the result.
+    static VkRenderPass createRenderPass(const RenderPassConstructionSet& aCtorSet);
+
+    /// Create a graphics pipeline from a construction set, a layout and a compatible render pass. Caller owns the result.
+    /// The time spent in vkCreateGraphicsPipelines is written to aCreationTimeOut if given.
+    /// If aBasePipeline is given, the pipeline is created as a derivative of it, which must have been created with
+    /// VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT.
+    static VkPipeline createGraphicsPipeline(
+        const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass,
+        std::chrono::microseconds* aCreationTimeOut = nullptr,
+        VkPipelineCreateFlags aFlags = 0, VkPipeline aBasePipeline = VK_NULL_HANDLE
+    );
+
     /// Submit aFinalCtorSet as the construction set for this pipeline. The pipeline
     /// is then created fresh using the given construction set. The success of this
     /// function will make the object valid and usable. 
     void build(const GraphicsPipelineConstructionSet& aFinalCtorSet);
 
+    /// Replace only the VkPipeline with one created elsewhere from aCtorSet, keeping the layout and render pass.
+    /// aCtorSet must be compatible with both. The previous pipeline is destroyed, so it must no longer be in use.
+    void swapPipeline(const GraphicsPipelineConstructionSet& aCtorSet, VkPipeline aPipeline);
+
+    /// Bits returned by rebuild(), naming the objects that were recreated
+    enum RebuildFlagBits : uint32_t
+    {
+        REBUILT_NONE = 0x0,
+        REBUILT_RENDER_PASS = 0x1,
+        REBUILT_LAYOUT = 0x2,
+        REBUILT_PIPELINE = 0x4
+    };
+
     /// Recreate the pipeline using the existing construction set. Swapchain information should
     /// still be accessible through the pointer given during construction of this object, so 
     /// an out of sync swapchain should be re-synchronized automatically during recreation. 
-    void rebuild();
+    uint32_t rebuild();
+
+    /// Switch to aNewCtorSet, recreating only the objects whose inputs differ from the current construction set:
+    /// the render pass when its attachments or dependencies change, the layout when its descriptor set layouts or
+    /// push constants change, and the pipeline when any state it was compiled with changes. A new pipeline is
+    /// derived from the current one. Replaced objects are destroyed, so they must no longer be in use, and
+    /// framebuffers must be recreated if REBUILT_RENDER_PASS is returned. Builds from scratch if not yet valid.
+    uint32_t rebuild(const GraphicsPipelineConstructionSet& aNewCtorSet);
 
     // Destroy this pipeline and associated Vulkan objects
     void destroy();
@@ -154,6 +219,10 @@ class BasicVulkanRenderPipeline
     const VkPipelineLayout& getLayout() const { return(mGraphicsPipeLayout); }
     const VkRenderPass& getRenderpass() const { return(mRenderPass); }
     const VkViewport& getViewport() const { return(mViewport); }
+    const GraphicsPipelineConstructionSet& getConstructionSet() const { return(_mConstructionSet); }
+
+    /// Time spent in vkCreateGraphicsPipelines during the most recent build.
+    std::chrono::microseconds getLastCreationTime() const { return(mLastCreationTime); }
 
  protected:
 
@@ -161,11 +230,14 @@ class BasicVulkanRenderPipeline
     VkPipelineLayout mGraphicsPipeLayout = VK_NULL_HANDLE;
     VkRenderPass mRenderPass = VK_NULL_HANDLE;
     VkViewport mViewport;
+    std::chrono::microseconds mLastCreationTime = std::chrono::microseconds(0);
 
  private:
     GraphicsPipelineConstructionSet _mConstructionSet;
     VkDevice _mLogicalDevice = VK_NULL_HANDLE;
     bool _mValid = false;
+    // Pipelines handed in through swapPipeline() may not allow derivatives
+    bool _mPipelineAllowsDerivatives = false;
 };
 
 } // end namespace vkutils
@@ -1,4 +1,6 @@
 #include "vkutils.h"
+#include "PipelineManager.h"
+#include "../utils/Hash.h"
 #include <cassert>
 
 #include <array>
@@ -7,6 +9,111 @@
 namespace vkutils
 {
 
+template<typename T>
+static std::vector<T> own_array(const T* aData, uint32_t aCount){
+    if(aData == nullptr || aCount == 0) return(std::vector<T>());
+    return(std::vector<T>(aData, aData + aCount));
+}
+
+RenderPassConstructionSet& RenderPassConstructionSet::operator=(const RenderPassConstructionSet& aOther){
+    mLogicalDevice = aOther.mLogicalDevice;
+    mSwapchainBundle = aOther.mSwapchainBundle;
+    mColorAttachment = aOther.mColorAttachment;
+    mDepthAttachment = aOther.mDepthAttachment;
+    mAttachmentRef = aOther.mAttachmentRef;
+    mAttachmentRef1 = aOther.mAttachmentRef1;
+    mSubpass = aOther.mSubpass;
+    mDependency = aOther.mDependency;
+
+    // References into aOther must become references into this copy, anything else is left alone
+    if(mSubpass.pColorAttachments == &aOther.mAttachmentRef) mSubpass.pColorAttachments = &mAttachmentRef;
+    if(mSubpass.pDepthStencilAttachment == &aOther.mAttachmentRef1) mSubpass.pDepthStencilAttachment = &mAttachmentRef1;
+    return(*this);
+}
+
+GraphicsPipelineConstructionSet& GraphicsPipelineConstructionSet::operator=(const GraphicsPipelineConstructionSet& aOther){
+    mLogicalDevice = aOther.mLogicalDevice;
+    mSwapchainBundle = aOther.mSwapchainBundle;
+    mRenderpassCtorSet = aOther.mRenderpassCtorSet;
+    mProgrammableStages = aOther.mProgrammableStages;
+    mVtxInputInfo = aOther.mVtxInputInfo;
+    mInputAsmInfo = aOther.mInputAsmInfo;
+    mViewport = aOther.mViewport;
+    mScissor = aOther.mScissor;
+    mRasterInfo = aOther.mRasterInfo;
+    mMultisampleInfo = aOther.mMultisampleInfo;
+    mDepthInfo = aOther.mDepthInfo;
+    mBlendAttachmentInfo = aOther.mBlendAttachmentInfo;
+    mColorBlendInfo = aOther.mColorBlendInfo;
+    mPipelineLayoutInfo = aOther.mPipelineLayoutInfo;
+    mDynamicStates = aOther.mDynamicStates;
+    mPipelineCache = aOther.mPipelineCache;
+
+    if(mColorBlendInfo.pAttachments == &aOther.mBlendAttachmentInfo) mColorBlendInfo.pAttachments = &mBlendAttachmentInfo;
+
+    // Take private copies of the arrays referenced through the create infos. Self assignment leaves them as they are.
+    if(this != &aOther){
+        _mVertexBindings = own_array(mVtxInputInfo.pVertexBindingDescriptions, mVtxInputInfo.vertexBindingDescriptionCount);
+        _mVertexAttributes = own_array(mVtxInputInfo.pVertexAttributeDescriptions, mVtxInputInfo.vertexAttributeDescriptionCount);
+        _mSetLayouts = own_array(mPipelineLayoutInfo.pSetLayouts, mPipelineLayoutInfo.setLayoutCount);
+        _mPushConstantRanges = own_array(mPipelineLayoutInfo.pPushConstantRanges, mPipelineLayoutInfo.pushConstantRangeCount);
+        mVtxInputInfo.pVertexBindingDescriptions = _mVertexBindings.empty() ? nullptr : _mVertexBindings.data();
+        mVtxInputInfo.pVertexAttributeDescriptions = _mVertexAttributes.empty() ? nullptr : _mVertexAttributes.data();
+        mPipelineLayoutInfo.pSetLayouts = _mSetLayouts.empty() ? nullptr : _mSetLayouts.data();
+        mPipelineLayoutInfo.pPushConstantRanges = _mPushConstantRanges.empty() ? nullptr : _mPushConstantRanges.data();
+
+        // Sized up front so the infos don't move once stages point at them
+        _mSpecializations.clear();
+        _mSpecializations.resize(mProgrammableStages.size());
+        for(size_t i = 0; i < mProgrammableStages.size(); ++i){
+            const VkSpecializationInfo* source = mProgrammableStages[i].pSpecializationInfo;
+            if(source == nullptr) continue;
+
+            OwnedSpecialization& owned = _mSpecializations[i];
+            owned.entries = own_array(source->pMapEntries, source->mapEntryCount);
+            const uint8_t* sourceData = static_cast<const uint8_t*>(source->pData);
+            owned.data.assign(sourceData, sourceData + (sourceData != nullptr ? source->dataSize : 0));
+            owned.info.mapEntryCount = static_cast<uint32_t>(owned.entries.size());
+            owned.info.pMapEntries = owned.entries.empty() ? nullptr : owned.entries.data();
+            owned.info.dataSize = owned.data.size();
+            owned.info.pData = owned.data.empty() ? nullptr : owned.data.data();
+            mProgrammableStages[i].pSpecializationInfo = &owned.info;
+        }
+    }
+    return(*this);
+}
+
+// Everything createRenderPass() consumes. Unlike render pass compatibility this includes load/store ops and layouts.
+static uint64_t hash_render_pass_inputs(const RenderPassConstructionSet& aCtorSet){
+    Fnv1aHasher hasher(PipelineManager::hashRenderPassCompatibility(aCtorSet));
+    for(const VkAttachmentDescription* attachment : {&aCtorSet.mColorAttachment, &aCtorSet.mDepthAttachment}){
+        hasher.add(attachment->flags).add(attachment->loadOp).add(attachment->storeOp);
+        hasher.add(attachment->stencilLoadOp).add(attachment->stencilStoreOp);
+        hasher.add(attachment->initialLayout).add(attachment->finalLayout);
+    }
+
+    const VkSubpassDescription& subpass = aCtorSet.mSubpass;
+    for(uint32_t i = 0; i < subpass.colorAttachmentCount; ++i){
+        hasher.add(subpass.pColorAttachments[i].layout);
+    }
+    hasher.add(subpass.pDepthStencilAttachment != nullptr ? subpass.pDepthStencilAttachment->layout : VK_IMAGE_LAYOUT_UNDEFINED);
+
+    const VkSubpassDependency& dependency = aCtorSet.mDependency;
+    hasher.add(dependency.srcSubpass).add(dependency.dstSubpass);
+    hasher.add(dependency.srcStageMask).add(dependency.dstStageMask);
+    hasher.add(dependency.srcAccessMask).add(dependency.dstAccessMask);
+    hasher.add(dependency.dependencyFlags);
+    return(hasher.value());
+}
+
+static VkPipelineLayout create_pipeline_layout(const GraphicsPipelineConstructionSet& aCtorSet){
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    if(vkCreatePipelineLayout(aCtorSet.mLogicalDevice, &aCtorSet.mPipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Unable to create pipeline layout!");
+    }
+    return(layout);
+}
+
 BasicVulkanRenderPipeline::BasicVulkanRenderPipeline(const VkDevice& aLogicalDevice, const VulkanSwapchainBundle* aChainBundle)
 :   _mConstructionSet(aLogicalDevice, aChainBundle), _mLogicalDevice(aLogicalDevice)
 {}
@@ -25,23 +132,30 @@ GraphicsPipelineConstructionSet& BasicVulkanRenderPipeline::setupConstructionSet
 }
 
 void BasicVulkanRenderPipeline::build(const GraphicsPipelineConstructionSet& aFinalCtorSet){
-    if(_mLogicalDevice != aFinalCtorSet.mLogicalDevice){
+    if(_mLogicalDevice == VK_NULL_HANDLE){
+        _mLogicalDevice = aFinalCtorSet.mLogicalDevice;
+    }else if(_mLogicalDevice != aFinalCtorSet.mLogicalDevice){
         throw std::runtime_error("Logical device assigned to BasicVulkanRenderPipeline does not match the device in the constructions set.");
     }
+    if(_mValid){
+        destroy();
+    }
     _mConstructionSet = aFinalCtorSet;
     
     // Create pipeline layout object
-    vkCreatePipelineLayout(aFinalCtorSet.mLogicalDevice, &aFinalCtorSet.mPipelineLayoutInfo, nullptr, &mGraphicsPipeLayout);
+    mGraphicsPipeLayout = create_pipeline_layout(aFinalCtorSet);
 
-    VkPipelineDynamicStateCreateInfo dynamicStateInfo;{
-        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicStateInfo.pNext = nullptr;
-        dynamicStateInfo.flags = 0;
-        dynamicStateInfo.dynamicStateCount = aFinalCtorSet.mDynamicStates.size();
-        dynamicStateInfo.pDynamicStates = aFinalCtorSet.mDynamicStates.data();
-    }
+    mRenderPass = createRenderPass(aFinalCtorSet.mRenderpassCtorSet);
+    mGraphicsPipeline = createGraphicsPipeline(aFinalCtorSet, mGraphicsPipeLayout, mRenderPass, &mLastCreationTime, VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT);
+    _mPipelineAllowsDerivatives = true;
 
-    std::array<VkAttachmentDescription, 2> attachments = {aFinalCtorSet.mRenderpassCtorSet.mColorAttachment, aFinalCtorSet.mRenderpassCtorSet.mDepthAttachment};
+    _mValid = true;
+}
+
+VkRenderPass BasicVulkanRenderPipeline::createRenderPass(const RenderPassConstructionSet& aCtorSet){
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+
+    std::array<VkAttachmentDescription, 2> attachments = {aCtorSet.mColorAttachment, aCtorSet.mDepthAttachment};
     VkRenderPassCreateInfo renderPassInfo;{
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.pNext = nullptr;
@@ -49,59 +163,152 @@ void BasicVulkanRenderPipeline::build(const GraphicsPipelineConstructionSet& aFi
         renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &aFinalCtorSet.mRenderpassCtorSet.mSubpass;
+        renderPassInfo.pSubpasses = &aCtorSet.mSubpass;
         renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &aFinalCtorSet.mRenderpassCtorSet.mDependency;
+        renderPassInfo.pDependencies = &aCtorSet.mDependency;
     }
 
-    if(vkCreateRenderPass(aFinalCtorSet.mLogicalDevice, &renderPassInfo, nullptr, &mRenderPass) != VK_SUCCESS){
+    if(vkCreateRenderPass(aCtorSet.mLogicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS){
         throw std::runtime_error("Unable to create render pass!");
     }
 
+    return(renderPass);
+}
+
+VkPipeline BasicVulkanRenderPipeline::createGraphicsPipeline(
+    const GraphicsPipelineConstructionSet& aCtorSet, VkPipelineLayout aLayout, VkRenderPass aRenderPass,
+    std::chrono::microseconds* aCreationTimeOut,
+    VkPipelineCreateFlags aFlags, VkPipeline aBasePipeline
+){
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo;{
+        dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateInfo.pNext = nullptr;
+        dynamicStateInfo.flags = 0;
+        dynamicStateInfo.dynamicStateCount = aCtorSet.mDynamicStates.size();
+        dynamicStateInfo.pDynamicStates = aCtorSet.mDynamicStates.data();
+    }
+
     VkPipelineViewportStateCreateInfo viewportInfo;{
         viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportInfo.pNext = nullptr;
         viewportInfo.flags = 0;
         viewportInfo.viewportCount = 1;
-        viewportInfo.pViewports = &aFinalCtorSet.mViewport;
+        viewportInfo.pViewports = &aCtorSet.mViewport;
         viewportInfo.scissorCount = 1;
-        viewportInfo.pScissors = &aFinalCtorSet.mScissor;
+        viewportInfo.pScissors = &aCtorSet.mScissor;
     }
 
     VkGraphicsPipelineCreateInfo pipelineInfo;{
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.pNext = nullptr;
-        pipelineInfo.flags = 0;
-        pipelineInfo.stageCount = aFinalCtorSet.mProgrammableStages.size();
-        pipelineInfo.pStages = aFinalCtorSet.mProgrammableStages.data();
-        pipelineInfo.pVertexInputState = &aFinalCtorSet.mVtxInputInfo;
-        pipelineInfo.pInputAssemblyState = &aFinalCtorSet.mInputAsmInfo;
+        pipelineInfo.flags = aFlags | (aBasePipeline != VK_NULL_HANDLE ? VK_PIPELINE_CREATE_DERIVATIVE_BIT : 0);
+        pipelineInfo.stageCount = aCtorSet.mProgrammableStages.size();
+        pipelineInfo.pStages = aCtorSet.mProgrammableStages.data();
+        pipelineInfo.pVertexInputState = &aCtorSet.mVtxInputInfo;
+        pipelineInfo.pInputAssemblyState = &aCtorSet.mInputAsmInfo;
         pipelineInfo.pTessellationState = nullptr;
         pipelineInfo.pViewportState = &viewportInfo;
-        pipelineInfo.pRasterizationState = &aFinalCtorSet.mRasterInfo;
-        pipelineInfo.pMultisampleState = &aFinalCtorSet.mMultisampleInfo;
-        pipelineInfo.pDepthStencilState = &aFinalCtorSet.mDepthInfo;
+        pipelineInfo.pRasterizationState = &aCtorSet.mRasterInfo;
+        pipelineInfo.pMultisampleState = &aCtorSet.mMultisampleInfo;
+        pipelineInfo.pDepthStencilState = &aCtorSet.mDepthInfo;
         //pipelineInfo.pDepthStencilState = nullptr;
-        pipelineInfo.pColorBlendState = &aFinalCtorSet.mColorBlendInfo;
-        pipelineInfo.pDynamicState = aFinalCtorSet.mDynamicStates.empty() ? nullptr : &dynamicStateInfo;
-        pipelineInfo.layout = mGraphicsPipeLayout;
-        pipelineInfo.renderPass = mRenderPass;
+        pipelineInfo.pColorBlendState = &aCtorSet.mColorBlendInfo;
+        pipelineInfo.pDynamicState = aCtorSet.mDynamicStates.empty() ? nullptr : &dynamicStateInfo;
+        pipelineInfo.layout = aLayout;
+        pipelineInfo.renderPass = aRenderPass;
         pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineHandle = aBasePipeline;
         pipelineInfo.basePipelineIndex = -1;
     }
 
-    if(vkCreateGraphicsPipelines(aFinalCtorSet.mLogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipeline) != VK_SUCCESS){
+    auto creationStart = std::chrono::steady_clock::now();
+    if(vkCreateGraphicsPipelines(aCtorSet.mLogicalDevice, aCtorSet.mPipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS){
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
+    if(aCreationTimeOut != nullptr){
+        *aCreationTimeOut = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - creationStart);
+    }
 
-    _mValid = true;
+    return(pipeline);
+}
+
+void BasicVulkanRenderPipeline::swapPipeline(const GraphicsPipelineConstructionSet& aCtorSet, VkPipeline aPipeline){
+    if(!_mValid){
+        throw std::runtime_error("BasicVulkanRenderPipeline::swapPipeline() called on a pipeline that was never built!");
+    }
+    vkDestroyPipeline(_mLogicalDevice, mGraphicsPipeline, nullptr);
+    mGraphicsPipeline = aPipeline;
+    _mConstructionSet = aCtorSet;
+    _mPipelineAllowsDerivatives = false;
+}
+
+uint32_t BasicVulkanRenderPipeline::rebuild(){
+    GraphicsPipelineConstructionSet ctorSet = _mConstructionSet;
+    if(ctorSet.mSwapchainBundle != nullptr){
+        prepareViewport(ctorSet);
+        ctorSet.mRenderpassCtorSet.mColorAttachment.format = ctorSet.mSwapchainBundle->surface_format.format;
+    }
+    return(rebuild(ctorSet));
 }
 
-void BasicVulkanRenderPipeline::rebuild(){
-    build(_mConstructionSet);
-    fprintf(stderr, "Warning. BasicVulkanRenderPipeline::rebuild() not fully implemented!");
-    // throw std::runtime_error("TODO: Not implemented");
+uint32_t BasicVulkanRenderPipeline::rebuild(const GraphicsPipelineConstructionSet& aNewCtorSet){
+    if(!_mValid){
+        build(aNewCtorSet);
+        return(REBUILT_RENDER_PASS | REBUILT_LAYOUT | REBUILT_PIPELINE);
+    }
+    if(_mLogicalDevice != aNewCtorSet.mLogicalDevice){
+        throw std::runtime_error("Logical device assigned to BasicVulkanRenderPipeline does not match the device in the constructions set.");
+    }
+
+    uint32_t rebuilt = REBUILT_NONE;
+    if(hash_render_pass_inputs(aNewCtorSet.mRenderpassCtorSet) != hash_render_pass_inputs(_mConstructionSet.mRenderpassCtorSet)){
+        rebuilt |= REBUILT_RENDER_PASS;
+    }
+    if(PipelineManager::hashPipelineLayout(aNewCtorSet.mPipelineLayoutInfo) != PipelineManager::hashPipelineLayout(_mConstructionSet.mPipelineLayoutInfo)){
+        rebuilt |= REBUILT_LAYOUT;
+    }
+    // The state hash covers render pass compatibility, so a render pass that only differs in e.g. load ops keeps the pipeline.
+    // A new layout object always needs a new pipeline, even if it was created from equal inputs.
+    if((rebuilt & REBUILT_LAYOUT) || PipelineManager::hashPipelineState(aNewCtorSet) != PipelineManager::hashPipelineState(_mConstructionSet)){
+        rebuilt |= REBUILT_PIPELINE;
+    }
+
+    // Create everything before destroying anything, so a failure leaves the pipeline as it was
+    VkRenderPass renderPass = mRenderPass;
+    VkPipelineLayout layout = mGraphicsPipeLayout;
+    VkPipeline pipeline = mGraphicsPipeline;
+    try{
+        if(rebuilt & REBUILT_RENDER_PASS) renderPass = createRenderPass(aNewCtorSet.mRenderpassCtorSet);
+        if(rebuilt & REBUILT_LAYOUT) layout = create_pipeline_layout(aNewCtorSet);
+        if(rebuilt & REBUILT_PIPELINE){
+            pipeline = createGraphicsPipeline(
+                aNewCtorSet, layout, renderPass, &mLastCreationTime,
+                VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT, _mPipelineAllowsDerivatives ? mGraphicsPipeline : VK_NULL_HANDLE
+            );
+        }
+    }catch(...){
+        if(renderPass != mRenderPass) vkDestroyRenderPass(_mLogicalDevice, renderPass, nullptr);
+        if(layout != mGraphicsPipeLayout) vkDestroyPipelineLayout(_mLogicalDevice, layout, nullptr);
+        throw;
+    }
+
+    if(rebuilt & REBUILT_PIPELINE){
+        vkDestroyPipeline(_mLogicalDevice, mGraphicsPipeline, nullptr);
+        mGraphicsPipeline = pipeline;
+        _mPipelineAllowsDerivatives = true;
+    }
+    if(rebuilt & REBUILT_LAYOUT){
+        vkDestroyPipelineLayout(_mLogicalDevice, mGraphicsPipeLayout, nullptr);
+        mGraphicsPipeLayout = layout;
+    }
+    if(rebuilt & REBUILT_RENDER_PASS){
+        vkDestroyRenderPass(_mLogicalDevice, mRenderPass, nullptr);
+        mRenderPass = renderPass;
+    }
+    _mConstructionSet = aNewCtorSet;
+    return(rebuilt);
 }
 
 void BasicVulkanRenderPipeline::prepareFixedStages(GraphicsPipelineConstructionSet& aCtorSetInOut){
@@ -152,7 +359,8 @@ void BasicVulkanRenderPipeline::prepareFixedStages(GraphicsPipelineConstructionS
     }
 
     {
-        aCtorSetInOut.mBlendAttachmentInfo.blendEnable = VK_TRUE;
+        // Opaque unless a material asks for blending
+        aCtorSetInOut.mBlendAttachmentInfo.blendEnable = VK_FALSE;
         aCtorSetInOut.mBlendAttachmentInfo.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
         aCtorSetInOut.mBlendAttachmentInfo.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
         aCtorSetInOut.mBlendAttachmentInfo.colorBlendOp = VK_BLEND_OP_ADD;
@@ -0,0 +1,165 @@
+#include "catch.hpp"
+#include "data/AssetRegistry.h"
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Stands in for the device buffers of a mesh, remembering whether they were freed
+class FakeBuffer : public DeviceSyncedBuffer
+{
+ public:
+    virtual DeviceSyncStateEnum getDeviceSyncState() const override {return(freed ? DEVICE_EMPTY : CPU_DATA_FLUSHED);}
+    virtual void updateDevice(const VulkanDeviceBundle& aDeviceBundle = {}) override {}
+    virtual VulkanDeviceHandlePair getCurrentDevice() const override {return(VulkanDeviceHandlePair());}
+    virtual const VkBuffer& getBuffer() const override {return(mBuffer);}
+    virtual void freeBuffer() override {freed = true;}
+
+    bool freed = false;
+
+ protected:
+    virtual void setupDeviceUpload(VulkanDeviceHandlePair aDevicePair) override {}
+    virtual void uploadToDevice(VulkanDeviceHandlePair aDevicePair) override {}
+    virtual void finalizeDeviceUpload(VulkanDeviceHandlePair aDevicePair) override {}
+
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+};
+
+// Records requests instead of loading them, and hands out whatever finish() was given
+class FakeStreamer : public AssetStreamer
+{
+ public:
+    virtual uint64_t requestModel(const std::string& aPath, StreamedVertexFormat aFormat) override {
+        requests.push_back(aPath);
+        return(requests.size());
+    }
+    virtual bool poll(StreamedMesh& aMeshOut) override {
+        if(finished.empty()) return(false);
+        aMeshOut = std::move(finished.front());
+        finished.pop_front();
+        return(true);
+    }
+
+    std::shared_ptr<FakeBuffer> finish(uint64_t aTicket, uint64_t aContentHash, const std::string& aError = ""){
+        std::shared_ptr<FakeBuffer> buffer = std::make_shared<FakeBuffer>();
+        StreamedMesh mesh;
+        mesh.ticket = aTicket;
+        mesh.contentHash = aContentHash;
+        mesh.error = aError;
+        if(aError.empty()){
+            mesh.indices = buffer;
+            mesh.deviceBytes = 256;
+        }
+        finished.push_back(std::move(mesh));
+        return(buffer);
+    }
+
+    std::vector<std::string> requests;
+    std::deque<StreamedMesh> finished;
+};
+
+static void write_file(const std::string& aPath, const std::string& aContents){
+    std::ofstream file(aPath, std::ios::binary | std::ios::trunc);
+    file << aContents;
+}
+
+TEST_CASE("AssetRegistry Tests"){
+    const std::string path = "AssetRegistry_tests_a.glb";
+    const std::string otherPath = "AssetRegistry_tests_b.glb";
+    write_file(path, "mesh");
+    write_file(otherPath, "mesh");
+
+    FakeStreamer streamer;
+
+    SECTION("References are counted and unused meshes unloaded"){
+        AssetRegistry registry(streamer);
+        MeshHandle handle = registry.acquire(path);
+        REQUIRE(handle.isValid());
+        // Different spellings of the same path load it once
+        REQUIRE(registry.acquire("./" + path) == handle);
+        REQUIRE(streamer.requests.size() == 1);
+        REQUIRE(registry.getMemoryInfo(handle).references == 2);
+        REQUIRE(registry.getState(handle) == ASSET_LOADING);
+        REQUIRE(registry.getMesh(handle) == nullptr);
+
+        streamer.finish(1, 0x1234);
+        REQUIRE(registry.update() == 1);
+        REQUIRE(registry.isReady(handle));
+        REQUIRE(registry.getMemoryInfo(handle).deviceBytes == 256);
+
+        registry.release(handle);
+        REQUIRE(registry.unloadUnused() == 0);
+        registry.release(handle);
+        REQUIRE(registry.unloadUnused() == 1);
+        REQUIRE(registry.getState(handle) == ASSET_UNLOADED);
+        REQUIRE_THROWS_AS(registry.release(handle), std::runtime_error);
+        REQUIRE_FALSE(registry.acquire("AssetRegistry_tests_missing.glb").isValid());
+    }
+
+    SECTION("Reused slots and edited files get new handles"){
+        AssetRegistry registry(streamer);
+        MeshHandle first = registry.acquire(path);
+        registry.release(first);
+        REQUIRE(registry.unloadUnused() == 1);
+
+        MeshHandle second = registry.acquire(path);
+        REQUIRE(streamer.requests.size() == 2);
+        REQUIRE(second.index == first.index);
+        REQUIRE(second.generation == first.generation + 1);
+        REQUIRE(registry.getState(first) == ASSET_UNLOADED);
+        REQUIRE(registry.getState(second) == ASSET_LOADING);
+
+        // The old version stays loaded for the handles still holding it
+        write_file(path, "edited mesh");
+        MeshHandle edited = registry.acquire(path);
+        REQUIRE(streamer.requests.size() == 3);
+        REQUIRE(edited != second);
+        REQUIRE(registry.getState(second) == ASSET_LOADING);
+        REQUIRE(registry.acquire(path) == edited);
+    }
+
+    SECTION("Files with the same content share a mesh"){
+        AssetRegistry registry(streamer);
+        MeshHandle handle = registry.acquire(path);
+        MeshHandle other = registry.acquire(otherPath);
+        REQUIRE(streamer.requests.size() == 2);
+        REQUIRE(other != handle);
+
+        std::shared_ptr<FakeBuffer> buffer = streamer.finish(1, 0x1234);
+        std::shared_ptr<FakeBuffer> otherBuffer = streamer.finish(2, 0x1234);
+        REQUIRE(registry.update() == 2);
+        REQUIRE(registry.getMesh(other) == registry.getMesh(handle));
+        REQUIRE(otherBuffer->freed);
+        REQUIRE_FALSE(buffer->freed);
+        REQUIRE(registry.getMemoryInfo().deviceBytes == 256);
+
+        // The shared mesh stays until the mesh sharing it is gone as well
+        registry.release(handle);
+        REQUIRE(registry.unloadUnused() == 0);
+        registry.release(other);
+        REQUIRE(registry.unloadUnused() == 2);
+        REQUIRE(buffer->freed);
+    }
+
+    SECTION("Failed loads are retried"){
+        AssetRegistry registry(streamer);
+        MeshHandle failed = registry.acquire(path);
+        streamer.finish(1, 0, "broken");
+        REQUIRE(registry.update() == 0);
+        REQUIRE(registry.getState(failed) == ASSET_FAILED);
+
+        MeshHandle retried = registry.acquire(path);
+        REQUIRE(streamer.requests.size() == 2);
+        REQUIRE(retried != failed);
+        streamer.finish(2, 0x1234);
+        REQUIRE(registry.update() == 1);
+        REQUIRE(registry.isReady(retried));
+        REQUIRE(registry.getState(failed) == ASSET_FAILED);
+    }
+
+    remove(path.c_str());
+    remove(otherPath.c_str());
+}
@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include "utils/CookedMesh.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("CookedMesh Tests"){
+    const std::string path = "CookedMesh_tests.mesh";
+
+    std::vector<float> vertices = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f};
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3};
+    std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+    IndexChunk chunk;
+    chunk.indexCount = 6;
+    chunk.vertexCount = 4;
+    Meshlet meshlet;
+    meshlet.indexCount = 6;
+    meshlet.vertexCount = 4;
+    meshlet.radius = 0.75f;
+    CookedMesh::Lod lod;
+    lod.chunkCount = 1;
+    lod.meshletCount = 1;
+
+    CookedMesh::Contents contents;
+    contents.sourceKey = 0x1234;
+    contents.vertices = vertices.data();
+    contents.vertexStride = 3 * sizeof(float);
+    contents.vertexCount = 4;
+    contents.shortIndices = shortIndices.data();
+    contents.indices = indices.data();
+    contents.indexCount = 6;
+    contents.chunks = &chunk;
+    contents.chunkCount = 1;
+    contents.lods = &lod;
+    contents.lodCount = 1;
+    contents.meshlets = &meshlet;
+    contents.meshletCount = 1;
+    contents.boundsMax[0] = contents.boundsMax[1] = 1.0f;
+    REQUIRE(CookedMesh::write(path, contents));
+
+    SECTION("Contents round trip through write and open"){
+        CookedMesh mesh;
+        REQUIRE(mesh.open(path, 0x1234, 3 * sizeof(float)));
+        const CookedMesh::Contents& loaded = mesh.getContents();
+        REQUIRE(loaded.vertexCount == 4);
+        REQUIRE(memcmp(loaded.vertices, vertices.data(), vertices.size() * sizeof(float)) == 0);
+        REQUIRE(std::vector<uint32_t>(loaded.indices, loaded.indices + loaded.indexCount) == indices);
+        REQUIRE(std::vector<uint16_t>(loaded.shortIndices, loaded.shortIndices + loaded.indexCount) == shortIndices);
+        REQUIRE(reinterpret_cast<uintptr_t>(loaded.vertices) % 16 == 0);
+        REQUIRE(loaded.chunkCount == 1);
+        REQUIRE(loaded.chunks[0].indexCount == 6);
+        REQUIRE(loaded.lodCount == 1);
+        REQUIRE(loaded.lods[0].meshletCount == 1);
+        REQUIRE(loaded.meshletCount == 1);
+        REQUIRE(loaded.meshlets[0].indexCount == 6);
+        REQUIRE(loaded.meshlets[0].radius == 0.75f);
+        REQUIRE(loaded.boundsMax[1] == 1.0f);
+    }
+
+    SECTION("Stale, mismatched and corrupt files are rejected"){
+        CookedMesh mesh;
+        REQUIRE_FALSE(mesh.open(path, 0x4321, 3 * sizeof(float)));
+        REQUIRE_FALSE(mesh.open(path, 0x1234, 4 * sizeof(float)));
+        REQUIRE_FALSE(mesh.open("does_not_exist.mesh", 0x1234, 3 * sizeof(float)));
+
+        // Indices past the vertices, whether 32 bit or chunk local 16 bit, would read outside the vertex buffer
+        indices[5] = 4;
+        REQUIRE(CookedMesh::write(path, contents));
+        REQUIRE_FALSE(mesh.open(path, 0x1234, 3 * sizeof(float)));
+        indices[5] = 3;
+        shortIndices[5] = 4;
+        REQUIRE(CookedMesh::write(path, contents));
+        REQUIRE_FALSE(mesh.open(path, 0x1234, 3 * sizeof(float)));
+
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << "definitely not a cooked mesh";
+        }
+        REQUIRE_FALSE(mesh.open(path, 0x1234, 3 * sizeof(float)));
+        REQUIRE_FALSE(mesh.isOpen());
+    }
+
+    SECTION("File hashes follow the content"){
+        uint64_t hash = CookedMesh::hashFile(path);
+        REQUIRE(hash != 0);
+        REQUIRE(CookedMesh::hashFile(path) == hash);
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::app);
+            file << "x";
+        }
+        REQUIRE(CookedMesh::hashFile(path) != hash);
+        REQUIRE(CookedMesh::hashFile("does_not_exist.mesh") == 0);
+    }
+
+    remove(path.c_str());
+}
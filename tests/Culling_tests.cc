@@ -0,0 +1,77 @@
+#include "catch.hpp"
+#include "utils/Culling.h"
+#include "TestMeshes.h"
+#include <cstdlib>
+#include <vector>
+
+static float random_float(float aMin, float aMax){
+    return(aMin + (aMax - aMin) * static_cast<float>(std::rand()) / RAND_MAX);
+}
+
+TEST_CASE("Culling Tests"){
+    const Frustum frustum = extract_frustum(make_view_projection());
+
+    SECTION("Bounds are transformed conservatively"){
+        Bounds bounds = make_bounds(glm::vec3(-1.0f, -2.0f, -3.0f), glm::vec3(3.0f, 2.0f, 1.0f), 4.0f);
+        REQUIRE(bounds.center.x == Approx(1.0f));
+        REQUIRE(bounds.center.z == Approx(-1.0f));
+        REQUIRE(bounds.extent.y == Approx(2.0f));
+
+        // Rotated a quarter turn around z and scaled by two
+        glm::mat4 transform(0.0f);
+        transform[0] = glm::vec4(0.0f, 2.0f, 0.0f, 0.0f);
+        transform[1] = glm::vec4(-2.0f, 0.0f, 0.0f, 0.0f);
+        transform[2] = glm::vec4(0.0f, 0.0f, 2.0f, 0.0f);
+        transform[3] = glm::vec4(10.0f, 0.0f, 0.0f, 1.0f);
+        Bounds moved = transform_bounds(bounds, transform);
+        REQUIRE(moved.center.x == Approx(10.0f));
+        REQUIRE(moved.center.y == Approx(2.0f));
+        REQUIRE(moved.center.z == Approx(-2.0f));
+        REQUIRE(moved.extent.x == Approx(4.0f));
+        REQUIRE(moved.extent.y == Approx(4.0f));
+        REQUIRE(moved.extent.z == Approx(4.0f));
+        REQUIRE(moved.radius == Approx(8.0f));
+    }
+
+    SECTION("Objects outside of a plane are culled"){
+        BoundsBatch batch;
+        batch.push_back(make_bounds(glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f), 1.8f)); // In view
+        batch.push_back(make_bounds(glm::vec3(12.0f, -1.0f, -11.0f), glm::vec3(14.0f, 1.0f, -9.0f), 1.8f)); // Right of it
+        batch.push_back(make_bounds(glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 6.0f), 1.8f)); // Behind the camera
+        batch.push_back(make_bounds(glm::vec3(-1.0f, -1.0f, -103.0f), glm::vec3(1.0f, 1.0f, -101.0f), 1.8f)); // Too far
+        // A long thin box poking into view from the side
+        batch.push_back(make_bounds(glm::vec3(9.0f, -0.1f, -10.1f), glm::vec3(20.0f, 0.1f, -9.9f), 5.6f));
+        // A ball just right of the view. Its box still reaches into the frustum, its sphere does not.
+        batch.push_back(make_bounds(glm::vec3(10.7f, -1.0f, -11.0f), glm::vec3(12.7f, 1.0f, -9.0f), 1.0f));
+
+        std::vector<uint32_t> visible = {42};
+        REQUIRE(cull_bounds(visible, batch, frustum) == 2);
+        REQUIRE(visible == std::vector<uint32_t>({42, 0, 4}));
+
+        visible.clear();
+        REQUIRE(cull_bounds_scalar(visible, batch, frustum) == 2);
+        REQUIRE(visible == std::vector<uint32_t>({0, 4}));
+    }
+
+    SECTION("The vectorized kernel agrees with the scalar one"){
+        // Sizes that leave a remainder after every batch width
+        std::srand(7);
+        for(size_t count : {1, 7, 9, 100, 1003}){
+            BoundsBatch batch;
+            for(size_t i = 0; i < count; ++i){
+                glm::vec3 center(random_float(-60.0f, 60.0f), random_float(-60.0f, 60.0f), random_float(-120.0f, 20.0f));
+                glm::vec3 extent(random_float(0.0f, 4.0f), random_float(0.0f, 4.0f), random_float(0.0f, 4.0f));
+                batch.push_back(make_bounds(center - extent, center + extent, glm::length(extent) * random_float(0.5f, 1.0f)));
+            }
+
+            std::vector<uint32_t> vectorized, scalar;
+            size_t kept = cull_bounds(vectorized, batch, frustum);
+            REQUIRE(cull_bounds_scalar(scalar, batch, frustum) == kept);
+            REQUIRE(vectorized == scalar);
+            if(count > 100){
+                REQUIRE(kept > 0);
+                REQUIRE(kept < count);
+            }
+        }
+    }
+}
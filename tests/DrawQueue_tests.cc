@@ -0,0 +1,76 @@
+#include "catch.hpp"
+#include "utils/DrawQueue.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+static DrawKey make_key(uint32_t aPass, uint32_t aPipeline, uint32_t aMaterial, uint32_t aVertexBuffer, uint32_t aDepth){
+    DrawKey key;
+    key.pass = aPass;
+    key.pipeline = aPipeline;
+    key.material = aMaterial;
+    key.vertexBuffer = aVertexBuffer;
+    key.depth = aDepth;
+    return(key);
+}
+
+TEST_CASE("DrawQueue Tests"){
+
+    SECTION("Keys round trip and clamp wide fields"){
+        DrawKey unpacked = DrawKey::unpack(make_key(3, 1234, 567, 8910, 1112).pack());
+        REQUIRE(unpacked.pass == 3);
+        REQUIRE(unpacked.pipeline == 1234);
+        REQUIRE(unpacked.material == 567);
+        REQUIRE(unpacked.vertexBuffer == 8910);
+        REQUIRE(unpacked.depth == 1112);
+
+        DrawKey clamped = DrawKey::unpack(make_key(100, 0, 0, 0, 0).pack());
+        REQUIRE(clamped.pass == (1U << DrawKey::PASS_BITS) - 1);
+        REQUIRE(clamped.pipeline == 0);
+    }
+
+    SECTION("Fields order from pass down to depth"){
+        REQUIRE(make_key(1, 0, 0, 0, 0).pack() > make_key(0, 65535, 4095, 65535, 65535).pack());
+        REQUIRE(make_key(0, 1, 0, 0, 0).pack() > make_key(0, 0, 4095, 65535, 65535).pack());
+        REQUIRE(make_key(0, 0, 1, 0, 0).pack() > make_key(0, 0, 0, 65535, 65535).pack());
+        REQUIRE(make_key(0, 0, 0, 1, 0).pack() > make_key(0, 0, 0, 0, 65535).pack());
+    }
+
+    SECTION("Depth buckets"){
+        REQUIRE(DrawKey::depthBucket(-1.0f) == 0);
+        REQUIRE(DrawKey::depthBucket(0.25f) < DrawKey::depthBucket(0.5f));
+        REQUIRE(DrawKey::depthBucket(2.0f) == (1U << DrawKey::DEPTH_BITS) - 1);
+    }
+
+    SECTION("Sorting matches a stable sort"){
+        std::srand(49);
+        DrawQueue queue;
+        std::vector<DrawQueue::Packet> expected;
+        for(uint32_t i = 0; i < 1000; ++i){
+            // Few distinct values per field, so many keys are equal
+            DrawKey key = make_key(std::rand() % 2, std::rand() % 5, std::rand() % 3, std::rand() % 4, std::rand() % 2);
+            queue.push(key, i);
+            expected.push_back(DrawQueue::Packet{key.pack(), i});
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](const DrawQueue::Packet& aLeft, const DrawQueue::Packet& aRight){
+            return(aLeft.key < aRight.key);
+        });
+
+        queue.sort();
+        REQUIRE(queue.size() == expected.size());
+        for(size_t i = 0; i < expected.size(); ++i){
+            REQUIRE(queue.getPackets()[i].key == expected[i].key);
+            REQUIRE(queue.getPackets()[i].draw == expected[i].draw);
+        }
+
+        // Sorting again changes nothing, and clearing keeps the queue usable
+        queue.sort();
+        REQUIRE(queue.getPackets().front().draw == expected.front().draw);
+        queue.clear();
+        REQUIRE(queue.empty());
+        queue.sort();
+        queue.push(7, 0);
+        queue.sort();
+        REQUIRE(queue.getPackets().front().key == 7);
+    }
+}
@@ -0,0 +1,35 @@
+#include "catch.hpp"
+#include "utils/Hash.h"
+#include <string>
+
+TEST_CASE("Hash Tests"){
+
+    SECTION("FNV-1a reference values"){
+        REQUIRE(fnv1a_hash("", 0) == 0xcbf29ce484222325ULL);
+        REQUIRE(fnv1a_hash("a", 1) == 0xaf63dc4c8601ec8cULL);
+        REQUIRE(fnv1a_hash("foobar", 6) == 0x85944171f73967e8ULL);
+    }
+
+    SECTION("Incremental hashing matches a single pass"){
+        Fnv1aHasher hasher;
+        hasher.addBytes("foo", 3).addBytes("bar", 3);
+        REQUIRE(hasher.value() == fnv1a_hash("foobar", 6));
+    }
+
+    SECTION("Field order matters"){
+        uint32_t a = 1, b = 2;
+        REQUIRE(Fnv1aHasher().add(a).add(b).value() != Fnv1aHasher().add(b).add(a).value());
+
+        uint64_t seedAB = 0, seedBA = 0;
+        hash_combine(seedAB, 1); hash_combine(seedAB, 2);
+        hash_combine(seedBA, 2); hash_combine(seedBA, 1);
+        REQUIRE(seedAB != seedBA);
+    }
+
+    SECTION("Strings are length prefixed"){
+        Fnv1aHasher split, joined;
+        split.add(std::string("ab")).add(std::string("c"));
+        joined.add(std::string("a")).add(std::string("bc"));
+        REQUIRE(split.value() != joined.value());
+    }
+}
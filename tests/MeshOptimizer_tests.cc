@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "utils/MeshOptimizer.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+static void shuffle_triangles(std::vector<uint32_t>& aIndices){
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for(size_t i = 0; i < aIndices.size(); i += 3) triangles.push_back({{aIndices[i], aIndices[i + 1], aIndices[i + 2]}});
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+    aIndices.clear();
+    for(const std::array<uint32_t, 3>& triangle : triangles) aIndices.insert(aIndices.end(), triangle.begin(), triangle.end());
+}
+
+// Triangles as a sorted list, with each triangle's winding preserved by rotating its smallest index to the front
+static std::vector<std::array<uint32_t, 3>> canonical_triangles(const std::vector<uint32_t>& aIndices){
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for(size_t i = 0; i < aIndices.size(); i += 3){
+        std::array<uint32_t, 3> triangle = {{aIndices[i], aIndices[i + 1], aIndices[i + 2]}};
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return(triangles);
+}
+
+TEST_CASE("MeshOptimizer Tests"){
+    std::vector<std::array<float, 3>> positions;
+    std::vector<uint32_t> indices;
+    make_grid(32, positions, indices);
+    shuffle_triangles(indices);
+    const size_t vertexCount = positions.size();
+
+    SECTION("Cache analysis of a worst case order"){
+        std::vector<uint32_t> disjoint = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+        VertexCacheStatistics stats = analyze_vertex_cache(disjoint, 9);
+        REQUIRE(stats.transformedVertices == 9);
+        REQUIRE(stats.acmr == Approx(3.0f));
+        REQUIRE(stats.atvr == Approx(1.0f));
+    }
+
+    SECTION("Vertex cache optimization keeps the triangles and lowers the ACMR"){
+        std::vector<uint32_t> optimized = indices;
+        optimize_vertex_cache(optimized, vertexCount);
+        REQUIRE(canonical_triangles(optimized) == canonical_triangles(indices));
+
+        VertexCacheStatistics before = analyze_vertex_cache(indices, vertexCount);
+        VertexCacheStatistics after = analyze_vertex_cache(optimized, vertexCount);
+        REQUIRE(after.acmr < before.acmr);
+        REQUIRE(after.acmr < 1.0f);
+    }
+
+    SECTION("Overdraw optimization keeps the triangles within the ACMR threshold"){
+        std::vector<uint32_t> optimized = indices;
+        optimize_vertex_cache(optimized, vertexCount);
+        float cacheOptimizedAcmr = analyze_vertex_cache(optimized, vertexCount).acmr;
+
+        optimize_overdraw(optimized, positions[0].data(), vertexCount, sizeof(positions[0]), 1.05f);
+        REQUIRE(canonical_triangles(optimized) == canonical_triangles(indices));
+        REQUIRE(analyze_vertex_cache(optimized, vertexCount).acmr <= cacheOptimizedAcmr * 1.05f);
+    }
+
+    SECTION("Vertex fetch remap orders vertices by first use and drops unused ones"){
+        std::vector<uint32_t> small = {4, 2, 0, 0, 2, 3};
+        std::vector<uint32_t> remap;
+        REQUIRE(optimize_vertex_fetch_remap(remap, small, 6) == 4);
+        REQUIRE(remap == std::vector<uint32_t>({2, UINT32_MAX, 1, 3, 0, UINT32_MAX}));
+
+        std::vector<int> vertices = {10, 11, 12, 13, 14, 15};
+        remap_vertices(vertices, small, remap, 4);
+        REQUIRE(vertices == std::vector<int>({14, 12, 10, 13}));
+        REQUIRE(small == std::vector<uint32_t>({0, 1, 2, 2, 1, 3}));
+    }
+
+    SECTION("Index chunks stay below the vertex limit and reproduce every triangle"){
+        std::vector<uint16_t> localIndices;
+        std::vector<uint32_t> vertexSource;
+        std::vector<IndexChunk> single = split_index_chunks(indices, vertexCount, localIndices, vertexSource);
+        REQUIRE(single.size() == 1);
+        REQUIRE(vertexSource.size() == vertexCount);
+        REQUIRE(std::vector<uint32_t>(localIndices.begin(), localIndices.end()) == indices);
+
+        const size_t chunkLimit = 200;
+        std::vector<IndexChunk> chunks = split_index_chunks(indices, vertexCount, localIndices, vertexSource, chunkLimit);
+        REQUIRE(chunks.size() > 1);
+        REQUIRE(localIndices.size() == indices.size());
+
+        std::vector<uint32_t> restored;
+        uint32_t nextIndex = 0;
+        for(const IndexChunk& chunk : chunks){
+            REQUIRE(chunk.firstIndex == nextIndex);
+            REQUIRE(chunk.vertexCount <= chunkLimit);
+            nextIndex += chunk.indexCount;
+            for(uint32_t i = chunk.firstIndex; i < chunk.firstIndex + chunk.indexCount; ++i){
+                REQUIRE(localIndices[i] < chunk.vertexCount);
+                restored.push_back(vertexSource[chunk.vertexOffset + localIndices[i]]);
+            }
+        }
+        REQUIRE(restored == indices);
+    }
+}
@@ -0,0 +1,168 @@
+#include "catch.hpp"
+#include "utils/MeshSimplifier.h"
+#include "TestMeshes.h"
+#include <array>
+#include <cmath>
+#include <set>
+#include <vector>
+
+// Unit sphere of latitude/longitude rings, closed and with a single vertex per position
+static void make_sphere(size_t aRings, std::vector<std::array<float, 3>>& aPositionsOut, std::vector<uint32_t>& aIndicesOut){
+    const float pi = 3.14159265f;
+    const size_t segments = aRings * 2;
+    aPositionsOut.push_back({{0.0f, 1.0f, 0.0f}});
+    for(size_t ring = 1; ring < aRings; ++ring){
+        float theta = pi * ring / aRings;
+        for(size_t segment = 0; segment < segments; ++segment){
+            float phi = 2.0f * pi * segment / segments;
+            aPositionsOut.push_back({{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)}});
+        }
+    }
+    aPositionsOut.push_back({{0.0f, -1.0f, 0.0f}});
+    const uint32_t bottom = static_cast<uint32_t>(aPositionsOut.size() - 1);
+
+    auto vertex = [segments](size_t aRing, size_t aSegment){return(static_cast<uint32_t>(1 + (aRing - 1) * segments + aSegment % segments));};
+    for(size_t segment = 0; segment < segments; ++segment){
+        aIndicesOut.insert(aIndicesOut.end(), {0, vertex(1, segment + 1), vertex(1, segment)});
+        aIndicesOut.insert(aIndicesOut.end(), {bottom, vertex(aRings - 1, segment), vertex(aRings - 1, segment + 1)});
+        for(size_t ring = 1; ring + 1 < aRings; ++ring){
+            uint32_t i0 = vertex(ring, segment), i1 = vertex(ring, segment + 1), i2 = vertex(ring + 1, segment), i3 = vertex(ring + 1, segment + 1);
+            aIndicesOut.insert(aIndicesOut.end(), {i0, i1, i2, i2, i1, i3});
+        }
+    }
+}
+
+static float signed_area_z(const std::vector<std::array<float, 3>>& aPositions, const std::vector<uint32_t>& aIndices){
+    float area = 0.0f;
+    for(size_t i = 0; i < aIndices.size(); i += 3){
+        const std::array<float, 3>& a = aPositions[aIndices[i]];
+        const std::array<float, 3>& b = aPositions[aIndices[i + 1]];
+        const std::array<float, 3>& c = aPositions[aIndices[i + 2]];
+        area += 0.5f * ((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]));
+    }
+    return(area);
+}
+
+struct TestLod
+{
+    float error;
+};
+
+TEST_CASE("MeshSimplifier Tests"){
+
+    SECTION("A flat grid collapses without error and keeps its outline"){
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> indices;
+        make_grid(16, positions, indices);
+
+        std::vector<uint32_t> simplified;
+        float error = simplify_mesh(simplified, indices, &positions[0][0], positions.size(), sizeof(positions[0]), indices.size() / 8, 1e-3f);
+        REQUIRE(simplified.size() % 3 == 0);
+        REQUIRE(simplified.size() <= indices.size() / 8);
+        REQUIRE(error < 1e-3f);
+
+        // Same area and winding, and the corners are still there
+        REQUIRE(signed_area_z(positions, simplified) == Approx(signed_area_z(positions, indices)));
+        std::set<uint32_t> used(simplified.begin(), simplified.end());
+        for(uint32_t corner : {0u, 16u, 16u * 17u, 17u * 17u - 1u}) REQUIRE(used.count(corner) == 1);
+    }
+
+    SECTION("Hard edges between split vertices are kept"){
+        // Cube with separate vertices per face, so every edge is a seam and every corner is locked
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> indices;
+        const int faces[6][4][3] = {
+            {{0,0,0},{0,1,0},{1,1,0},{1,0,0}}, {{0,0,1},{1,0,1},{1,1,1},{0,1,1}},
+            {{0,0,0},{1,0,0},{1,0,1},{0,0,1}}, {{0,1,0},{0,1,1},{1,1,1},{1,1,0}},
+            {{0,0,0},{0,0,1},{0,1,1},{0,1,0}}, {{1,0,0},{1,1,0},{1,1,1},{1,0,1}}
+        };
+        for(const auto& face : faces){
+            uint32_t base = static_cast<uint32_t>(positions.size());
+            for(const auto& corner : face) positions.push_back({{float(corner[0]), float(corner[1]), float(corner[2])}});
+            indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+        }
+
+        std::vector<uint32_t> simplified;
+        float error = simplify_mesh(simplified, indices, &positions[0][0], positions.size(), sizeof(positions[0]), 0);
+        REQUIRE(simplified.size() == indices.size());
+        REQUIRE(error == 0.0f);
+    }
+
+    SECTION("A closed mesh reaches its target with a bounded error"){
+        std::vector<std::array<float, 3>> positions;
+        std::vector<uint32_t> indices;
+        make_sphere(16, positions, indices);
+
+        std::vector<uint32_t> simplified;
+        float error = simplify_mesh(simplified, indices, &positions[0][0], positions.size(), sizeof(positions[0]), indices.size() / 4);
+        REQUIRE(simplified.size() <= indices.size() / 4);
+        REQUIRE(simplified.size() >= indices.size() / 8);
+        REQUIRE(error > 0.0f);
+        REQUIRE(error < 0.1f);
+
+        for(size_t i = 0; i < simplified.size(); i += 3){
+            REQUIRE(simplified[i] < positions.size());
+            REQUIRE(simplified[i] != simplified[i + 1]);
+            REQUIRE(simplified[i + 1] != simplified[i + 2]);
+            REQUIRE(simplified[i] != simplified[i + 2]);
+        }
+
+        // Stopping at a smaller error leaves more triangles
+        std::vector<uint32_t> limited;
+        simplify_mesh(limited, indices, &positions[0][0], positions.size(), sizeof(positions[0]), 0, error * 0.5f);
+        REQUIRE(limited.size() > simplified.size());
+    }
+
+    SECTION("Faceted meshes simplify across soft seams when given normals"){
+        std::vector<std::array<float, 3>> smoothPositions;
+        std::vector<uint32_t> smoothIndices;
+        make_sphere(16, smoothPositions, smoothIndices);
+
+        // Every triangle gets its own vertices with the face normal, so every edge is a seam
+        std::vector<std::array<float, 3>> positions, normals;
+        std::vector<uint32_t> indices;
+        for(size_t i = 0; i < smoothIndices.size(); i += 3){
+            const std::array<float, 3>& a = smoothPositions[smoothIndices[i]];
+            const std::array<float, 3>& b = smoothPositions[smoothIndices[i + 1]];
+            const std::array<float, 3>& c = smoothPositions[smoothIndices[i + 2]];
+            std::array<float, 3> normal = {{
+                (b[1] - a[1]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[1] - a[1]),
+                (b[2] - a[2]) * (c[0] - a[0]) - (b[0] - a[0]) * (c[2] - a[2]),
+                (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0])
+            }};
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for(float& component : normal) component /= length;
+            for(size_t k = 0; k < 3; ++k){
+                indices.push_back(static_cast<uint32_t>(positions.size()));
+                positions.push_back(smoothPositions[smoothIndices[i + k]]);
+                normals.push_back(normal);
+            }
+        }
+
+        std::vector<uint32_t> simplified;
+        simplify_mesh(simplified, indices, &positions[0][0], positions.size(), sizeof(positions[0]), indices.size() / 4);
+        REQUIRE(simplified.size() == indices.size());
+
+        float error = simplify_mesh(simplified, indices, &positions[0][0], positions.size(), sizeof(positions[0]), indices.size() / 4,
+            FLT_MAX, &normals[0][0], sizeof(normals[0]));
+        REQUIRE(simplified.size() <= indices.size() / 4);
+        REQUIRE(error < 0.1f);
+    }
+
+    SECTION("Coarser levels are selected as the distance grows"){
+        std::vector<TestLod> lods = {{0.0f}, {0.01f}, {0.04f}, {0.16f}};
+        const float pixelsPerUnit = 1000.0f;
+        REQUIRE(select_lod(lods, 1.0f, pixelsPerUnit) == 0);
+        REQUIRE(select_lod(lods, 10.0f, pixelsPerUnit) == 1);
+        REQUIRE(select_lod(lods, 40.0f, pixelsPerUnit) == 2);
+        REQUIRE(select_lod(lods, 1000.0f, pixelsPerUnit) == 3);
+
+        size_t previous = 0;
+        for(float distance = 0.5f; distance < 2000.0f; distance *= 1.5f){
+            size_t selected = select_lod(lods, distance, pixelsPerUnit);
+            REQUIRE(selected >= previous);
+            previous = selected;
+        }
+        REQUIRE(projected_error(0.01f, 10.0f, pixelsPerUnit) == Approx(1.0f));
+    }
+}
@@ -0,0 +1,116 @@
+#include "catch.hpp"
+#include "utils/Culling.h"
+#include "utils/Meshlets.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <set>
+#include <vector>
+
+TEST_CASE("Meshlets Tests"){
+    std::vector<std::array<float, 3>> positions;
+    std::vector<uint32_t> indices;
+    make_grid(32, positions, indices);
+
+    SECTION("Meshlets cover every triangle once and stay within their limits"){
+        const std::vector<uint32_t> original = indices;
+        std::vector<Meshlet> meshlets;
+        build_meshlets(meshlets, indices, 0, indices.size(), &positions[0][0], positions.size(), sizeof(positions[0]), 64, 124);
+        REQUIRE(meshlets.size() > 1);
+
+        uint32_t nextIndex = 0;
+        for(const Meshlet& meshlet : meshlets){
+            REQUIRE(meshlet.firstIndex == nextIndex);
+            REQUIRE(meshlet.indexCount % 3 == 0);
+            REQUIRE(meshlet.indexCount / 3 <= 124);
+            nextIndex += meshlet.indexCount;
+
+            std::set<uint32_t> vertices(indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+            REQUIRE(vertices.size() == meshlet.vertexCount);
+            REQUIRE(meshlet.vertexCount <= 64);
+
+            // The sphere holds every vertex, and a flat patch has a cone of zero width around its normal
+            for(uint32_t vertex : vertices){
+                const std::array<float, 3>& p = positions[vertex];
+                float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+                REQUIRE(std::sqrt(dx * dx + dy * dy + dz * dz) <= meshlet.radius * 1.0001f);
+            }
+            REQUIRE(meshlet.coneAxis[2] == Approx(1.0f));
+            REQUIRE(meshlet.coneCutoff == Approx(0.0f).margin(1e-3));
+        }
+        REQUIRE(nextIndex == indices.size());
+
+        // Only the order of the triangles changed. Rotating each to start at its smallest index keeps the winding.
+        auto sorted_triangles = [](const std::vector<uint32_t>& aIndices){
+            std::vector<std::array<uint32_t, 3>> triangles;
+            for(size_t i = 0; i < aIndices.size(); i += 3){
+                std::array<uint32_t, 3> triangle = {{aIndices[i], aIndices[i + 1], aIndices[i + 2]}};
+                std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+                triangles.push_back(triangle);
+            }
+            std::sort(triangles.begin(), triangles.end());
+            return(triangles);
+        };
+        std::vector<std::array<uint32_t, 3>> before = sorted_triangles(original), after = sorted_triangles(indices);
+        REQUIRE(before == after);
+    }
+
+    SECTION("Only the given range is split and reordered"){
+        // Five quads of the first row
+        const std::vector<uint32_t> original = indices;
+        std::vector<Meshlet> meshlets;
+        build_meshlets(meshlets, indices, 60, 30, &positions[0][0], positions.size(), sizeof(positions[0]));
+        REQUIRE(meshlets.size() == 1);
+        REQUIRE(meshlets[0].firstIndex == 60);
+        REQUIRE(meshlets[0].indexCount == 30);
+        REQUIRE(meshlets[0].vertexCount == 12);
+        REQUIRE(std::equal(indices.begin(), indices.begin() + 60, original.begin()));
+        REQUIRE(std::equal(indices.begin() + 90, indices.end(), original.begin() + 90));
+    }
+
+    SECTION("Meshlets facing away from the camera are culled"){
+        std::vector<Meshlet> meshlets;
+        build_meshlets(meshlets, indices, 0, indices.size(), &positions[0][0], positions.size(), sizeof(positions[0]));
+
+        // Behind the plane, and far enough away for the test, which is conservative by the meshlet's radius
+        const float front[3] = {16.0f, 16.0f, 10.0f};
+        const float behind[3] = {16.0f, 16.0f, -40.0f};
+        for(const Meshlet& meshlet : meshlets){
+            REQUIRE_FALSE(meshlet_backfacing(meshlet, front));
+            REQUIRE(meshlet_backfacing(meshlet, behind));
+        }
+
+        // A cone of normals pointing every way is never culled
+        Meshlet folded;
+        folded.coneCutoff = 1.0f;
+        REQUIRE_FALSE(meshlet_backfacing(folded, behind));
+    }
+
+    SECTION("Meshlets outside of the view frustum are culled"){
+        Frustum frustum = extract_frustum(make_view_projection());
+        REQUIRE(sphere_in_frustum(frustum, glm::vec3(0.0f, 0.0f, -10.0f), 1.0f));
+        REQUIRE(sphere_in_frustum(frustum, glm::vec3(10.5f, 0.0f, -10.0f), 1.0f));
+        REQUIRE_FALSE(sphere_in_frustum(frustum, glm::vec3(12.0f, 0.0f, -10.0f), 1.0f));
+        REQUIRE_FALSE(sphere_in_frustum(frustum, glm::vec3(0.0f, 0.0f, 5.0f), 1.0f));
+        REQUIRE_FALSE(sphere_in_frustum(frustum, glm::vec3(0.0f, 0.0f, -102.0f), 1.0f));
+
+        // The grid moved in front of the camera with its corner on the view axis, so parts of it are off screen
+        std::vector<std::array<float, 3>> moved = positions;
+        for(std::array<float, 3>& p : moved) p[2] = -8.0f;
+        std::vector<Meshlet> meshlets;
+        build_meshlets(meshlets, indices, 0, indices.size(), &moved[0][0], moved.size(), sizeof(moved[0]));
+
+        std::vector<uint32_t> culled;
+        size_t kept = cull_meshlets(culled, meshlets, 0, meshlets.size(), indices, frustum, glm::vec3(0.0f));
+        REQUIRE(kept > 0);
+        REQUIRE(kept < meshlets.size());
+        REQUIRE(culled.size() % 3 == 0);
+        REQUIRE(culled.size() < indices.size());
+
+        // From far enough behind the grid every meshlet faces away
+        culled.clear();
+        REQUIRE(cull_meshlets(culled, meshlets, 0, meshlets.size(), indices, frustum, glm::vec3(0.0f, 0.0f, -60.0f)) == 0);
+        REQUIRE(culled.empty());
+    }
+}
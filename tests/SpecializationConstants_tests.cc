@@ -0,0 +1,36 @@
+#include "catch.hpp"
+#include "data/SpecializationConstants.h"
+#include <cstddef>
+
+struct TestConstants {
+    VkBool32 enableFeature;
+    uint32_t count;
+};
+
+constexpr std::array<VkSpecializationMapEntry, 2> sTestLayout = {{
+    {0, offsetof(TestConstants, enableFeature), sizeof(VkBool32)},
+    {1, offsetof(TestConstants, count), sizeof(uint32_t)}
+}};
+
+TEST_CASE("SpecializationConstants Tests"){
+    using TestSpecialization = SpecializationConstants<TestConstants, 2>;
+
+    SECTION("Specialization info describes the values"){
+        TestSpecialization::ptr_t constants = TestSpecialization::create(sTestLayout, {VK_TRUE, 7});
+        const VkSpecializationInfo& info = constants->getSpecializationInfo();
+
+        REQUIRE(info.mapEntryCount == 2);
+        REQUIRE(info.dataSize == sizeof(TestConstants));
+        REQUIRE(info.pMapEntries[1].constantID == 1);
+
+        const TestConstants* data = static_cast<const TestConstants*>(info.pData);
+        REQUIRE(data->enableFeature == VK_TRUE);
+        REQUIRE(data->count == 7);
+    }
+
+    SECTION("Entries outside of the struct are rejected"){
+        std::array<VkSpecializationMapEntry, 2> badLayout = sTestLayout;
+        badLayout[1].offset = sizeof(TestConstants);
+        REQUIRE_THROWS(TestSpecialization::create(badLayout, {VK_FALSE, 0}));
+    }
+}
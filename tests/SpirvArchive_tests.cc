@@ -0,0 +1,60 @@
+#include "catch.hpp"
+#include "utils/SpirvArchive.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> fake_spirv(uint32_t aWordCount, uint32_t aFill){
+    std::vector<uint32_t> words(aWordCount, aFill);
+    words[0] = SpirvArchive::sSpirvMagic;
+    std::vector<uint8_t> bytes(words.size() * sizeof(uint32_t));
+    memcpy(bytes.data(), words.data(), bytes.size());
+    return(bytes);
+}
+
+TEST_CASE("SpirvArchive Tests"){
+    const std::string path = "SpirvArchive_tests.spvpack";
+
+    SECTION("Entries round trip through write and open"){
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> entries = {
+            {"standard.vert", fake_spirv(5, 0xAAAAAAAA)},
+            {"a.frag", fake_spirv(3, 0xBBBBBBBB)}
+        };
+        REQUIRE(SpirvArchive::write(path, entries));
+
+        SpirvArchive archive;
+        REQUIRE(archive.open(path));
+        REQUIRE(archive.getEntryCount() == 2);
+        for(const auto& entry : entries){
+            SpirvArchive::Blob blob = archive.find(entry.first);
+            REQUIRE(blob.code != nullptr);
+            REQUIRE(reinterpret_cast<uintptr_t>(blob.code) % sizeof(uint32_t) == 0);
+            REQUIRE(blob.size == entry.second.size());
+            REQUIRE(memcmp(blob.code, entry.second.data(), blob.size) == 0);
+        }
+        REQUIRE(archive.find("missing.frag").code == nullptr);
+    }
+
+    SECTION("Missing and corrupt archives are rejected"){
+        SpirvArchive archive;
+        REQUIRE_FALSE(archive.open("does_not_exist.spvpack"));
+
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << "definitely not an archive";
+        }
+        REQUIRE_FALSE(archive.open(path));
+        REQUIRE_FALSE(archive.isOpen());
+    }
+
+    SECTION("Blobs that are not SPIR-V are rejected"){
+        std::vector<uint8_t> notSpirv(8, 0);
+        REQUIRE(SpirvArchive::write(path, {{"bad.frag", notSpirv}}));
+        SpirvArchive archive;
+        REQUIRE_FALSE(archive.open(path));
+    }
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "utils/SpscQueue.h"
+#include <memory>
+#include <thread>
+
+TEST_CASE("SpscQueue Tests"){
+
+    SECTION("Values come out in order and a full queue rejects pushes"){
+        SpscQueue<int> queue(3);
+        REQUIRE(queue.capacity() == 4);
+
+        int value = -1;
+        REQUIRE_FALSE(queue.tryPop(value));
+        for(int i = 0; i < 4; ++i) REQUIRE(queue.tryPush(int(i)));
+        REQUIRE_FALSE(queue.tryPush(4));
+        REQUIRE(queue.size() == 4);
+
+        for(int i = 0; i < 4; ++i){
+            REQUIRE(queue.tryPop(value));
+            REQUIRE(value == i);
+        }
+        REQUIRE_FALSE(queue.tryPop(value));
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("Popped slots release what they held"){
+        SpscQueue<std::shared_ptr<int>> queue(2);
+        std::shared_ptr<int> shared = std::make_shared<int>(7);
+        REQUIRE(queue.tryPush(std::shared_ptr<int>(shared)));
+        std::shared_ptr<int> popped;
+        REQUIRE(queue.tryPop(popped));
+        popped = nullptr;
+        REQUIRE(shared.use_count() == 1);
+    }
+
+    SECTION("Concurrent producer delivers every value exactly once"){
+        SpscQueue<uint64_t> queue(16);
+        const uint64_t count = 100000;
+
+        std::thread producer([&queue, count](){
+            for(uint64_t i = 1; i <= count; ++i){
+                while(!queue.tryPush(uint64_t(i))) std::this_thread::yield();
+            }
+        });
+
+        uint64_t expected = 1;
+        uint64_t value = 0;
+        while(expected <= count){
+            if(queue.tryPop(value)){
+                REQUIRE(value == expected);
+                ++expected;
+            }
+        }
+        producer.join();
+        REQUIRE(queue.empty());
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef TEST_MESHES_H_
+#define TEST_MESHES_H_
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Triangulated grid of aSize x aSize quads on the z = 0 plane, facing +z
+inline void make_grid(size_t aSize, std::vector<std::array<float, 3>>& aPositionsOut, std::vector<uint32_t>& aIndicesOut){
+    for(size_t y = 0; y <= aSize; ++y){
+        for(size_t x = 0; x <= aSize; ++x){
+            aPositionsOut.push_back({{static_cast<float>(x), static_cast<float>(y), 0.0f}});
+        }
+    }
+    for(size_t y = 0; y < aSize; ++y){
+        for(size_t x = 0; x < aSize; ++x){
+            uint32_t i0 = static_cast<uint32_t>(y * (aSize + 1) + x);
+            uint32_t i1 = i0 + 1, i2 = i0 + static_cast<uint32_t>(aSize + 1), i3 = i2 + 1;
+            aIndicesOut.insert(aIndicesOut.end(), {i0, i1, i2, i2, i1, i3});
+        }
+    }
+}
+
+// Camera at the origin looking down -z, with a square 90 degree field of view from 0.1 to 100 units
+inline glm::mat4 make_view_projection(){
+    glm::mat4 projection(0.0f);
+    projection[0][0] = 1.0f;
+    projection[1][1] = 1.0f;
+    projection[2][2] = -100.0f / 99.9f;
+    projection[2][3] = -1.0f;
+    projection[3][2] = -100.0f * 0.1f / 99.9f;
+    return(projection);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "catch.hpp"
+#include "utils/TripleBuffer.h"
+#include <thread>
+
+TEST_CASE("TripleBuffer Tests"){
+
+    SECTION("Consumer sees only the latest published value"){
+        TripleBuffer<int> buffer(0);
+        REQUIRE_FALSE(buffer.update());
+        REQUIRE(buffer.getReadBuffer() == 0);
+
+        buffer.getWriteBuffer() = 1;
+        buffer.publish();
+        buffer.getWriteBuffer() = 2;
+        buffer.publish();
+
+        REQUIRE(buffer.hasFreshValue());
+        REQUIRE(buffer.update());
+        REQUIRE(buffer.getReadBuffer() == 2);
+        REQUIRE_FALSE(buffer.update());
+        REQUIRE(buffer.getReadBuffer() == 2);
+    }
+
+    SECTION("Concurrent producer never tears a snapshot"){
+        struct Pair { uint64_t a = 0; uint64_t b = 0; };
+        TripleBuffer<Pair> buffer;
+        const uint64_t count = 100000;
+
+        std::thread producer([&buffer, count](){
+            for(uint64_t i = 1; i <= count; ++i){
+                buffer.getWriteBuffer() = {i, ~i};
+                buffer.publish();
+            }
+        });
+
+        uint64_t last = 0;
+        while(last < count){
+            if(buffer.update()){
+                const Pair& value = buffer.getReadBuffer();
+                REQUIRE(value.b == ~value.a);
+                REQUIRE(value.a > last);
+                last = value.a;
+            }
+        }
+        producer.join();
+    }
+}
@@ -0,0 +1,47 @@
+#include "catch.hpp"
+#include "utils/VertexPacking.h"
+#include <cmath>
+
+TEST_CASE("VertexPacking Tests"){
+
+    SECTION("Positions quantize to within half a step of the bounds"){
+        glm::vec3 min(-2.0f, 0.0f, 1.0f);
+        glm::vec3 max(2.0f, 0.5f, 1.0f); // Flat along z
+        QuantizationTransform transform = make_quantization(min, max);
+        for(int i = 0; i <= 100; ++i){
+            float t = i / 100.0f;
+            glm::vec3 position(min.x + t * 4.0f, min.y + t * 0.5f, 1.0f);
+            std::array<uint16_t, 4> quantized = quantize_position(position, transform);
+            glm::vec3 restored = dequantize_position(quantized.data(), transform);
+            REQUIRE(std::abs(restored.x - position.x) <= 4.0f / 65535.0f);
+            REQUIRE(std::abs(restored.y - position.y) <= 0.5f / 65535.0f);
+            REQUIRE(std::abs(restored.z - position.z) <= 1e-6f);
+        }
+        REQUIRE(quantize_position(min, transform)[0] == 0);
+        REQUIRE(quantize_position(max, transform)[0] == 65535);
+    }
+
+    SECTION("Octahedral normals round trip in every octant"){
+        for(int i = 0; i < 1000; ++i){
+            // Deterministic spread of directions over the sphere
+            float z = 1.0f - 2.0f * (i + 0.5f) / 1000.0f;
+            float angle = i * 2.39996323f;
+            float radius = std::sqrt(1.0f - z * z);
+            glm::vec3 normal(radius * std::cos(angle), radius * std::sin(angle), z);
+
+            std::array<int16_t, 2> encoded = encode_octahedral(normal);
+            glm::vec3 decoded = decode_octahedral(encoded.data());
+            REQUIRE(glm::dot(decoded, normal) > 0.99999f);
+        }
+        std::array<int16_t, 2> down = encode_octahedral(glm::vec3(0.0f, 0.0f, -1.0f));
+        REQUIRE(decode_octahedral(down.data()).z == Approx(-1.0f));
+    }
+
+    SECTION("Colors pack to unsigned normalized bytes"){
+        std::array<uint8_t, 4> color = pack_color(glm::vec4(1.0f, 0.0f, 0.5f, 2.0f));
+        REQUIRE(color[0] == 255);
+        REQUIRE(color[1] == 0);
+        REQUIRE(color[2] == 128);
+        REQUIRE(color[3] == 255);
+    }
+}
@@ -0,0 +1,46 @@
+// Packs compiled SPIR-V files into a single archive that can be memory mapped at startup.
+// Usage: spvpack <output.spvpack> <shader.spv>...
+// Entries are named after the input file without its directory and ".spv" suffix, e.g. "standard.vert".
+
+#include "utils/SpirvArchive.h"
+#include "utils/MappedFile.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+static std::string entry_name(const std::string& aPath){
+    size_t nameStart = aPath.find_last_of("/\\");
+    std::string name = nameStart == std::string::npos ? aPath : aPath.substr(nameStart + 1);
+    const std::string suffix = ".spv";
+    if(name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0){
+        name.resize(name.size() - suffix.size());
+    }
+    return(name);
+}
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cerr << "Usage: " << argv[0] << " <output.spvpack> <shader.spv>..." << std::endl;
+        return(1);
+    }
+
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> entries;
+    for(int i = 2; i < argc; ++i){
+        MappedFile input(argv[i]);
+        if(!input.isValid()){
+            std::cerr << "spvpack: Unable to read '" << argv[i] << "'" << std::endl;
+            return(1);
+        }
+        if(input.size() < sizeof(uint32_t) || input.size() % sizeof(uint32_t) != 0 || reinterpret_cast<const uint32_t*>(input.data())[0] != SpirvArchive::sSpirvMagic){
+            std::cerr << "spvpack: '" << argv[i] << "' is not a SPIR-V module" << std::endl;
+            return(1);
+        }
+        entries.emplace_back(entry_name(argv[i]), std::vector<uint8_t>(input.data(), input.data() + input.size()));
+    }
+
+    if(!SpirvArchive::write(argv[1], entries)){
+        std::cerr << "spvpack: Unable to write '" << argv[1] << "'" << std::endl;
+        return(1);
+    }
+    return(0);
+}